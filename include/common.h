@@ -15,5 +15,17 @@ std::string readFileContents(std::string path) {
     return buffer.str();
 }
 
+// Same as above, but tells a missing file apart from an empty one.
+bool readFileContents(const std::string &path, std::string &contents) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
 
 #endif //PROJECT_BASE_COMMON_H
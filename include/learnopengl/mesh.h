@@ -7,6 +7,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <rg/Frustum.h>
+#include <rg/GlState.h>
 
 #include <string>
 #include <vector>
@@ -35,38 +37,129 @@ struct Texture {
 
 class Mesh {
 public:
-    // mesh Data
-    vector<Vertex>       vertices;
-    vector<unsigned int> indices;
+    // mesh Data, vertices and indices live only in the GL buffers
+    unsigned int         vertexCount = 0;
+    unsigned int         indexCount = 0;
     vector<Texture>      textures;
+    // object space box around the vertices, for culling
+    AABB                 bounds;
 
-    unsigned int VAO;
+    unsigned int VAO = 0;
     std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, uploads straight from the given memory (e.g. a mapped .rgmesh file) and keeps none of it
+    Mesh(const Vertex *vertices, unsigned int vertexCount, const unsigned int *indices, unsigned int indexCount, vector<Texture> textures)
+        : vertexCount(vertexCount), indexCount(indexCount), textures(std::move(textures))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(vertices, indices);
+        setupSamplerNames();
+        bounds = rg::boundsOf(&vertices[0].Position.x, vertexCount, sizeof(Vertex) / sizeof(float));
+    }
+
+    Mesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices, vector<Texture> textures)
+        : Mesh(vertices.data(), vertices.size(), indices.data(), indices.size(), std::move(textures))
+    {
+    }
+
+    // a mesh owns its VAO and buffers, so it can be moved into a model but never copied
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh&& other) noexcept
+        : vertexCount(other.vertexCount), indexCount(other.indexCount), textures(std::move(other.textures)), bounds(other.bounds),
+          VAO(other.VAO), glslIdentifierPrefix(std::move(other.glslIdentifierPrefix)),
+          samplerNames(std::move(other.samplerNames)), samplerHandles(std::move(other.samplerHandles)),
+          samplerPrograms(std::move(other.samplerPrograms)), VBO(other.VBO), EBO(other.EBO)
+    {
+        other.VAO = other.VBO = other.EBO = 0;
+    }
+
+    Mesh& operator=(Mesh&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            vertexCount = other.vertexCount;
+            indexCount = other.indexCount;
+            bounds = other.bounds;
+            textures = std::move(other.textures);
+            glslIdentifierPrefix = std::move(other.glslIdentifierPrefix);
+            samplerNames = std::move(other.samplerNames);
+            samplerHandles = std::move(other.samplerHandles);
+            samplerPrograms = std::move(other.samplerPrograms);
+            VAO = other.VAO;
+            VBO = other.VBO;
+            EBO = other.EBO;
+            other.VAO = other.VBO = other.EBO = 0;
+        }
+        return *this;
+    }
+
+    ~Mesh()
+    {
+        release();
+    }
+
+    void setGlslIdentifierPrefix(const std::string &prefix)
+    {
+        glslIdentifierPrefix = prefix;
+        setupSamplerNames();
+    }
+
+    // Looks up the sampler handles for shader, at load time for every program that will draw the mesh;
+    // Draw only finds them again. A new prefix forgets them.
+    void prepare(const shader &shader)
+    {
+        if (samplerHandlesFor(shader))
+            return;
+        samplerPrograms.push_back(shader.ID);
+        for(size_t i = 0; i < textures.size(); i++)
+            samplerHandles.push_back(shader.uniform(samplerNames[i].c_str()));
     }
 
     // render the mesh
-    void Draw(shader &shader)
+    void Draw(const shader &shader) const
     {
+        const UniformHandle *handles = samplerHandlesFor(shader);
+        ASSERT(handles, "Mesh drawn with program " << shader.ID << " it wasn't prepared for");
         // bind appropriate textures
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            // now set the sampler to the correct texture unit
+            shader.setInt(handles[i], i);
+            // and bind the texture there, unless it already is
+            rg::glState().bindTexture(i, GL_TEXTURE_2D, textures[i].id);
+        }
+
+
+
+        // draw mesh
+        rg::glState().bindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    }
+
+private:
+    // sampler uniform name for every texture, e.g. texture_diffuse1, built once so Draw doesn't allocate
+    vector<string> samplerNames;
+    // one run of textures.size() handles per program in samplerPrograms, so permutations of a shader
+    // can take turns drawing the mesh without looking anything up again
+    vector<UniformHandle> samplerHandles;
+    vector<unsigned int> samplerPrograms;
+    // render data
+    unsigned int VBO = 0, EBO = 0;
+
+    void setupSamplerNames()
+    {
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
+        samplerNames.clear();
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
-            string name = textures[i].type;
+            const string &name = textures[i].type;
             if(name == "texture_diffuse")
                 number = std::to_string(diffuseNr++);
             else if(name == "texture_specular")
@@ -75,46 +168,53 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to stream
             else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplerNames.push_back(glslIdentifierPrefix + name + number);
         }
+        samplerHandles.clear();
+        samplerPrograms.clear();
+    }
 
-
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // nullptr until prepare(shader)
+    const UniformHandle *samplerHandlesFor(const shader &shader) const
+    {
+        size_t count = textures.size();
+        for(size_t p = 0; p < samplerPrograms.size(); p++)
+            if(samplerPrograms[p] == shader.ID)
+                return samplerHandles.data() + p * count;
+        return nullptr;
     }
 
-private:
-    // render data
-    unsigned int VBO, EBO;
+    void release()
+    {
+        if (VAO) {
+            glDeleteVertexArrays(1, &VAO);
+            rg::glState().vertexArrayDeleted(VAO);
+        }
+        if (VBO)
+            glDeleteBuffers(1, &VBO);
+        if (EBO)
+            glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex *vertices, const unsigned int *indices)
     {
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        rg::glState().bindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -133,7 +233,8 @@ private:
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 
-        glBindVertexArray(0);
+        // so the next mesh's element buffer isn't bound into this one
+        rg::glState().bindVertexArray(0);
     }
 };
 #endif
\ No newline at end of file
@@ -6,13 +6,18 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+#include <rg/MappedFile.h>
+#include <rg/MeshFile.h>
+#include <rg/MeshBaker.h>
+#include <rg/TextureLoader.h>
+#include <rg/CompressedTexture.h>
+#include <rg/GlState.h>
+#include <rg/Profiler.h>
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
 
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -23,6 +28,12 @@ using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
 
+// baked vertices are handed to Mesh as they are
+static_assert(sizeof(Vertex) == sizeof(BakedVertex) && offsetof(Vertex, Normal) == offsetof(BakedVertex, normal) &&
+              offsetof(Vertex, TexCoords) == offsetof(BakedVertex, texCoords) &&
+              offsetof(Vertex, Tangent) == offsetof(BakedVertex, tangent) &&
+              offsetof(Vertex, Bitangent) == offsetof(BakedVertex, bitangent), "Vertex must match the baked layout");
+
 
 
 class Model
@@ -31,6 +42,7 @@ public:
     // model data
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    AABB            bounds;     // object space, around every mesh
     string directory;
     bool gammaCorrection;
 
@@ -40,8 +52,29 @@ public:
         loadModel(path);
     }
 
+    // the model owns the textures in textures_loaded (meshes only reference them by id)
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+    Model(Model&&) = default;
+
+    ~Model()
+    {
+        for(const Texture &texture : textures_loaded)
+        {
+            rg::cancelTextureLoad(texture.id);
+            glDeleteTextures(1, &texture.id);
+        }
+    }
+
+    // every program that will draw the model, before it does
+    void prepare(const shader &shader)
+    {
+        for(Mesh &mesh : meshes)
+            mesh.prepare(shader);
+    }
+
     // draws the model, and thus all its meshes
-    void Draw(shader &shader)
+    void Draw(const shader &shader) const
     {
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
@@ -49,170 +82,94 @@ public:
 
     void SetShaderTextureNamePrefix(std::string prefix) {
         for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+            mesh.setGlslIdentifierPrefix(prefix);
         }
     }
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // loads the baked copy next to the file (path + ".rgmesh", made by the mesh_baker tool) when it is up to date,
+    // otherwise any format ASSIMP supports
     void loadModel(string const &path)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
-        }
+        RG_PROFILE_ZONE_DETAIL("load model", path.c_str());
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        auto start = chrono::steady_clock::now();
+        const char *source = "baked file";
+        if (!loadBakedModel(path))
+        {
+            // read file via ASSIMP
+            BakedModel baked;
+            string error;
+            if (!rg::bakeModelFile(path, baked, error))
+            {
+                cout << "ERROR::ASSIMP:: " << error << endl;
+                return;
+            }
+            createMeshes(MeshFileView(baked));
+            source = "ASSIMP";
+        }
+        double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "Model " << path << ": " << meshes.size() << " mesh(es) from " << source << " in " << milliseconds << " ms" << endl;
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    bool loadBakedModel(string const &path)
     {
-        // process each mesh located at the current node
-        for(unsigned int i = 0; i < node->mNumMeshes; i++)
+        string bakedPath = path + MeshFile::EXTENSION;
+        MappedFile file;
+        if (!file.open(bakedPath))
+            return false;
+        MeshFileView view;
+        if (!view.open(file.data(), file.size()))
         {
-            // the node object only contains indices to index the actual objects in the scene.
-            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            cout << "ERROR::MESH_FILE:: " << bakedPath << ": " << view.error() << endl;
+            return false;
         }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-        for(unsigned int i = 0; i < node->mNumChildren; i++)
+        // the source may be left out next to a baked file, but if it is there it must be the one that was baked
+        FileStamp stamp;
+        if (FileStamp::of(path, stamp) && !(stamp == view.source()))
         {
-            processNode(node->mChildren[i], scene);
+            cout << "Model " << path << ": source changed since it was baked, run the bake_meshes target" << endl;
+            return false;
         }
-
+        // the vertex and index blobs are uploaded from the mapping, which is unmapped when we return
+        createMeshes(view);
+        return true;
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // one Mesh per baked mesh, with its material's textures
+    void createMeshes(const MeshFileView &model)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
+        meshes.reserve(model.meshCount());
         vector<Texture> textures;
-
-        // walk through each of the mesh's vertices
-        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
+        for(uint32_t i = 0; i < model.meshCount(); i++)
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
-            }
-            // texture coordinates
-            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
-            {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
-            }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
-
-
+            const MeshFile::MeshRecord &mesh = model.mesh(i);
+            const MeshFile::MaterialRecord &material = model.material(mesh.material);
+            textures.clear();
+            for(uint32_t t = material.firstTexture; t < material.firstTexture + material.textureCount; t++)
+                textures.push_back(loadMaterialTexture(model.texturePath(t), meshTextureTypeName(model.texture(t).type)));
+            meshes.emplace_back(reinterpret_cast<const Vertex*>(model.vertices(mesh)), mesh.vertexCount,
+                                model.indices(mesh), mesh.indexCount, textures);
+            bounds.extend(meshes.back().bounds);
         }
-        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
-        {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
-            for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
-        }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
-        // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
-        // Same applies to other texture as the following list summarizes:
-        // diffuse: texture_diffuseN
-        // specular: texture_specularN
-        // normal: texture_normalN
-        aiColor3D color(0.0f, 0.0f, 0.0f);
-        material->Get(AI_MATKEY_COLOR_AMBIENT, color);
-
-
-        // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-        // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-        // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // returns the texture at path, loading it unless an earlier mesh already did.
+    Texture loadMaterialTexture(const string &path, const string &typeName)
     {
-        vector<Texture> textures;
-        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        for(unsigned int j = 0; j < textures_loaded.size(); j++)
         {
-            aiString str;
-            mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            // a texture with the same filepath has already been loaded (optimization)
+            if(textures_loaded[j].path == path)
+                return textures_loaded[j];
         }
-        return textures;
+        Texture texture;
+        texture.id = TextureFromFile(path.c_str(), this->directory);
+        texture.type = typeName;
+        texture.path = path;
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        return texture;
     }
 };
 
@@ -221,10 +178,25 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
 {
     string filename = string(path);
     filename = directory + '/' + filename;
+    RG_PROFILE_ZONE_DETAIL("load texture", filename.c_str());
 
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
+    // a baked .rgtex next to the image goes up as it is; otherwise, with a loader running, the image is
+    // decoded in the background and a placeholder is shown meanwhile
+    bool baked = rg::loadBakedTexture(textureID, filename, false, rg::flipImagesOnLoad());
+    if (baked || rg::textureLoader())
+    {
+        if (!baked)
+            rg::textureLoader()->request(textureID, filename, false);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return textureID;
+    }
+
     int width, height, nrComponents;
     unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
     if (data)
@@ -237,9 +209,10 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        MipChain chain;
+        rg::buildMipChain(data, width, height, nrComponents, false, chain, std::thread::hardware_concurrency());
+        rg::glState().bindTexture(GL_TEXTURE_2D, textureID);
+        rg::texImageMipChain(chain, format, format, chain.pixels.data());
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
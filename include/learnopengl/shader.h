@@ -9,14 +9,19 @@
 #include <sstream>
 #include <iostream>
 #include <common.h>
+#include <rg/UniformTable.h>
+#include <rg/GlState.h>
+#include <rg/Profiler.h>
 class shader
 {
 public:
     unsigned int ID;
+    UniformTable uniforms;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
     {
+        RG_PROFILE_ZONE_DETAIL("build shader", vertexPath);
         std::string vertexPathString(vertexPath);
         std::string fragmentPathString(fragmentPath);
 
@@ -96,6 +101,7 @@ public:
             glAttachShader(ID, geometry);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        uniforms.build(ID);
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -103,69 +109,153 @@ public:
             glDeleteShader(geometry);
 
     }
+
+    // move-only: the destructor releases the program
+    shader(const shader&) = delete;
+    shader& operator=(const shader&) = delete;
+
+    shader(shader&& other) noexcept : ID(other.ID), uniforms(std::move(other.uniforms))
+    {
+        other.ID = 0;
+    }
+
+    shader& operator=(shader&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (ID)
+            {
+                glDeleteProgram(ID);
+                rg::glState().programDeleted(ID);
+            }
+            ID = other.ID;
+            uniforms = std::move(other.uniforms);
+            other.ID = 0;
+        }
+        return *this;
+    }
+
+    ~shader()
+    {
+        if (ID)
+        {
+            glDeleteProgram(ID);
+            rg::glState().programDeleted(ID);
+        }
+    }
+
     // activate the shader
     // ------------------------------------------------------------------------
-    void use() 
-    { 
-        glUseProgram(ID); 
+    void use() const
+    {
+        rg::glState().useProgram(ID);
+    }
+    // look a uniform up once and keep the handle; every setter takes a handle or a name
+    UniformHandle uniform(const char *name) const
+    {
+        return uniforms.find(name);
+    }
+    // point a uniform block at a binding point (no-op when the program has no such block)
+    void bindUniformBlock(const char *name, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, name);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(ID, index, binding);
+        }
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
-    {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    void setBool(UniformHandle uniform, bool value) const
+    {
+        glUniform1i(uniform.location, (int)value);
+    }
+    void setBool(const char *name, bool value) const
+    {
+        setBool(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
-    { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    void setInt(UniformHandle uniform, int value) const
+    {
+        glUniform1i(uniform.location, value);
+    }
+    void setInt(const char *name, int value) const
+    {
+        setInt(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
-    { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    void setFloat(UniformHandle uniform, float value) const
+    {
+        glUniform1f(uniform.location, value);
+    }
+    void setFloat(const char *name, float value) const
+    {
+        setFloat(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
-    { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    void setVec2(UniformHandle uniform, const glm::vec2 &value) const
+    {
+        glUniform2fv(uniform.location, 1, &value[0]);
+    }
+    void setVec2(const char *name, const glm::vec2 &value) const
+    {
+        setVec2(uniform(name), value);
     }
-    void setVec2(const std::string &name, float x, float y) const
-    { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+    void setVec2(const char *name, float x, float y) const
+    {
+        glUniform2f(uniform(name).location, x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
-    { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    void setVec3(UniformHandle uniform, const glm::vec3 &value) const
+    {
+        glUniform3fv(uniform.location, 1, &value[0]);
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
-    { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+    void setVec3(const char *name, const glm::vec3 &value) const
+    {
+        setVec3(uniform(name), value);
+    }
+    void setVec3(const char *name, float x, float y, float z) const
+    {
+        glUniform3f(uniform(name).location, x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
-    { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    void setVec4(UniformHandle uniform, const glm::vec4 &value) const
+    {
+        glUniform4fv(uniform.location, 1, &value[0]);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) 
-    { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+    void setVec4(const char *name, const glm::vec4 &value) const
+    {
+        setVec4(uniform(name), value);
+    }
+    void setVec4(const char *name, float x, float y, float z, float w) const
+    {
+        glUniform4f(uniform(name).location, x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(UniformHandle uniform, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat2(const char *name, const glm::mat2 &mat) const
+    {
+        setMat2(uniform(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(UniformHandle uniform, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat3(const char *name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(uniform(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(UniformHandle uniform, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(const char *name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(uniform(name), mat);
     }
 
 private:
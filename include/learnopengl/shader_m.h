@@ -9,138 +9,217 @@
 #include <sstream>
 #include <iostream>
 #include <common.h>
+#include <rg/UniformTable.h>
+#include <rg/GlState.h>
+#include <rg/ShaderPreprocessor.h>
+#include <rg/ProgramBinary.h>
+#include <rg/Profiler.h>
 class shader
 {
 public:
     unsigned int ID;
+    UniformTable uniforms;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    shader(const char* vertexPath, const char* fragmentPath)
+    shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines &defines = ShaderDefines())
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-
-        // 1. retrieve the vertex/fragment source code from filePath
+        RG_PROFILE_ZONE_DETAIL("build shader", vertexPath);
+        // 1. retrieve the vertex/fragment source code from filePath, with #includes expanded and defines injected
         std::string vertexCode;
         std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try
+        ShaderPreprocessor preprocessor;
+        if (!preprocessor.process(vertexPath, defines, vertexCode) ||
+            !preprocessor.process(fragmentPath, defines, fragmentCode))
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ\n" << preprocessor.error() << std::endl;
         }
-        catch (std::ifstream::failure& e)
+        // 2. reuse the binary of an earlier run when the sources and the driver are unchanged
+        ProgramBinaryCache::Key cacheKey = rg::programBinaryKey(vertexCode, fragmentCode);
+        ID = glCreateProgram();
+        if (!rg::loadCachedProgram(ID, cacheKey))
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            linkFromSource(vertexCode, fragmentCode);
+            rg::storeCachedProgram(ID, cacheKey);
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        uniforms.build(ID);
+    }
+
+    // programs are GL objects: one owner, moved around but never duplicated
+    shader(const shader&) = delete;
+    shader& operator=(const shader&) = delete;
+
+    shader(shader&& other) noexcept : ID(other.ID), uniforms(std::move(other.uniforms))
+    {
+        other.ID = 0;
+    }
+
+    shader& operator=(shader&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (ID)
+            {
+                glDeleteProgram(ID);
+                rg::glState().programDeleted(ID);
+            }
+            ID = other.ID;
+            uniforms = std::move(other.uniforms);
+            other.ID = 0;
+        }
+        return *this;
+    }
 
+    ~shader()
+    {
+        if (ID)
+        {
+            glDeleteProgram(ID);
+            rg::glState().programDeleted(ID);
+        }
     }
+
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     {
-        glUseProgram(ID);
+        rg::glState().useProgram(ID);
+    }
+    // look a uniform up once and keep the handle; every setter takes a handle or a name
+    UniformHandle uniform(const char *name) const
+    {
+        return uniforms.find(name);
+    }
+    // connect the named uniform block to a GL_UNIFORM_BUFFER binding point, if the program declares it
+    void bindUniformBlock(const char *name, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, name);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(ID, index, binding);
+        }
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(UniformHandle uniform, bool value) const
+    {
+        glUniform1i(uniform.location, (int)value);
+    }
+    void setBool(const char *name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setBool(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(UniformHandle uniform, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(uniform.location, value);
+    }
+    void setInt(const char *name, int value) const
+    {
+        setInt(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(UniformHandle uniform, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(uniform.location, value);
+    }
+    void setFloat(const char *name, float value) const
+    {
+        setFloat(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(UniformHandle uniform, const glm::vec2 &value) const
+    {
+        glUniform2fv(uniform.location, 1, &value[0]);
+    }
+    void setVec2(const char *name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec2(uniform(name), value);
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(const char *name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(uniform(name).location, x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(UniformHandle uniform, const glm::vec3 &value) const
+    {
+        glUniform3fv(uniform.location, 1, &value[0]);
+    }
+    void setVec3(const char *name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec3(uniform(name), value);
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(const char *name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(uniform(name).location, x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(UniformHandle uniform, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(uniform.location, 1, &value[0]);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) const
+    void setVec4(const char *name, const glm::vec4 &value) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        setVec4(uniform(name), value);
+    }
+    void setVec4(const char *name, float x, float y, float z, float w) const
+    {
+        glUniform4f(uniform(name).location, x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(UniformHandle uniform, const glm::mat2 &mat) const
+    {
+        glUniformMatrix2fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat2(const char *name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(uniform(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(UniformHandle uniform, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat3(const char *name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(uniform(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(UniformHandle uniform, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(const char *name, const glm::mat4 &mat) const
+    {
+        setMat4(uniform(name), mat);
     }
 
 private:
+    // compile both stages and link them into ID
+    // ------------------------------------------------------------------------
+    void linkFromSource(const std::string &vertexCode, const std::string &fragmentCode)
+    {
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+        unsigned int vertex, fragment;
+        // vertex shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+        // fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+        // shader Program
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        rg::markProgramRetrievable(ID);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
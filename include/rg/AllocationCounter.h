@@ -0,0 +1,85 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_ALLOCATIONCOUNTER_H
+#define PROJECT_BASE_ALLOCATIONCOUNTER_H
+
+#include <cstdlib>
+#include <new>
+#include <rg/Error.h>
+
+// Debug heap allocation counter. Configure with -DRG_COUNT_ALLOCATIONS=ON to replace the global
+// operator new and have every steady-state frame assert that it did no heap allocations.
+// Include this header from exactly one translation unit (it defines the replacement operators).
+
+namespace rg {
+
+    // per thread: a frame is checked on the render thread, worker threads allocate as they please
+    thread_local unsigned long g_heapAllocations = 0;
+
+    unsigned long heapAllocationCount() {
+        return g_heapAllocations;
+    }
+
+    // Checks the number of allocations done between construction and destruction.
+    // The first few frames are allowed to allocate (lazy driver/static initialisation).
+    class FrameAllocationCheck {
+        unsigned long m_frame;
+        unsigned long m_start;
+    public:
+        static constexpr unsigned long WARMUP_FRAMES = 3;
+
+        explicit FrameAllocationCheck(unsigned long frame)
+        : m_frame(frame), m_start(heapAllocationCount()) {}
+
+        ~FrameAllocationCheck() {
+            unsigned long allocations = heapAllocationCount() - m_start;
+            ASSERT(m_frame < WARMUP_FRAMES || allocations == 0,
+                   "Frame " << m_frame << " did " << allocations << " heap allocation(s), steady-state frames must do none");
+        }
+    };
+};
+
+#ifdef RG_COUNT_ALLOCATIONS
+
+void* operator new(std::size_t size) {
+    ++rg::g_heapAllocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++rg::g_heapAllocations;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+#endif
+
+#endif //PROJECT_BASE_ALLOCATIONCOUNTER_H
@@ -0,0 +1,150 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_BENCHMARK_H
+#define PROJECT_BASE_BENCHMARK_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// --benchmark[=PREFIX]: the camera flies a scripted path instead of following the input, the scene's
+// clock advances a fixed step a frame, and the rocks are laid out from a fixed seed, so every run draws
+// the same frames. A warm-up of the path's first frames comes before the measured flight, which writes
+// every frame to PREFIX.csv and the statistics to PREFIX.json.
+struct BenchmarkOptions {
+    bool enabled = false;
+    std::string prefix = "benchmark";
+    unsigned long warmupFrames = 120;
+    // of the scene's clock, per frame
+    double step = 1.0 / 60.0;
+    // rand()'s seed for the rock field, for any run; a benchmark without one uses 1, a replay its
+    // recording's, others the clock
+    long seed = -1;
+};
+
+struct BenchmarkFrame {
+    double seconds = 0.0;
+    unsigned draws = 0;
+    uint64_t triangles = 0;
+};
+
+// The frames of one benchmark: warmupFrames, then frames measured ones, then the few it takes for the
+// last measured frame's triangle count to come back.
+class BenchmarkRun {
+public:
+    BenchmarkRun(const BenchmarkOptions &options, unsigned long frames, unsigned triangleLatency)
+    : m_options(options), m_frames(frames), m_triangleLatency(triangleLatency) {
+        m_samples.resize(frames);
+    }
+
+    // The scene's clock this frame, step a frame from the first.
+    double time() const {
+        return m_frame * m_options.step;
+    }
+    // Where on the camera path this frame is: from 0 through the warm-up, and again from 0 for the
+    // measured frames.
+    double pathTime() const {
+        unsigned long frame = m_frame < m_options.warmupFrames ? m_frame : m_frame - m_options.warmupFrames;
+        return frame * m_options.step;
+    }
+    bool finished() const {
+        return m_frame >= m_options.warmupFrames + m_frames + m_triangleLatency;
+    }
+
+    // draws are the GL draw calls the render queue made this frame, triangles what it counted
+    // m_triangleLatency frames ago; the GL calls themselves go straight to the driver
+    void endFrame(double seconds, unsigned draws, uint64_t triangles) {
+        long measured = (long)m_frame - (long)m_options.warmupFrames;
+        if (measured >= 0 && measured < (long)m_frames) {
+            m_samples[measured].seconds = seconds;
+            m_samples[measured].draws = draws;
+        }
+        long counted = measured - (long)m_triangleLatency;
+        if (counted >= 0 && counted < (long)m_frames) {
+            m_samples[counted].triangles = triangles;
+        }
+        ++m_frame;
+    }
+
+    // PREFIX.csv and PREFIX.json, and the summary on the console; renderer and build label the results.
+    bool write(const std::string &renderer, const std::string &build) const {
+        std::vector<double> sorted(m_samples.size());
+        double total = 0.0;
+        uint64_t draws = 0, triangles = 0, maxDraws = 0, maxTriangles = 0;
+        for (size_t i = 0; i < m_samples.size(); ++i) {
+            sorted[i] = m_samples[i].seconds * 1000.0;
+            total += sorted[i];
+            draws += m_samples[i].draws;
+            triangles += m_samples[i].triangles;
+            maxDraws = std::max<uint64_t>(maxDraws, m_samples[i].draws);
+            maxTriangles = std::max(maxTriangles, m_samples[i].triangles);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        double count = sorted.empty() ? 1.0 : (double)sorted.size();
+        double mean = total / count, p50 = percentile(sorted, 0.50), p95 = percentile(sorted, 0.95),
+               p99 = percentile(sorted, 0.99), longest = sorted.empty() ? 0.0 : sorted.back();
+
+        std::string csvPath = m_options.prefix + ".csv", jsonPath = m_options.prefix + ".json";
+        std::ofstream csv(csvPath, std::ios::trunc);
+        std::ofstream json(jsonPath, std::ios::trunc);
+        if (!csv || !json) {
+            std::cout << "ERROR::BENCHMARK::CANNOT_WRITE " << (csv ? jsonPath : csvPath) << std::endl;
+            return false;
+        }
+        csv << "frame,time_ms,draws,triangles\n";
+        for (size_t i = 0; i < m_samples.size(); ++i) {
+            csv << i << "," << m_samples[i].seconds * 1000.0 << "," << m_samples[i].draws << "," << m_samples[i].triangles << "\n";
+        }
+        json << "{\n"
+             << "  \"renderer\": \"" << escaped(renderer) << "\",\n"
+             << "  \"build\": \"" << escaped(build) << "\",\n"
+             << "  \"seed\": " << m_options.seed << ",\n"
+             << "  \"step\": " << m_options.step << ",\n"
+             << "  \"warmup_frames\": " << m_options.warmupFrames << ",\n"
+             << "  \"frames\": " << m_samples.size() << ",\n"
+             << "  \"frame_ms\": {\"mean\": " << mean << ", \"p50\": " << p50 << ", \"p95\": " << p95
+             << ", \"p99\": " << p99 << ", \"max\": " << longest << "},\n"
+             << "  \"draws\": {\"mean\": " << draws / count << ", \"max\": " << maxDraws << "},\n"
+             << "  \"triangles\": {\"mean\": " << triangles / count << ", \"max\": " << maxTriangles << "}\n"
+             << "}\n";
+
+        std::cout << "benchmark: " << m_samples.size() << " frames, frame time mean " << mean << " ms, p50 " << p50
+                  << " ms, p95 " << p95 << " ms, p99 " << p99 << " ms, max " << longest << " ms, "
+                  << draws / count << " draws and " << triangles / count << " triangles a frame on " << renderer
+                  << ", written to " << csvPath << " and " << jsonPath << std::endl;
+        return bool(csv) && bool(json);
+    }
+
+private:
+    BenchmarkOptions m_options;
+    unsigned long m_frames;
+    unsigned m_triangleLatency;
+    unsigned long m_frame = 0;
+    std::vector<BenchmarkFrame> m_samples;
+
+    // nearest rank
+    static double percentile(const std::vector<double> &sorted, double fraction) {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        return sorted[std::min(sorted.size() - 1, (size_t)(fraction * (sorted.size() - 1) + 0.5))];
+    }
+
+    static std::string escaped(const std::string &text) {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result;
+    }
+};
+
+#endif //PROJECT_BASE_BENCHMARK_H
@@ -0,0 +1,444 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_BLOCKCOMPRESSION_H
+#define PROJECT_BASE_BLOCKCOMPRESSION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// CPU encoder and decoder for the block compressed formats every desktop GL driver samples directly:
+//   BC1  RGB, 8 bytes per 4x4 block (S3TC DXT1)
+//   BC3  RGBA, BC1 color plus a BC4 alpha block (S3TC DXT5)
+//   BC4  one channel, red (RGTC1)
+//   BC5  two channels, red and green (RGTC2)
+// Images are RGBA8 on the way in and out, whatever the format keeps. No GL: the baker encodes with
+// this, and decodes its own output to measure the error.
+
+enum BlockFormat : uint32_t {
+    BLOCK_BC1 = 1,
+    BLOCK_BC3 = 3,
+    BLOCK_BC4 = 4,
+    BLOCK_BC5 = 5
+};
+
+namespace rg {
+
+    bool isBlockFormat(uint32_t format) {
+        return format == BLOCK_BC1 || format == BLOCK_BC3 || format == BLOCK_BC4 || format == BLOCK_BC5;
+    }
+
+    size_t blockBytes(uint32_t format) {
+        return format == BLOCK_BC1 || format == BLOCK_BC4 ? 8 : 16;
+    }
+
+    // How many of the RGBA channels survive, from red on.
+    unsigned blockChannels(uint32_t format) {
+        switch (format) {
+            case BLOCK_BC1: return 3;
+            case BLOCK_BC3: return 4;
+            case BLOCK_BC4: return 1;
+            default: return 2;
+        }
+    }
+
+    size_t compressedSize(uint32_t format, unsigned width, unsigned height) {
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+    }
+
+    // --- BC1 color block ------------------------------------------------------------------------------
+
+    uint16_t packColor565(const float* color) {
+        int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+        int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+        int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    void unpackColor565(uint16_t packed, int* color) {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // The four colors of a block whose first endpoint is the larger one.
+    void colorPalette(uint16_t c0, uint16_t c1, int palette[4][3]) {
+        unpackColor565(c0, palette[0]);
+        unpackColor565(c1, palette[1]);
+        for (int i = 0; i < 3; ++i) {
+            palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+            palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+        }
+    }
+
+    // Picks the nearest palette entry for every pixel, returns the packed indices and the squared error.
+    uint32_t colorIndices(const uint8_t* rgba, uint16_t c0, uint16_t c1, long &error) {
+        int palette[4][3];
+        colorPalette(c0, c1, palette);
+        uint32_t indices = 0;
+        error = 0;
+        for (int p = 0; p < 16; ++p) {
+            long best = -1;
+            uint32_t bestIndex = 0;
+            for (uint32_t i = 0; i < 4; ++i) {
+                long d = 0;
+                for (int c = 0; c < 3; ++c) {
+                    long diff = (long)rgba[p * 4 + c] - palette[i][c];
+                    d += diff * diff;
+                }
+                if (best < 0 || d < best) {
+                    best = d;
+                    bestIndex = i;
+                }
+            }
+            indices |= bestIndex << (2 * p);
+            error += best;
+        }
+        return indices;
+    }
+
+    void writeColorBlock(uint16_t c0, uint16_t c1, uint32_t indices, uint8_t* out) {
+        out[0] = (uint8_t)(c0 & 0xFF);
+        out[1] = (uint8_t)(c0 >> 8);
+        out[2] = (uint8_t)(c1 & 0xFF);
+        out[3] = (uint8_t)(c1 >> 8);
+        for (int i = 0; i < 4; ++i) {
+            out[4 + i] = (uint8_t)(indices >> (8 * i));
+        }
+    }
+
+    // Endpoints from the extremes along the principal axis of the block's colors, then one least squares
+    // pass that refits them to the chosen indices.
+    void encodeColorBlock(const uint8_t* rgba, uint8_t* out) {
+        float mean[3] = {0, 0, 0};
+        for (int p = 0; p < 16; ++p) {
+            for (int c = 0; c < 3; ++c) {
+                mean[c] += rgba[p * 4 + c] / 16.0f;
+            }
+        }
+        float cov[6] = {0, 0, 0, 0, 0, 0};
+        for (int p = 0; p < 16; ++p) {
+            float r = rgba[p * 4] - mean[0], g = rgba[p * 4 + 1] - mean[1], b = rgba[p * 4 + 2] - mean[2];
+            cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+            cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+        }
+        float axis[3] = {1.0f, 1.0f, 1.0f};
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+            float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+            float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+            float length = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+            if (length < 1e-6f) {
+                break;
+            }
+            axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+        }
+        float lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+        float lowest = 0, highest = 0;
+        for (int p = 0; p < 16; ++p) {
+            float t = ((rgba[p * 4] - mean[0]) * axis[0] + (rgba[p * 4 + 1] - mean[1]) * axis[1] +
+                       (rgba[p * 4 + 2] - mean[2]) * axis[2]) / lengthSquared;
+            lowest = std::min(lowest, t);
+            highest = std::max(highest, t);
+        }
+        float high[3], low[3];
+        for (int c = 0; c < 3; ++c) {
+            high[c] = mean[c] + axis[c] * highest;
+            low[c] = mean[c] + axis[c] * lowest;
+        }
+
+        uint16_t c0 = packColor565(high), c1 = packColor565(low);
+        if (c0 < c1) {
+            std::swap(c0, c1);
+        }
+        if (c0 == c1) {
+            // flat block, in 3 color mode index 0 is still c0
+            writeColorBlock(c0, c1, 0, out);
+            return;
+        }
+        long error;
+        uint32_t indices = colorIndices(rgba, c0, c1, error);
+
+        // weights of the endpoints for indices 0..3
+        static const float w0[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0, ab = 0, bb = 0, ax[3] = {0, 0, 0}, bx[3] = {0, 0, 0};
+        for (int p = 0; p < 16; ++p) {
+            float a = w0[(indices >> (2 * p)) & 3], b = 1.0f - a;
+            aa += a * a; ab += a * b; bb += b * b;
+            for (int c = 0; c < 3; ++c) {
+                ax[c] += a * rgba[p * 4 + c];
+                bx[c] += b * rgba[p * 4 + c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) > 1e-6f) {
+            float refined0[3], refined1[3];
+            for (int c = 0; c < 3; ++c) {
+                refined0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                refined1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+            }
+            uint16_t r0 = packColor565(refined0), r1 = packColor565(refined1);
+            if (r0 < r1) {
+                std::swap(r0, r1);
+            }
+            if (r0 != r1) {
+                long refinedError;
+                uint32_t refinedIndices = colorIndices(rgba, r0, r1, refinedError);
+                if (refinedError < error) {
+                    c0 = r0;
+                    c1 = r1;
+                    indices = refinedIndices;
+                }
+            }
+        }
+        writeColorBlock(c0, c1, indices, out);
+    }
+
+    void decodeColorBlock(const uint8_t* block, uint8_t* rgba) {
+        uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8)), c1 = (uint16_t)(block[2] | (block[3] << 8));
+        int palette[4][4];
+        unpackColor565(c0, palette[0]);
+        unpackColor565(c1, palette[1]);
+        palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+        for (int i = 0; i < 3; ++i) {
+            if (c0 > c1) {
+                palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+                palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+            } else {
+                palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+                palette[3][i] = 0;
+            }
+        }
+        if (c0 <= c1) {
+            palette[3][3] = 0;
+        }
+        uint32_t indices = (uint32_t)block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+        for (int p = 0; p < 16; ++p) {
+            const int* color = palette[(indices >> (2 * p)) & 3];
+            for (int c = 0; c < 4; ++c) {
+                rgba[p * 4 + c] = (uint8_t)color[c];
+            }
+        }
+    }
+
+    // --- BC4 single channel block ---------------------------------------------------------------------
+
+    void channelPalette(int v0, int v1, int palette[8]) {
+        palette[0] = v0;
+        palette[1] = v1;
+        if (v0 > v1) {
+            for (int i = 2; i < 8; ++i) {
+                palette[i] = ((8 - i) * v0 + (i - 1) * v1) / 7;
+            }
+        } else {
+            for (int i = 2; i < 6; ++i) {
+                palette[i] = ((6 - i) * v0 + (i - 1) * v1) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    // Encodes channel `channel` of the 16 RGBA pixels. Always the 8 value mode, between the block's extremes.
+    void encodeChannelBlock(const uint8_t* rgba, int channel, uint8_t* out) {
+        int highest = 0, lowest = 255;
+        for (int p = 0; p < 16; ++p) {
+            highest = std::max(highest, (int)rgba[p * 4 + channel]);
+            lowest = std::min(lowest, (int)rgba[p * 4 + channel]);
+        }
+        int palette[8];
+        channelPalette(highest, lowest, palette);
+        uint64_t indices = 0;
+        if (highest != lowest) {
+            for (int p = 0; p < 16; ++p) {
+                int value = rgba[p * 4 + channel];
+                uint64_t bestIndex = 0;
+                int best = 256;
+                for (int i = 0; i < 8; ++i) {
+                    int d = std::abs(value - palette[i]);
+                    if (d < best) {
+                        best = d;
+                        bestIndex = (uint64_t)i;
+                    }
+                }
+                indices |= bestIndex << (3 * p);
+            }
+        }
+        out[0] = (uint8_t)highest;
+        out[1] = (uint8_t)lowest;
+        for (int i = 0; i < 6; ++i) {
+            out[2 + i] = (uint8_t)(indices >> (8 * i));
+        }
+    }
+
+    void decodeChannelBlock(const uint8_t* block, uint8_t* rgba, int channel) {
+        int palette[8];
+        channelPalette(block[0], block[1], palette);
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; ++i) {
+            indices |= (uint64_t)block[2 + i] << (8 * i);
+        }
+        for (int p = 0; p < 16; ++p) {
+            rgba[p * 4 + channel] = (uint8_t)palette[(indices >> (3 * p)) & 7];
+        }
+    }
+
+    // --- blocks and images ----------------------------------------------------------------------------
+
+    void encodeBlock(uint32_t format, const uint8_t* rgba, uint8_t* out) {
+        switch (format) {
+            case BLOCK_BC1:
+                encodeColorBlock(rgba, out);
+                break;
+            case BLOCK_BC3:
+                encodeChannelBlock(rgba, 3, out);
+                encodeColorBlock(rgba, out + 8);
+                break;
+            case BLOCK_BC4:
+                encodeChannelBlock(rgba, 0, out);
+                break;
+            case BLOCK_BC5:
+                encodeChannelBlock(rgba, 0, out);
+                encodeChannelBlock(rgba, 1, out + 8);
+                break;
+        }
+    }
+
+    // Channels the format drops come out as 0 (green, blue) and 255 (alpha), as GL samples them.
+    void decodeBlock(uint32_t format, const uint8_t* block, uint8_t* rgba) {
+        for (int p = 0; p < 16; ++p) {
+            rgba[p * 4] = rgba[p * 4 + 1] = rgba[p * 4 + 2] = 0;
+            rgba[p * 4 + 3] = 255;
+        }
+        switch (format) {
+            case BLOCK_BC1:
+                decodeColorBlock(block, rgba);
+                break;
+            case BLOCK_BC3:
+                decodeColorBlock(block + 8, rgba);
+                decodeChannelBlock(block, rgba, 3);
+                break;
+            case BLOCK_BC4:
+                decodeChannelBlock(block, rgba, 0);
+                break;
+            case BLOCK_BC5:
+                decodeChannelBlock(block, rgba, 0);
+                decodeChannelBlock(block + 8, rgba, 1);
+                break;
+        }
+    }
+
+    // Whole RGBA8 image; blocks hanging over the right or bottom edge repeat the last column/row.
+    void compressImage(uint32_t format, const uint8_t* rgba, unsigned width, unsigned height, uint8_t* out) {
+        uint8_t block[64];
+        for (unsigned by = 0; by < height; by += 4) {
+            for (unsigned bx = 0; bx < width; bx += 4) {
+                for (unsigned y = 0; y < 4; ++y) {
+                    for (unsigned x = 0; x < 4; ++x) {
+                        unsigned sx = std::min(bx + x, width - 1), sy = std::min(by + y, height - 1);
+                        std::memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+                    }
+                }
+                encodeBlock(format, block, out);
+                out += blockBytes(format);
+            }
+        }
+    }
+
+    void decompressImage(uint32_t format, const uint8_t* blocks, unsigned width, unsigned height, uint8_t* rgba) {
+        uint8_t block[64];
+        for (unsigned by = 0; by < height; by += 4) {
+            for (unsigned bx = 0; bx < width; bx += 4) {
+                decodeBlock(format, blocks, block);
+                blocks += blockBytes(format);
+                for (unsigned y = 0; y < 4 && by + y < height; ++y) {
+                    for (unsigned x = 0; x < 4 && bx + x < width; ++x) {
+                        std::memcpy(rgba + ((size_t)(by + y) * width + bx + x) * 4, block + (y * 4 + x) * 4, 4);
+                    }
+                }
+            }
+        }
+    }
+
+    // --- vertical flip --------------------------------------------------------------------------------
+
+    void flipColorRows(uint8_t* block, unsigned rows) {
+        std::reverse(block + 4, block + 4 + rows);
+    }
+
+    void flipChannelRows(uint8_t* block, unsigned rows) {
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; ++i) {
+            indices |= (uint64_t)block[2 + i] << (8 * i);
+        }
+        uint64_t flipped = indices;
+        for (unsigned row = 0; row < rows; ++row) {
+            uint64_t bits = (indices >> (12 * (rows - 1 - row))) & 0xFFF;
+            flipped = (flipped & ~((uint64_t)0xFFF << (12 * row))) | (bits << (12 * row));
+        }
+        for (int i = 0; i < 6; ++i) {
+            block[2 + i] = (uint8_t)(flipped >> (8 * i));
+        }
+    }
+
+    // Mirrors a compressed level top to bottom without decoding it: block rows swap places and the pixel
+    // rows inside every block are reversed. Not possible when the height is above 4 and not a multiple
+    // of 4 (the padding would move to the top), then it returns false.
+    bool flipCompressedLevel(uint32_t format, const uint8_t* in, unsigned width, unsigned height, uint8_t* out) {
+        if (height > 4 && height % 4 != 0) {
+            return false;
+        }
+        unsigned rows = std::min(height, 4u);
+        size_t rowBytes = (size_t)((width + 3) / 4) * blockBytes(format);
+        unsigned blockRows = (height + 3) / 4;
+        for (unsigned by = 0; by < blockRows; ++by) {
+            uint8_t* row = out + (size_t)by * rowBytes;
+            std::memcpy(row, in + (size_t)(blockRows - 1 - by) * rowBytes, rowBytes);
+            for (uint8_t* block = row; block < row + rowBytes; block += blockBytes(format)) {
+                switch (format) {
+                    case BLOCK_BC1:
+                        flipColorRows(block, rows);
+                        break;
+                    case BLOCK_BC3:
+                        flipChannelRows(block, rows);
+                        flipColorRows(block + 8, rows);
+                        break;
+                    case BLOCK_BC4:
+                        flipChannelRows(block, rows);
+                        break;
+                    case BLOCK_BC5:
+                        flipChannelRows(block, rows);
+                        flipChannelRows(block + 8, rows);
+                        break;
+                }
+            }
+        }
+        return true;
+    }
+
+    // --- error ----------------------------------------------------------------------------------------
+
+    // Peak signal to noise ratio in dB over the first `channels` channels of two RGBA8 images.
+    // Identical images give 99.
+    double psnr(const uint8_t* a, const uint8_t* b, size_t pixelCount, unsigned channels) {
+        double sum = 0;
+        for (size_t p = 0; p < pixelCount; ++p) {
+            for (unsigned c = 0; c < channels; ++c) {
+                double diff = (double)a[p * 4 + c] - b[p * 4 + c];
+                sum += diff * diff;
+            }
+        }
+        if (sum == 0) {
+            return 99.0;
+        }
+        double mse = sum / ((double)pixelCount * channels);
+        return 10.0 * std::log10(255.0 * 255.0 / mse);
+    }
+};
+
+#endif //PROJECT_BASE_BLOCKCOMPRESSION_H
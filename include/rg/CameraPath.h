@@ -0,0 +1,67 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_CAMERAPATH_H
+#define PROJECT_BASE_CAMERAPATH_H
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+struct CameraPose {
+    glm::vec3 position;
+    // unit length
+    glm::vec3 front;
+};
+
+struct CameraKey {
+    glm::vec3 position;
+    // the point the camera looks at
+    glm::vec3 target;
+};
+
+// A camera flight through keys a fixed time apart: the position and the point looked at each follow a
+// Catmull-Rom spline, which passes through every key. A pose depends on nothing but the time, so two
+// runs that sample the same times see the same frames.
+class CameraPath {
+public:
+    CameraPath(std::vector<CameraKey> keys, float secondsPerKey)
+    : m_keys(std::move(keys)), m_secondsPerKey(secondsPerKey) {}
+
+    float duration() const {
+        return m_keys.size() > 1 ? (m_keys.size() - 1) * m_secondsPerKey : 0.0f;
+    }
+
+    // Clamped to the ends outside [0, duration()].
+    CameraPose sample(double seconds) const {
+        float t = (float)std::max(0.0, std::min<double>(seconds, duration())) / m_secondsPerKey;
+        int last = (int)m_keys.size() - 1;
+        int segment = std::min((int)t, std::max(last - 1, 0));
+        float s = t - segment;
+        CameraPose pose;
+        pose.position = point(segment, s, &CameraKey::position);
+        glm::vec3 target = point(segment, s, &CameraKey::target);
+        pose.front = glm::normalize(target - pose.position);
+        return pose;
+    }
+
+private:
+    std::vector<CameraKey> m_keys;
+    float m_secondsPerKey;
+
+    // between keys segment and segment + 1; the ends stand in for the keys beyond them
+    glm::vec3 point(int segment, float s, glm::vec3 CameraKey::*member) const {
+        int last = (int)m_keys.size() - 1;
+        const glm::vec3 &p0 = m_keys[std::max(segment - 1, 0)].*member;
+        const glm::vec3 &p1 = m_keys[std::min(segment, last)].*member;
+        const glm::vec3 &p2 = m_keys[std::min(segment + 1, last)].*member;
+        const glm::vec3 &p3 = m_keys[std::min(segment + 2, last)].*member;
+        float s2 = s * s, s3 = s2 * s;
+        return 0.5f * (2.0f * p1 + (p2 - p0) * s + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * s2 +
+                       (3.0f * p1 - p0 - 3.0f * p2 + p3) * s3);
+    }
+};
+
+#endif //PROJECT_BASE_CAMERAPATH_H
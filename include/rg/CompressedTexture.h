@@ -0,0 +1,97 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_COMPRESSEDTEXTURE_H
+#define PROJECT_BASE_COMPRESSEDTEXTURE_H
+
+#include <glad/glad.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <rg/GlExtensions.h>
+#include <rg/GlState.h>
+#include <rg/TextureFile.h>
+
+// GL side of the baked texture format. BC4/BC5 (RGTC) are core since 3.0, BC1/BC3 need S3TC and
+// their sRGB variants EXT_texture_sRGB; glad loads neither, so the enums are defined here.
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace rg {
+
+    // 0 when the context can't sample the format.
+    GLenum compressedInternalFormat(uint32_t format, bool srgb) {
+        static const bool s3tc = hasGlExtension("GL_EXT_texture_compression_s3tc");
+        static const bool s3tcSrgb = s3tc && (hasGlExtension("GL_EXT_texture_sRGB") ||
+                                              hasGlExtension("GL_EXT_texture_compression_s3tc_srgb"));
+        switch (format) {
+            case BLOCK_BC1:
+                return !s3tc ? 0 : !srgb ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : s3tcSrgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : 0;
+            case BLOCK_BC3:
+                return !s3tc ? 0 : !srgb ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : s3tcSrgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : 0;
+            case BLOCK_BC4:
+                return GL_COMPRESSED_RED_RGTC1;
+            case BLOCK_BC5:
+                return GL_COMPRESSED_RG_RGTC2;
+        }
+        return 0;
+    }
+
+    // Uploads <imagePath>.rgtex into texture, all levels as they are stored. Returns false, and leaves
+    // the texture alone, when there is no usable baked file; the caller then decodes the image itself.
+    // srgb and flip mean what they mean for the image: the sRGB format, and rows bottom up.
+    bool loadBakedTexture(GLuint texture, const std::string &imagePath, bool srgb, bool flip) {
+        std::string bakedPath = imagePath + TextureFile::EXTENSION;
+        MappedFile file;
+        if (!file.open(bakedPath)) {
+            return false;
+        }
+        TextureFileView view;
+        if (!view.open(file.data(), file.size())) {
+            std::cout << "ERROR::TEXTURE_FILE:: " << bakedPath << ": " << view.error() << std::endl;
+            return false;
+        }
+        FileStamp stamp;
+        if (FileStamp::of(imagePath, stamp) && !(stamp == view.source())) {
+            std::cout << "Texture " << imagePath << ": image changed since it was baked, run the bake_textures target" << std::endl;
+            return false;
+        }
+        GLenum internalFormat = compressedInternalFormat(view.header().format, srgb);
+        if (!internalFormat) {
+            return false;
+        }
+
+        // baked the other way up: blocks can be flipped without decoding, unless a level's height rules it out
+        bool flipLevels = view.flipped() != flip;
+        std::vector<std::vector<uint8_t>> flipped(flipLevels ? view.levelCount() : 0);
+        for (uint32_t i = 0; i < flipped.size(); ++i) {
+            const TextureFile::Level &level = view.level(i);
+            flipped[i].resize(level.size);
+            if (!flipCompressedLevel(view.header().format, view.levelData(i), level.width, level.height, flipped[i].data())) {
+                std::cout << "Texture " << imagePath << ": baked " << (view.flipped() ? "flipped" : "unflipped")
+                          << " and level " << i << " can't be turned, rebake it " << (flip ? "with" : "without") << " --flip" << std::endl;
+                return false;
+            }
+        }
+
+        rg::glState().bindTexture(GL_TEXTURE_2D, texture);
+        for (uint32_t i = 0; i < view.levelCount(); ++i) {
+            const TextureFile::Level &level = view.level(i);
+            const uint8_t* data = flipLevels ? flipped[i].data() : view.levelData(i);
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, level.width, level.height, 0, (GLsizei)level.size, data);
+        }
+        // a chain cut short must not leave the texture incomplete for mipmapped filters
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)view.levelCount() - 1);
+        return true;
+    }
+};
+
+#endif //PROJECT_BASE_COMPRESSEDTEXTURE_H
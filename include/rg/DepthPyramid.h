@@ -0,0 +1,156 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_DEPTHPYRAMID_H
+#define PROJECT_BASE_DEPTHPYRAMID_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <rg/GlState.h>
+#include <rg/Profiler.h>
+#include <rg/ProgramBuilder.h>
+
+// Hierarchical depth buffer for occlusion culling: the scene framebuffer's depth after a frame, and
+// mip levels that each keep the farthest depth of the 2x2 (3x3 at odd edges) texels under them. The
+// next frame's culling compares a bounding sphere's nearest depth against it, through the camera
+// the pyramid was built with.
+class DepthPyramid {
+public:
+    explicit DepthPyramid(const std::string &shaderDirectory) {
+        m_program = rg::buildProgram({{GL_VERTEX_SHADER, shaderDirectory + "/depth_pyramid.vert"},
+                                      {GL_FRAGMENT_SHADER, shaderDirectory + "/depth_pyramid.frag"}});
+        m_sourceLevel = glGetUniformLocation(m_program, "sourceLevel");
+        glGenVertexArrays(1, &m_emptyVAO);
+        glGenTextures(1, &m_texture);
+    }
+
+    DepthPyramid(const DepthPyramid&) = delete;
+    DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+    ~DepthPyramid() {
+        if (!m_framebuffers.empty()) {
+            glDeleteFramebuffers((GLsizei)m_framebuffers.size(), m_framebuffers.data());
+        }
+        glDeleteTextures(1, &m_texture);
+        rg::glState().textureDeleted(m_texture);
+        glDeleteVertexArrays(1, &m_emptyVAO);
+        rg::glState().vertexArrayDeleted(m_emptyVAO);
+        glDeleteProgram(m_program);
+        rg::glState().programDeleted(m_program);
+    }
+
+    // After the frame's geometry, before the swap. viewProjection is the camera the frame was drawn with,
+    // sceneFramebuffer what it was drawn into (0, the window, or an OffscreenTarget); it is bound again
+    // afterwards.
+    void build(int width, int height, const glm::mat4 &viewProjection, GLuint sceneFramebuffer = 0) {
+        RG_PROFILE_GPU_ZONE("depth pyramid");
+        if (!m_program || width <= 0 || height <= 0) {
+            m_levels = 0;
+            return;
+        }
+        if (width != m_width || height != m_height) {
+            resize(width, height);
+        }
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffers[0]);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        rg::glState().useProgram(m_program);
+        glUniform1i(m_sourceLevel, 0);
+        // the level parameters below go to the active unit's texture
+        rg::glState().activeTexture(GL_TEXTURE0);
+        rg::glState().bindTexture(GL_TEXTURE_2D, m_texture);
+        rg::glState().bindVertexArray(m_emptyVAO);
+        glDepthFunc(GL_ALWAYS);
+        rg::glState().disable(GL_CULL_FACE);
+        for (int level = 1; level < m_levels; ++level) {
+            // only the level above is readable while this one is written
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+            glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[level]);
+            glViewport(0, 0, levelWidth(level), levelHeight(level));
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+
+        glDepthFunc(GL_LESS);
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        m_viewProjection = viewProjection;
+    }
+
+    // 0 until the first build
+    int levels() const {
+        return m_levels;
+    }
+    GLuint texture() const {
+        return m_texture;
+    }
+    glm::vec2 size() const {
+        return glm::vec2((float)m_width, (float)m_height);
+    }
+    const glm::mat4& viewProjection() const {
+        return m_viewProjection;
+    }
+
+private:
+    GLuint m_program = 0;
+    GLint m_sourceLevel = -1;
+    GLuint m_emptyVAO = 0;
+    GLuint m_texture = 0;
+    std::vector<GLuint> m_framebuffers;
+    int m_width = 0, m_height = 0, m_levels = 0;
+    glm::mat4 m_viewProjection = glm::mat4(1.0f);
+
+    int levelWidth(int level) const {
+        return std::max(1, m_width >> level);
+    }
+    int levelHeight(int level) const {
+        return std::max(1, m_height >> level);
+    }
+
+    // DEPTH24_STENCIL8, the format of GLFW's default depth buffer and OffscreenTarget's, which the blit has
+    // to match
+    void resize(int width, int height) {
+        if (!m_framebuffers.empty()) {
+            glDeleteFramebuffers((GLsizei)m_framebuffers.size(), m_framebuffers.data());
+        }
+        m_width = width;
+        m_height = height;
+        m_levels = 1;
+        while (levelWidth(m_levels - 1) > 1 || levelHeight(m_levels - 1) > 1) {
+            ++m_levels;
+        }
+
+        rg::glState().bindTexture(GL_TEXTURE_2D, m_texture);
+        for (int level = 0; level < m_levels; ++level) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_DEPTH24_STENCIL8, levelWidth(level), levelHeight(level), 0,
+                         GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        m_framebuffers.assign(m_levels, 0);
+        glGenFramebuffers(m_levels, m_framebuffers.data());
+        for (int level = 0; level < m_levels; ++level) {
+            glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[level]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_texture, level);
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+};
+
+#endif //PROJECT_BASE_DEPTHPYRAMID_H
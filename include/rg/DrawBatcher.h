@@ -0,0 +1,134 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_DRAWBATCHER_H
+#define PROJECT_BASE_DRAWBATCHER_H
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <vector>
+#include <rg/FrameUniforms.h>
+#include <rg/StreamBuffer.h>
+#include <rg/RenderQueue.h>
+
+// Merges a frame's repeated glDrawArrays of the same mesh with the same program and textures into
+// instanced draws. Render functions submit a DrawInstance (model matrix and material parameters) per
+// object instead of drawing; flush() writes each batch's instances to the stream buffer as one
+// InstanceData block and queues a glDrawArraysInstanced of them, up to MAX_INSTANCES at a time.
+//
+// A batch is sorted by its nearest instance, so only opaque geometry should go through here.
+class DrawBatcher {
+public:
+    // What a batch shares. Textures are bound to units 0 and 1, 0 meaning none. zone is the profiling
+    // zone of the queued draws (RenderCommand::zone); it isn't compared, a batch keeps its first draw's.
+    struct Key {
+        GLuint program;
+        GLuint VAO;
+        GLsizei vertexCount;
+        GLuint textures[2];
+        const char* zone;
+
+        bool operator==(const Key &other) const {
+            return program == other.program && VAO == other.VAO && vertexCount == other.vertexCount &&
+                   textures[0] == other.textures[0] && textures[1] == other.textures[1];
+        }
+    };
+
+    // Room for maxDraws submissions and maxBatches distinct keys a frame, allocated up front.
+    explicit DrawBatcher(size_t maxDraws = 256, size_t maxBatches = 16) {
+        m_draws.reserve(maxDraws);
+        m_keys.reserve(maxBatches);
+    }
+
+    // Off, every submitted draw is issued on its own, to see what merging them saves.
+    void setInstancing(bool instancing) {
+        m_instancing = instancing;
+    }
+
+    void submit(const Key &key, const DrawInstance &instance) {
+        unsigned batch = 0;
+        while (batch < m_keys.size() && !(m_keys[batch] == key)) {
+            ++batch;
+        }
+        if (batch == m_keys.size()) {
+            m_keys.push_back(key);
+        }
+        m_draws.push_back({batch, instance});
+    }
+
+    // Queues every batch and starts over. Batches that don't fit in the stream buffer are dropped.
+    void flush(StreamBuffer &stream, RenderQueue &queue) {
+        RG_PROFILE_ZONE("cube batches");
+        m_submitted = (unsigned)m_draws.size();
+        m_issued = 0;
+        const unsigned batchSize = m_instancing ? InstanceUniforms::MAX_INSTANCES : 1;
+        for (unsigned batch = 0; batch < m_keys.size(); ++batch) {
+            const Key &key = m_keys[batch];
+            unsigned count = 0;
+            float depth = 0.0f;
+            for (const Draw &draw : m_draws) {
+                if (draw.batch != batch) {
+                    continue;
+                }
+                float drawDepth = queue.depth(glm::vec3(draw.instance.model[3]));
+                depth = count == 0 ? drawDepth : std::min(depth, drawDepth);
+                m_block.instances[count++] = draw.instance;
+                if (count == batchSize) {
+                    issue(stream, queue, key, count, depth);
+                    count = 0;
+                }
+            }
+            issue(stream, queue, key, count, depth);
+        }
+        m_draws.clear();
+        m_keys.clear();
+    }
+
+    // Draw calls the last flush() was asked for, and the instanced ones it queued for them.
+    unsigned submittedDraws() const {
+        return m_submitted;
+    }
+    unsigned issuedDraws() const {
+        return m_issued;
+    }
+
+private:
+    struct Draw {
+        unsigned batch;
+        DrawInstance instance;
+    };
+
+    std::vector<Draw> m_draws;
+    std::vector<Key> m_keys;
+    InstanceUniforms m_block;
+    unsigned m_submitted = 0, m_issued = 0;
+    bool m_instancing = true;
+
+    void issue(StreamBuffer &stream, RenderQueue &queue, const Key &key, unsigned count, float depth) {
+        if (count == 0) {
+            return;
+        }
+        // the whole block is bound, but the frame's region only gives up the instances actually written
+        GLintptr offset = stream.write(&m_block, count * sizeof(DrawInstance), sizeof(InstanceUniforms));
+        if (offset < 0) {
+            return;
+        }
+        RenderCommand command;
+        command.program = key.program;
+        command.VAO = key.VAO;
+        command.textures[0] = key.textures[0];
+        command.textures[1] = key.textures[1];
+        command.count = key.vertexCount;
+        command.instanceCount = (GLsizei)count;
+        command.blockBinding = InstanceUniforms::BINDING;
+        command.blockBuffer = stream.buffer();
+        command.blockOffset = offset;
+        command.blockSize = sizeof(InstanceUniforms);
+        command.zone = key.zone;
+        queue.submit(command, depth);
+        ++m_issued;
+    }
+};
+
+#endif //PROJECT_BASE_DRAWBATCHER_H
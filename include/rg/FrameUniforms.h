@@ -0,0 +1,124 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_FRAMEUNIFORMS_H
+#define PROJECT_BASE_FRAMEUNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+
+// CPU mirror of the std140 "FrameData" block declared in resources/shaders. Every vec3 takes a full
+// vec4 slot unless a scalar fits in its last component, and structs are padded to 16 bytes.
+
+struct DirLightBlock {
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 color;
+    float pad1;
+};
+
+struct PointLightBlock {
+    float lightConst;
+    float linearConst;
+    float quadraticConst;
+    float pad0;
+    glm::vec3 position;
+    float pad1;
+    glm::vec3 color;
+    float pad2;
+};
+
+struct SpotLightBlock {
+    float lightConst;
+    float linearConst;
+    float quadraticConst;
+    int spotLightFlag;
+    glm::vec3 position;
+    float pad0;
+    glm::vec3 direction;
+    float pad1;
+    glm::vec3 color;
+    float cutOff;
+    float outerCutOff;
+    float pad2[3];
+};
+
+struct FrameUniforms {
+    static constexpr GLuint BINDING = 0;
+    static constexpr const char* BLOCK_NAME = "FrameData";
+
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPos;
+    float pad0;
+    DirLightBlock dirLight;
+    PointLightBlock pointLight;
+    SpotLightBlock spotLight;
+};
+
+static_assert(sizeof(glm::vec3) == 12 && sizeof(glm::mat4) == 64, "glm types must be tightly packed");
+
+static_assert(offsetof(DirLightBlock, direction) == 0, "std140 DirLight.direction");
+static_assert(offsetof(DirLightBlock, color) == 16, "std140 DirLight.color");
+static_assert(sizeof(DirLightBlock) == 32, "std140 DirLight size");
+
+static_assert(offsetof(PointLightBlock, lightConst) == 0, "std140 PointLight.lightConst");
+static_assert(offsetof(PointLightBlock, linearConst) == 4, "std140 PointLight.linearConst");
+static_assert(offsetof(PointLightBlock, quadraticConst) == 8, "std140 PointLight.quadraticConst");
+static_assert(offsetof(PointLightBlock, position) == 16, "std140 PointLight.position");
+static_assert(offsetof(PointLightBlock, color) == 32, "std140 PointLight.color");
+static_assert(sizeof(PointLightBlock) == 48, "std140 PointLight size");
+
+static_assert(offsetof(SpotLightBlock, lightConst) == 0, "std140 SpotLight.lightConst");
+static_assert(offsetof(SpotLightBlock, linearConst) == 4, "std140 SpotLight.linearConst");
+static_assert(offsetof(SpotLightBlock, quadraticConst) == 8, "std140 SpotLight.quadraticConst");
+static_assert(offsetof(SpotLightBlock, spotLightFlag) == 12, "std140 SpotLight.spotLightFlag");
+static_assert(offsetof(SpotLightBlock, position) == 16, "std140 SpotLight.position");
+static_assert(offsetof(SpotLightBlock, direction) == 32, "std140 SpotLight.direction");
+static_assert(offsetof(SpotLightBlock, color) == 48, "std140 SpotLight.color");
+static_assert(offsetof(SpotLightBlock, cutOff) == 60, "std140 SpotLight.cutOff");
+static_assert(offsetof(SpotLightBlock, outerCutOff) == 64, "std140 SpotLight.outerCutOff");
+static_assert(sizeof(SpotLightBlock) == 80, "std140 SpotLight size");
+
+static_assert(offsetof(FrameUniforms, view) == 0, "std140 FrameData.view");
+static_assert(offsetof(FrameUniforms, projection) == 64, "std140 FrameData.projection");
+static_assert(offsetof(FrameUniforms, viewPos) == 128, "std140 FrameData.viewPos");
+static_assert(offsetof(FrameUniforms, dirLight) == 144, "std140 FrameData.dirLight");
+static_assert(offsetof(FrameUniforms, pointLight) == 176, "std140 FrameData.pointLight");
+static_assert(offsetof(FrameUniforms, spotLight) == 224, "std140 FrameData.spotLight");
+static_assert(sizeof(FrameUniforms) == 304, "std140 FrameData size");
+
+// CPU mirror of the std140 "DrawData" block in resources/shaders/common/draw_data.glsl, one per draw.
+struct DrawUniforms {
+    static constexpr GLuint BINDING = 1;
+    static constexpr const char* BLOCK_NAME = "DrawData";
+
+    glm::mat4 model;
+};
+
+static_assert(offsetof(DrawUniforms, model) == 0, "std140 DrawData.model");
+static_assert(sizeof(DrawUniforms) == 64, "std140 DrawData size");
+
+// One element of the std140 "InstanceData" block in resources/shaders/common/instance_data.glsl, read by
+// the batched cube draws through gl_InstanceID. What material holds is up to the program.
+struct DrawInstance {
+    glm::mat4 model;
+    glm::vec4 material;
+};
+
+struct InstanceUniforms {
+    static constexpr GLuint BINDING = 2;
+    static constexpr const char* BLOCK_NAME = "InstanceData";
+    // MAX_DRAW_INSTANCES in instance_data.glsl
+    static constexpr unsigned MAX_INSTANCES = 64;
+
+    DrawInstance instances[MAX_INSTANCES];
+};
+
+static_assert(offsetof(DrawInstance, material) == 64, "std140 DrawInstance.material");
+static_assert(sizeof(DrawInstance) == 80, "std140 DrawInstance size");
+static_assert(sizeof(InstanceUniforms) == 80 * InstanceUniforms::MAX_INSTANCES, "std140 InstanceData size");
+
+#endif //PROJECT_BASE_FRAMEUNIFORMS_H
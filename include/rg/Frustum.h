@@ -0,0 +1,239 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_FRUSTUM_H
+#define PROJECT_BASE_FRUSTUM_H
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RG_FRUSTUM_X86 1
+#endif
+
+// Bounding volumes and the view frustum test behind renderScene's culling. Single objects are tested one
+// at a time; many small ones (the rock field) go through cullSpheres, four or eight spheres per step.
+
+struct AABB {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool empty() const {
+        return min.x > max.x;
+    }
+    void extend(const glm::vec3 &point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    void extend(const AABB &box) {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+    glm::vec3 center() const {
+        return (min + max) * 0.5f;
+    }
+    glm::vec3 extent() const {
+        return (max - min) * 0.5f;
+    }
+
+    // Box around this box after the affine transform m (Arvo): the centre is transformed, the half
+    // extents go through the absolute values of the linear part.
+    AABB transformed(const glm::mat4 &m) const {
+        if (empty()) {
+            return *this;
+        }
+        glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+        glm::vec3 e = extent();
+        glm::vec3 r = glm::abs(glm::vec3(m[0])) * e.x + glm::abs(glm::vec3(m[1])) * e.y + glm::abs(glm::vec3(m[2])) * e.z;
+        AABB box;
+        box.min = c - r;
+        box.max = c + r;
+        return box;
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center;
+    float radius;
+};
+
+// Spheres as separate arrays, the layout the SIMD test loads from.
+struct BoundingSpheres {
+    std::vector<float> x, y, z, radius;
+
+    void reserve(size_t count) {
+        x.reserve(count);
+        y.reserve(count);
+        z.reserve(count);
+        radius.reserve(count);
+    }
+    void push_back(const BoundingSphere &sphere) {
+        x.push_back(sphere.center.x);
+        y.push_back(sphere.center.y);
+        z.push_back(sphere.center.z);
+        radius.push_back(sphere.radius);
+    }
+    size_t size() const {
+        return x.size();
+    }
+};
+
+namespace rg {
+    // Positions are the first three floats of every vertex, stride is in floats.
+    AABB boundsOf(const float* vertices, size_t vertexCount, size_t stride) {
+        AABB box;
+        for (size_t i = 0; i < vertexCount; ++i) {
+            box.extend(glm::vec3(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]));
+        }
+        return box;
+    }
+
+    // Sphere around a box transformed by m, for instances whose matrix keeps its shape (rotation,
+    // translation, uniform scale); the radius is taken along the longest axis otherwise.
+    BoundingSphere boundingSphere(const AABB &box, const glm::mat4 &m) {
+        float scale = std::sqrt(std::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+                                         std::max(glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2])))));
+        return {glm::vec3(m * glm::vec4(box.center(), 1.0f)), glm::length(box.extent()) * scale};
+    }
+};
+
+class Frustum {
+public:
+    Frustum() = default;
+
+    // Planes of a view-projection matrix (Gribb & Hartmann), normals point inside.
+    explicit Frustum(const glm::mat4 &viewProjection) {
+        glm::vec4 row[4];
+        for (int i = 0; i < 4; ++i) {
+            row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+        m_planes[0] = row[3] + row[0];
+        m_planes[1] = row[3] - row[0];
+        m_planes[2] = row[3] + row[1];
+        m_planes[3] = row[3] - row[1];
+        m_planes[4] = row[3] + row[2];
+        m_planes[5] = row[3] - row[2];
+        for (glm::vec4 &plane : m_planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+    }
+
+    const glm::vec4& plane(int i) const {
+        return m_planes[i];
+    }
+
+    // Conservative: true for anything that may be inside.
+    bool intersects(const AABB &box) const {
+        if (box.empty()) {
+            return false;
+        }
+        glm::vec3 c = box.center(), e = box.extent();
+        for (const glm::vec4 &p : m_planes) {
+            float distance = p.x * c.x + p.y * c.y + p.z * c.z + p.w;
+            float reach = std::abs(p.x) * e.x + std::abs(p.y) * e.y + std::abs(p.z) * e.z;
+            if (distance < -reach) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool intersects(const BoundingSphere &sphere) const {
+        for (const glm::vec4 &p : m_planes) {
+            if (glm::dot(glm::vec3(p), sphere.center) + p.w < -sphere.radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Writes the indices of the spheres that may be visible to visible (room for spheres.size()) and
+    // returns how many there are, in order.
+    size_t cullSpheres(const BoundingSpheres &spheres, uint32_t* visible) const {
+        return cullSpheres(spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.radius.data(), spheres.size(), visible);
+    }
+
+    size_t cullSpheres(const float* x, const float* y, const float* z, const float* r, size_t count, uint32_t* visible) const {
+#ifdef RG_FRUSTUM_X86
+        static const bool avx = __builtin_cpu_supports("avx");
+        return avx ? cullSpheresAvx(x, y, z, r, count, visible) : cullSpheresSse(x, y, z, r, count, visible);
+#else
+        return cullSpheresScalar(x, y, z, r, 0, count, visible, 0);
+#endif
+    }
+
+    size_t cullSpheresScalar(const float* x, const float* y, const float* z, const float* r, size_t first, size_t count,
+                             uint32_t* visible, size_t visibleCount) const {
+        for (size_t i = first; i < count; ++i) {
+            if (intersects(BoundingSphere{glm::vec3(x[i], y[i], z[i]), r[i]})) {
+                visible[visibleCount++] = (uint32_t)i;
+            }
+        }
+        return visibleCount;
+    }
+
+#ifdef RG_FRUSTUM_X86
+    __attribute__((target("sse2")))
+    size_t cullSpheresSse(const float* x, const float* y, const float* z, const float* r, size_t count, uint32_t* visible) const {
+        size_t visibleCount = 0, i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+            __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r + i));
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const glm::vec4 &p : m_planes) {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(p.x)), _mm_mul_ps(vy, _mm_set1_ps(p.y))),
+                                             _mm_add_ps(_mm_mul_ps(vz, _mm_set1_ps(p.z)), _mm_set1_ps(p.w)));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+            for (int mask = _mm_movemask_ps(inside); mask; mask &= mask - 1) {
+                visible[visibleCount++] = (uint32_t)(i + __builtin_ctz(mask));
+            }
+        }
+        return cullSpheresScalar(x, y, z, r, i, count, visible, visibleCount);
+    }
+
+    __attribute__((target("avx")))
+    size_t cullSpheresAvx(const float* x, const float* y, const float* z, const float* r, size_t count, uint32_t* visible) const {
+        size_t visibleCount = 0, i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+            __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(r + i));
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const glm::vec4 &p : m_planes) {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, _mm256_set1_ps(p.x)), _mm256_mul_ps(vy, _mm256_set1_ps(p.y))),
+                                                _mm256_add_ps(_mm256_mul_ps(vz, _mm256_set1_ps(p.z)), _mm256_set1_ps(p.w)));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+            }
+            for (int mask = _mm256_movemask_ps(inside); mask; mask &= mask - 1) {
+                visible[visibleCount++] = (uint32_t)(i + __builtin_ctz(mask));
+            }
+        }
+        size_t tail = cullSpheresSse(x + i, y + i, z + i, r + i, count - i, visible + visibleCount);
+        for (size_t j = visibleCount; j < visibleCount + tail; ++j) {
+            visible[j] += (uint32_t)i;
+        }
+        return visibleCount + tail;
+    }
+#endif
+
+private:
+    glm::vec4 m_planes[6] = {};
+};
+
+// Objects tested against the frustum in a frame, and how many of them were drawn.
+struct CullStats {
+    unsigned submitted = 0;
+    unsigned visible = 0;
+
+    bool count(bool isVisible) {
+        ++submitted;
+        visible += isVisible;
+        return isVisible;
+    }
+};
+
+#endif //PROJECT_BASE_FRUSTUM_H
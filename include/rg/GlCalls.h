@@ -0,0 +1,207 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_GLCALLS_H
+#define PROJECT_BASE_GLCALLS_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstring>
+
+// Every GL entry point the renderer calls, for the loaders that stand in for the driver (GlMock) or sit
+// in front of it (GlTrace). A function missing here loads as null through them, like an extension the
+// driver doesn't have.
+//
+// Each entry is name, argument kinds and class. The kinds, one character per argument, tell a replay
+// which values are object names that differ between contexts:
+//
+//     v  plain value          B  buffer          T  texture         A  vertex array
+//     F  framebuffer          R  renderbuffer    Q  query           P  program or shader
+//     L  uniform location of the current program                    K  sync object
+//     o  pointer GL writes through, pointed at scratch memory on replay
+#define RG_GL_CALLS(X) \
+    X(ActiveTexture, "v", BIND) \
+    X(AttachShader, "PP", OBJECT) \
+    X(BeginQuery, "vQ", STATE) \
+    X(BeginTransformFeedback, "v", STATE) \
+    X(BindBuffer, "vB", BIND) \
+    X(BindBufferBase, "vvB", BIND) \
+    X(BindBufferRange, "vvBvv", BIND) \
+    X(BindFramebuffer, "vF", BIND) \
+    X(BindRenderbuffer, "vR", BIND) \
+    X(BindTexture, "vT", BIND) \
+    X(BindVertexArray, "A", BIND) \
+    X(BlitFramebuffer, "vvvvvvvvvv", STATE) \
+    X(BufferData, "vvvv", UPLOAD) \
+    X(BufferSubData, "vvvv", UPLOAD) \
+    X(CheckFramebufferStatus, "v", QUERY) \
+    X(Clear, "v", STATE) \
+    X(ClearColor, "vvvv", STATE) \
+    X(ClientWaitSync, "Kvv", QUERY) \
+    X(CompileShader, "P", OBJECT) \
+    X(CompressedTexImage2D, "vvvvvvvv", UPLOAD) \
+    X(CopyBufferSubData, "vvvvv", STATE) \
+    X(CreateProgram, "", OBJECT) \
+    X(CreateShader, "v", OBJECT) \
+    X(CullFace, "v", STATE) \
+    X(DeleteBuffers, "vv", OBJECT) \
+    X(DeleteFramebuffers, "vv", OBJECT) \
+    X(DeleteProgram, "P", OBJECT) \
+    X(DeleteQueries, "vv", OBJECT) \
+    X(DeleteRenderbuffers, "vv", OBJECT) \
+    X(DeleteShader, "P", OBJECT) \
+    X(DeleteSync, "K", OBJECT) \
+    X(DeleteTextures, "vv", OBJECT) \
+    X(DeleteVertexArrays, "vv", OBJECT) \
+    X(DepthFunc, "v", STATE) \
+    X(Disable, "v", STATE) \
+    X(DrawArrays, "vvv", DRAW) \
+    X(DrawArraysInstanced, "vvvv", DRAW) \
+    X(DrawBuffer, "v", STATE) \
+    X(DrawElements, "vvvv", DRAW) \
+    X(DrawElementsInstanced, "vvvvv", DRAW) \
+    X(Enable, "v", STATE) \
+    X(EnableVertexAttribArray, "v", STATE) \
+    X(EndQuery, "v", STATE) \
+    X(EndTransformFeedback, "", STATE) \
+    X(FenceSync, "vv", OBJECT) \
+    X(Finish, "", STATE) \
+    X(FramebufferRenderbuffer, "vvvR", STATE) \
+    X(FramebufferTexture2D, "vvvTv", STATE) \
+    X(FrontFace, "v", STATE) \
+    X(GenBuffers, "vo", OBJECT) \
+    X(GenFramebuffers, "vo", OBJECT) \
+    X(GenQueries, "vo", OBJECT) \
+    X(GenRenderbuffers, "vo", OBJECT) \
+    X(GenTextures, "vo", OBJECT) \
+    X(GenVertexArrays, "vo", OBJECT) \
+    X(GetActiveUniform, "Pvvoooo", QUERY) \
+    X(GetBufferSubData, "vvvo", QUERY) \
+    X(GetError, "", QUERY) \
+    X(GetInteger64v, "vo", QUERY) \
+    X(GetIntegerv, "vo", QUERY) \
+    X(GetProgramInfoLog, "Pvoo", QUERY) \
+    X(GetProgramiv, "Pvo", QUERY) \
+    X(GetQueryObjectui64v, "Qvo", QUERY) \
+    X(GetQueryObjectuiv, "Qvo", QUERY) \
+    X(GetShaderInfoLog, "Pvoo", QUERY) \
+    X(GetShaderiv, "Pvo", QUERY) \
+    X(GetString, "v", QUERY) \
+    X(GetStringi, "vv", QUERY) \
+    X(GetUniformBlockIndex, "Pv", QUERY) \
+    X(GetUniformLocation, "Pv", QUERY) \
+    X(GetVertexAttribiv, "vvo", QUERY) \
+    X(IsEnabled, "v", QUERY) \
+    X(LinkProgram, "P", OBJECT) \
+    X(MapBufferRange, "vvvv", UPLOAD) \
+    X(PixelStorei, "vv", STATE) \
+    X(PolygonMode, "vv", STATE) \
+    X(QueryCounter, "Qv", STATE) \
+    X(ReadBuffer, "v", STATE) \
+    X(ReadPixels, "vvvvvvo", QUERY) \
+    X(RenderbufferStorage, "vvvv", STATE) \
+    X(ShaderSource, "Pvvv", OBJECT) \
+    X(TexImage2D, "vvvvvvvvv", UPLOAD) \
+    X(TexParameteri, "vvv", STATE) \
+    X(TransformFeedbackVaryings, "Pvvv", OBJECT) \
+    X(Uniform1f, "Lv", UNIFORM) \
+    X(Uniform1i, "Lv", UNIFORM) \
+    X(Uniform1ui, "Lv", UNIFORM) \
+    X(Uniform2f, "Lvv", UNIFORM) \
+    X(Uniform2fv, "Lvv", UNIFORM) \
+    X(Uniform3f, "Lvvv", UNIFORM) \
+    X(Uniform3fv, "Lvv", UNIFORM) \
+    X(Uniform4f, "Lvvvv", UNIFORM) \
+    X(Uniform4fv, "Lvv", UNIFORM) \
+    X(UniformBlockBinding, "Pvv", STATE) \
+    X(UniformMatrix2fv, "Lvvv", UNIFORM) \
+    X(UniformMatrix3fv, "Lvvv", UNIFORM) \
+    X(UniformMatrix4fv, "Lvvv", UNIFORM) \
+    X(UnmapBuffer, "v", UPLOAD) \
+    X(UseProgram, "P", BIND) \
+    X(VertexAttribDivisor, "vv", STATE) \
+    X(VertexAttribPointer, "vvvvvv", STATE) \
+    X(Viewport, "vvvv", STATE)
+
+// Number of arguments of a GL function pointer type.
+template <typename F>
+struct GlArity;
+template <typename R, typename... A>
+struct GlArity<R (APIENTRYP)(A...)> {
+    static const size_t value = sizeof...(A);
+};
+
+struct GlCall {
+    enum Id : uint16_t {
+#define RG_GL_CALL_ID(name, kinds, type) name,
+        RG_GL_CALLS(RG_GL_CALL_ID)
+#undef RG_GL_CALL_ID
+        COUNT,
+        // not a GL call: the end of a frame in a trace
+        FRAME_END = COUNT
+    };
+
+    // what a call costs, roughly: draws and uniform uploads are what frame budgets are about
+    enum Type {
+        DRAW,
+        UNIFORM,
+        UPLOAD,
+        BIND,
+        STATE,
+        QUERY,
+        OBJECT,
+        TYPES
+    };
+
+    static const char* name(Id id) {
+        static const char* const names[COUNT + 1] = {
+#define RG_GL_CALL_NAME(name, kinds, type) "gl" #name,
+                RG_GL_CALLS(RG_GL_CALL_NAME)
+#undef RG_GL_CALL_NAME
+                "frame end"
+        };
+        return id <= COUNT ? names[id] : "unknown";
+    }
+
+    static const char* kinds(Id id) {
+        static const char* const kinds[COUNT] = {
+#define RG_GL_CALL_KINDS(name, kinds, type) kinds,
+                RG_GL_CALLS(RG_GL_CALL_KINDS)
+#undef RG_GL_CALL_KINDS
+        };
+        return id < COUNT ? kinds[id] : "";
+    }
+
+    static Type type(Id id) {
+        static const Type types[COUNT] = {
+#define RG_GL_CALL_TYPE(name, kinds, type) type,
+                RG_GL_CALLS(RG_GL_CALL_TYPE)
+#undef RG_GL_CALL_TYPE
+        };
+        return id < COUNT ? types[id] : STATE;
+    }
+
+    static const char* typeName(Type type) {
+        static const char* const names[TYPES] = {"draw", "uniform", "upload", "bind", "state", "query", "object"};
+        return names[type];
+    }
+
+    // COUNT when name isn't one of ours
+    static Id find(const char* name) {
+        for (uint16_t id = 0; id < COUNT; ++id) {
+            if (std::strcmp(GlCall::name((Id)id), name) == 0) {
+                return (Id)id;
+            }
+        }
+        return COUNT;
+    }
+};
+
+// a kinds string per argument, checked against glad's prototypes
+#define RG_GL_CALL_ARITY(name, kinds, type) \
+    static_assert(GlArity<decltype(glad_gl##name)>::value == sizeof(kinds) - 1, "gl" #name " kinds");
+RG_GL_CALLS(RG_GL_CALL_ARITY)
+#undef RG_GL_CALL_ARITY
+
+#endif //PROJECT_BASE_GLCALLS_H
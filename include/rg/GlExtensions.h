@@ -0,0 +1,27 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_GLEXTENSIONS_H
+#define PROJECT_BASE_GLEXTENSIONS_H
+
+#include <glad/glad.h>
+#include <cstring>
+
+namespace rg {
+
+    // Our glad is generated for core 3.3 without extensions, so they are looked up by name.
+    bool hasGlExtension(const char* name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+            if (extension && std::strcmp(extension, name) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif //PROJECT_BASE_GLEXTENSIONS_H
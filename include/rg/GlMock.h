@@ -0,0 +1,317 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_GLMOCK_H
+#define PROJECT_BASE_GLMOCK_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <rg/GlCalls.h>
+#include <rg/UniformTable.h>
+
+// A GL without a driver, loaded through GlMock::loadFunction in place of a context's loader. Every call
+// in RG_GL_CALLS succeeds and does nothing, except for the state queries need: a 3.3 core context whose
+// one extension is GL_RG_no_driver (glad gives up on a context without any), bindings and capabilities
+// read back as they were set, names counting up from 1, shaders that compile and programs that link,
+// uniform locations derived from the name, complete framebuffers and fences that are already
+// signalled. Nothing is drawn; readbacks return zeros.
+//
+// Meant to sit behind a GlTrace, so rendering code can run and be counted on a machine without a GPU.
+class GlMock {
+public:
+    static const GLuint TEXTURE_UNITS = 32;
+
+    // what glad asks for; null outside RG_GL_CALLS
+    static void* loadFunction(const char *name) {
+        GlCall::Id id = GlCall::find(name);
+        if (id == GlCall::COUNT) {
+            return nullptr;
+        }
+        void* function = implementation(id);
+        return function ? function : noop(id);
+    }
+
+private:
+    GLuint m_nextName = 1;
+    uintptr_t m_nextSync = 1;
+    GLuint m_program = 0, m_VAO = 0, m_activeTexture = GL_TEXTURE0;
+    GLuint m_textures[TEXTURE_UNITS] = {};
+    GLuint m_unpackBuffer = 0;
+    GLint m_viewport[4] = {0, 0, 0, 0};
+    GLint m_unpackAlignment = 4, m_packAlignment = 4;
+    // a capability is enabled while it is in here
+    GLenum m_enabled[16] = {};
+    unsigned m_enabledCount = 0;
+    std::vector<char> m_mapping;
+
+    static GlMock& state() {
+        static GlMock mock;
+        return mock;
+    }
+
+    template <typename F>
+    struct Noop;
+    template <typename R, typename... A>
+    struct Noop<R (APIENTRYP)(A...)> {
+        static R APIENTRY call(A...) {
+            return R();
+        }
+    };
+
+    static void* noop(GlCall::Id id) {
+        static void* const functions[GlCall::COUNT] = {
+#define RG_GL_MOCK_NOOP(name, kinds, type) (void*)&Noop<decltype(glad_gl##name)>::call,
+                RG_GL_CALLS(RG_GL_MOCK_NOOP)
+#undef RG_GL_MOCK_NOOP
+        };
+        return functions[id];
+    }
+
+    static void* implementation(GlCall::Id id) {
+        switch (id) {
+            case GlCall::ActiveTexture: return (void*)&activeTexture;
+            case GlCall::BindBuffer: return (void*)&bindBuffer;
+            case GlCall::BindTexture: return (void*)&bindTexture;
+            case GlCall::BindVertexArray: return (void*)&bindVertexArray;
+            case GlCall::CheckFramebufferStatus: return (void*)&checkFramebufferStatus;
+            case GlCall::ClientWaitSync: return (void*)&clientWaitSync;
+            case GlCall::CreateProgram: return (void*)&createProgram;
+            case GlCall::CreateShader: return (void*)&createShader;
+            case GlCall::DeleteTextures: return (void*)&deleteTextures;
+            case GlCall::DeleteVertexArrays: return (void*)&deleteVertexArrays;
+            case GlCall::Disable: return (void*)&disable;
+            case GlCall::Enable: return (void*)&enable;
+            case GlCall::FenceSync: return (void*)&fenceSync;
+            case GlCall::GenBuffers:
+            case GlCall::GenFramebuffers:
+            case GlCall::GenQueries:
+            case GlCall::GenRenderbuffers:
+            case GlCall::GenTextures:
+            case GlCall::GenVertexArrays: return (void*)&genNames;
+            case GlCall::GetActiveUniform: return (void*)&getActiveUniform;
+            case GlCall::GetBufferSubData: return (void*)&getBufferSubData;
+            case GlCall::GetInteger64v: return (void*)&getInteger64v;
+            case GlCall::GetIntegerv: return (void*)&getIntegerv;
+            case GlCall::GetProgramInfoLog:
+            case GlCall::GetShaderInfoLog: return (void*)&getInfoLog;
+            case GlCall::GetProgramiv: return (void*)&getProgramiv;
+            case GlCall::GetQueryObjectui64v: return (void*)&getQueryObjectui64v;
+            case GlCall::GetQueryObjectuiv: return (void*)&getQueryObjectuiv;
+            case GlCall::GetShaderiv: return (void*)&getShaderiv;
+            case GlCall::GetString: return (void*)&getString;
+            case GlCall::GetStringi: return (void*)&getStringi;
+            case GlCall::GetUniformBlockIndex: return (void*)&getUniformBlockIndex;
+            case GlCall::GetUniformLocation: return (void*)&getUniformLocation;
+            case GlCall::GetVertexAttribiv: return (void*)&getVertexAttribiv;
+            case GlCall::IsEnabled: return (void*)&isEnabled;
+            case GlCall::MapBufferRange: return (void*)&mapBufferRange;
+            case GlCall::PixelStorei: return (void*)&pixelStorei;
+            case GlCall::ReadPixels: return (void*)&readPixels;
+            case GlCall::UnmapBuffer: return (void*)&unmapBuffer;
+            case GlCall::UseProgram: return (void*)&useProgram;
+            case GlCall::Viewport: return (void*)&viewport;
+            default: return nullptr;
+        }
+    }
+
+    static void APIENTRY activeTexture(GLenum unit) {
+        state().m_activeTexture = unit;
+    }
+    static void APIENTRY bindBuffer(GLenum target, GLuint buffer) {
+        if (target == GL_PIXEL_UNPACK_BUFFER) {
+            state().m_unpackBuffer = buffer;
+        }
+    }
+    static void APIENTRY bindTexture(GLenum target, GLuint texture) {
+        GLuint unit = state().m_activeTexture - GL_TEXTURE0;
+        if (target == GL_TEXTURE_2D && unit < TEXTURE_UNITS) {
+            state().m_textures[unit] = texture;
+        }
+    }
+    static void APIENTRY bindVertexArray(GLuint VAO) {
+        state().m_VAO = VAO;
+    }
+    static GLenum APIENTRY checkFramebufferStatus(GLenum) {
+        return GL_FRAMEBUFFER_COMPLETE;
+    }
+    static GLenum APIENTRY clientWaitSync(GLsync, GLbitfield, GLuint64) {
+        return GL_ALREADY_SIGNALED;
+    }
+    static GLuint APIENTRY createProgram() {
+        return state().m_nextName++;
+    }
+    static GLuint APIENTRY createShader(GLenum) {
+        return state().m_nextName++;
+    }
+    static void APIENTRY deleteTextures(GLsizei n, const GLuint *textures) {
+        for (GLsizei i = 0; i < n; ++i) {
+            for (GLuint &bound : state().m_textures) {
+                bound = bound == textures[i] ? 0 : bound;
+            }
+        }
+    }
+    static void APIENTRY deleteVertexArrays(GLsizei n, const GLuint *VAOs) {
+        for (GLsizei i = 0; i < n; ++i) {
+            state().m_VAO = state().m_VAO == VAOs[i] ? 0 : state().m_VAO;
+        }
+    }
+    static void APIENTRY enable(GLenum capability) {
+        GlMock &mock = state();
+        if (!isEnabled(capability) && mock.m_enabledCount < 16) {
+            mock.m_enabled[mock.m_enabledCount++] = capability;
+        }
+    }
+    static void APIENTRY disable(GLenum capability) {
+        GlMock &mock = state();
+        for (unsigned i = 0; i < mock.m_enabledCount; ++i) {
+            if (mock.m_enabled[i] == capability) {
+                mock.m_enabled[i] = mock.m_enabled[--mock.m_enabledCount];
+                return;
+            }
+        }
+    }
+    static GLsync APIENTRY fenceSync(GLenum, GLbitfield) {
+        return (GLsync)state().m_nextSync++;
+    }
+    static void APIENTRY genNames(GLsizei n, GLuint *names) {
+        for (GLsizei i = 0; i < n; ++i) {
+            names[i] = state().m_nextName++;
+        }
+    }
+    static void APIENTRY getActiveUniform(GLuint, GLuint, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type,
+                                          GLchar *name) {
+        if (length) {
+            *length = 0;
+        }
+        *size = 0;
+        *type = GL_FLOAT;
+        if (bufSize > 0) {
+            name[0] = '\0';
+        }
+    }
+    static void APIENTRY getBufferSubData(GLenum, GLintptr, GLsizeiptr size, void *data) {
+        std::memset(data, 0, (size_t)size);
+    }
+    // the GPU clock (GL_TIMESTAMP) stands still at 0
+    static void APIENTRY getInteger64v(GLenum name, GLint64 *value) {
+        *value = 0;
+    }
+    static void APIENTRY getIntegerv(GLenum name, GLint *value) {
+        GlMock &mock = state();
+        switch (name) {
+            case GL_MAJOR_VERSION: *value = 3; break;
+            case GL_MINOR_VERSION: *value = 3; break;
+            case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: *value = 256; break;
+            case GL_MAX_VERTEX_ATTRIBS: *value = 16; break;
+            case GL_MAX_TEXTURE_SIZE: *value = 16384; break;
+            case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS: *value = (GLint)TEXTURE_UNITS; break;
+            case GL_CURRENT_PROGRAM: *value = (GLint)mock.m_program; break;
+            case GL_ACTIVE_TEXTURE: *value = (GLint)mock.m_activeTexture; break;
+            case GL_VERTEX_ARRAY_BINDING: *value = (GLint)mock.m_VAO; break;
+            case GL_PIXEL_UNPACK_BUFFER_BINDING: *value = (GLint)mock.m_unpackBuffer; break;
+            case GL_UNPACK_ALIGNMENT: *value = mock.m_unpackAlignment; break;
+            case GL_PACK_ALIGNMENT: *value = mock.m_packAlignment; break;
+            case GL_TEXTURE_BINDING_2D: {
+                GLuint unit = mock.m_activeTexture - GL_TEXTURE0;
+                *value = unit < TEXTURE_UNITS ? (GLint)mock.m_textures[unit] : 0;
+                break;
+            }
+            case GL_VIEWPORT: std::memcpy(value, mock.m_viewport, sizeof(mock.m_viewport)); break;
+            case GL_NUM_EXTENSIONS: *value = 1; break;
+            // GL_NUM_PROGRAM_BINARY_FORMATS and the rest
+            default: *value = 0; break;
+        }
+    }
+    static void APIENTRY getInfoLog(GLuint, GLsizei bufSize, GLsizei *length, GLchar *log) {
+        if (length) {
+            *length = 0;
+        }
+        if (bufSize > 0) {
+            log[0] = '\0';
+        }
+    }
+    static void APIENTRY getProgramiv(GLuint, GLenum name, GLint *value) {
+        *value = name == GL_LINK_STATUS || name == GL_VALIDATE_STATUS ? GL_TRUE : 0;
+    }
+    static void APIENTRY getQueryObjectuiv(GLuint, GLenum name, GLuint *value) {
+        *value = name == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+    }
+    static void APIENTRY getQueryObjectui64v(GLuint, GLenum name, GLuint64 *value) {
+        *value = name == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+    }
+    static void APIENTRY getShaderiv(GLuint, GLenum name, GLint *value) {
+        *value = name == GL_COMPILE_STATUS ? GL_TRUE : 0;
+    }
+    static const GLubyte* APIENTRY getString(GLenum name) {
+        switch (name) {
+            case GL_VERSION: return (const GLubyte*)"3.3 (core profile) rg mock";
+            case GL_SHADING_LANGUAGE_VERSION: return (const GLubyte*)"3.30";
+            case GL_VENDOR: return (const GLubyte*)"rg";
+            case GL_RENDERER: return (const GLubyte*)"rg mock, no driver";
+            default: return nullptr;
+        }
+    }
+    static const GLubyte* APIENTRY getStringi(GLenum name, GLuint index) {
+        return name == GL_EXTENSIONS && index == 0 ? (const GLubyte*)"GL_RG_no_driver" : nullptr;
+    }
+    // a block index below the 12 blocks a 3.3 context guarantees per stage
+    static GLuint APIENTRY getUniformBlockIndex(GLuint, const GLchar *name) {
+        return rg::hashUniformName(name) % 12;
+    }
+    // Stable for a name without keeping anything, and never -1, so every glUniform* the code makes is
+    // made (and traced).
+    static GLint APIENTRY getUniformLocation(GLuint, const GLchar *name) {
+        return (GLint)(rg::hashUniformName(name) & 0xfff);
+    }
+    static void APIENTRY getVertexAttribiv(GLuint, GLenum, GLint *value) {
+        *value = 0;
+    }
+    static GLboolean APIENTRY isEnabled(GLenum capability) {
+        GlMock &mock = state();
+        for (unsigned i = 0; i < mock.m_enabledCount; ++i) {
+            if (mock.m_enabled[i] == capability) {
+                return GL_TRUE;
+            }
+        }
+        return GL_FALSE;
+    }
+    // one mapping at a time is all the renderer makes
+    static void* APIENTRY mapBufferRange(GLenum, GLintptr, GLsizeiptr length, GLbitfield) {
+        std::vector<char> &mapping = state().m_mapping;
+        if (mapping.size() < (size_t)length) {
+            mapping.resize((size_t)length);
+        }
+        return mapping.data();
+    }
+    static void APIENTRY pixelStorei(GLenum name, GLint value) {
+        if (name == GL_UNPACK_ALIGNMENT) {
+            state().m_unpackAlignment = value;
+        } else if (name == GL_PACK_ALIGNMENT) {
+            state().m_packAlignment = value;
+        }
+    }
+    static void APIENTRY readPixels(GLint, GLint, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels) {
+        // RGBA bytes is the only readback there is
+        if (format == GL_RGBA && type == GL_UNSIGNED_BYTE) {
+            std::memset(pixels, 0, (size_t)width * height * 4);
+        }
+    }
+    static GLboolean APIENTRY unmapBuffer(GLenum) {
+        return GL_TRUE;
+    }
+    static void APIENTRY useProgram(GLuint program) {
+        state().m_program = program;
+    }
+    static void APIENTRY viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        GLint *viewport = state().m_viewport;
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = width;
+        viewport[3] = height;
+    }
+};
+
+#endif //PROJECT_BASE_GLMOCK_H
@@ -0,0 +1,300 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_GLSTATE_H
+#define PROJECT_BASE_GLSTATE_H
+
+#include <glad/glad.h>
+#include <iostream>
+#include <rg/Error.h>
+
+// Shadow copy of the binding state the renderer changes all the time: current program, active texture
+// unit, the GL_TEXTURE_2D binding of every unit, the VAO and a few capabilities. Everything that binds
+// one of them goes through rg::glState(), which drops a call when it would set what is already set.
+//
+// Every value starts out unknown, so the first call always reaches GL. Code that changes the state
+// behind the cache's back has to invalidate() it; deleting a bound texture or VAO resets the binding to
+// 0 in GL, which textureDeleted() and vertexArrayDeleted() mirror, and a deleted program's name can come
+// back for a new one, which programDeleted() guards against.
+//
+// Configure with -DRG_CHECK_GL_STATE=ON to have every dropped call check the cache against glGet* first
+// and endFrame() compare all of it; a difference is reported once as ERROR::GL_STATE::DRIFT and the
+// cache takes GL's value.
+
+class GlState {
+public:
+    static const GLuint TEXTURE_UNITS = 16;
+
+    enum Kind {
+        PROGRAM,
+        ACTIVE_TEXTURE,
+        TEXTURE,
+        VERTEX_ARRAY,
+        CAPABILITY,
+        KINDS
+    };
+
+    // Calls asked for and calls dropped, per kind of state.
+    struct Stats {
+        unsigned calls[KINDS] = {};
+        unsigned redundant[KINDS] = {};
+
+        unsigned totalCalls() const {
+            unsigned total = 0;
+            for (unsigned calls : this->calls) {
+                total += calls;
+            }
+            return total;
+        }
+        unsigned totalRedundant() const {
+            unsigned total = 0;
+            for (unsigned redundant : this->redundant) {
+                total += redundant;
+            }
+            return total;
+        }
+    };
+
+    GlState() {
+        invalidateTextures();
+    }
+
+    GlState(const GlState&) = delete;
+    GlState& operator=(const GlState&) = delete;
+
+    static const char* kindName(Kind kind) {
+        static const char* const names[KINDS] = {"program", "active texture", "texture", "VAO", "capability"};
+        return names[kind];
+    }
+
+    void useProgram(GLuint program) {
+        if (count(PROGRAM, program == m_program) && check(GL_CURRENT_PROGRAM, m_program, "program")) {
+            return;
+        }
+        glUseProgram(program);
+        m_program = program;
+    }
+
+    // unit is the enum, GL_TEXTURE0 + i
+    void activeTexture(GLenum unit) {
+        if (count(ACTIVE_TEXTURE, unit == m_activeTexture) && check(GL_ACTIVE_TEXTURE, m_activeTexture, "active texture")) {
+            return;
+        }
+        glActiveTexture(unit);
+        m_activeTexture = unit;
+    }
+
+    // On the active unit. Only GL_TEXTURE_2D is shadowed, other targets always go through.
+    void bindTexture(GLenum target, GLuint texture) {
+        GLuint unit = m_activeTexture - GL_TEXTURE0;
+        if (target != GL_TEXTURE_2D || m_activeTexture == UNKNOWN || unit >= TEXTURE_UNITS) {
+            glBindTexture(target, texture);
+            if (target == GL_TEXTURE_2D) {
+                invalidateTextures();
+            }
+            return;
+        }
+        if (count(TEXTURE, texture == m_textures[unit]) && check(GL_TEXTURE_BINDING_2D, m_textures[unit], "texture")) {
+            return;
+        }
+        glBindTexture(target, texture);
+        m_textures[unit] = texture;
+    }
+
+    // texture on GL_TEXTURE0 + unit, for sampling. The active unit only changes when the texture wasn't
+    // there yet, so glTexParameter* and friends need activeTexture() and the other bindTexture().
+    void bindTexture(GLuint unit, GLenum target, GLuint texture) {
+        if (target == GL_TEXTURE_2D && unit < TEXTURE_UNITS && texture == m_textures[unit]) {
+            count(TEXTURE, true);
+            if (!CHECKED || check(GL_TEXTURE0 + unit, GL_TEXTURE_BINDING_2D, m_textures[unit])) {
+                return;
+            }
+        }
+        activeTexture(GL_TEXTURE0 + unit);
+        bindTexture(target, texture);
+    }
+
+    void bindVertexArray(GLuint VAO) {
+        if (count(VERTEX_ARRAY, VAO == m_VAO) && check(GL_VERTEX_ARRAY_BINDING, m_VAO, "VAO")) {
+            return;
+        }
+        glBindVertexArray(VAO);
+        m_VAO = VAO;
+    }
+
+    // GL_CULL_FACE, GL_DEPTH_TEST, GL_BLEND and GL_RASTERIZER_DISCARD are shadowed, others always go through.
+    void setEnabled(GLenum capability, bool enabled) {
+        GLuint *shadow = capabilityShadow(capability);
+        if (shadow && count(CAPABILITY, *shadow == (GLuint)enabled) && checkCapability(capability, *shadow)) {
+            return;
+        }
+        if (enabled) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+        if (shadow) {
+            *shadow = enabled;
+        }
+    }
+    void enable(GLenum capability) {
+        setEnabled(capability, true);
+    }
+    void disable(GLenum capability) {
+        setEnabled(capability, false);
+    }
+
+    // GL unbinds a deleted texture from every unit and a deleted VAO if it was bound.
+    void textureDeleted(GLuint texture) {
+        for (GLuint &bound : m_textures) {
+            if (bound == texture) {
+                bound = 0;
+            }
+        }
+    }
+    void vertexArrayDeleted(GLuint VAO) {
+        if (VAO == m_VAO) {
+            m_VAO = 0;
+        }
+    }
+    // A deleted program stays current until another is used, but glCreateProgram may hand its name out
+    // again, and useProgram() of the new one must not be dropped. The binding becomes unknown, not 0.
+    void programDeleted(GLuint program) {
+        if (program == m_program) {
+            m_program = UNKNOWN;
+        }
+    }
+
+    // After code that changes the state without going through here.
+    void invalidate() {
+        m_program = m_activeTexture = m_VAO = UNKNOWN;
+        invalidateTextures();
+        for (GLuint &capability : m_capabilities) {
+            capability = UNKNOWN;
+        }
+    }
+
+    // Ends the frame's statistics; lastFrame() has them until the next endFrame().
+    void endFrame() {
+        if (CHECKED) {
+            verify();
+        }
+        m_lastFrame = m_frame;
+        m_frame = Stats();
+    }
+
+    const Stats& lastFrame() const {
+        return m_lastFrame;
+    }
+
+    // Compares everything the cache knows with GL. Costs a glGet per value, a debugging aid only.
+    bool verify() {
+        bool same = check(GL_CURRENT_PROGRAM, m_program, "program") &&
+                    check(GL_ACTIVE_TEXTURE, m_activeTexture, "active texture") &&
+                    check(GL_VERTEX_ARRAY_BINDING, m_VAO, "VAO");
+        for (GLuint unit = 0; unit < TEXTURE_UNITS && same; ++unit) {
+            same = check(GL_TEXTURE0 + unit, GL_TEXTURE_BINDING_2D, m_textures[unit]);
+        }
+        for (unsigned i = 0; i < CAPABILITIES && same; ++i) {
+            same = checkCapability(CAPABILITY_ENUMS[i], m_capabilities[i]);
+        }
+        return same;
+    }
+
+private:
+    static const GLuint UNKNOWN = 0xffffffffu;
+    static const unsigned CAPABILITIES = 4;
+    static constexpr GLenum CAPABILITY_ENUMS[CAPABILITIES] = {GL_CULL_FACE, GL_DEPTH_TEST, GL_BLEND, GL_RASTERIZER_DISCARD};
+#ifdef RG_CHECK_GL_STATE
+    static const bool CHECKED = true;
+#else
+    static const bool CHECKED = false;
+#endif
+
+    GLuint m_program = UNKNOWN;
+    GLuint m_activeTexture = UNKNOWN;
+    GLuint m_textures[TEXTURE_UNITS];
+    GLuint m_VAO = UNKNOWN;
+    GLuint m_capabilities[CAPABILITIES] = {UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN};
+    Stats m_frame, m_lastFrame;
+    bool m_drifted = false;
+
+    void invalidateTextures() {
+        for (GLuint &texture : m_textures) {
+            texture = UNKNOWN;
+        }
+    }
+
+    GLuint* capabilityShadow(GLenum capability) {
+        for (unsigned i = 0; i < CAPABILITIES; ++i) {
+            if (CAPABILITY_ENUMS[i] == capability) {
+                return &m_capabilities[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // counts the call, true when it can be dropped
+    bool count(Kind kind, bool redundant) {
+        ++m_frame.calls[kind];
+        m_frame.redundant[kind] += redundant;
+        return redundant;
+    }
+
+    // True when GL agrees with the cache, always without RG_CHECK_GL_STATE. An unknown value agrees with
+    // nothing, so it is never compared.
+    bool check(GLenum binding, GLuint &cached, const char *what) {
+        if (!CHECKED || cached == UNKNOWN) {
+            return true;
+        }
+        GLint actual = 0;
+        glGetIntegerv(binding, &actual);
+        return agrees((GLuint)actual, cached, what);
+    }
+
+    // a unit's binding, which has to be made active to be read
+    bool check(GLenum unit, GLenum binding, GLuint &cached) {
+        if (!CHECKED || cached == UNKNOWN) {
+            return true;
+        }
+        GLint active = GL_TEXTURE0, actual = 0;
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &active);
+        glActiveTexture(unit);
+        glGetIntegerv(binding, &actual);
+        glActiveTexture((GLenum)active);
+        return agrees((GLuint)actual, cached, "texture");
+    }
+
+    bool checkCapability(GLenum capability, GLuint &cached) {
+        if (!CHECKED || cached == UNKNOWN) {
+            return true;
+        }
+        return agrees(glIsEnabled(capability) ? 1u : 0u, cached, "capability");
+    }
+
+    bool agrees(GLuint actual, GLuint &cached, const char *what) {
+        if (actual == cached) {
+            return true;
+        }
+        if (!m_drifted) {
+            std::cout << "ERROR::GL_STATE::DRIFT " << what << " is " << actual << " in GL, the cache had " << cached
+                      << "; something changed it without going through rg::glState()" << std::endl;
+            m_drifted = true;
+        }
+        cached = actual;
+        return false;
+    }
+};
+
+constexpr GLenum GlState::CAPABILITY_ENUMS[GlState::CAPABILITIES];
+
+namespace rg {
+    // the one context's state
+    GlState& glState() {
+        static GlState state;
+        return state;
+    }
+};
+
+#endif //PROJECT_BASE_GLSTATE_H
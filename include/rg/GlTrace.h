@@ -0,0 +1,913 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_GLTRACE_H
+#define PROJECT_BASE_GLTRACE_H
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <rg/Error.h>
+#include <rg/GlCalls.h>
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER_BINDING
+#define GL_DRAW_INDIRECT_BUFFER_BINDING 0x8F43
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER_BINDING
+#define GL_SHADER_STORAGE_BUFFER_BINDING 0x90D3
+#endif
+
+// What one frame of a trace did, by call type. uploadBytes is the size of the upload records, the data
+// they carry included.
+struct GlTraceStats {
+    unsigned calls = 0;
+    unsigned types[GlCall::TYPES] = {};
+    uint64_t uploadBytes = 0;
+
+    void add(GlCall::Id id, uint64_t recordSize) {
+        GlCall::Type type = GlCall::type(id);
+        ++calls;
+        ++types[type];
+        if (type == GlCall::UPLOAD) {
+            uploadBytes += recordSize;
+        }
+    }
+
+    unsigned draws() const {
+        return types[GlCall::DRAW];
+    }
+    unsigned uniforms() const {
+        return types[GlCall::UNIFORM];
+    }
+};
+
+// GPU memory held by what the traced calls allocated: buffer stores, texture levels and renderbuffers.
+// Uncompressed texels count what their internal format takes.
+struct GlTraceMemory {
+    uint64_t buffers = 0;
+    uint64_t textures = 0;
+    uint64_t renderbuffers = 0;
+};
+
+namespace rg {
+    // A trace file is this header followed by records: a 2-byte GlCall::Id, the 4-byte size of what
+    // follows and then the arguments in order, little endian as the machine writes them. Integers and
+    // floats take their own size, pointers and GLsync 8 bytes. Calls passing data by pointer add it
+    // inline, see the GlTraceStub specialisations. A frame ends with a GlCall::FRAME_END record.
+    const char GL_TRACE_MAGIC[8] = {'R', 'G', 'T', 'R', 'A', 'C', 'E', '\0'};
+    const uint32_t GL_TRACE_VERSION = 1;
+    const size_t GL_TRACE_HEADER_SIZE = 16;
+    const size_t GL_TRACE_RECORD_HEADER_SIZE = 6;
+
+    // bytes glTexImage2D reads for a width x height image, rows aligned to alignment
+    size_t glImageSize(GLsizei width, GLsizei height, GLenum format, GLenum type, GLint alignment) {
+        size_t pixelSize;
+        if (type == GL_UNSIGNED_INT_24_8) {
+            pixelSize = 4;
+        } else {
+            size_t components = format == GL_RG ? 2 : format == GL_RGB || format == GL_BGR ? 3 :
+                                format == GL_RGBA || format == GL_BGRA ? 4 : 1;
+            size_t componentSize = type == GL_UNSIGNED_BYTE || type == GL_BYTE ? 1 :
+                                   type == GL_UNSIGNED_SHORT || type == GL_SHORT || type == GL_HALF_FLOAT ? 2 : 4;
+            pixelSize = components * componentSize;
+        }
+        if (width <= 0 || height <= 0) {
+            return 0;
+        }
+        size_t rowSize = pixelSize * width;
+        size_t rowStride = (rowSize + alignment - 1) / alignment * alignment;
+        return rowStride * (height - 1) + rowSize;
+    }
+
+    // bytes a texel or renderbuffer sample of an uncompressed internal format takes; three-channel
+    // formats are padded to four by the drivers
+    size_t glInternalFormatSize(GLint internalFormat) {
+        switch (internalFormat) {
+            case GL_RED: case GL_R8: return 1;
+            case GL_RG: case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+            case GL_RGBA16F: case GL_RG32F: return 8;
+            case GL_RGBA32F: return 16;
+            default: return 4;
+        }
+    }
+};
+
+// Records every GL call into a trace file and counts each frame's calls. Loaded in place of a context's
+// loader (GlTrace::loadFunction for gladLoadGLLoader and every other GLADloadproc user), it writes a
+// record and passes the call on to the function the wrapped loader returned: the driver's, or GlMock's
+// for runs without one. While recording, entry points outside RG_GL_CALLS load as null, so the code
+// takes the path it takes on a driver without them; in particular persistently mapped buffers, whose
+// writes would never be seen, fall back to glBufferSubData.
+//
+// Records go to a 1 MB buffer written out when full, so tracing a frame doesn't allocate. Without a
+// path nothing is written and only the statistics are kept; the entry points outside RG_GL_CALLS are
+// then the driver's own, uncounted, and the code takes the same paths as without a trace.
+//
+// Either way the memory the calls allocate is kept by buffer, texture level and renderbuffer name. Which
+// object an upload lands in is followed from the traced bind calls, so counting it doesn't cost a
+// glGetIntegerv.
+class GlTrace {
+public:
+    GlTrace() = default;
+
+    GlTrace(const GlTrace&) = delete;
+    GlTrace& operator=(const GlTrace&) = delete;
+
+    ~GlTrace() {
+        close();
+    }
+
+    // Traces the functions load returns from now on; path may be empty. Prints ERROR::GL_TRACE::OPEN and
+    // returns false when the file can't be created.
+    bool open(const std::string &path, GLADloadproc load) {
+        close();
+        if (!path.empty()) {
+            m_file = std::fopen(path.c_str(), "wb");
+            if (!m_file) {
+                std::cout << "ERROR::GL_TRACE::OPEN " << path << std::endl;
+                return false;
+            }
+            m_buffer.resize(1 << 20);
+            char header[rg::GL_TRACE_HEADER_SIZE];
+            uint32_t count = GlCall::COUNT;
+            std::memcpy(header, rg::GL_TRACE_MAGIC, 8);
+            std::memcpy(header + 8, &rg::GL_TRACE_VERSION, 4);
+            std::memcpy(header + 12, &count, 4);
+            std::fwrite(header, 1, sizeof(header), m_file);
+            m_written = sizeof(header);
+        }
+        m_load = load;
+        m_frames = 0;
+        m_frame = m_lastFrame = GlTraceStats();
+        // what a new context has bound
+        std::fill(std::begin(m_boundBuffers), std::end(m_boundBuffers), 0u);
+        std::fill(std::begin(m_boundTextures), std::end(m_boundTextures), 0u);
+        m_elementBuffers.clear();
+        m_vertexArray = m_renderbuffer = m_activeTexture = 0;
+        m_unpackAlignment = 4;
+        return true;
+    }
+
+    // Writes out what is buffered and closes the file. The traced functions keep being counted.
+    void close() {
+        if (m_file) {
+            flush();
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    // true once open() was called, whether or not there is a file
+    bool active() const {
+        return m_load != nullptr;
+    }
+    bool recording() const {
+        return m_file != nullptr;
+    }
+
+    static void* loadFunction(const char *name);
+
+    // Marks the end of a frame in the trace; lastFrame() has its statistics until the next one.
+    void endFrame() {
+        beginRecord(GlCall::FRAME_END, 0);
+        endRecord();
+        m_lastFrame = m_frame;
+        m_frame = GlTraceStats();
+        ++m_frames;
+    }
+
+    const GlTraceStats& lastFrame() const {
+        return m_lastFrame;
+    }
+    // The frame still being made, so far.
+    const GlTraceStats& frame() const {
+        return m_frame;
+    }
+    const GlTraceMemory& memory() const {
+        return m_memory;
+    }
+    unsigned long frames() const {
+        return m_frames;
+    }
+    // size of the trace so far, header included
+    uint64_t bytes() const {
+        return m_written + m_used;
+    }
+
+    // The rest is for the stubs.
+
+    template <typename F>
+    F target(GlCall::Id id) const {
+        return (F)m_targets[id];
+    }
+
+    // size is what the puts up to endRecord() add up to
+    void beginRecord(GlCall::Id id, uint64_t size) {
+        ASSERT(size <= 0xffffffffu, "GL trace record of " << size << " bytes");
+        m_record = id;
+        m_recordSize = size;
+        m_recordLeft = size + rg::GL_TRACE_RECORD_HEADER_SIZE;
+        uint16_t call = id;
+        uint32_t size32 = (uint32_t)size;
+        putBytes(&call, sizeof(call));
+        putBytes(&size32, sizeof(size32));
+    }
+
+    void endRecord() {
+        ASSERT(m_recordLeft == 0, GlCall::name(m_record) << " record is " << m_recordLeft << " bytes off");
+        if (m_record != GlCall::FRAME_END) {
+            m_frame.add(m_record, m_recordSize);
+        }
+    }
+
+    template <typename T>
+    void put(T value) {
+        putBytes(&value, sizeof(value));
+    }
+    template <typename T>
+    void put(T* pointer) {
+        put((uint64_t)(uintptr_t)pointer);
+    }
+
+    void putBytes(const void *data, size_t size) {
+        m_recordLeft -= size;
+        if (!m_file) {
+            return;
+        }
+        if (m_used + size > m_buffer.size()) {
+            flush();
+            if (size > m_buffer.size()) {
+                std::fwrite(data, 1, size, m_file);
+                m_written += size;
+                return;
+            }
+        }
+        std::memcpy(m_buffer.data() + m_used, data, size);
+        m_used += size;
+    }
+
+    // a length and the characters, no terminator
+    static uint64_t stringSize(const char *string, GLint length = -1) {
+        return 4 + (length >= 0 ? (size_t)length : std::strlen(string));
+    }
+    void putString(const char *string, GLint length = -1) {
+        uint32_t size = (uint32_t)(stringSize(string, length) - 4);
+        put(size);
+        putBytes(string, size);
+    }
+
+    // Pixels for glTexImage2D and friends: an offset into the bound GL_PIXEL_UNPACK_BUFFER or the data.
+    uint64_t pixelsSize(const void *pixels, size_t size) const {
+        return 1 + 8 + (unpackBuffer() || !pixels ? 0 : size);
+    }
+    void putPixels(const void *pixels, size_t size) {
+        bool inline_ = !unpackBuffer() && pixels;
+        put((uint8_t)inline_);
+        if (inline_) {
+            put((uint64_t)size);
+            putBytes(pixels, size);
+        } else {
+            put(pixels);
+        }
+    }
+
+    GLint unpackAlignment() const {
+        return m_unpackAlignment;
+    }
+
+    // the binds the accounting below needs, as the calls are passed on
+    void bufferBound(GLenum target, GLuint buffer) {
+        if (target == GL_ELEMENT_ARRAY_BUFFER) {
+            // part of the vertex array's state
+            m_elementBuffers[m_vertexArray] = buffer;
+        } else if (bufferSlot(target) < BUFFER_TARGETS) {
+            m_boundBuffers[bufferSlot(target)] = buffer;
+        }
+    }
+    void textureBound(GLenum target, GLuint texture) {
+        // the renderer only makes 2D textures
+        if (target == GL_TEXTURE_2D && m_activeTexture < TEXTURE_UNITS) {
+            m_boundTextures[m_activeTexture] = texture;
+        }
+    }
+    void activeTexture(GLenum unit) {
+        m_activeTexture = unit - GL_TEXTURE0;
+    }
+    void renderbufferBound(GLuint renderbuffer) {
+        m_renderbuffer = renderbuffer;
+    }
+    void vertexArrayBound(GLuint vertexArray) {
+        m_vertexArray = vertexArray;
+    }
+    void pixelStored(GLenum name, GLint value) {
+        if (name == GL_UNPACK_ALIGNMENT) {
+            m_unpackAlignment = value;
+        }
+    }
+
+    // what the bound object now holds, replacing what it held before
+    void bufferAllocated(GLenum target, uint64_t size) {
+        resize(m_bufferSizes, boundBuffer(target), size, m_memory.buffers);
+    }
+    void textureAllocated(GLenum target, GLint level, uint64_t size) {
+        if (target == GL_TEXTURE_2D && m_activeTexture < TEXTURE_UNITS) {
+            resize(m_textureSizes, textureKey(m_boundTextures[m_activeTexture], level), size, m_memory.textures);
+        }
+    }
+    void renderbufferAllocated(uint64_t size) {
+        resize(m_renderbufferSizes, m_renderbuffer, size, m_memory.renderbuffers);
+    }
+    // Deleting a bound object also unbinds it, from the current vertex array as well.
+    void deleted(GlCall::Id call, GLsizei n, const GLuint *names) {
+        for (GLsizei i = 0; i < n; ++i) {
+            if (call == GlCall::DeleteBuffers) {
+                release(m_bufferSizes, names[i], m_memory.buffers);
+                unbind(m_boundBuffers, names[i]);
+                Bindings::iterator elements = m_elementBuffers.find(m_vertexArray);
+                if (elements != m_elementBuffers.end() && elements->second == names[i]) {
+                    elements->second = 0;
+                }
+            } else if (call == GlCall::DeleteRenderbuffers) {
+                release(m_renderbufferSizes, names[i], m_memory.renderbuffers);
+                m_renderbuffer = m_renderbuffer == names[i] ? 0 : m_renderbuffer;
+            } else if (call == GlCall::DeleteTextures) {
+                for (GLint level = 0; level < MAX_LEVELS; ++level) {
+                    release(m_textureSizes, textureKey(names[i], level), m_memory.textures);
+                }
+                unbind(m_boundTextures, names[i]);
+            } else if (call == GlCall::DeleteVertexArrays && names[i] != 0) {
+                m_elementBuffers.erase(names[i]);
+                m_vertexArray = m_vertexArray == names[i] ? 0 : m_vertexArray;
+            }
+        }
+    }
+
+    // glMapBufferRange's result, kept until glUnmapBuffer records what was written into it
+    void mapped(GLenum target, void *data, GLsizeiptr length, GLbitfield access) {
+        Mapping &mapping = m_mappings[mappingSlot(target)];
+        mapping.target = target;
+        mapping.data = data;
+        mapping.length = data && (access & GL_MAP_WRITE_BIT) ? length : 0;
+    }
+    // what the mapping of target has to record, 0 when nothing was written through it
+    GLsizeiptr mappedLength(GLenum target) const {
+        const Mapping &mapping = m_mappings[mappingSlot(target)];
+        return mapping.target == target ? mapping.length : 0;
+    }
+    const void* mappedData(GLenum target) const {
+        return m_mappings[mappingSlot(target)].data;
+    }
+
+private:
+    using Sizes = std::unordered_map<uint64_t, uint64_t>;
+    using Bindings = std::unordered_map<GLuint, GLuint>;
+    static const GLint MAX_LEVELS = 32;
+    static const unsigned BUFFER_TARGETS = 9;
+    static const unsigned TEXTURE_UNITS = 32;
+
+    struct Mapping {
+        GLenum target = 0;
+        void *data = nullptr;
+        GLsizeiptr length = 0;
+    };
+
+    GLADloadproc m_load = nullptr;
+    void* m_targets[GlCall::COUNT] = {};
+    std::FILE *m_file = nullptr;
+    std::vector<char> m_buffer;
+    size_t m_used = 0;
+    uint64_t m_written = 0;
+    GlCall::Id m_record = GlCall::FRAME_END;
+    uint64_t m_recordSize = 0, m_recordLeft = 0;
+    GlTraceStats m_frame, m_lastFrame;
+    unsigned long m_frames = 0;
+    Mapping m_mappings[4];
+    Sizes m_bufferSizes, m_textureSizes, m_renderbufferSizes;
+    GlTraceMemory m_memory;
+    void *m_bufferStorage = nullptr;
+    // by bufferSlot(); the element array buffer of each vertex array, 0 included
+    GLuint m_boundBuffers[BUFFER_TARGETS] = {};
+    Bindings m_elementBuffers;
+    GLuint m_vertexArray = 0;
+    GLuint m_boundTextures[TEXTURE_UNITS] = {};
+    GLuint m_activeTexture = 0;
+    GLuint m_renderbuffer = 0;
+    GLint m_unpackAlignment = 4;
+
+    static void APIENTRY bufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+    static uint64_t textureKey(GLuint texture, GLint level) {
+        return (uint64_t)texture * MAX_LEVELS + (uint64_t)level;
+    }
+
+    static void resize(Sizes &sizes, uint64_t name, uint64_t size, uint64_t &total) {
+        if (name == 0) {
+            return;
+        }
+        uint64_t &held = sizes[name];
+        total = total - held + size;
+        held = size;
+    }
+    static void release(Sizes &sizes, uint64_t name, uint64_t &total) {
+        Sizes::iterator found = sizes.find(name);
+        if (found != sizes.end()) {
+            total -= found->second;
+            sizes.erase(found);
+        }
+    }
+
+    template <size_t N>
+    static void unbind(GLuint (&bindings)[N], GLuint name) {
+        for (GLuint &bound : bindings) {
+            bound = bound == name ? 0 : bound;
+        }
+    }
+
+    GLuint boundBuffer(GLenum target) const {
+        if (target == GL_ELEMENT_ARRAY_BUFFER) {
+            Bindings::const_iterator elements = m_elementBuffers.find(m_vertexArray);
+            return elements != m_elementBuffers.end() ? elements->second : 0;
+        }
+        unsigned slot = bufferSlot(target);
+        return slot < BUFFER_TARGETS ? m_boundBuffers[slot] : 0;
+    }
+    // the generic targets followed, BUFFER_TARGETS for the others
+    static unsigned bufferSlot(GLenum target) {
+        switch (target) {
+            case GL_ARRAY_BUFFER: return 0;
+            case GL_UNIFORM_BUFFER: return 1;
+            case GL_PIXEL_UNPACK_BUFFER: return 2;
+            case GL_PIXEL_PACK_BUFFER: return 3;
+            case GL_TRANSFORM_FEEDBACK_BUFFER: return 4;
+            case GL_COPY_READ_BUFFER: return 5;
+            case GL_COPY_WRITE_BUFFER: return 6;
+            case GL_DRAW_INDIRECT_BUFFER: return 7;
+            case GL_SHADER_STORAGE_BUFFER: return 8;
+            default: return BUFFER_TARGETS;
+        }
+    }
+
+    static size_t mappingSlot(GLenum target) {
+        return target == GL_PIXEL_UNPACK_BUFFER ? 0 : target == GL_UNIFORM_BUFFER ? 1 : target == GL_ARRAY_BUFFER ? 2 : 3;
+    }
+
+    GLuint unpackBuffer() const {
+        return boundBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    void flush() {
+        if (m_file && m_used) {
+            std::fwrite(m_buffer.data(), 1, m_used, m_file);
+            m_written += m_used;
+            m_used = 0;
+        }
+    }
+};
+
+namespace rg {
+    // the one trace
+    GlTrace& glTrace() {
+        static GlTrace trace;
+        return trace;
+    }
+};
+
+// What a call binds, for the trace to follow; nothing for most.
+template <GlCall::Id C>
+struct GlTraceBind {
+    template <typename... A>
+    static void bound(GlTrace&, A...) {}
+};
+template <>
+struct GlTraceBind<GlCall::BindBuffer> {
+    static void bound(GlTrace &trace, GLenum target, GLuint buffer) {
+        trace.bufferBound(target, buffer);
+    }
+};
+// binds the generic target as well as the indexed one
+template <>
+struct GlTraceBind<GlCall::BindBufferBase> {
+    static void bound(GlTrace &trace, GLenum target, GLuint, GLuint buffer) {
+        trace.bufferBound(target, buffer);
+    }
+};
+template <>
+struct GlTraceBind<GlCall::BindBufferRange> {
+    static void bound(GlTrace &trace, GLenum target, GLuint, GLuint buffer, GLintptr, GLsizeiptr) {
+        trace.bufferBound(target, buffer);
+    }
+};
+template <>
+struct GlTraceBind<GlCall::BindTexture> {
+    static void bound(GlTrace &trace, GLenum target, GLuint texture) {
+        trace.textureBound(target, texture);
+    }
+};
+template <>
+struct GlTraceBind<GlCall::ActiveTexture> {
+    static void bound(GlTrace &trace, GLenum unit) {
+        trace.activeTexture(unit);
+    }
+};
+template <>
+struct GlTraceBind<GlCall::BindRenderbuffer> {
+    static void bound(GlTrace &trace, GLenum, GLuint renderbuffer) {
+        trace.renderbufferBound(renderbuffer);
+    }
+};
+template <>
+struct GlTraceBind<GlCall::BindVertexArray> {
+    static void bound(GlTrace &trace, GLuint vertexArray) {
+        trace.vertexArrayBound(vertexArray);
+    }
+};
+template <>
+struct GlTraceBind<GlCall::PixelStorei> {
+    static void bound(GlTrace &trace, GLenum name, GLint value) {
+        trace.pixelStored(name, value);
+    }
+};
+
+// Records a call, then makes it. Arguments are written by type, pointers as their value: offsets into
+// a bound buffer, or output pointers the replay points at its own memory.
+template <GlCall::Id C, typename F>
+struct GlTraceStub;
+template <GlCall::Id C, typename R, typename... A>
+struct GlTraceStub<C, R (APIENTRYP)(A...)> {
+    static uint64_t size() {
+        uint64_t sizes[] = {0, (std::is_pointer<A>::value ? 8 : sizeof(A))...};
+        uint64_t total = 0;
+        for (uint64_t size : sizes) {
+            total += size;
+        }
+        return total;
+    }
+
+    static R APIENTRY call(A... arguments) {
+        GlTrace &trace = rg::glTrace();
+        trace.beginRecord(C, size());
+        // in order, which a braced list guarantees
+        int written[] = {0, (trace.put(arguments), 0)...};
+        (void)written;
+        trace.endRecord();
+        GlTraceBind<C>::bound(trace, arguments...);
+        return trace.target<R (APIENTRYP)(A...)>(C)(arguments...);
+    }
+};
+
+// target, size, usage, whether data follows (1 byte), data
+template <>
+struct GlTraceStub<GlCall::BufferData, PFNGLBUFFERDATAPROC> {
+    static void APIENTRY call(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+        GlTrace &trace = rg::glTrace();
+        trace.beginRecord(GlCall::BufferData, 4 + 8 + 4 + 1 + (data ? size : 0));
+        trace.put(target);
+        trace.put(size);
+        trace.put(usage);
+        trace.put((uint8_t)(data != nullptr));
+        if (data) {
+            trace.putBytes(data, (size_t)size);
+        }
+        trace.endRecord();
+        trace.target<PFNGLBUFFERDATAPROC>(GlCall::BufferData)(target, size, data, usage);
+        trace.bufferAllocated(target, (uint64_t)size);
+    }
+};
+
+// target, offset, size, data
+template <>
+struct GlTraceStub<GlCall::BufferSubData, PFNGLBUFFERSUBDATAPROC> {
+    static void APIENTRY call(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+        GlTrace &trace = rg::glTrace();
+        trace.beginRecord(GlCall::BufferSubData, 4 + 8 + 8 + size);
+        trace.put(target);
+        trace.put(offset);
+        trace.put(size);
+        trace.putBytes(data, (size_t)size);
+        trace.endRecord();
+        trace.target<PFNGLBUFFERSUBDATAPROC>(GlCall::BufferSubData)(target, offset, size, data);
+    }
+};
+
+// the eight value arguments, then the pixels (GlTrace::putPixels)
+template <>
+struct GlTraceStub<GlCall::TexImage2D, PFNGLTEXIMAGE2DPROC> {
+    static void APIENTRY call(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                              GLint border, GLenum format, GLenum type, const void *pixels) {
+        GlTrace &trace = rg::glTrace();
+        size_t size = rg::glImageSize(width, height, format, type, trace.unpackAlignment());
+        trace.beginRecord(GlCall::TexImage2D, 8 * 4 + trace.pixelsSize(pixels, size));
+        trace.put(target);
+        trace.put(level);
+        trace.put(internalFormat);
+        trace.put(width);
+        trace.put(height);
+        trace.put(border);
+        trace.put(format);
+        trace.put(type);
+        trace.putPixels(pixels, size);
+        trace.endRecord();
+        trace.target<PFNGLTEXIMAGE2DPROC>(GlCall::TexImage2D)(target, level, internalFormat, width, height, border,
+                                                             format, type, pixels);
+        trace.textureAllocated(target, level, (uint64_t)width * height * rg::glInternalFormatSize(internalFormat));
+    }
+};
+
+// the seven value arguments, then the pixels
+template <>
+struct GlTraceStub<GlCall::CompressedTexImage2D, PFNGLCOMPRESSEDTEXIMAGE2DPROC> {
+    static void APIENTRY call(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                              GLint border, GLsizei imageSize, const void *data) {
+        GlTrace &trace = rg::glTrace();
+        trace.beginRecord(GlCall::CompressedTexImage2D, 7 * 4 + trace.pixelsSize(data, (size_t)imageSize));
+        trace.put(target);
+        trace.put(level);
+        trace.put(internalFormat);
+        trace.put(width);
+        trace.put(height);
+        trace.put(border);
+        trace.put(imageSize);
+        trace.putPixels(data, (size_t)imageSize);
+        trace.endRecord();
+        trace.target<PFNGLCOMPRESSEDTEXIMAGE2DPROC>(GlCall::CompressedTexImage2D)(target, level, internalFormat, width,
+                                                                                 height, border, imageSize, data);
+        trace.textureAllocated(target, level, (uint64_t)imageSize);
+    }
+};
+
+// recorded like any other call, the storage is counted
+template <>
+struct GlTraceStub<GlCall::RenderbufferStorage, PFNGLRENDERBUFFERSTORAGEPROC> {
+    static void APIENTRY call(GLenum target, GLenum internalFormat, GLsizei width, GLsizei height) {
+        GlTrace &trace = rg::glTrace();
+        trace.beginRecord(GlCall::RenderbufferStorage, 4 * 4);
+        trace.put(target);
+        trace.put(internalFormat);
+        trace.put(width);
+        trace.put(height);
+        trace.endRecord();
+        trace.target<PFNGLRENDERBUFFERSTORAGEPROC>(GlCall::RenderbufferStorage)(target, internalFormat, width, height);
+        trace.renderbufferAllocated((uint64_t)width * height * rg::glInternalFormatSize((GLint)internalFormat));
+    }
+};
+
+// glGen*: n, then the names made
+template <GlCall::Id C>
+struct GlTraceGenStub {
+    static void APIENTRY call(GLsizei n, GLuint *names) {
+        GlTrace &trace = rg::glTrace();
+        trace.target<PFNGLGENBUFFERSPROC>(C)(n, names);
+        trace.beginRecord(C, 4 + 4 * (uint64_t)n);
+        trace.put(n);
+        trace.putBytes(names, 4 * (size_t)n);
+        trace.endRecord();
+    }
+};
+template <> struct GlTraceStub<GlCall::GenBuffers, PFNGLGENBUFFERSPROC> : GlTraceGenStub<GlCall::GenBuffers> {};
+template <> struct GlTraceStub<GlCall::GenFramebuffers, PFNGLGENFRAMEBUFFERSPROC> : GlTraceGenStub<GlCall::GenFramebuffers> {};
+template <> struct GlTraceStub<GlCall::GenQueries, PFNGLGENQUERIESPROC> : GlTraceGenStub<GlCall::GenQueries> {};
+template <> struct GlTraceStub<GlCall::GenRenderbuffers, PFNGLGENRENDERBUFFERSPROC> : GlTraceGenStub<GlCall::GenRenderbuffers> {};
+template <> struct GlTraceStub<GlCall::GenTextures, PFNGLGENTEXTURESPROC> : GlTraceGenStub<GlCall::GenTextures> {};
+template <> struct GlTraceStub<GlCall::GenVertexArrays, PFNGLGENVERTEXARRAYSPROC> : GlTraceGenStub<GlCall::GenVertexArrays> {};
+
+// glDelete*: n, then the names
+template <GlCall::Id C>
+struct GlTraceDeleteStub {
+    static void APIENTRY call(GLsizei n, const GLuint *names) {
+        GlTrace &trace = rg::glTrace();
+        trace.beginRecord(C, 4 + 4 * (uint64_t)n);
+        trace.put(n);
+        trace.putBytes(names, 4 * (size_t)n);
+        trace.endRecord();
+        trace.deleted(C, n, names);
+        trace.target<PFNGLDELETEBUFFERSPROC>(C)(n, names);
+    }
+};
+template <> struct GlTraceStub<GlCall::DeleteBuffers, PFNGLDELETEBUFFERSPROC> : GlTraceDeleteStub<GlCall::DeleteBuffers> {};
+template <> struct GlTraceStub<GlCall::DeleteFramebuffers, PFNGLDELETEFRAMEBUFFERSPROC> : GlTraceDeleteStub<GlCall::DeleteFramebuffers> {};
+template <> struct GlTraceStub<GlCall::DeleteQueries, PFNGLDELETEQUERIESPROC> : GlTraceDeleteStub<GlCall::DeleteQueries> {};
+template <> struct GlTraceStub<GlCall::DeleteRenderbuffers, PFNGLDELETERENDERBUFFERSPROC> : GlTraceDeleteStub<GlCall::DeleteRenderbuffers> {};
+template <> struct GlTraceStub<GlCall::DeleteTextures, PFNGLDELETETEXTURESPROC> : GlTraceDeleteStub<GlCall::DeleteTextures> {};
+template <> struct GlTraceStub<GlCall::DeleteVertexArrays, PFNGLDELETEVERTEXARRAYSPROC> : GlTraceDeleteStub<GlCall::DeleteVertexArrays> {};
+
+// no arguments, then the program made
+template <>
+struct GlTraceStub<GlCall::CreateProgram, PFNGLCREATEPROGRAMPROC> {
+    static GLuint APIENTRY call() {
+        GlTrace &trace = rg::glTrace();
+        GLuint program = trace.target<PFNGLCREATEPROGRAMPROC>(GlCall::CreateProgram)();
+        trace.beginRecord(GlCall::CreateProgram, 4);
+        trace.put(program);
+        trace.endRecord();
+        return program;
+    }
+};
+
+// type, then the shader made
+template <>
+struct GlTraceStub<GlCall::CreateShader, PFNGLCREATESHADERPROC> {
+    static GLuint APIENTRY call(GLenum type) {
+        GlTrace &trace = rg::glTrace();
+        GLuint shader = trace.target<PFNGLCREATESHADERPROC>(GlCall::CreateShader)(type);
+        trace.beginRecord(GlCall::CreateShader, 8);
+        trace.put(type);
+        trace.put(shader);
+        trace.endRecord();
+        return shader;
+    }
+};
+
+// condition, flags, then the sync object made
+template <>
+struct GlTraceStub<GlCall::FenceSync, PFNGLFENCESYNCPROC> {
+    static GLsync APIENTRY call(GLenum condition, GLbitfield flags) {
+        GlTrace &trace = rg::glTrace();
+        GLsync sync = trace.target<PFNGLFENCESYNCPROC>(GlCall::FenceSync)(condition, flags);
+        trace.beginRecord(GlCall::FenceSync, 4 + 4 + 8);
+        trace.put(condition);
+        trace.put(flags);
+        trace.put(sync);
+        trace.endRecord();
+        return sync;
+    }
+};
+
+// program, name (GlTrace::putString), then the location or index GL answered
+template <GlCall::Id C, typename F, typename R>
+struct GlTraceNameQueryStub {
+    static R APIENTRY call(GLuint program, const GLchar *name) {
+        GlTrace &trace = rg::glTrace();
+        R result = trace.target<F>(C)(program, name);
+        trace.beginRecord(C, 4 + GlTrace::stringSize(name) + 4);
+        trace.put(program);
+        trace.putString(name);
+        trace.put(result);
+        trace.endRecord();
+        return result;
+    }
+};
+template <> struct GlTraceStub<GlCall::GetUniformLocation, PFNGLGETUNIFORMLOCATIONPROC>
+        : GlTraceNameQueryStub<GlCall::GetUniformLocation, PFNGLGETUNIFORMLOCATIONPROC, GLint> {};
+template <> struct GlTraceStub<GlCall::GetUniformBlockIndex, PFNGLGETUNIFORMBLOCKINDEXPROC>
+        : GlTraceNameQueryStub<GlCall::GetUniformBlockIndex, PFNGLGETUNIFORMBLOCKINDEXPROC, GLuint> {};
+
+// shader, count, then count strings
+template <>
+struct GlTraceStub<GlCall::ShaderSource, PFNGLSHADERSOURCEPROC> {
+    static void APIENTRY call(GLuint shader, GLsizei count, const GLchar *const *strings, const GLint *lengths) {
+        GlTrace &trace = rg::glTrace();
+        uint64_t size = 4 + 4;
+        for (GLsizei i = 0; i < count; ++i) {
+            size += GlTrace::stringSize(strings[i], lengths ? lengths[i] : -1);
+        }
+        trace.beginRecord(GlCall::ShaderSource, size);
+        trace.put(shader);
+        trace.put(count);
+        for (GLsizei i = 0; i < count; ++i) {
+            trace.putString(strings[i], lengths ? lengths[i] : -1);
+        }
+        trace.endRecord();
+        trace.target<PFNGLSHADERSOURCEPROC>(GlCall::ShaderSource)(shader, count, strings, lengths);
+    }
+};
+
+// program, count, count strings, then the buffer mode
+template <>
+struct GlTraceStub<GlCall::TransformFeedbackVaryings, PFNGLTRANSFORMFEEDBACKVARYINGSPROC> {
+    static void APIENTRY call(GLuint program, GLsizei count, const GLchar *const *varyings, GLenum bufferMode) {
+        GlTrace &trace = rg::glTrace();
+        uint64_t size = 4 + 4 + 4;
+        for (GLsizei i = 0; i < count; ++i) {
+            size += GlTrace::stringSize(varyings[i]);
+        }
+        trace.beginRecord(GlCall::TransformFeedbackVaryings, size);
+        trace.put(program);
+        trace.put(count);
+        for (GLsizei i = 0; i < count; ++i) {
+            trace.putString(varyings[i]);
+        }
+        trace.put(bufferMode);
+        trace.endRecord();
+        trace.target<PFNGLTRANSFORMFEEDBACKVARYINGSPROC>(GlCall::TransformFeedbackVaryings)(program, count, varyings,
+                                                                                           bufferMode);
+    }
+};
+
+// glUniform*fv: location, count, then count * N floats
+template <GlCall::Id C, unsigned N>
+struct GlTraceUniformStub {
+    static void APIENTRY call(GLint location, GLsizei count, const GLfloat *value) {
+        GlTrace &trace = rg::glTrace();
+        size_t size = sizeof(GLfloat) * N * count;
+        trace.beginRecord(C, 4 + 4 + size);
+        trace.put(location);
+        trace.put(count);
+        trace.putBytes(value, size);
+        trace.endRecord();
+        trace.target<PFNGLUNIFORM2FVPROC>(C)(location, count, value);
+    }
+};
+template <> struct GlTraceStub<GlCall::Uniform2fv, PFNGLUNIFORM2FVPROC> : GlTraceUniformStub<GlCall::Uniform2fv, 2> {};
+template <> struct GlTraceStub<GlCall::Uniform3fv, PFNGLUNIFORM3FVPROC> : GlTraceUniformStub<GlCall::Uniform3fv, 3> {};
+template <> struct GlTraceStub<GlCall::Uniform4fv, PFNGLUNIFORM4FVPROC> : GlTraceUniformStub<GlCall::Uniform4fv, 4> {};
+
+// glUniformMatrix*fv: location, count, transpose, then count * N floats
+template <GlCall::Id C, unsigned N>
+struct GlTraceUniformMatrixStub {
+    static void APIENTRY call(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+        GlTrace &trace = rg::glTrace();
+        size_t size = sizeof(GLfloat) * N * count;
+        trace.beginRecord(C, 4 + 4 + 1 + size);
+        trace.put(location);
+        trace.put(count);
+        trace.put(transpose);
+        trace.putBytes(value, size);
+        trace.endRecord();
+        trace.target<PFNGLUNIFORMMATRIX4FVPROC>(C)(location, count, transpose, value);
+    }
+};
+template <> struct GlTraceStub<GlCall::UniformMatrix2fv, PFNGLUNIFORMMATRIX2FVPROC> : GlTraceUniformMatrixStub<GlCall::UniformMatrix2fv, 4> {};
+template <> struct GlTraceStub<GlCall::UniformMatrix3fv, PFNGLUNIFORMMATRIX3FVPROC> : GlTraceUniformMatrixStub<GlCall::UniformMatrix3fv, 9> {};
+template <> struct GlTraceStub<GlCall::UniformMatrix4fv, PFNGLUNIFORMMATRIX4FVPROC> : GlTraceUniformMatrixStub<GlCall::UniformMatrix4fv, 16> {};
+
+// recorded like any other call; the mapping is remembered for glUnmapBuffer
+template <>
+struct GlTraceStub<GlCall::MapBufferRange, PFNGLMAPBUFFERRANGEPROC> {
+    static void* APIENTRY call(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+        GlTrace &trace = rg::glTrace();
+        void *data = trace.target<PFNGLMAPBUFFERRANGEPROC>(GlCall::MapBufferRange)(target, offset, length, access);
+        trace.beginRecord(GlCall::MapBufferRange, 4 + 8 + 8 + 4);
+        trace.put(target);
+        trace.put(offset);
+        trace.put(length);
+        trace.put(access);
+        trace.endRecord();
+        trace.mapped(target, data, length, access);
+        return data;
+    }
+};
+
+// target, then what was written through the mapping: its length (8 bytes, 0 for a read mapping) and data
+template <>
+struct GlTraceStub<GlCall::UnmapBuffer, PFNGLUNMAPBUFFERPROC> {
+    static GLboolean APIENTRY call(GLenum target) {
+        GlTrace &trace = rg::glTrace();
+        GLsizeiptr length = trace.mappedLength(target);
+        trace.beginRecord(GlCall::UnmapBuffer, 4 + 8 + length);
+        trace.put(target);
+        trace.put(length);
+        trace.putBytes(trace.mappedData(target), (size_t)length);
+        trace.endRecord();
+        trace.mapped(target, nullptr, 0, 0);
+        return trace.target<PFNGLUNMAPBUFFERPROC>(GlCall::UnmapBuffer)(target);
+    }
+};
+
+void* GlTrace::loadFunction(const char *name) {
+    static void* const stubs[GlCall::COUNT] = {
+#define RG_GL_TRACE_STUB(name, kinds, type) (void*)&GlTraceStub<GlCall::name, decltype(glad_gl##name)>::call,
+            RG_GL_CALLS(RG_GL_TRACE_STUB)
+#undef RG_GL_TRACE_STUB
+    };
+    GlTrace &trace = rg::glTrace();
+    GlCall::Id id = GlCall::find(name);
+    if (!trace.m_load) {
+        return nullptr;
+    }
+    if (id == GlCall::COUNT) {
+        if (trace.m_file) {
+            return nullptr;
+        }
+        if (std::strcmp(name, "glBufferStorage") == 0) {
+            trace.m_bufferStorage = trace.m_load(name);
+            return trace.m_bufferStorage ? (void*)&bufferStorage : nullptr;
+        }
+        return trace.m_load(name);
+    }
+    trace.m_targets[id] = trace.m_load(name);
+    return trace.m_targets[id] ? stubs[id] : nullptr;
+}
+
+void APIENTRY GlTrace::bufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) {
+    GlTrace &trace = rg::glTrace();
+    typedef void (APIENTRYP BufferStorageProc)(GLenum, GLsizeiptr, const void*, GLbitfield);
+    ((BufferStorageProc)trace.m_bufferStorage)(target, size, data, flags);
+    trace.bufferAllocated(target, (uint64_t)size);
+}
+
+#endif //PROJECT_BASE_GLTRACE_H
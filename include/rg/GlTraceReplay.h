@@ -0,0 +1,470 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_GLTRACEREPLAY_H
+#define PROJECT_BASE_GLTRACEREPLAY_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <rg/GlCalls.h>
+#include <rg/GlTrace.h>
+#include <rg/MappedFile.h>
+
+// A trace written by GlTrace, mapped read-only.
+class GlTraceFile {
+public:
+    struct Record {
+        GlCall::Id call = GlCall::FRAME_END;
+        const char *data = nullptr;
+        uint32_t size = 0;
+    };
+
+    // Prints ERROR::GL_TRACE:: and returns false when path isn't a trace this build can read.
+    bool open(const std::string &path) {
+        if (!m_file.open(path)) {
+            std::cout << "ERROR::GL_TRACE::CANNOT_OPEN " << path << std::endl;
+            return false;
+        }
+        uint32_t version = 0, calls = 0;
+        if (m_file.size() < rg::GL_TRACE_HEADER_SIZE || std::memcmp(m_file.data(), rg::GL_TRACE_MAGIC, 8) != 0) {
+            std::cout << "ERROR::GL_TRACE::NOT_A_TRACE " << path << std::endl;
+            m_file.close();
+            return false;
+        }
+        std::memcpy(&version, m_file.data() + 8, 4);
+        std::memcpy(&calls, m_file.data() + 12, 4);
+        if (version != rg::GL_TRACE_VERSION || calls != GlCall::COUNT) {
+            std::cout << "ERROR::GL_TRACE::VERSION " << path << " is version " << version << " with " << calls
+                      << " calls, this build reads " << rg::GL_TRACE_VERSION << " with " << GlCall::COUNT << std::endl;
+            m_file.close();
+            return false;
+        }
+        return true;
+    }
+
+    // offset of the first record
+    size_t begin() const {
+        return rg::GL_TRACE_HEADER_SIZE;
+    }
+
+    // Reads the record at offset and moves offset past it; false at the end, or at a record cut short
+    // by a run that didn't close its trace.
+    bool next(size_t &offset, Record &record) const {
+        if (offset + rg::GL_TRACE_RECORD_HEADER_SIZE > m_file.size()) {
+            return false;
+        }
+        uint16_t call;
+        std::memcpy(&call, m_file.data() + offset, 2);
+        std::memcpy(&record.size, m_file.data() + offset + 2, 4);
+        if (call > GlCall::COUNT || offset + rg::GL_TRACE_RECORD_HEADER_SIZE + record.size > m_file.size()) {
+            return false;
+        }
+        record.call = (GlCall::Id)call;
+        record.data = m_file.data() + offset + rg::GL_TRACE_RECORD_HEADER_SIZE;
+        offset += rg::GL_TRACE_RECORD_HEADER_SIZE + record.size;
+        return true;
+    }
+
+    // One entry per frame end in the trace. Frame 0 includes everything before it, loading too; calls
+    // after the last frame end (shutdown) are left out.
+    void frameStats(std::vector<GlTraceStats> &frames) const {
+        frames.clear();
+        GlTraceStats frame;
+        size_t offset = begin();
+        Record record;
+        while (next(offset, record)) {
+            if (record.call == GlCall::FRAME_END) {
+                frames.push_back(frame);
+                frame = GlTraceStats();
+            } else {
+                frame.add(record.call, record.size);
+            }
+        }
+    }
+
+private:
+    MappedFile m_file;
+};
+
+// Plays a trace back against the current context, frame by frame. Names the trace made (buffers,
+// textures, programs, ...) are mapped to the ones the context makes when the same glGen*/glCreate* call
+// is replayed, uniform locations and block indices to what the context answers for the same name, sync
+// objects to the fences it creates. Data a call passed by pointer comes from the trace; pointers GL
+// writes through point at scratch memory.
+class GlTraceReplay {
+public:
+    explicit GlTraceReplay(const GlTraceFile &file) : m_file(file), m_offset(file.begin()) {
+        m_scratch.resize(1 << 16);
+    }
+
+    GlTraceReplay(const GlTraceReplay&) = delete;
+    GlTraceReplay& operator=(const GlTraceReplay&) = delete;
+
+    // Replays the calls up to and including the next frame end; false once the trace is over.
+    bool replayFrame() {
+        GlTraceFile::Record record;
+        while (m_file.next(m_offset, record)) {
+            if (record.call == GlCall::FRAME_END) {
+                return true;
+            }
+            replay(record);
+            ++m_calls;
+        }
+        return false;
+    }
+
+    unsigned long calls() const {
+        return m_calls;
+    }
+
+    // The rest is for the generic replay of a call's arguments.
+
+    template <typename T>
+    T get() {
+        T value;
+        std::memcpy(&value, m_cursor, sizeof(T));
+        m_cursor += sizeof(T);
+        return value;
+    }
+
+    // the next argument of a call, a name or location mapped by its kind (see RG_GL_CALLS)
+    template <typename T>
+    typename std::enable_if<!std::is_pointer<T>::value, T>::type argument(char kind) {
+        T value = get<T>();
+        return kind == 'v' ? value : (T)mapped(kind, (int64_t)value);
+    }
+    template <typename T>
+    typename std::enable_if<std::is_pointer<T>::value, T>::type argument(char kind) {
+        uint64_t value = get<uint64_t>();
+        if (kind == 'o') {
+            return (T)m_scratch.data();
+        }
+        if (kind == 'K') {
+            return (T)m_syncs[value];
+        }
+        return (T)(uintptr_t)value;
+    }
+
+private:
+    // buffers, textures, vertex arrays, framebuffers, renderbuffers, queries, programs and shaders
+    static const char* kindLetters() {
+        return "BTAFRQP";
+    }
+
+    const GlTraceFile &m_file;
+    size_t m_offset;
+    const char *m_cursor = nullptr;
+    unsigned long m_calls = 0;
+
+    std::vector<GLuint> m_names[7];
+    GLuint m_program = 0;
+    std::unordered_map<uint64_t, GLint> m_locations;
+    std::unordered_map<uint64_t, GLuint> m_blockIndices;
+    std::unordered_map<uint64_t, GLsync> m_syncs;
+    void *m_mappings[4] = {};
+    std::vector<char> m_scratch;
+    std::vector<const GLchar*> m_strings;
+
+    static size_t mappingSlot(GLenum target) {
+        return target == GL_PIXEL_UNPACK_BUFFER ? 0 : target == GL_UNIFORM_BUFFER ? 1 : target == GL_ARRAY_BUFFER ? 2 : 3;
+    }
+
+    static uint64_t key(GLuint program, uint32_t value) {
+        return (uint64_t)program << 32 | value;
+    }
+
+    int64_t mapped(char kind, int64_t value) {
+        if (kind == 'L') {
+            auto location = m_locations.find(key(m_program, (uint32_t)value));
+            return location != m_locations.end() ? location->second : value;
+        }
+        const char *letter = std::strchr(kindLetters(), kind);
+        if (!letter || value <= 0) {
+            return value;
+        }
+        const std::vector<GLuint> &names = m_names[letter - kindLetters()];
+        return (size_t)value < names.size() && names[value] ? names[value] : value;
+    }
+
+    void name(char kind, GLuint traced, GLuint actual) {
+        std::vector<GLuint> &names = m_names[std::strchr(kindLetters(), kind) - kindLetters()];
+        if (names.size() <= traced) {
+            names.resize(traced + 1, 0);
+        }
+        names[traced] = actual;
+    }
+
+    const char* bytes(size_t size) {
+        const char *data = m_cursor;
+        m_cursor += size;
+        return data;
+    }
+
+    // GlTrace::putString's
+    const GLchar* string(GLint &length) {
+        length = (GLint)get<uint32_t>();
+        return bytes((size_t)length);
+    }
+
+    // GlTrace::putPixels's
+    const void* pixels() {
+        bool inline_ = get<uint8_t>() != 0;
+        uint64_t value = get<uint64_t>();
+        return inline_ ? (const void*)bytes((size_t)value) : (const void*)(uintptr_t)value;
+    }
+
+    void scratch(size_t size) {
+        if (m_scratch.size() < size) {
+            m_scratch.resize(size);
+        }
+    }
+
+    template <typename F>
+    struct Generic;
+    template <typename R, typename... A>
+    struct Generic<R (APIENTRYP)(A...)> {
+        static void call(R (APIENTRYP function)(A...), GlTraceReplay &replay, const char *kinds) {
+            call(function, replay, kinds, std::index_sequence_for<A...>());
+        }
+        template <size_t... I>
+        static void call(R (APIENTRYP function)(A...), GlTraceReplay &replay, const char *kinds, std::index_sequence<I...>) {
+            // a braced list reads the arguments in order
+            std::tuple<A...> arguments{replay.argument<A>(kinds[I])...};
+            function(std::get<I>(arguments)...);
+        }
+    };
+
+    void replay(const GlTraceFile::Record &record) {
+        m_cursor = record.data;
+        if (replaySpecial(record.call)) {
+            return;
+        }
+        switch (record.call) {
+#define RG_GL_REPLAY_GENERIC(name, kinds, type) \
+            case GlCall::name: Generic<decltype(glad_gl##name)>::call(glad_gl##name, *this, kinds); break;
+            RG_GL_CALLS(RG_GL_REPLAY_GENERIC)
+#undef RG_GL_REPLAY_GENERIC
+            default: break;
+        }
+    }
+
+    // glGen*: generates as many and maps them
+    void gen(void (APIENTRYP function)(GLsizei, GLuint*), char kind) {
+        GLsizei n = get<GLsizei>();
+        scratch(4 * (size_t)n);
+        GLuint *names = (GLuint*)m_scratch.data();
+        function(n, names);
+        for (GLsizei i = 0; i < n; ++i) {
+            name(kind, get<GLuint>(), names[i]);
+        }
+    }
+
+    void remove(void (APIENTRYP function)(GLsizei, const GLuint*), char kind) {
+        GLsizei n = get<GLsizei>();
+        scratch(4 * (size_t)n);
+        GLuint *names = (GLuint*)m_scratch.data();
+        for (GLsizei i = 0; i < n; ++i) {
+            names[i] = (GLuint)mapped(kind, get<GLuint>());
+        }
+        function(n, names);
+    }
+
+    template <typename F>
+    void uniformVector(F function, unsigned components) {
+        GLint location = (GLint)mapped('L', get<GLint>());
+        GLsizei count = get<GLsizei>();
+        function(location, count, (const GLfloat*)bytes(sizeof(GLfloat) * components * count));
+    }
+
+    template <typename F>
+    void uniformMatrix(F function, unsigned components) {
+        GLint location = (GLint)mapped('L', get<GLint>());
+        GLsizei count = get<GLsizei>();
+        GLboolean transpose = get<GLboolean>();
+        function(location, count, transpose, (const GLfloat*)bytes(sizeof(GLfloat) * components * count));
+    }
+
+    // the calls recorded with more than their arguments, or that make names; false for the rest
+    bool replaySpecial(GlCall::Id call) {
+        switch (call) {
+            case GlCall::BufferData: {
+                GLenum target = get<GLenum>();
+                GLsizeiptr size = get<GLsizeiptr>();
+                GLenum usage = get<GLenum>();
+                const void *data = get<uint8_t>() ? bytes((size_t)size) : nullptr;
+                glBufferData(target, size, data, usage);
+                return true;
+            }
+            case GlCall::BufferSubData: {
+                GLenum target = get<GLenum>();
+                GLintptr offset = get<GLintptr>();
+                GLsizeiptr size = get<GLsizeiptr>();
+                glBufferSubData(target, offset, size, bytes((size_t)size));
+                return true;
+            }
+            case GlCall::TexImage2D: {
+                GLenum target = get<GLenum>();
+                GLint level = get<GLint>(), internalFormat = get<GLint>();
+                GLsizei width = get<GLsizei>(), height = get<GLsizei>();
+                GLint border = get<GLint>();
+                GLenum format = get<GLenum>(), type = get<GLenum>();
+                glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels());
+                return true;
+            }
+            case GlCall::CompressedTexImage2D: {
+                GLenum target = get<GLenum>();
+                GLint level = get<GLint>();
+                GLenum internalFormat = get<GLenum>();
+                GLsizei width = get<GLsizei>(), height = get<GLsizei>();
+                GLint border = get<GLint>();
+                GLsizei imageSize = get<GLsizei>();
+                glCompressedTexImage2D(target, level, internalFormat, width, height, border, imageSize, pixels());
+                return true;
+            }
+            case GlCall::GenBuffers: gen(glGenBuffers, 'B'); return true;
+            case GlCall::GenFramebuffers: gen(glGenFramebuffers, 'F'); return true;
+            case GlCall::GenQueries: gen(glGenQueries, 'Q'); return true;
+            case GlCall::GenRenderbuffers: gen(glGenRenderbuffers, 'R'); return true;
+            case GlCall::GenTextures: gen(glGenTextures, 'T'); return true;
+            case GlCall::GenVertexArrays: gen(glGenVertexArrays, 'A'); return true;
+            case GlCall::DeleteBuffers: remove(glDeleteBuffers, 'B'); return true;
+            case GlCall::DeleteFramebuffers: remove(glDeleteFramebuffers, 'F'); return true;
+            case GlCall::DeleteQueries: remove(glDeleteQueries, 'Q'); return true;
+            case GlCall::DeleteRenderbuffers: remove(glDeleteRenderbuffers, 'R'); return true;
+            case GlCall::DeleteTextures: remove(glDeleteTextures, 'T'); return true;
+            case GlCall::DeleteVertexArrays: remove(glDeleteVertexArrays, 'A'); return true;
+            case GlCall::CreateProgram:
+                name('P', get<GLuint>(), glCreateProgram());
+                return true;
+            case GlCall::CreateShader: {
+                GLenum type = get<GLenum>();
+                name('P', get<GLuint>(), glCreateShader(type));
+                return true;
+            }
+            case GlCall::UseProgram:
+                m_program = get<GLuint>();
+                glUseProgram((GLuint)mapped('P', m_program));
+                return true;
+            case GlCall::FenceSync: {
+                GLenum condition = get<GLenum>();
+                GLbitfield flags = get<GLbitfield>();
+                m_syncs[get<uint64_t>()] = glFenceSync(condition, flags);
+                return true;
+            }
+            case GlCall::DeleteSync: {
+                auto sync = m_syncs.find(get<uint64_t>());
+                if (sync != m_syncs.end()) {
+                    glDeleteSync(sync->second);
+                    m_syncs.erase(sync);
+                }
+                return true;
+            }
+            case GlCall::GetUniformLocation: {
+                GLuint program = get<GLuint>();
+                GLint length;
+                const GLchar *characters = string(length);
+                std::string uniform(characters, (size_t)length);
+                m_locations[key(program, get<uint32_t>())] = glGetUniformLocation((GLuint)mapped('P', program), uniform.c_str());
+                return true;
+            }
+            case GlCall::GetUniformBlockIndex: {
+                GLuint program = get<GLuint>();
+                GLint length;
+                const GLchar *characters = string(length);
+                std::string block(characters, (size_t)length);
+                m_blockIndices[key(program, get<uint32_t>())] = glGetUniformBlockIndex((GLuint)mapped('P', program), block.c_str());
+                return true;
+            }
+            case GlCall::UniformBlockBinding: {
+                GLuint program = get<GLuint>(), index = get<GLuint>(), binding = get<GLuint>();
+                auto actual = m_blockIndices.find(key(program, index));
+                glUniformBlockBinding((GLuint)mapped('P', program), actual != m_blockIndices.end() ? actual->second : index, binding);
+                return true;
+            }
+            case GlCall::ShaderSource: {
+                GLuint shader = (GLuint)mapped('P', get<GLuint>());
+                GLsizei count = get<GLsizei>();
+                std::vector<GLint> lengths((size_t)count);
+                m_strings.resize((size_t)count);
+                for (GLsizei i = 0; i < count; ++i) {
+                    m_strings[i] = string(lengths[i]);
+                }
+                glShaderSource(shader, count, m_strings.data(), lengths.data());
+                return true;
+            }
+            case GlCall::TransformFeedbackVaryings: {
+                GLuint program = (GLuint)mapped('P', get<GLuint>());
+                GLsizei count = get<GLsizei>();
+                // the names have to be terminated here
+                std::vector<std::string> varyings((size_t)count);
+                for (GLsizei i = 0; i < count; ++i) {
+                    GLint length;
+                    const GLchar *varying = string(length);
+                    varyings[i].assign(varying, (size_t)length);
+                }
+                m_strings.resize((size_t)count);
+                for (GLsizei i = 0; i < count; ++i) {
+                    m_strings[i] = varyings[i].c_str();
+                }
+                glTransformFeedbackVaryings(program, count, m_strings.data(), get<GLenum>());
+                return true;
+            }
+            case GlCall::Uniform2fv: uniformVector(glUniform2fv, 2); return true;
+            case GlCall::Uniform3fv: uniformVector(glUniform3fv, 3); return true;
+            case GlCall::Uniform4fv: uniformVector(glUniform4fv, 4); return true;
+            case GlCall::UniformMatrix2fv: uniformMatrix(glUniformMatrix2fv, 4); return true;
+            case GlCall::UniformMatrix3fv: uniformMatrix(glUniformMatrix3fv, 9); return true;
+            case GlCall::UniformMatrix4fv: uniformMatrix(glUniformMatrix4fv, 16); return true;
+            case GlCall::MapBufferRange: {
+                GLenum target = get<GLenum>();
+                GLintptr offset = get<GLintptr>();
+                GLsizeiptr length = get<GLsizeiptr>();
+                m_mappings[mappingSlot(target)] = glMapBufferRange(target, offset, length, get<GLbitfield>());
+                return true;
+            }
+            case GlCall::UnmapBuffer: {
+                GLenum target = get<GLenum>();
+                GLsizeiptr length = get<GLsizeiptr>();
+                void *&mapping = m_mappings[mappingSlot(target)];
+                if (mapping && length > 0) {
+                    std::memcpy(mapping, bytes((size_t)length), (size_t)length);
+                }
+                mapping = nullptr;
+                glUnmapBuffer(target);
+                return true;
+            }
+            case GlCall::ReadPixels: {
+                GLint x = get<GLint>(), y = get<GLint>();
+                GLsizei width = get<GLsizei>(), height = get<GLsizei>();
+                GLenum format = get<GLenum>(), type = get<GLenum>();
+                get<uint64_t>();
+                // four components of four bytes is the most a pixel takes
+                scratch((size_t)width * height * 16);
+                glReadPixels(x, y, width, height, format, type, m_scratch.data());
+                return true;
+            }
+            case GlCall::GetBufferSubData: {
+                GLenum target = get<GLenum>();
+                GLintptr offset = get<GLintptr>();
+                GLsizeiptr size = get<GLsizeiptr>();
+                get<uint64_t>();
+                scratch((size_t)size);
+                glGetBufferSubData(target, offset, size, m_scratch.data());
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+};
+
+#endif //PROJECT_BASE_GLTRACEREPLAY_H
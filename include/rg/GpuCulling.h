@@ -0,0 +1,400 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_GPUCULLING_H
+#define PROJECT_BASE_GPUCULLING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <rg/DepthPyramid.h>
+#include <rg/Frustum.h>
+#include <rg/GlExtensions.h>
+#include <rg/GlState.h>
+#include <rg/ProgramBuilder.h>
+
+// Instance culling on the GPU: every instance's bounding sphere is tested against the frustum and the
+// previous frame's depth pyramid, and only the survivors' matrices are written, packed, to a buffer the
+// instanced draw reads as its per-instance attribute.
+//
+// Two ways to run it. With ARB_compute_shader, SSBOs and ARB_draw_indirect (core 4.3, exposed on
+// 3.3 contexts by most desktop drivers) a compute shader does the test and counts the survivors into
+// indirect draw commands, so nothing comes back to the CPU. Otherwise a vertex + geometry shader pass
+// with transform feedback does the test; the survivor count then comes from a query, read once the GPU
+// has it so it never stalls, and the draw uses the buffer that count belongs to.
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_SHADER_STORAGE_BLOCK
+#define GL_SHADER_STORAGE_BLOCK 0x92E6
+#endif
+
+namespace rg {
+    typedef void (APIENTRYP DispatchComputeProc)(GLuint x, GLuint y, GLuint z);
+    typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+    typedef void (APIENTRYP DrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect);
+    typedef void (APIENTRYP ShaderStorageBlockBindingProc)(GLuint program, GLuint index, GLuint binding);
+    typedef GLuint (APIENTRYP GetProgramResourceIndexProc)(GLuint program, GLenum programInterface, const GLchar* name);
+
+    struct ComputeCullingFunctions {
+        DispatchComputeProc dispatchCompute = nullptr;
+        MemoryBarrierProc memoryBarrier = nullptr;
+        DrawElementsIndirectProc drawElementsIndirect = nullptr;
+        ShaderStorageBlockBindingProc shaderStorageBlockBinding = nullptr;
+        GetProgramResourceIndexProc getProgramResourceIndex = nullptr;
+    };
+
+    // Fills functions and returns true when the context can run the compute path.
+    bool loadComputeCullingFunctions(GLADloadproc load, ComputeCullingFunctions &functions) {
+        functions = ComputeCullingFunctions();
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major * 10 + minor < 43 && !(hasGlExtension("GL_ARB_compute_shader") &&
+                                         hasGlExtension("GL_ARB_shader_storage_buffer_object") &&
+                                         hasGlExtension("GL_ARB_draw_indirect"))) {
+            return false;
+        }
+        functions.dispatchCompute = (DispatchComputeProc)load("glDispatchCompute");
+        functions.memoryBarrier = (MemoryBarrierProc)load("glMemoryBarrier");
+        functions.drawElementsIndirect = (DrawElementsIndirectProc)load("glDrawElementsIndirect");
+        functions.shaderStorageBlockBinding = (ShaderStorageBlockBindingProc)load("glShaderStorageBlockBinding");
+        functions.getProgramResourceIndex = (GetProgramResourceIndexProc)load("glGetProgramResourceIndex");
+        if (!functions.dispatchCompute || !functions.memoryBarrier || !functions.drawElementsIndirect ||
+            !functions.shaderStorageBlockBinding || !functions.getProgramResourceIndex) {
+            functions = ComputeCullingFunctions();
+            return false;
+        }
+        return true;
+    }
+};
+
+class InstanceCuller {
+public:
+    enum Path {
+        PATH_COMPUTE,
+        PATH_TRANSFORM_FEEDBACK
+    };
+
+    // Matrices and spheres are uploaded once; indexCounts has one entry per mesh drawn with them.
+    // Shaders are read from shaderDirectory. load fetches the entry points glad doesn't have.
+    InstanceCuller(const glm::mat4* matrices, const BoundingSpheres &spheres, const std::vector<unsigned> &indexCounts,
+                   const std::string &shaderDirectory, GLADloadproc load)
+    : m_instanceCount((GLuint)spheres.size()), m_activeCount(m_instanceCount), m_indexCounts(indexCounts) {
+        std::vector<glm::vec4> packedSpheres(m_instanceCount);
+        for (GLuint i = 0; i < m_instanceCount; ++i) {
+            packedSpheres[i] = glm::vec4(spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i]);
+        }
+        if (rg::loadComputeCullingFunctions(load, m_compute)) {
+            m_program = rg::buildProgram({{GL_COMPUTE_SHADER, shaderDirectory + "/instance_cull.comp"}});
+        }
+        if (m_program) {
+            m_path = PATH_COMPUTE;
+            setupCompute(matrices, packedSpheres);
+        } else {
+            m_path = PATH_TRANSFORM_FEEDBACK;
+            m_program = rg::buildProgram({{GL_VERTEX_SHADER, shaderDirectory + "/instance_cull.vert"},
+                                          {GL_GEOMETRY_SHADER, shaderDirectory + "/instance_cull.geom"}},
+                                         {"matrixColumn0", "matrixColumn1", "matrixColumn2", "matrixColumn3"});
+            setupTransformFeedback(matrices, packedSpheres);
+        }
+        m_frustumPlanes = glGetUniformLocation(m_program, "frustumPlanes");
+        m_depthPyramid = glGetUniformLocation(m_program, "depthPyramid");
+        m_depthPyramidLevels = glGetUniformLocation(m_program, "depthPyramidLevels");
+        m_depthPyramidSize = glGetUniformLocation(m_program, "depthPyramidSize");
+        m_depthViewProjection = glGetUniformLocation(m_program, "depthViewProjection");
+        m_instanceCountUniform = glGetUniformLocation(m_program, "instanceCount");
+        m_commandCountUniform = glGetUniformLocation(m_program, "commandCount");
+    }
+
+    InstanceCuller(const InstanceCuller&) = delete;
+    InstanceCuller& operator=(const InstanceCuller&) = delete;
+
+    ~InstanceCuller() {
+        for (GLsync fence : m_readbackFences) {
+            if (fence) {
+                glDeleteSync(fence);
+            }
+        }
+        glDeleteBuffers(BUFFER_COUNT, m_buffers);
+        glDeleteQueries(FEEDBACK_BUFFERS, m_queries);
+        glDeleteVertexArrays(1, &m_inputVAO);
+        rg::glState().vertexArrayDeleted(m_inputVAO);
+        glDeleteProgram(m_program);
+        rg::glState().programDeleted(m_program);
+    }
+
+    Path path() const {
+        return m_path;
+    }
+    const char* pathName() const {
+        return m_path == PATH_COMPUTE ? "compute shader" : "transform feedback";
+    }
+
+    // Tests every instance; the depth pyramid is used once it has been built.
+    void cull(const Frustum &frustum, const DepthPyramid &depthPyramid) {
+        rg::glState().useProgram(m_program);
+        glUniform4fv(m_frustumPlanes, 6, &frustum.plane(0)[0]);
+        glUniform1i(m_depthPyramid, 0);
+        glUniform1i(m_depthPyramidLevels, depthPyramid.levels());
+        glUniform2fv(m_depthPyramidSize, 1, &depthPyramid.size()[0]);
+        glUniformMatrix4fv(m_depthViewProjection, 1, GL_FALSE, &depthPyramid.viewProjection()[0][0]);
+        rg::glState().bindTexture(0, GL_TEXTURE_2D, depthPyramid.texture());
+        if (m_path == PATH_COMPUTE) {
+            cullCompute();
+        } else {
+            cullTransformFeedback();
+        }
+        ++m_frame;
+    }
+
+    // The packed matrices of the last cull(), for the mesh VAOs' instance attributes.
+    GLuint visibleMatrices() const {
+        return m_path == PATH_COMPUTE || m_drawBuffer == NO_BUFFER ? m_buffers[VISIBLE_0] : m_buffers[VISIBLE_0 + m_drawBuffer];
+    }
+
+    // Draws mesh (index into indexCounts) with its VAO bound and its instance attributes on visibleMatrices().
+    void draw(unsigned mesh) const {
+        if (m_path == PATH_COMPUTE) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffers[COMMANDS]);
+            m_compute.drawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(mesh * sizeof(DrawCommand)));
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        } else if (m_drawCount > 0) {
+            glDrawElementsInstanced(GL_TRIANGLES, m_indexCounts[mesh], GL_UNSIGNED_INT, 0, m_drawCount);
+        }
+    }
+
+    GLuint instanceCount() const {
+        return m_instanceCount;
+    }
+    // Culls and draws only the first count instances; the rest stay uploaded.
+    void setActiveCount(GLuint count) {
+        m_activeCount = count < m_instanceCount ? count : m_instanceCount;
+    }
+    GLuint activeCount() const {
+        return m_activeCount;
+    }
+    // Survivors as the CPU last heard, a frame or more behind.
+    GLuint lastVisibleCount() const {
+        return m_visibleCount;
+    }
+
+private:
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // The transform feedback path writes to one of three, and never to the one drawn from or one whose
+    // count hasn't been read yet. The compute path only uses VISIBLE_0.
+    static const unsigned FEEDBACK_BUFFERS = 3;
+    static const unsigned NO_BUFFER = ~0u;
+    // copies of the compute path's visible count, each read once its fence has signalled
+    static const unsigned READBACKS = 3;
+
+    enum Buffer {
+        SPHERES,
+        MATRICES,
+        COMMANDS,
+        READBACK_0,
+        VISIBLE_0 = READBACK_0 + READBACKS,
+        BUFFER_COUNT = VISIBLE_0 + FEEDBACK_BUFFERS
+    };
+
+    Path m_path = PATH_TRANSFORM_FEEDBACK;
+    rg::ComputeCullingFunctions m_compute;
+    GLuint m_program = 0;
+    GLuint m_instanceCount;
+    GLuint m_activeCount;
+    std::vector<unsigned> m_indexCounts;
+    std::vector<DrawCommand> m_commands;
+    GLuint m_buffers[BUFFER_COUNT] = {};
+    GLuint m_queries[FEEDBACK_BUFFERS] = {};
+    GLuint m_inputVAO = 0;
+    unsigned long m_frame = 0;
+    unsigned m_drawBuffer = NO_BUFFER;
+    // 1 + the frame that wrote each feedback buffer while its count is still to be read, else 0
+    unsigned long m_pending[FEEDBACK_BUFFERS] = {};
+    GLsync m_readbackFences[READBACKS] = {};
+    GLsizei m_drawCount = 0;
+    GLuint m_visibleCount = 0;
+    GLint m_frustumPlanes = -1, m_depthPyramid = -1, m_depthPyramidLevels = -1, m_depthPyramidSize = -1;
+    GLint m_depthViewProjection = -1, m_instanceCountUniform = -1, m_commandCountUniform = -1;
+
+    static void bufferData(GLenum target, GLuint buffer, size_t size, const void* data, GLenum usage) {
+        glBindBuffer(target, buffer);
+        glBufferData(target, size, data, usage);
+    }
+
+    void setupCompute(const glm::mat4* matrices, const std::vector<glm::vec4> &spheres) {
+        glGenBuffers(BUFFER_COUNT, m_buffers);
+        size_t matricesSize = m_instanceCount * sizeof(glm::mat4);
+        bufferData(GL_SHADER_STORAGE_BUFFER, m_buffers[SPHERES], spheres.size() * sizeof(glm::vec4), spheres.data(), GL_STATIC_DRAW);
+        bufferData(GL_SHADER_STORAGE_BUFFER, m_buffers[MATRICES], matricesSize, matrices, GL_STATIC_DRAW);
+        bufferData(GL_SHADER_STORAGE_BUFFER, m_buffers[VISIBLE_0], matricesSize, nullptr, GL_DYNAMIC_COPY);
+        for (unsigned count : m_indexCounts) {
+            m_commands.push_back({count, 0, 0, 0, 0});
+        }
+        bufferData(GL_SHADER_STORAGE_BUFFER, m_buffers[COMMANDS], m_commands.size() * sizeof(DrawCommand), m_commands.data(), GL_DYNAMIC_DRAW);
+        for (unsigned i = 0; i < READBACKS; ++i) {
+            bufferData(GL_COPY_WRITE_BUFFER, m_buffers[READBACK_0 + i], sizeof(GLuint), nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        const char* blocks[] = {"InstanceSpheres", "InstanceMatrices", "VisibleMatrices", "DrawCommands"};
+        for (GLuint binding = 0; binding < 4; ++binding) {
+            GLuint index = m_compute.getProgramResourceIndex(m_program, GL_SHADER_STORAGE_BLOCK, blocks[binding]);
+            if (index != GL_INVALID_INDEX) {
+                m_compute.shaderStorageBlockBinding(m_program, index, binding);
+            }
+        }
+    }
+
+    void cullCompute() {
+        // zero the instance counts, the rest of the commands never changes
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[COMMANDS]);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_commands.size() * sizeof(DrawCommand), m_commands.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        GLuint storage[] = {m_buffers[SPHERES], m_buffers[MATRICES], m_buffers[VISIBLE_0], m_buffers[COMMANDS]};
+        for (GLuint binding = 0; binding < 4; ++binding) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, storage[binding]);
+        }
+        glUniform1ui(m_instanceCountUniform, m_activeCount);
+        glUniform1ui(m_commandCountUniform, (GLuint)m_commands.size());
+        m_compute.dispatchCompute((m_activeCount + 63) / 64, 1, 1);
+        m_compute.memoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+        // the count for the stats goes through a copy, read once the GPU has made it
+        collectReadbacks();
+        unsigned slot = (unsigned)(m_frame % READBACKS);
+        if (m_readbackFences[slot]) {
+            // the GPU is READBACKS frames behind: this count is dropped rather than waited for
+            glDeleteSync(m_readbackFences[slot]);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, m_buffers[COMMANDS]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffers[READBACK_0 + slot]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offsetof(DrawCommand, instanceCount), 0, sizeof(GLuint));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // Reads the copies whose fences have signalled, oldest first, so the newest of them is the count kept.
+    // The GPU finishes them in order, so the first one still running ends the search; without any the
+    // previous count stays.
+    void collectReadbacks() {
+        // frame m_frame - READBACKS wrote the slot this frame writes, the one after it came next
+        for (unsigned i = 0; i < READBACKS; ++i) {
+            unsigned slot = (unsigned)((m_frame + i) % READBACKS);
+            GLsync &fence = m_readbackFences[slot];
+            if (!fence) {
+                continue;
+            }
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                break;
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+            glBindBuffer(GL_COPY_READ_BUFFER, m_buffers[READBACK_0 + slot]);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &m_visibleCount);
+        }
+    }
+
+    void setupTransformFeedback(const glm::mat4* matrices, const std::vector<glm::vec4> &spheres) {
+        glGenBuffers(BUFFER_COUNT, m_buffers);
+        glGenQueries(FEEDBACK_BUFFERS, m_queries);
+        size_t matricesSize = m_instanceCount * sizeof(glm::mat4);
+        bufferData(GL_ARRAY_BUFFER, m_buffers[SPHERES], spheres.size() * sizeof(glm::vec4), spheres.data(), GL_STATIC_DRAW);
+        bufferData(GL_ARRAY_BUFFER, m_buffers[MATRICES], matricesSize, matrices, GL_STATIC_DRAW);
+        for (unsigned i = 0; i < FEEDBACK_BUFFERS; ++i) {
+            bufferData(GL_TRANSFORM_FEEDBACK_BUFFER, m_buffers[VISIBLE_0 + i], matricesSize, nullptr, GL_DYNAMIC_COPY);
+        }
+        glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+
+        glGenVertexArrays(1, &m_inputVAO);
+        rg::glState().bindVertexArray(m_inputVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffers[SPHERES]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffers[MATRICES]);
+        for (GLuint column = 0; column < 4; ++column) {
+            glEnableVertexAttribArray(1 + column);
+            glVertexAttribPointer(1 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // The newest count the GPU has back makes its buffer the one drawn from; the buffers of older counts
+    // are free again without reading them. Until anything has been drawn the oldest count is waited for.
+    void collectVisibleCount() {
+        unsigned newest = NO_BUFFER, oldest = NO_BUFFER;
+        for (unsigned i = 0; i < FEEDBACK_BUFFERS; ++i) {
+            if (m_pending[i] == 0) {
+                continue;
+            }
+            oldest = oldest == NO_BUFFER || m_pending[i] < m_pending[oldest] ? i : oldest;
+            if (newest != NO_BUFFER && m_pending[i] < m_pending[newest]) {
+                continue;
+            }
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(m_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            newest = available ? i : newest;
+        }
+        if (newest == NO_BUFFER && m_drawBuffer == NO_BUFFER) {
+            newest = oldest;
+        }
+        if (newest == NO_BUFFER) {
+            return;
+        }
+        glGetQueryObjectuiv(m_queries[newest], GL_QUERY_RESULT, &m_visibleCount);
+        m_drawBuffer = newest;
+        m_drawCount = (GLsizei)m_visibleCount;
+        unsigned long written = m_pending[newest];
+        for (unsigned long &pending : m_pending) {
+            pending = pending <= written ? 0 : pending;
+        }
+    }
+
+    // When the GPU is so far behind that every buffer is drawn from or waiting for its count, nothing is
+    // culled this frame and the last buffer is drawn again with its own count.
+    void cullTransformFeedback() {
+        collectVisibleCount();
+        unsigned target = 0;
+        while (target < FEEDBACK_BUFFERS && (target == m_drawBuffer || m_pending[target] != 0)) {
+            ++target;
+        }
+        if (target == FEEDBACK_BUFFERS) {
+            return;
+        }
+        rg::glState().enable(GL_RASTERIZER_DISCARD);
+        rg::glState().bindVertexArray(m_inputVAO);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_buffers[VISIBLE_0 + target]);
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, m_queries[target]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, m_activeCount);
+        glEndTransformFeedback();
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        rg::glState().disable(GL_RASTERIZER_DISCARD);
+        m_pending[target] = m_frame + 1;
+    }
+};
+
+#endif //PROJECT_BASE_GPUCULLING_H
@@ -0,0 +1,127 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_HEADLESSCONTEXT_H
+#define PROJECT_BASE_HEADLESSCONTEXT_H
+
+#include <iostream>
+#include <cstring>
+#ifdef RG_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// A GL 3.3 core context with no window and no surface, for machines without a display: EGL on Mesa's
+// surfaceless platform when it has one (llvmpipe renders on the CPU without any GPU), the default EGL
+// display otherwise. Everything is drawn into an OffscreenTarget.
+//
+// Needs EGL_KHR_surfaceless_context and a build configured with -DRG_HEADLESS=ON; without it create()
+// always fails.
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    ~HeadlessContext() {
+#ifdef RG_HEADLESS
+        if (m_display != EGL_NO_DISPLAY) {
+            eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (m_context != EGL_NO_CONTEXT) {
+                eglDestroyContext(m_display, m_context);
+            }
+            eglTerminate(m_display);
+        }
+#endif
+    }
+
+    // Makes the context current on this thread; false, with the reason printed, when there is none.
+    bool create() {
+#ifdef RG_HEADLESS
+        createContext();
+#else
+        std::cout << "ERROR::HEADLESS::NOT_BUILT configure with -DRG_HEADLESS=ON for a context without a window" << std::endl;
+#endif
+        return m_valid;
+    }
+
+    bool valid() const {
+        return m_valid;
+    }
+
+    // for gladLoadGLLoader and the other GLADloadproc users
+    static void* loadFunction(const char *name) {
+#ifdef RG_HEADLESS
+        return (void*)eglGetProcAddress(name);
+#else
+        return nullptr;
+#endif
+    }
+
+private:
+    bool m_valid = false;
+#ifdef RG_HEADLESS
+    EGLDisplay m_display = EGL_NO_DISPLAY;
+    EGLContext m_context = EGL_NO_CONTEXT;
+
+    void createContext() {
+        const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay && clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+            m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (m_display == EGL_NO_DISPLAY) {
+            m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        EGLint major = 0, minor = 0;
+        if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor)) {
+            std::cout << "ERROR::HEADLESS::NO_DISPLAY eglInitialize failed, 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            m_display = EGL_NO_DISPLAY;
+            return;
+        }
+        const char *extensions = eglQueryString(m_display, EGL_EXTENSIONS);
+        if (!extensions || !std::strstr(extensions, "EGL_KHR_surfaceless_context")) {
+            std::cout << "ERROR::HEADLESS::NO_SURFACELESS_CONTEXT EGL " << major << "." << minor << std::endl;
+            return;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            std::cout << "ERROR::HEADLESS::NO_DESKTOP_GL" << std::endl;
+            return;
+        }
+
+        // no surface is ever made, so any surface type will do
+        const EGLint configAttributes[] = {
+                EGL_SURFACE_TYPE, 0,
+                EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(m_display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            std::cout << "ERROR::HEADLESS::NO_CONFIG" << std::endl;
+            return;
+        }
+        const EGLint contextAttributes[] = {
+                EGL_CONTEXT_MAJOR_VERSION, 3,
+                EGL_CONTEXT_MINOR_VERSION, 3,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+        };
+        m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (m_context == EGL_NO_CONTEXT) {
+            std::cout << "ERROR::HEADLESS::NO_CONTEXT 3.3 core, 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            return;
+        }
+        if (!eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context)) {
+            std::cout << "ERROR::HEADLESS::MAKE_CURRENT 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            return;
+        }
+        m_valid = true;
+    }
+#endif
+};
+
+#endif //PROJECT_BASE_HEADLESSCONTEXT_H
@@ -0,0 +1,272 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_INPUTLOG_H
+#define PROJECT_BASE_INPUTLOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <rg/MappedFile.h>
+
+// Keyboard, cursor and scroll input between the GLFW callbacks and the simulation. The callbacks queue
+// events, and the simulation takes them at its next step (SimulationClock), so what they change depends
+// on the step they arrive in and not on when frames happen to be drawn. Keys held down are tracked here
+// too, for the simulation to read instead of glfwGetKey.
+//
+// --record-input=FILE writes every step's events to FILE, --replay-input=FILE feeds them back at the
+// same steps and ignores the live input, so a replayed session moves the camera and flips the switches
+// exactly as the recorded one did. The file is a header (magic, version, the simulation step and the
+// rock field's seed) and then one record per event: the step it was taken in, its type, and two int32
+// (key, action) or two float64 (cursor position, scroll offset). An END record closes it.
+
+struct InputEvent {
+    enum Type : uint8_t {
+        KEY,
+        CURSOR,
+        SCROLL,
+        END
+    };
+
+    Type type = END;
+    int key = 0, action = 0;
+    double x = 0.0, y = 0.0;
+
+    static InputEvent keyEvent(int key, int action) {
+        InputEvent event;
+        event.type = KEY;
+        event.key = key;
+        event.action = action;
+        return event;
+    }
+    static InputEvent pointerEvent(Type type, double x, double y) {
+        InputEvent event;
+        event.type = type;
+        event.x = x;
+        event.y = y;
+        return event;
+    }
+};
+
+namespace rg {
+    const char INPUT_LOG_MAGIC[8] = {'R', 'G', 'I', 'N', 'P', 'U', 'T', '\0'};
+    const uint32_t INPUT_LOG_VERSION = 1;
+    const size_t INPUT_LOG_HEADER_SIZE = 8 + 4 + 8 + 8;
+};
+
+class InputLog {
+public:
+    // events queued between two steps; cursor and scroll events merge with the one before them
+    static const unsigned QUEUE_SIZE = 256;
+    static const int KEYS = 512;
+
+    InputLog() = default;
+    InputLog(const InputLog&) = delete;
+    InputLog& operator=(const InputLog&) = delete;
+
+    ~InputLog() {
+        if (m_file) {
+            std::fclose(m_file);
+        }
+    }
+
+    // Prints ERROR::INPUT_LOG::CANNOT_WRITE and returns false when path can't be written.
+    bool record(const std::string &path, double stepSeconds, int64_t seed) {
+        m_file = std::fopen(path.c_str(), "wb");
+        if (!m_file) {
+            std::cout << "ERROR::INPUT_LOG::CANNOT_WRITE " << path << std::endl;
+            return false;
+        }
+        char header[rg::INPUT_LOG_HEADER_SIZE];
+        std::memcpy(header, rg::INPUT_LOG_MAGIC, 8);
+        std::memcpy(header + 8, &rg::INPUT_LOG_VERSION, 4);
+        std::memcpy(header + 12, &stepSeconds, 8);
+        std::memcpy(header + 20, &seed, 8);
+        std::fwrite(header, 1, sizeof(header), m_file);
+        return true;
+    }
+
+    // Prints ERROR::INPUT_LOG:: and returns false when path isn't a log of a simulation stepping
+    // stepSeconds at a time; seed is the recorded session's.
+    bool replay(const std::string &path, double stepSeconds, int64_t &seed) {
+        if (!m_replay.open(path)) {
+            std::cout << "ERROR::INPUT_LOG::CANNOT_OPEN " << path << std::endl;
+            return false;
+        }
+        uint32_t version = 0;
+        double recordedStep = 0.0;
+        if (m_replay.size() < rg::INPUT_LOG_HEADER_SIZE || std::memcmp(m_replay.data(), rg::INPUT_LOG_MAGIC, 8) != 0) {
+            std::cout << "ERROR::INPUT_LOG::NOT_A_LOG " << path << std::endl;
+            m_replay.close();
+            return false;
+        }
+        std::memcpy(&version, m_replay.data() + 8, 4);
+        std::memcpy(&recordedStep, m_replay.data() + 12, 8);
+        if (version != rg::INPUT_LOG_VERSION || recordedStep != stepSeconds) {
+            std::cout << "ERROR::INPUT_LOG::VERSION " << path << " is version " << version << " stepping " << recordedStep
+                      << " s, this build reads " << rg::INPUT_LOG_VERSION << " stepping " << stepSeconds << " s" << std::endl;
+            m_replay.close();
+            return false;
+        }
+        std::memcpy(&seed, m_replay.data() + 20, 8);
+        m_offset = rg::INPUT_LOG_HEADER_SIZE;
+        m_replaying = true;
+        return true;
+    }
+
+    bool recording() const {
+        return m_file != nullptr;
+    }
+    bool replaying() const {
+        return m_replaying;
+    }
+    // a replay past its END record, or a log cut short
+    bool finished() const {
+        return m_finished;
+    }
+
+    // From the callbacks; dropped while replaying.
+    void push(const InputEvent &event) {
+        if (m_replaying) {
+            return;
+        }
+        if (m_queued > 0 && event.type != InputEvent::KEY && m_queue[m_queued - 1].type == event.type) {
+            InputEvent &last = m_queue[m_queued - 1];
+            // the cursor's position is absolute, scroll offsets add up
+            last.x = event.type == InputEvent::CURSOR ? event.x : last.x + event.x;
+            last.y = event.type == InputEvent::CURSOR ? event.y : last.y + event.y;
+            return;
+        }
+        if (m_queued == QUEUE_SIZE) {
+            ++m_dropped;
+            return;
+        }
+        m_queue[m_queued++] = event;
+    }
+
+    // The events of simulation step step, in order: the queued ones, written down when recording, or the
+    // log's when replaying. apply(const InputEvent&) is called for each after the held keys are updated.
+    template<typename Apply>
+    void step(uint64_t step, Apply apply) {
+        if (m_replaying) {
+            InputEvent event;
+            uint64_t eventStep = 0;
+            size_t size = 0;
+            while (!m_finished && peek(eventStep, event, size) && eventStep <= step) {
+                m_offset += size;
+                if (event.type == InputEvent::END) {
+                    m_finished = true;
+                    break;
+                }
+                take(event, apply);
+            }
+            return;
+        }
+        for (unsigned i = 0; i < m_queued; ++i) {
+            if (m_file) {
+                write(step, m_queue[i]);
+            }
+            take(m_queue[i], apply);
+        }
+        m_queued = 0;
+    }
+
+    bool held(int key) const {
+        return key >= 0 && key < KEYS && m_held[key];
+    }
+
+    // Ends a recording at step.
+    void close(uint64_t step) {
+        if (m_file) {
+            write(step, InputEvent());
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+        if (m_dropped) {
+            std::cout << "input: " << m_dropped << " event(s) over a step's " << QUEUE_SIZE << " dropped" << std::endl;
+        }
+    }
+
+private:
+    std::FILE *m_file = nullptr;
+    MappedFile m_replay;
+    size_t m_offset = 0;
+    bool m_replaying = false, m_finished = false;
+
+    InputEvent m_queue[QUEUE_SIZE];
+    unsigned m_queued = 0;
+    unsigned long m_dropped = 0;
+    bool m_held[KEYS] = {};
+
+    // GLFW_PRESS, GLFW_RELEASE
+    static const int PRESS = 1, RELEASE = 0;
+
+    template<typename Apply>
+    void take(const InputEvent &event, Apply &apply) {
+        if (event.type == InputEvent::KEY && event.key >= 0 && event.key < KEYS) {
+            if (event.action == PRESS) {
+                m_held[event.key] = true;
+            } else if (event.action == RELEASE) {
+                m_held[event.key] = false;
+            }
+        }
+        apply(event);
+    }
+
+    void write(uint64_t step, const InputEvent &event) {
+        char record[4 + 1 + 16];
+        uint32_t recordStep = (uint32_t)step;
+        uint8_t type = event.type;
+        std::memcpy(record, &recordStep, 4);
+        std::memcpy(record + 4, &type, 1);
+        size_t size = 5;
+        if (event.type == InputEvent::KEY) {
+            int32_t key = event.key, action = event.action;
+            std::memcpy(record + 5, &key, 4);
+            std::memcpy(record + 9, &action, 4);
+            size += 8;
+        } else if (event.type != InputEvent::END) {
+            std::memcpy(record + 5, &event.x, 8);
+            std::memcpy(record + 13, &event.y, 8);
+            size += 16;
+        }
+        std::fwrite(record, 1, size, m_file);
+    }
+
+    // the record at m_offset and its size; false at the end of a log cut short
+    bool peek(uint64_t &step, InputEvent &event, size_t &size) {
+        if (m_offset + 5 > m_replay.size()) {
+            m_finished = true;
+            return false;
+        }
+        const char *record = m_replay.data() + m_offset;
+        uint32_t recordStep = 0;
+        uint8_t type = 0;
+        std::memcpy(&recordStep, record, 4);
+        std::memcpy(&type, record + 4, 1);
+        size = type == InputEvent::KEY ? 13 : type == InputEvent::END ? 5 : 21;
+        if (type > InputEvent::END || m_offset + size > m_replay.size()) {
+            m_finished = true;
+            return false;
+        }
+        step = recordStep;
+        event = InputEvent();
+        event.type = (InputEvent::Type)type;
+        if (type == InputEvent::KEY) {
+            int32_t key = 0, action = 0;
+            std::memcpy(&key, record + 5, 4);
+            std::memcpy(&action, record + 9, 4);
+            event.key = key;
+            event.action = action;
+        } else if (type != InputEvent::END) {
+            std::memcpy(&event.x, record + 5, 8);
+            std::memcpy(&event.y, record + 13, 8);
+        }
+        return true;
+    }
+};
+
+#endif //PROJECT_BASE_INPUTLOG_H
@@ -0,0 +1,260 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_INSTANCEDBATCH_H
+#define PROJECT_BASE_INSTANCEDBATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <rg/GlState.h>
+
+// Many copies of one model in one instanced draw per mesh. Every instance is a model matrix, fed to the
+// vertex shader as a mat4 attribute (four vec4 slots) with divisor 1.
+//
+// The matrix slots are checked against the attributes the meshes' VAOs already enable - Mesh takes 0-4
+// for position, normal, texture coordinates, tangent and bitangent - so asking for a taken slot is
+// reported and moved past them instead of silently replacing the mesh's data.
+//
+// Instances live packed in slots [0, size()); a handle stays valid across removals, which move the last
+// instance into the hole. Changes are uploaded by upload() as one glBufferSubData over the slots that
+// changed since the last one.
+class InstancedBatch {
+public:
+    typedef uint32_t Handle;
+    static const Handle INVALID_HANDLE = 0xffffffffu;
+    // first slot after what Mesh enables
+    static const GLuint FIRST_FREE_LOCATION = 5;
+
+    // One per mesh: its VAO and how many indices (or vertices, for glDrawArrays meshes) it draws.
+    struct Part {
+        GLuint VAO;
+        GLsizei count;
+        bool indexed;
+    };
+
+    // Any model with meshes that have a VAO and an indexCount, both copies of Model included.
+    template<typename ModelType>
+    InstancedBatch(const ModelType &model, size_t capacity, GLuint matrixLocation = FIRST_FREE_LOCATION)
+    : m_capacity(capacity) {
+        for (const auto &mesh : model.meshes) {
+            m_parts.push_back({mesh.VAO, (GLsizei)mesh.indexCount, true});
+        }
+        init(matrixLocation);
+    }
+
+    // A VAO drawn with glDrawArrays(GL_TRIANGLES, 0, vertexCount), like the hard-coded cube and pyramid.
+    InstancedBatch(GLuint VAO, GLsizei vertexCount, size_t capacity, GLuint matrixLocation = FIRST_FREE_LOCATION)
+    : m_capacity(capacity) {
+        m_parts.push_back({VAO, vertexCount, false});
+        init(matrixLocation);
+    }
+
+    InstancedBatch(const InstancedBatch&) = delete;
+    InstancedBatch& operator=(const InstancedBatch&) = delete;
+
+    ~InstancedBatch() {
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    // INVALID_HANDLE when the batch is full.
+    Handle add(const glm::mat4 &matrix) {
+        if (m_matrices.size() == m_capacity) {
+            std::cout << "ERROR::INSTANCED_BATCH::FULL " << m_capacity << " instances" << std::endl;
+            return INVALID_HANDLE;
+        }
+        Handle handle;
+        if (!m_freeHandles.empty()) {
+            handle = m_freeHandles.back();
+            m_freeHandles.pop_back();
+        } else {
+            handle = (Handle)m_handleSlots.size();
+            m_handleSlots.push_back(0);
+        }
+        uint32_t slot = (uint32_t)m_matrices.size();
+        m_matrices.push_back(matrix);
+        m_slotHandles.push_back(handle);
+        m_handleSlots[handle] = slot;
+        markDirty(slot);
+        return handle;
+    }
+
+    void remove(Handle handle) {
+        if (!contains(handle)) {
+            return;
+        }
+        uint32_t slot = m_handleSlots[handle], last = (uint32_t)m_matrices.size() - 1;
+        if (slot != last) {
+            m_matrices[slot] = m_matrices[last];
+            m_slotHandles[slot] = m_slotHandles[last];
+            m_handleSlots[m_slotHandles[slot]] = slot;
+            markDirty(slot);
+        }
+        m_matrices.pop_back();
+        m_slotHandles.pop_back();
+        m_handleSlots[handle] = INVALID_HANDLE;
+        m_freeHandles.push_back(handle);
+    }
+
+    void update(Handle handle, const glm::mat4 &matrix) {
+        if (!contains(handle)) {
+            return;
+        }
+        uint32_t slot = m_handleSlots[handle];
+        m_matrices[slot] = matrix;
+        markDirty(slot);
+    }
+
+    bool contains(Handle handle) const {
+        return handle < m_handleSlots.size() && m_handleSlots[handle] != INVALID_HANDLE;
+    }
+    const glm::mat4& matrix(Handle handle) const {
+        return m_matrices[m_handleSlots[handle]];
+    }
+
+    // Sends the slots changed since the last call; nothing when there are none.
+    void upload() {
+        // slots past the end were removed again before ever being drawn
+        m_dirtyEnd = std::min(m_dirtyEnd, (uint32_t)m_matrices.size());
+        if (m_dirtyBegin >= m_dirtyEnd) {
+            m_dirtyBegin = m_dirtyEnd = 0;
+            return;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, m_dirtyBegin * sizeof(glm::mat4), (m_dirtyEnd - m_dirtyBegin) * sizeof(glm::mat4),
+                        m_matrices.data() + m_dirtyBegin);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_dirtyBegin = m_dirtyEnd = 0;
+    }
+
+    // Every instance, one draw per part. Uploads pending changes first.
+    void draw() {
+        upload();
+        setSource(m_buffer);
+        draw((GLsizei)m_matrices.size());
+    }
+
+    // The first instanceCount matrices of whatever buffer setSource() last pointed the parts at.
+    void draw(GLsizei instanceCount) const {
+        if (instanceCount <= 0) {
+            return;
+        }
+        for (const Part &part : m_parts) {
+            rg::glState().bindVertexArray(part.VAO);
+            if (part.indexed) {
+                glDrawElementsInstanced(GL_TRIANGLES, part.count, GL_UNSIGNED_INT, 0, instanceCount);
+            } else {
+                glDrawArraysInstanced(GL_TRIANGLES, 0, part.count, instanceCount);
+            }
+        }
+    }
+
+    // Points the matrix attributes of every part at another buffer of packed mat4s, e.g. a culled
+    // subset of the instances; buffer() puts them back.
+    void setSource(GLuint source) {
+        if (source == m_source) {
+            return;
+        }
+        m_source = source;
+        glBindBuffer(GL_ARRAY_BUFFER, source);
+        for (const Part &part : m_parts) {
+            rg::glState().bindVertexArray(part.VAO);
+            for (GLuint column = 0; column < 4; ++column) {
+                glEnableVertexAttribArray(m_matrixLocation + column);
+                glVertexAttribPointer(m_matrixLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                      (void*)(column * sizeof(glm::vec4)));
+                glVertexAttribDivisor(m_matrixLocation + column, 1);
+            }
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    size_t size() const {
+        return m_matrices.size();
+    }
+    size_t capacity() const {
+        return m_capacity;
+    }
+    // packed, slot order
+    const glm::mat4* matrices() const {
+        return m_matrices.data();
+    }
+    const std::vector<Part>& parts() const {
+        return m_parts;
+    }
+    GLuint buffer() const {
+        return m_buffer;
+    }
+    // the location the shader's mat4 instance attribute has to use
+    GLuint matrixLocation() const {
+        return m_matrixLocation;
+    }
+
+private:
+    std::vector<Part> m_parts;
+    size_t m_capacity;
+    GLuint m_buffer = 0;
+    GLuint m_source = 0;
+    GLuint m_matrixLocation = FIRST_FREE_LOCATION;
+    std::vector<glm::mat4> m_matrices;
+    std::vector<Handle> m_slotHandles;
+    std::vector<uint32_t> m_handleSlots;
+    std::vector<Handle> m_freeHandles;
+    uint32_t m_dirtyBegin = 0, m_dirtyEnd = 0;
+
+    void markDirty(uint32_t slot) {
+        if (m_dirtyBegin >= m_dirtyEnd) {
+            m_dirtyBegin = slot;
+            m_dirtyEnd = slot + 1;
+        } else {
+            m_dirtyBegin = std::min(m_dirtyBegin, slot);
+            m_dirtyEnd = std::max(m_dirtyEnd, slot + 1);
+        }
+    }
+
+    void init(GLuint matrixLocation) {
+        m_matrixLocation = allocateLocation(matrixLocation);
+        m_matrices.reserve(m_capacity);
+        m_slotHandles.reserve(m_capacity);
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        setSource(m_buffer);
+    }
+
+    // The wanted four slots when no part enables any of them, else the four after the highest one in use.
+    GLuint allocateLocation(GLuint wanted) const {
+        GLint maxAttributes = 16;
+        glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttributes);
+        GLint highestUsed = -1;
+        bool collides = false;
+        for (const Part &part : m_parts) {
+            rg::glState().bindVertexArray(part.VAO);
+            for (GLint location = 0; location < maxAttributes; ++location) {
+                GLint enabled = GL_FALSE;
+                glGetVertexAttribiv((GLuint)location, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+                if (enabled) {
+                    highestUsed = std::max(highestUsed, location);
+                    collides |= (GLuint)location >= wanted && (GLuint)location < wanted + 4;
+                }
+            }
+        }
+        GLuint location = wanted;
+        if (collides) {
+            location = (GLuint)(highestUsed + 1);
+            std::cout << "ERROR::INSTANCED_BATCH::ATTRIBUTE_COLLISION slots " << wanted << "-" << wanted + 3
+                      << " are used by the mesh, the matrix goes to " << location << "-" << location + 3 << std::endl;
+        }
+        if (location + 4 > (GLuint)maxAttributes) {
+            std::cout << "ERROR::INSTANCED_BATCH::OUT_OF_ATTRIBUTES " << maxAttributes << " available" << std::endl;
+        }
+        return location;
+    }
+};
+
+#endif //PROJECT_BASE_INSTANCEDBATCH_H
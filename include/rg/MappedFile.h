@@ -0,0 +1,114 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_MAPPEDFILE_H
+#define PROJECT_BASE_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only view of a whole file through mmap. Pages come in on first touch, so data handed
+// straight to glBufferData is read from disk exactly once and never copied into our own buffers.
+class MappedFile {
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string &path) {
+        open(path);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept : m_data(other.m_data), m_size(other.m_size) {
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            m_data = other.m_data;
+            m_size = other.m_size;
+            other.m_data = nullptr;
+            other.m_size = 0;
+        }
+        return *this;
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    // False if the file is missing, empty or can't be mapped.
+    bool open(const std::string &path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps its own reference to the file
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        madvise(data, (size_t)info.st_size, MADV_WILLNEED);
+        m_data = (const char*)data;
+        m_size = (size_t)info.st_size;
+        return true;
+    }
+
+    void close() {
+        if (m_data) {
+            munmap((void*)m_data, m_size);
+        }
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    bool isOpen() const {
+        return m_data != nullptr;
+    }
+    const char* data() const {
+        return m_data;
+    }
+    size_t size() const {
+        return m_size;
+    }
+};
+
+// Identifies the source a file was baked from; a source edited after baking makes the file stale.
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t modified = 0;
+
+    static bool of(const std::string &path, FileStamp &stamp) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return false;
+        }
+        stamp.size = (uint64_t)info.st_size;
+        stamp.modified = (int64_t)info.st_mtime;
+        return true;
+    }
+
+    bool operator==(const FileStamp &other) const {
+        return size == other.size && modified == other.modified;
+    }
+};
+
+#endif //PROJECT_BASE_MAPPEDFILE_H
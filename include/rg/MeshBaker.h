@@ -0,0 +1,101 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_MESHBAKER_H
+#define PROJECT_BASE_MESHBAKER_H
+
+#include <string>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <rg/MeshFile.h>
+
+// Assimp side of the baked mesh format: imports a model the way Model always has and lays it out as a
+// BakedModel. Used by the offline baker and by Model when there is no usable baked file.
+namespace rg {
+
+    void bakeVector(float* out, const aiVector3D &v) {
+        out[0] = v.x;
+        out[1] = v.y;
+        out[2] = v.z;
+    }
+
+    void bakeMesh(const aiMesh* mesh, BakedModel &model) {
+        MeshFile::MeshRecord record;
+        record.firstVertex = (uint32_t)model.vertices.size();
+        record.vertexCount = mesh->mNumVertices;
+        record.firstIndex = (uint32_t)model.indices.size();
+        record.material = mesh->mMaterialIndex;
+
+        model.vertices.resize(model.vertices.size() + mesh->mNumVertices);
+        BakedVertex* vertices = model.vertices.data() + record.firstVertex;
+        std::memset(vertices, 0, mesh->mNumVertices * sizeof(BakedVertex));
+        for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+            BakedVertex &vertex = vertices[i];
+            bakeVector(vertex.position, mesh->mVertices[i]);
+            if (mesh->HasNormals()) {
+                bakeVector(vertex.normal, mesh->mNormals[i]);
+            }
+            // only the first of the (up to 8) uv sets is used; tangents come with it from CalcTangentSpace
+            if (mesh->mTextureCoords[0]) {
+                vertex.texCoords[0] = mesh->mTextureCoords[0][i].x;
+                vertex.texCoords[1] = mesh->mTextureCoords[0][i].y;
+                bakeVector(vertex.tangent, mesh->mTangents[i]);
+                bakeVector(vertex.bitangent, mesh->mBitangents[i]);
+            }
+        }
+
+        for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+            const aiFace &face = mesh->mFaces[i];
+            model.indices.insert(model.indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+        }
+        record.indexCount = (uint32_t)model.indices.size() - record.firstIndex;
+        model.meshes.push_back(record);
+    }
+
+    void bakeNode(const aiNode* node, const aiScene* scene, BakedModel &model) {
+        for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+            bakeMesh(scene->mMeshes[node->mMeshes[i]], model);
+        }
+        for (unsigned int i = 0; i < node->mNumChildren; ++i) {
+            bakeNode(node->mChildren[i], scene, model);
+        }
+    }
+
+    void bakeMaterial(const aiMaterial* material, BakedModel &model) {
+        // aiTextureType_HEIGHT holds the normal maps of .obj files and AMBIENT the height maps
+        static const aiTextureType sources[MESH_TEXTURE_TYPE_COUNT] = {
+                aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_HEIGHT, aiTextureType_AMBIENT
+        };
+        MeshFile::MaterialRecord record;
+        record.firstTexture = (uint32_t)model.textures.size();
+        for (uint32_t type = 0; type < MESH_TEXTURE_TYPE_COUNT; ++type) {
+            for (unsigned int i = 0; i < material->GetTextureCount(sources[type]); ++i) {
+                aiString path;
+                material->GetTexture(sources[type], i, &path);
+                model.addTexture(type, path.C_Str());
+            }
+        }
+        record.textureCount = (uint32_t)model.textures.size() - record.firstTexture;
+        model.materials.push_back(record);
+    }
+
+    // Imports path with Assimp and fills model. On false error holds Assimp's message.
+    bool bakeModelFile(const std::string &path, BakedModel &model, std::string &error) {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+            error = importer.GetErrorString();
+            return false;
+        }
+        model = BakedModel();
+        for (unsigned int i = 0; i < scene->mNumMaterials; ++i) {
+            bakeMaterial(scene->mMaterials[i], model);
+        }
+        bakeNode(scene->mRootNode, scene, model);
+        return true;
+    }
+};
+
+#endif //PROJECT_BASE_MESHBAKER_H
@@ -0,0 +1,306 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_MESHFILE_H
+#define PROJECT_BASE_MESHFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <rg/MappedFile.h>
+
+// Baked model format (.rgmesh), written by tools/mesh_baker.cpp and mapped by Model at startup.
+//
+//   Header
+//   MeshRecord[meshCount]          vertex and index range of every mesh, in Assimp node order
+//   MaterialRecord[materialCount]  range of TextureRecords
+//   TextureRecord[textureCount]    sampler type and a path into the string table
+//   char[stringSize]               texture paths, not terminated
+//   (zero padding to 16 bytes)
+//   BakedVertex[vertexCount]       interleaved, laid out exactly like Mesh's Vertex
+//   uint32_t[indexCount]           triangles, relative to the first vertex of their mesh
+//
+// Little endian, no pointers: every range is checked against the file once and then the vertex and
+// index blobs go to glBufferData as they are.
+
+// Texture types in the order processMesh always loaded them.
+enum MeshTextureType : uint32_t {
+    MESH_TEXTURE_DIFFUSE,
+    MESH_TEXTURE_SPECULAR,
+    MESH_TEXTURE_NORMAL,
+    MESH_TEXTURE_HEIGHT,
+    MESH_TEXTURE_TYPE_COUNT
+};
+
+// The sampler name prefix Mesh numbers (texture_diffuse1, texture_diffuse2, ...).
+const char* meshTextureTypeName(uint32_t type) {
+    static const char* names[MESH_TEXTURE_TYPE_COUNT] = {
+            "texture_diffuse", "texture_specular", "texture_normal", "texture_height"
+    };
+    return type < MESH_TEXTURE_TYPE_COUNT ? names[type] : "";
+}
+
+struct BakedVertex {
+    float position[3];
+    float normal[3];
+    float texCoords[2];
+    float tangent[3];
+    float bitangent[3];
+};
+
+static_assert(sizeof(BakedVertex) == 56, "BakedVertex is stored as raw bytes");
+
+struct MeshFile {
+    static constexpr uint32_t VERSION = 1;
+    static constexpr const char* EXTENSION = ".rgmesh";
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        uint32_t meshCount;
+        uint32_t materialCount;
+        uint32_t textureCount;
+        uint32_t stringSize;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint64_t fileSize;
+    };
+
+    struct MeshRecord {
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t material;
+    };
+
+    struct MaterialRecord {
+        uint32_t firstTexture;
+        uint32_t textureCount;
+    };
+
+    struct TextureRecord {
+        uint32_t type;
+        uint32_t pathOffset;
+        uint32_t pathLength;
+    };
+
+    // Where the blobs of a file with these counts start, and how long it is.
+    static void layout(const Header &counts, uint64_t &vertexOffset, uint64_t &indexOffset, uint64_t &fileSize) {
+        uint64_t tables = sizeof(Header)
+                          + (uint64_t)counts.meshCount * sizeof(MeshRecord)
+                          + (uint64_t)counts.materialCount * sizeof(MaterialRecord)
+                          + (uint64_t)counts.textureCount * sizeof(TextureRecord)
+                          + counts.stringSize;
+        vertexOffset = (tables + 15) & ~(uint64_t)15;
+        indexOffset = vertexOffset + (uint64_t)counts.vertexCount * sizeof(BakedVertex);
+        fileSize = indexOffset + (uint64_t)counts.indexCount * sizeof(uint32_t);
+    }
+};
+
+static_assert(sizeof(MeshFile::Header) == 72, "mesh file header is written as raw bytes");
+static_assert(sizeof(MeshFile::MeshRecord) == 20 && sizeof(MeshFile::MaterialRecord) == 8 &&
+              sizeof(MeshFile::TextureRecord) == 12, "mesh file tables are written as raw bytes");
+
+// A model in the baked layout, built in memory by the baker before it is written out.
+struct BakedModel {
+    std::vector<MeshFile::MeshRecord> meshes;
+    std::vector<MeshFile::MaterialRecord> materials;
+    std::vector<MeshFile::TextureRecord> textures;
+    std::string strings;
+    std::vector<BakedVertex> vertices;
+    std::vector<uint32_t> indices;
+
+    void addTexture(uint32_t type, const std::string &path) {
+        MeshFile::TextureRecord texture;
+        texture.type = type;
+        texture.pathOffset = (uint32_t)strings.size();
+        texture.pathLength = (uint32_t)path.size();
+        strings += path;
+        textures.push_back(texture);
+    }
+};
+
+// Writes next to the target and renames, so a reader never maps a half written file.
+bool writeMeshFile(const std::string &path, const BakedModel &model, const FileStamp &source) {
+    MeshFile::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "RGMS", 4);
+    header.version = MeshFile::VERSION;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.meshCount = (uint32_t)model.meshes.size();
+    header.materialCount = (uint32_t)model.materials.size();
+    header.textureCount = (uint32_t)model.textures.size();
+    header.stringSize = (uint32_t)model.strings.size();
+    header.vertexCount = (uint32_t)model.vertices.size();
+    header.indexCount = (uint32_t)model.indices.size();
+    MeshFile::layout(header, header.vertexOffset, header.indexOffset, header.fileSize);
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)model.meshes.data(), model.meshes.size() * sizeof(MeshFile::MeshRecord));
+        out.write((const char*)model.materials.data(), model.materials.size() * sizeof(MeshFile::MaterialRecord));
+        out.write((const char*)model.textures.data(), model.textures.size() * sizeof(MeshFile::TextureRecord));
+        out.write(model.strings.data(), model.strings.size());
+        static const char padding[16] = {};
+        out.write(padding, header.vertexOffset - (uint64_t)out.tellp());
+        out.write((const char*)model.vertices.data(), model.vertices.size() * sizeof(BakedVertex));
+        out.write((const char*)model.indices.data(), model.indices.size() * sizeof(uint32_t));
+        if (!out || (uint64_t)out.tellp() != header.fileSize) {
+            out.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Read access to a baked model, either a mapped file (open) or a BakedModel still in memory. Holds only
+// pointers, the bytes must outlive the view.
+class MeshFileView {
+public:
+    MeshFileView() = default;
+
+    explicit MeshFileView(const BakedModel &model)
+            : m_meshes(model.meshes.data()), m_materials(model.materials.data()), m_textures(model.textures.data()),
+              m_strings(model.strings.data()), m_vertices(model.vertices.data()), m_indices(model.indices.data()),
+              m_meshCount((uint32_t)model.meshes.size()), m_materialCount((uint32_t)model.materials.size()) {}
+
+    // Checks every count, offset and index against the size before handing out any pointer. On false
+    // error() says what is wrong and the view stays empty.
+    bool open(const char* data, size_t size) {
+        *this = MeshFileView();
+        MeshFile::Header header;
+        if (size < sizeof(header)) {
+            return fail("file too small for a header");
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, "RGMS", 4) != 0) {
+            return fail("not a baked mesh file");
+        }
+        if (header.version != MeshFile::VERSION) {
+            return fail("baked with format version " + std::to_string(header.version) + ", expected " +
+                        std::to_string(MeshFile::VERSION));
+        }
+        uint64_t vertexOffset, indexOffset, fileSize;
+        MeshFile::layout(header, vertexOffset, indexOffset, fileSize);
+        if (header.vertexOffset != vertexOffset || header.indexOffset != indexOffset ||
+            header.fileSize != fileSize || fileSize != size) {
+            return fail("size does not match the header, file is truncated or corrupt");
+        }
+
+        const char* cursor = data + sizeof(header);
+        const MeshFile::MeshRecord* meshes = (const MeshFile::MeshRecord*)cursor;
+        cursor += header.meshCount * sizeof(MeshFile::MeshRecord);
+        const MeshFile::MaterialRecord* materials = (const MeshFile::MaterialRecord*)cursor;
+        cursor += header.materialCount * sizeof(MeshFile::MaterialRecord);
+        const MeshFile::TextureRecord* textures = (const MeshFile::TextureRecord*)cursor;
+        cursor += header.textureCount * sizeof(MeshFile::TextureRecord);
+        const char* strings = cursor;
+        const uint32_t* indices = (const uint32_t*)(data + indexOffset);
+
+        for (uint32_t i = 0; i < header.textureCount; ++i) {
+            if (textures[i].type >= MESH_TEXTURE_TYPE_COUNT ||
+                (uint64_t)textures[i].pathOffset + textures[i].pathLength > header.stringSize) {
+                return fail("texture " + std::to_string(i) + " is out of range");
+            }
+        }
+        for (uint32_t i = 0; i < header.materialCount; ++i) {
+            if ((uint64_t)materials[i].firstTexture + materials[i].textureCount > header.textureCount) {
+                return fail("material " + std::to_string(i) + " is out of range");
+            }
+        }
+        for (uint32_t i = 0; i < header.meshCount; ++i) {
+            const MeshFile::MeshRecord &mesh = meshes[i];
+            if ((uint64_t)mesh.firstVertex + mesh.vertexCount > header.vertexCount ||
+                (uint64_t)mesh.firstIndex + mesh.indexCount > header.indexCount ||
+                mesh.material >= header.materialCount) {
+                return fail("mesh " + std::to_string(i) + " is out of range");
+            }
+            // a bad index would make the GPU read past the vertex buffer
+            const uint32_t* meshIndices = indices + mesh.firstIndex;
+            uint32_t largest = 0;
+            for (uint32_t j = 0; j < mesh.indexCount; ++j) {
+                largest = meshIndices[j] > largest ? meshIndices[j] : largest;
+            }
+            if (mesh.indexCount && largest >= mesh.vertexCount) {
+                return fail("mesh " + std::to_string(i) + " indexes past its vertices");
+            }
+        }
+
+        m_meshes = meshes;
+        m_materials = materials;
+        m_textures = textures;
+        m_strings = strings;
+        m_vertices = (const BakedVertex*)(data + vertexOffset);
+        m_indices = indices;
+        m_meshCount = header.meshCount;
+        m_materialCount = header.materialCount;
+        m_source.size = header.sourceSize;
+        m_source.modified = header.sourceModified;
+        return true;
+    }
+
+    uint32_t meshCount() const {
+        return m_meshCount;
+    }
+    const MeshFile::MeshRecord& mesh(uint32_t i) const {
+        return m_meshes[i];
+    }
+    const MeshFile::MaterialRecord& material(uint32_t i) const {
+        return m_materials[i];
+    }
+    const MeshFile::TextureRecord& texture(uint32_t i) const {
+        return m_textures[i];
+    }
+    std::string texturePath(uint32_t i) const {
+        return std::string(m_strings + m_textures[i].pathOffset, m_textures[i].pathLength);
+    }
+    const BakedVertex* vertices(const MeshFile::MeshRecord &mesh) const {
+        return m_vertices + mesh.firstVertex;
+    }
+    const uint32_t* indices(const MeshFile::MeshRecord &mesh) const {
+        return m_indices + mesh.firstIndex;
+    }
+    // only set for an opened file
+    const FileStamp& source() const {
+        return m_source;
+    }
+    const std::string& error() const {
+        return m_error;
+    }
+
+private:
+    const MeshFile::MeshRecord* m_meshes = nullptr;
+    const MeshFile::MaterialRecord* m_materials = nullptr;
+    const MeshFile::TextureRecord* m_textures = nullptr;
+    const char* m_strings = nullptr;
+    const BakedVertex* m_vertices = nullptr;
+    const uint32_t* m_indices = nullptr;
+    uint32_t m_meshCount = 0;
+    uint32_t m_materialCount = 0;
+    FileStamp m_source;
+    std::string m_error;
+
+    bool fail(const std::string &error) {
+        m_error = error;
+        return false;
+    }
+};
+
+#endif //PROJECT_BASE_MESHFILE_H
@@ -0,0 +1,386 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_MIPCHAIN_H
+#define PROJECT_BASE_MIPCHAIN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RG_MIP_X86 1
+#endif
+
+// CPU mip chain builder, so every texture gets the same 2x2 box filter whatever the driver's
+// glGenerateMipmap does. Works on 1 to 4 channel 8 bit images. For sRGB images the colour channels
+// are averaged in linear light and alpha as it is; the GL sRGB formats only cover 3 and 4 channels,
+// so that is where srgb applies.
+//
+// An odd width or height drops the last column or row, a side of 1 stays 1. Each level is filtered from
+// the one before it.
+//
+// Kernels: scalar, SSE4.1 and AVX2, picked at run time. They only differ in speed, the output is the
+// same to the bit. Both paths sum in 16 bit lanes: 8 bit values as they are, sRGB values as 14 bit
+// linear ones, so four of them never overflow.
+
+// One buffer with every level, largest first, rows tightly packed (GL_UNPACK_ALIGNMENT 1).
+struct MipChain {
+    struct Level {
+        unsigned width, height;
+        size_t offset, size;
+    };
+    unsigned channels = 0;
+    std::vector<Level> levels;
+    std::vector<uint8_t> pixels;
+
+    const uint8_t* level(size_t i) const {
+        return pixels.data() + levels[i].offset;
+    }
+};
+
+namespace rg {
+    enum MipKernel {
+        MIP_KERNEL_SCALAR,
+        MIP_KERNEL_SSE41,
+        MIP_KERNEL_AVX2,
+        MIP_KERNEL_COUNT
+    };
+
+    const char* mipKernelName(MipKernel kernel) {
+        switch (kernel) {
+            case MIP_KERNEL_SCALAR: return "scalar";
+            case MIP_KERNEL_SSE41: return "SSE4.1";
+            case MIP_KERNEL_AVX2: return "AVX2";
+            default: return "?";
+        }
+    }
+
+    bool mipKernelSupported(MipKernel kernel) {
+#ifdef RG_MIP_X86
+        switch (kernel) {
+            case MIP_KERNEL_SCALAR: return true;
+            case MIP_KERNEL_SSE41: return __builtin_cpu_supports("sse4.1");
+            case MIP_KERNEL_AVX2: return __builtin_cpu_supports("avx2");
+            default: return false;
+        }
+#else
+        return kernel == MIP_KERNEL_SCALAR;
+#endif
+    }
+
+    MipKernel bestMipKernel() {
+        static const MipKernel best = mipKernelSupported(MIP_KERNEL_AVX2) ? MIP_KERNEL_AVX2 :
+                                      mipKernelSupported(MIP_KERNEL_SSE41) ? MIP_KERNEL_SSE41 : MIP_KERNEL_SCALAR;
+        return best;
+    }
+
+    // sRGB byte -> linear value in [0, 16383]
+    const uint16_t* srgbToLinearTable() {
+        static const std::vector<uint16_t> table = [] {
+            std::vector<uint16_t> t(256);
+            for (int i = 0; i < 256; ++i) {
+                double c = i / 255.0;
+                double linear = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+                t[i] = (uint16_t)std::lround(linear * 16383.0);
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // linear value in [0, 16383] -> nearest sRGB byte
+    const uint8_t* linearToSrgbTable() {
+        static const std::vector<uint8_t> table = [] {
+            std::vector<uint8_t> t(16384);
+            for (int i = 0; i < 16384; ++i) {
+                double linear = i / 16383.0;
+                double c = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+                t[i] = (uint8_t)std::lround(std::min(1.0, std::max(0.0, c)) * 255.0);
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // out[i] = a[i] + b[i], widened to 16 bits
+    void mipAddRows8Scalar(const uint8_t* a, const uint8_t* b, uint16_t* out, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = (uint16_t)(a[i] + b[i]);
+        }
+    }
+
+    void mipAddRows16Scalar(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = (uint16_t)(a[i] + b[i]);
+        }
+    }
+
+    // out pixel x = in pixel 2x + in pixel 2x+1, per channel
+    void mipAddPairsScalar(const uint16_t* in, uint16_t* out, size_t outWidth, unsigned channels) {
+        for (size_t x = 0; x < outWidth; ++x) {
+            for (unsigned c = 0; c < channels; ++c) {
+                out[x * channels + c] = (uint16_t)(in[2 * x * channels + c] + in[(2 * x + 1) * channels + c]);
+            }
+        }
+    }
+
+    // rounded sum / 4 back to bytes
+    void mipAverageScalar(const uint16_t* sums, uint8_t* out, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = (uint8_t)((sums[i] + 2) >> 2);
+        }
+    }
+
+#ifdef RG_MIP_X86
+    __attribute__((target("sse4.1")))
+    void mipAddRows8Sse41(const uint8_t* a, const uint8_t* b, uint16_t* out, size_t n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+            __m128i zero = _mm_setzero_si128();
+            _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero)));
+            _mm_storeu_si128((__m128i*)(out + i + 8), _mm_add_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero)));
+        }
+        mipAddRows8Scalar(a + i, b + i, out + i, n - i);
+    }
+
+    __attribute__((target("sse4.1")))
+    void mipAddRows16Sse41(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i sum = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+            _mm_storeu_si128((__m128i*)(out + i), sum);
+        }
+        mipAddRows16Scalar(a + i, b + i, out + i, n - i);
+    }
+
+    // hadd wraps instead of saturating, which is exact here: no sum reaches 65536, and for 2 channels
+    // the low half of a 32 bit lane never carries into the high one
+    __attribute__((target("sse4.1")))
+    void mipAddPairsSse41(const uint16_t* in, uint16_t* out, size_t outWidth, unsigned channels) {
+        size_t x = 0;
+        if (channels == 1) {
+            for (; x + 8 <= outWidth; x += 8) {
+                __m128i lo = _mm_loadu_si128((const __m128i*)(in + 2 * x));
+                __m128i hi = _mm_loadu_si128((const __m128i*)(in + 2 * x + 8));
+                _mm_storeu_si128((__m128i*)(out + x), _mm_hadd_epi16(lo, hi));
+            }
+        } else if (channels == 2) {
+            for (; x + 4 <= outWidth; x += 4) {
+                __m128i lo = _mm_loadu_si128((const __m128i*)(in + 4 * x));
+                __m128i hi = _mm_loadu_si128((const __m128i*)(in + 4 * x + 8));
+                _mm_storeu_si128((__m128i*)(out + 2 * x), _mm_hadd_epi32(lo, hi));
+            }
+        } else if (channels == 4) {
+            for (; x + 2 <= outWidth; x += 2) {
+                __m128i lo = _mm_loadu_si128((const __m128i*)(in + 8 * x));
+                __m128i hi = _mm_loadu_si128((const __m128i*)(in + 8 * x + 8));
+                __m128i even = _mm_unpacklo_epi64(lo, hi), odd = _mm_unpackhi_epi64(lo, hi);
+                _mm_storeu_si128((__m128i*)(out + 4 * x), _mm_add_epi16(even, odd));
+            }
+        }
+        mipAddPairsScalar(in + 2 * x * channels, out + x * channels, outWidth - x, channels);
+    }
+
+    __attribute__((target("sse4.1")))
+    void mipAverageSse41(const uint16_t* sums, uint8_t* out, size_t n) {
+        size_t i = 0;
+        const __m128i two = _mm_set1_epi16(2);
+        for (; i + 16 <= n; i += 16) {
+            __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*)(sums + i)), two), 2);
+            __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*)(sums + i + 8)), two), 2);
+            _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(lo, hi));
+        }
+        mipAverageScalar(sums + i, out + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    void mipAddRows8Avx2(const uint8_t* a, const uint8_t* b, uint16_t* out, size_t n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + i)));
+            __m256i vb = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + i)));
+            _mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi16(va, vb));
+        }
+        mipAddRows8Scalar(a + i, b + i, out + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    void mipAddRows16Avx2(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m256i sum = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+            _mm256_storeu_si256((__m256i*)(out + i), sum);
+        }
+        mipAddRows16Scalar(a + i, b + i, out + i, n - i);
+    }
+
+    // the 256 bit hadd/unpack work per 128 bit half, the permute puts the halves back in order
+    __attribute__((target("avx2")))
+    void mipAddPairsAvx2(const uint16_t* in, uint16_t* out, size_t outWidth, unsigned channels) {
+        size_t x = 0;
+        if (channels == 1) {
+            for (; x + 16 <= outWidth; x += 16) {
+                __m256i lo = _mm256_loadu_si256((const __m256i*)(in + 2 * x));
+                __m256i hi = _mm256_loadu_si256((const __m256i*)(in + 2 * x + 16));
+                __m256i sum = _mm256_permute4x64_epi64(_mm256_hadd_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+                _mm256_storeu_si256((__m256i*)(out + x), sum);
+            }
+        } else if (channels == 2) {
+            for (; x + 8 <= outWidth; x += 8) {
+                __m256i lo = _mm256_loadu_si256((const __m256i*)(in + 4 * x));
+                __m256i hi = _mm256_loadu_si256((const __m256i*)(in + 4 * x + 16));
+                __m256i sum = _mm256_permute4x64_epi64(_mm256_hadd_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+                _mm256_storeu_si256((__m256i*)(out + 2 * x), sum);
+            }
+        } else if (channels == 4) {
+            for (; x + 4 <= outWidth; x += 4) {
+                __m256i lo = _mm256_loadu_si256((const __m256i*)(in + 8 * x));
+                __m256i hi = _mm256_loadu_si256((const __m256i*)(in + 8 * x + 16));
+                __m256i even = _mm256_unpacklo_epi64(lo, hi), odd = _mm256_unpackhi_epi64(lo, hi);
+                __m256i sum = _mm256_permute4x64_epi64(_mm256_add_epi16(even, odd), _MM_SHUFFLE(3, 1, 2, 0));
+                _mm256_storeu_si256((__m256i*)(out + 4 * x), sum);
+            }
+        }
+        mipAddPairsSse41(in + 2 * x * channels, out + x * channels, outWidth - x, channels);
+    }
+
+    __attribute__((target("avx2")))
+    void mipAverageAvx2(const uint16_t* sums, uint8_t* out, size_t n) {
+        size_t i = 0;
+        const __m256i two = _mm256_set1_epi16(2);
+        for (; i + 32 <= n; i += 32) {
+            __m256i lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(sums + i)), two), 2);
+            __m256i hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(sums + i + 16)), two), 2);
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256((__m256i*)(out + i), packed);
+        }
+        mipAverageSse41(sums + i, out + i, n - i);
+    }
+#endif
+
+    struct MipKernelFunctions {
+        void (*addRows8)(const uint8_t*, const uint8_t*, uint16_t*, size_t);
+        void (*addRows16)(const uint16_t*, const uint16_t*, uint16_t*, size_t);
+        void (*addPairs)(const uint16_t*, uint16_t*, size_t, unsigned);
+        void (*average)(const uint16_t*, uint8_t*, size_t);
+    };
+
+    MipKernelFunctions mipKernelFunctions(MipKernel kernel) {
+#ifdef RG_MIP_X86
+        if (kernel == MIP_KERNEL_AVX2) {
+            return {mipAddRows8Avx2, mipAddRows16Avx2, mipAddPairsAvx2, mipAverageAvx2};
+        }
+        if (kernel == MIP_KERNEL_SSE41) {
+            return {mipAddRows8Sse41, mipAddRows16Sse41, mipAddPairsSse41, mipAverageSse41};
+        }
+#endif
+        return {mipAddRows8Scalar, mipAddRows16Scalar, mipAddPairsScalar, mipAverageScalar};
+    }
+
+    // Output rows [firstRow, lastRow) of the level below src.
+    void downsampleRows(const uint8_t* src, unsigned width, unsigned height, unsigned channels, bool srgb,
+                        uint8_t* dst, unsigned firstRow, unsigned lastRow, const MipKernelFunctions &kernel) {
+        unsigned outWidth = std::max(1u, width / 2);
+        size_t rowSize = (size_t)width * channels, outRowSize = (size_t)outWidth * channels;
+        bool linearLight = srgb && channels >= 3;
+        std::vector<uint16_t> rows(linearLight ? 2 * rowSize : 0), vertical(std::max<size_t>(rowSize, 2 * channels)),
+                sums(outRowSize);
+        const uint16_t* toLinear = srgbToLinearTable();
+        const uint8_t* toSrgb = linearToSrgbTable();
+
+        for (unsigned y = firstRow; y < lastRow; ++y) {
+            const uint8_t* row0 = src + std::min(2 * y, height - 1) * rowSize;
+            const uint8_t* row1 = src + std::min(2 * y + 1, height - 1) * rowSize;
+            if (linearLight) {
+                // alpha goes through the same sums scaled to 14 bits, 255 * 64 = 16320
+                uint16_t* linear0 = rows.data();
+                uint16_t* linear1 = rows.data() + rowSize;
+                for (size_t i = 0; i < rowSize; i += channels) {
+                    for (unsigned c = 0; c < 3; ++c) {
+                        linear0[i + c] = toLinear[row0[i + c]];
+                        linear1[i + c] = toLinear[row1[i + c]];
+                    }
+                    if (channels == 4) {
+                        linear0[i + 3] = (uint16_t)(row0[i + 3] << 6);
+                        linear1[i + 3] = (uint16_t)(row1[i + 3] << 6);
+                    }
+                }
+                kernel.addRows16(rows.data(), rows.data() + rowSize, vertical.data(), rowSize);
+            } else {
+                kernel.addRows8(row0, row1, vertical.data(), rowSize);
+            }
+            if (width == 1) {
+                std::memcpy(vertical.data() + channels, vertical.data(), channels * sizeof(uint16_t));
+            }
+            kernel.addPairs(vertical.data(), sums.data(), outWidth, channels);
+
+            uint8_t* out = dst + y * outRowSize;
+            if (linearLight) {
+                for (size_t i = 0; i < outRowSize; i += channels) {
+                    for (unsigned c = 0; c < 3; ++c) {
+                        out[i + c] = toSrgb[(sums[i + c] + 2) >> 2];
+                    }
+                    if (channels == 4) {
+                        out[i + 3] = (uint8_t)((sums[i + 3] + 128) >> 8);
+                    }
+                }
+            } else {
+                kernel.average(sums.data(), out, outRowSize);
+            }
+        }
+    }
+
+    // Filters src (width x height) into dst (max(1, width / 2) x max(1, height / 2)). Images of at
+    // least a megapixel are split into bands of rows over up to threadCount threads.
+    void downsample(const uint8_t* src, unsigned width, unsigned height, unsigned channels, bool srgb, uint8_t* dst,
+                    MipKernel kernel = bestMipKernel(), unsigned threadCount = 1) {
+        MipKernelFunctions functions = mipKernelFunctions(mipKernelSupported(kernel) ? kernel : MIP_KERNEL_SCALAR);
+        unsigned outHeight = std::max(1u, height / 2);
+        unsigned bands = (size_t)width * height >= (1u << 20) ? std::min(threadCount, outHeight) : 1;
+        if (bands <= 1) {
+            downsampleRows(src, width, height, channels, srgb, dst, 0, outHeight, functions);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (unsigned band = 1; band < bands; ++band) {
+            threads.emplace_back(downsampleRows, src, width, height, channels, srgb, dst,
+                                 outHeight * band / bands, outHeight * (band + 1) / bands, std::cref(functions));
+        }
+        downsampleRows(src, width, height, channels, srgb, dst, 0, outHeight / bands, functions);
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Copies the image into chain as level 0 and filters it down to 1x1.
+    void buildMipChain(const uint8_t* pixels, unsigned width, unsigned height, unsigned channels, bool srgb,
+                       MipChain &chain, unsigned threadCount = 1, MipKernel kernel = bestMipKernel()) {
+        chain.channels = channels;
+        chain.levels.clear();
+        size_t total = 0;
+        for (unsigned w = width, h = height;; w = std::max(1u, w / 2), h = std::max(1u, h / 2)) {
+            size_t size = (size_t)w * h * channels;
+            chain.levels.push_back({w, h, total, size});
+            total += size;
+            if (w == 1 && h == 1) {
+                break;
+            }
+        }
+        chain.pixels.resize(total);
+        std::memcpy(chain.pixels.data(), pixels, chain.levels[0].size);
+        for (size_t i = 1; i < chain.levels.size(); ++i) {
+            const MipChain::Level &above = chain.levels[i - 1];
+            downsample(chain.pixels.data() + above.offset, above.width, above.height, channels, srgb,
+                       chain.pixels.data() + chain.levels[i].offset, kernel, threadCount);
+        }
+    }
+};
+
+#endif //PROJECT_BASE_MIPCHAIN_H
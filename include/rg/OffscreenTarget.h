@@ -0,0 +1,118 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_OFFSCREENTARGET_H
+#define PROJECT_BASE_OFFSCREENTARGET_H
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// A framebuffer to render into when there is no window, or below the window's resolution: RGBA8 colour
+// and a DEPTH24_STENCIL8 depth buffer, the formats of GLFW's default framebuffer, so DepthPyramid can
+// blit the depth the same way.
+class OffscreenTarget {
+public:
+    OffscreenTarget() = default;
+
+    // Allocates the buffers; false, with ERROR::OFFSCREEN_TARGET:: printed, when the driver can't render
+    // to them.
+    bool create(int width, int height) {
+        glGenRenderbuffers(2, m_renderbuffers);
+        allocate(width, height);
+
+        glGenFramebuffers(1, &m_framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_renderbuffers[1]);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::OFFSCREEN_TARGET::INCOMPLETE status 0x" << std::hex << status << std::dec << std::endl;
+        } else {
+            m_complete = true;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return m_complete;
+    }
+
+    // New buffers of another size behind the same framebuffer; creates it the first time.
+    bool resize(int width, int height) {
+        if (!m_framebuffer) {
+            return create(width, height);
+        }
+        allocate(width, height);
+        return m_complete;
+    }
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    ~OffscreenTarget() {
+        if (m_framebuffer) {
+            glDeleteFramebuffers(1, &m_framebuffer);
+            glDeleteRenderbuffers(2, m_renderbuffers);
+        }
+    }
+
+    // Makes it the framebuffer draws go to, all of it.
+    void bind() const {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+        glViewport(0, 0, m_width, m_height);
+    }
+
+    // The colour buffer as RGBA rows, top to bottom like an image file. Waits for the frame to finish.
+    void readPixels(std::vector<uint8_t> &pixels) const {
+        size_t rowSize = (size_t)m_width * 4;
+        pixels.resize(rowSize * m_height);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        for (int top = 0, bottom = m_height - 1; top < bottom; ++top, --bottom) {
+            std::swap_ranges(pixels.begin() + top * rowSize, pixels.begin() + (top + 1) * rowSize, pixels.begin() + bottom * rowSize);
+        }
+    }
+
+    // Scales the colour buffer onto all of framebuffer (0, the window), and leaves that bound.
+    void blitTo(GLuint framebuffer, int width, int height) const {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, width, height);
+    }
+
+    GLuint framebuffer() const {
+        return m_framebuffer;
+    }
+    int width() const {
+        return m_width;
+    }
+    int height() const {
+        return m_height;
+    }
+    bool complete() const {
+        return m_complete;
+    }
+
+private:
+    int m_width = 0, m_height = 0;
+    GLuint m_framebuffer = 0;
+    GLuint m_renderbuffers[2] = {0, 0};
+    bool m_complete = false;
+
+    void allocate(int width, int height) {
+        m_width = width;
+        m_height = height;
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
+};
+
+#endif //PROJECT_BASE_OFFSCREENTARGET_H
@@ -0,0 +1,253 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_PERFORMANCEHUD_H
+#define PROJECT_BASE_PERFORMANCEHUD_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <imgui.h>
+#include <imgui_impl_glfw.h>
+#include <imgui_impl_opengl3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <rg/Frustum.h>
+#include <rg/GlState.h>
+#include <rg/GlTrace.h>
+#include <rg/Profiler.h>
+#include <rg/RenderQueue.h>
+
+// An ImGui window over the scene: frame times with their percentiles, the time of every profiling zone
+// on the CPU and the GPU, what the frame asked of GL, and switches for the features whose cost it is
+// there to show. F1 brings it up (project_base --hud).
+//
+// The counts come from a GlTrace open without a file, the per pass times from a Profiler started without
+// one (-DRG_PROFILE=ON). The HUD's own calls are taken out of the counts and shown on their own, with the
+// CPU and GPU time it took, the GPU's a GL_TIME_ELAPSED query read a few frames late.
+
+// What the tuning panel changes; the scene reads it every frame.
+struct HudTuning {
+    bool frustumCulling = true;
+    // the cube batches; the rock field is always one instanced draw
+    bool instancing = true;
+    int rockCount = 0, rockCapacity = 0;
+    // of the window's size the scene is drawn at
+    float resolutionScale = 1.0f;
+};
+
+// What the scene did in the frame the HUD is drawn over.
+struct HudFrameStats {
+    CullStats cull;
+    RenderQueueStats queue;
+    unsigned batchedDraws = 0, batchDrawCalls = 0;
+    GLintptr streamBytes = 0;
+};
+
+class PerformanceHud {
+public:
+    // frame times kept for the graph and the percentiles
+    static const unsigned FRAMES = 256;
+    static const unsigned GPU_LATENCY = 4;
+
+    PerformanceHud() = default;
+    PerformanceHud(const PerformanceHud&) = delete;
+    PerformanceHud& operator=(const PerformanceHud&) = delete;
+
+    ~PerformanceHud() {
+        if (m_window) {
+            glDeleteQueries(GPU_LATENCY, m_queries);
+            ImGui_ImplOpenGL3_Shutdown();
+            ImGui_ImplGlfw_Shutdown();
+            ImGui::DestroyContext();
+        }
+    }
+
+    // After the window's own callbacks are set; ImGui's pass everything on to them.
+    bool init(GLFWwindow *window) {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGui::StyleColorsDark();
+        if (!ImGui_ImplGlfw_InitForOpenGL(window, true)) {
+            std::cout << "ERROR::HUD::INIT glfw" << std::endl;
+            ImGui::DestroyContext();
+            return false;
+        }
+        if (!ImGui_ImplOpenGL3_Init("#version 330 core")) {
+            std::cout << "ERROR::HUD::INIT opengl" << std::endl;
+            ImGui_ImplGlfw_Shutdown();
+            ImGui::DestroyContext();
+            return false;
+        }
+        glGenQueries(GPU_LATENCY, m_queries);
+        m_window = window;
+        return true;
+    }
+
+    // Shows or hides it; the cursor is free while it is up, so the camera stops following the mouse.
+    void toggle() {
+        m_visible = !m_visible;
+        glfwSetInputMode(m_window, GLFW_CURSOR, m_visible ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
+    }
+    bool visible() const {
+        return m_visible;
+    }
+
+    // Every frame, shown or not, so the graph is full when it comes up.
+    void frameTime(float seconds) {
+        m_frameTimes[m_frame % FRAMES] = seconds * 1000.0f;
+        ++m_frame;
+    }
+
+    void draw(const HudFrameStats &stats, HudTuning &tuning) {
+        auto start = std::chrono::steady_clock::now();
+        const GlTraceStats &frameCalls = rg::glTrace().frame();
+        unsigned calls = frameCalls.calls, draws = frameCalls.draws(), uniforms = frameCalls.uniforms();
+
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowBgAlpha(0.8f);
+        ImGui::Begin("Performance", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+        drawFrameTimes();
+        drawPasses();
+        drawCounts(stats);
+        drawTuning(tuning);
+        drawOwnCost();
+        ImGui::End();
+        ImGui::Render();
+
+        unsigned slot = m_drawn % GPU_LATENCY;
+        readGpuTime(slot);
+        glBeginQuery(GL_TIME_ELAPSED, m_queries[slot]);
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        glEndQuery(GL_TIME_ELAPSED);
+        m_pending[slot] = true;
+        ++m_drawn;
+        // ImGui binds behind the state cache's back
+        rg::glState().invalidate();
+
+        m_ownCalls = frameCalls.calls - calls;
+        m_ownDraws = frameCalls.draws() - draws;
+        m_ownUniforms = frameCalls.uniforms() - uniforms;
+        m_ownCpu = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    GLFWwindow *m_window = nullptr;
+    bool m_visible = false;
+
+    float m_frameTimes[FRAMES] = {};
+    float m_sorted[FRAMES];
+    unsigned long m_frame = 0;
+
+    GLuint m_queries[GPU_LATENCY] = {};
+    bool m_pending[GPU_LATENCY] = {};
+    unsigned long m_drawn = 0;
+    // the HUD's part of the last frame it was drawn in
+    unsigned m_ownCalls = 0, m_ownDraws = 0, m_ownUniforms = 0;
+    float m_ownCpu = 0.0f, m_ownGpu = 0.0f;
+
+    void drawFrameTimes() {
+        unsigned count = (unsigned)std::min<unsigned long>(m_frame, FRAMES);
+        if (count == 0) {
+            return;
+        }
+        std::copy(m_frameTimes, m_frameTimes + count, m_sorted);
+        std::sort(m_sorted, m_sorted + count);
+        float last = m_frameTimes[(m_frame - 1) % FRAMES];
+        ImGui::Text("frame %.2f ms (%.0f fps)", last, last > 0.0f ? 1000.0f / last : 0.0f);
+        ImGui::Text("p50 %.2f ms  p95 %.2f ms  p99 %.2f ms", percentile(count, 0.50f), percentile(count, 0.95f),
+                    percentile(count, 0.99f));
+        // oldest on the left
+        ImGui::PlotLines("##frame times", m_frameTimes, (int)count, count == FRAMES ? (int)(m_frame % FRAMES) : 0,
+                         nullptr, 0.0f, m_sorted[count - 1] * 1.25f, ImVec2(320.0f, 60.0f));
+    }
+
+    float percentile(unsigned count, float fraction) const {
+        return m_sorted[std::min(count - 1, (unsigned)(fraction * (count - 1) + 0.5f))];
+    }
+
+    void drawPasses() {
+        ImGui::Separator();
+        Profiler &profiler = rg::profiler();
+        if (!profiler.active()) {
+            ImGui::TextDisabled("per pass times: configure with -DRG_PROFILE=ON");
+            return;
+        }
+        if (!ImGui::BeginTable("passes", 3, ImGuiTableFlags_RowBg)) {
+            return;
+        }
+        ImGui::TableSetupColumn("pass");
+        ImGui::TableSetupColumn("CPU ms");
+        ImGui::TableSetupColumn("GPU ms");
+        ImGui::TableHeadersRow();
+        for (unsigned zone = 0; zone < profiler.zoneCount(); ++zone) {
+            const ProfileZoneTimes &times = profiler.zoneTimes(zone);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(times.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", times.cpu / 1e6);
+            ImGui::TableNextColumn();
+            if (profiler.gpu()) {
+                ImGui::Text("%.3f", times.gpu / 1e6);
+            } else {
+                ImGui::TextDisabled("-");
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    void drawCounts(const HudFrameStats &stats) {
+        ImGui::Separator();
+        const GlTrace &trace = rg::glTrace();
+        if (trace.active()) {
+            const GlTraceStats &last = trace.lastFrame();
+            ImGui::Text("gl calls %u, draw calls %u, uniform uploads %u", last.calls - m_ownCalls, last.draws() - m_ownDraws,
+                        last.uniforms() - m_ownUniforms);
+        }
+        ImGui::Text("triangles %llu", (unsigned long long)stats.queue.primitives);
+        ImGui::Text("objects drawn %u of %u", stats.cull.visible, stats.cull.submitted);
+        ImGui::Text("cube draws %u in %u call(s)", stats.batchedDraws, stats.batchDrawCalls);
+        if (trace.active()) {
+            const GlTraceMemory &memory = trace.memory();
+            ImGui::Text("buffers %.1f MB, textures %.1f MB, renderbuffers %.1f MB", memory.buffers / 1048576.0,
+                        memory.textures / 1048576.0, memory.renderbuffers / 1048576.0);
+        }
+        ImGui::Text("stream buffer %ld bytes this frame", (long)stats.streamBytes);
+    }
+
+    void drawTuning(HudTuning &tuning) {
+        ImGui::Separator();
+        ImGui::Checkbox("frustum culling", &tuning.frustumCulling);
+        ImGui::Checkbox("instanced cubes", &tuning.instancing);
+        ImGui::SliderInt("rocks", &tuning.rockCount, 0, tuning.rockCapacity);
+        ImGui::SliderFloat("resolution scale", &tuning.resolutionScale, 0.25f, 1.0f, "%.2f");
+    }
+
+    void drawOwnCost() {
+        ImGui::Separator();
+        ImGui::Text("HUD: %.3f ms CPU, %.3f ms GPU, %u gl calls, %u draw calls", m_ownCpu, m_ownGpu, m_ownCalls, m_ownDraws);
+    }
+
+    // the time of the draw that last used the slot, if it is back; the last one stays otherwise
+    void readGpuTime(unsigned slot) {
+        if (!m_pending[slot]) {
+            return;
+        }
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(m_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint nanoseconds = 0;
+            glGetQueryObjectuiv(m_queries[slot], GL_QUERY_RESULT, &nanoseconds);
+            m_ownGpu = nanoseconds / 1e6f;
+        }
+        m_pending[slot] = false;
+    }
+};
+
+#endif //PROJECT_BASE_PERFORMANCEHUD_H
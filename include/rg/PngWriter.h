@@ -0,0 +1,115 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_PNGWRITER_H
+#define PROJECT_BASE_PNGWRITER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Just enough PNG to look at a frame: 8-bit RGB or RGBA, no filtering, and a zlib stream of stored
+// (uncompressed) deflate blocks. Files are about as large as the raw pixels, which is fine for dumps.
+
+namespace rg {
+
+    uint32_t pngCrc(const uint8_t* data, size_t size, uint32_t crc = 0xffffffffu) {
+        static uint32_t table[256];
+        static bool built = false;
+        if (!built) {
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) {
+                    c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                table[n] = c;
+            }
+            built = true;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    void pngPutBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+        out.push_back((uint8_t)(value >> 24));
+        out.push_back((uint8_t)(value >> 16));
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+
+    void pngPutChunk(std::vector<uint8_t> &out, const char type[4], const std::vector<uint8_t> &data) {
+        pngPutBigEndian(out, (uint32_t)data.size());
+        size_t typeStart = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        pngPutBigEndian(out, pngCrc(out.data() + typeStart, out.size() - typeStart) ^ 0xffffffffu);
+    }
+
+    // pixels are rows top to bottom, channels 3 or 4. Prints ERROR::PNG:: and returns false on failure.
+    bool writePng(const std::string &path, int width, int height, int channels, const uint8_t* pixels) {
+        if (width <= 0 || height <= 0 || (channels != 3 && channels != 4)) {
+            std::cout << "ERROR::PNG::UNSUPPORTED " << width << "x" << height << "x" << channels << std::endl;
+            return false;
+        }
+
+        // every row starts with its filter type, 0 for none
+        size_t rowSize = (size_t)width * channels;
+        std::vector<uint8_t> raw;
+        raw.reserve((rowSize + 1) * height);
+        for (int y = 0; y < height; ++y) {
+            raw.push_back(0);
+            raw.insert(raw.end(), pixels + y * rowSize, pixels + (y + 1) * rowSize);
+        }
+
+        std::vector<uint8_t> zlib = {0x78, 0x01};
+        uint32_t a = 1, b = 0;
+        size_t offset = 0;
+        bool last = false;
+        while (!last) {
+            size_t size = std::min(raw.size() - offset, (size_t)65535);
+            last = offset + size == raw.size();
+            zlib.push_back(last ? 1 : 0);
+            zlib.push_back((uint8_t)size);
+            zlib.push_back((uint8_t)(size >> 8));
+            zlib.push_back((uint8_t)~size);
+            zlib.push_back((uint8_t)(~size >> 8));
+            for (size_t i = offset; i < offset + size; ++i) {
+                zlib.push_back(raw[i]);
+                a = (a + raw[i]) % 65521;
+                b = (b + a) % 65521;
+            }
+            offset += size;
+        }
+        pngPutBigEndian(zlib, b << 16 | a);
+
+        std::vector<uint8_t> header;
+        pngPutBigEndian(header, (uint32_t)width);
+        pngPutBigEndian(header, (uint32_t)height);
+        header.push_back(8);
+        header.push_back(channels == 4 ? 6 : 2);
+        header.push_back(0);
+        header.push_back(0);
+        header.push_back(0);
+
+        std::vector<uint8_t> file = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        pngPutChunk(file, "IHDR", header);
+        pngPutChunk(file, "IDAT", zlib);
+        pngPutChunk(file, "IEND", std::vector<uint8_t>());
+
+        std::ofstream out(path, std::ios::binary);
+        out.write((const char*)file.data(), (std::streamsize)file.size());
+        if (!out) {
+            std::cout << "ERROR::PNG::WRITE_FAILED " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif //PROJECT_BASE_PNGWRITER_H
@@ -0,0 +1,497 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_PROFILER_H
+#define PROJECT_BASE_PROFILER_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Frame profiler. RG_PROFILE_ZONE("name") times the rest of the enclosing scope on the calling thread,
+// RG_PROFILE_GPU_ZONE("name") times it on the GPU as well. Zones nest, on any thread; GPU zones only on
+// the one that owns the context. Names must be string literals, RG_PROFILE_ZONE_DETAIL adds a string
+// (a file name) copied when the zone ends, which is meant for loading and not for every frame. Code that
+// only finds out where its zones start and end as it runs opens and closes a GpuProfileSpan instead.
+//
+// Configure with -DRG_PROFILE=ON to build the zones in, without it they compile to nothing. Recording
+// starts with start() and ends with write(), which saves everything as Chrome trace events
+// (chrome://tracing, ui.perfetto.dev). Started without a path nothing is kept but the time each zone
+// name took in the last frame, on the render thread and on the GPU (zoneTimes()).
+//
+// GPU zones are a pair of GL_TIMESTAMP queries each, so they can nest (GL_TIME_ELAPSED queries can't).
+// The results are read back LATENCY frames later, when the GPU has long finished them, and a
+// frame whose results still aren't there is dropped rather than waited for.
+
+// nanoseconds a zone name took in the render thread's last frame, and in the last frame the GPU's
+// results were read for
+struct ProfileZoneTimes {
+    const char *name = nullptr;
+    uint64_t cpu = 0;
+    uint64_t gpu = 0;
+};
+
+struct ProfileEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+    // index into the thread's details, or -1
+    int32_t detail;
+};
+
+// What one thread recorded. Only that thread appends; the count is published after the event so
+// write() can read a thread that is still running.
+struct ProfileThread {
+    uint32_t id;
+    std::string name;
+    std::vector<ProfileEvent> events;
+    std::atomic<size_t> count{0};
+    unsigned long dropped = 0;
+    std::mutex detailMutex;
+    std::deque<std::string> details;
+
+    ProfileThread(uint32_t id, size_t capacity) : id(id) {
+        events.resize(capacity);
+    }
+
+    void add(const char *name, uint64_t start, uint64_t end, int32_t detail = -1) {
+        size_t index = count.load(std::memory_order_relaxed);
+        if (index == events.size()) {
+            ++dropped;
+            return;
+        }
+        events[index] = ProfileEvent{name, start, end, detail};
+        count.store(index + 1, std::memory_order_release);
+    }
+
+    int32_t addDetail(const std::string &detail) {
+        std::lock_guard<std::mutex> lock(detailMutex);
+        details.push_back(detail);
+        return (int32_t)details.size() - 1;
+    }
+};
+
+class Profiler {
+public:
+    // how many frames GPU results are read after their frame, and the GPU zones a frame may have
+    static constexpr unsigned LATENCY = 4;
+    static constexpr unsigned GPU_ZONES = 64;
+    // events kept per thread, the render thread gets more (a frame is about twenty zones)
+    static constexpr size_t RENDER_THREAD_EVENTS = 1 << 18;
+    static constexpr size_t WORKER_THREAD_EVENTS = 1 << 14;
+    // distinct zone names zoneTimes() keeps
+    static constexpr unsigned ZONE_NAMES = 48;
+
+    Profiler() = default;
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Begins recording on the calling thread, which has the GL context. GPU zones stay CPU only when
+    // gpu is false or the context has no timer queries.
+    bool start(const std::string &path, bool gpu) {
+#ifndef RG_PROFILE
+        std::cout << "ERROR::PROFILER::NOT_BUILT configure with -DRG_PROFILE=ON for profiling zones" << std::endl;
+        return false;
+#endif
+        m_path = path;
+        m_recording = !path.empty();
+        m_epoch = std::chrono::steady_clock::now();
+        m_renderThread = current() = &addThread("render", m_recording ? RENDER_THREAD_EVENTS : 0);
+        if (gpu && glad_glQueryCounter && glad_glGetQueryObjectui64v && glad_glGetInteger64v) {
+            m_gpu.reset(new ProfileThread(GPU_THREAD_ID, m_recording ? RENDER_THREAD_EVENTS : 0));
+            m_gpu->name = "GPU";
+            m_queries.resize(LATENCY * GPU_ZONES * 2);
+            glGenQueries((GLsizei)m_queries.size(), m_queries.data());
+            // GPU timestamps are on their own clock, this is where it was when ours read now()
+            GLint64 gpuNow = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+            m_gpuOffset = (int64_t)now() - gpuNow;
+        }
+        m_active.store(true, std::memory_order_release);
+        return true;
+    }
+
+    bool active() const {
+        return m_active.load(std::memory_order_relaxed);
+    }
+
+    bool gpu() const {
+        return m_gpu != nullptr;
+    }
+
+    // nanoseconds since start()
+    uint64_t now() const {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+    }
+
+    // the calling thread's events
+    ProfileThread& thread() {
+        if (!current()) {
+            current() = &addThread("", WORKER_THREAD_EVENTS);
+        }
+        return *current();
+    }
+
+    void zoneEnded(const char *name, const char *detail, uint64_t start, uint64_t end) {
+        if (current() && current() == m_renderThread) {
+            unsigned zone = zoneIndex(name);
+            if (zone < ZONE_NAMES) {
+                m_cpuTimes[zone] += end - start;
+            }
+        }
+        if (m_recording) {
+            ProfileThread &thread = this->thread();
+            thread.add(name, start, end, detail ? thread.addDetail(detail) : -1);
+        }
+    }
+
+    // render thread
+    unsigned zoneCount() const {
+        return m_zoneNames;
+    }
+    const ProfileZoneTimes& zoneTimes(unsigned zone) const {
+        return m_times[zone];
+    }
+
+    // the index of a GPU zone's queries, or -1 when the frame has no more of them
+    int beginGpuZone() {
+        GpuFrame &frame = m_gpuFrames[m_gpuFrame];
+        if (!m_gpu || frame.count == GPU_ZONES) {
+            return -1;
+        }
+        unsigned zone = frame.count++;
+        glQueryCounter(query(m_gpuFrame, zone, 0), GL_TIMESTAMP);
+        return (int)zone;
+    }
+
+    void endGpuZone(int zone, const char *name) {
+        GpuFrame &frame = m_gpuFrames[m_gpuFrame];
+        frame.names[zone] = name;
+        frame.lastEnded = (unsigned)zone;
+        glQueryCounter(query(m_gpuFrame, (unsigned)zone, 1), GL_TIMESTAMP);
+    }
+
+    // After the frame's last zone: publishes its CPU times and collects the frame LATENCY frames back,
+    // whose queries are next.
+    void endFrame() {
+        if (!active()) {
+            return;
+        }
+        for (unsigned zone = 0; zone < m_zoneNames; ++zone) {
+            m_times[zone].cpu = m_cpuTimes[zone];
+            m_cpuTimes[zone] = 0;
+        }
+        if (m_gpu) {
+            m_gpuFrame = (m_gpuFrame + 1) % LATENCY;
+            collect(m_gpuFrame, false);
+        }
+    }
+
+    // Ends recording and writes the trace, waiting for the GPU zones still out. Without a path it only
+    // stops.
+    bool write() {
+        if (!active()) {
+            return true;
+        }
+        m_active.store(false, std::memory_order_release);
+        if (m_gpu) {
+            for (unsigned i = 1; i <= LATENCY; ++i) {
+                collect((m_gpuFrame + i) % LATENCY, true);
+            }
+            glDeleteQueries((GLsizei)m_queries.size(), m_queries.data());
+        }
+        if (!m_recording) {
+            return true;
+        }
+
+        std::ofstream out(m_path, std::ios::trunc);
+        if (!out) {
+            std::cout << "ERROR::PROFILER::CANNOT_WRITE " << m_path << std::endl;
+            return false;
+        }
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        std::lock_guard<std::mutex> lock(m_threadMutex);
+        for (const std::unique_ptr<ProfileThread> &thread : m_threads) {
+            writeThread(out, *thread, first);
+        }
+        if (m_gpu) {
+            writeThread(out, *m_gpu, first);
+        }
+        out << "\n]}\n";
+
+        size_t events = m_gpu ? m_gpu->count.load() : 0;
+        unsigned long dropped = m_gpu ? m_gpu->dropped : 0;
+        for (const std::unique_ptr<ProfileThread> &thread : m_threads) {
+            events += thread->count.load();
+            dropped += thread->dropped;
+        }
+        std::cout << "profile: " << events << " zones from " << m_threads.size() << " thread(s)"
+                  << (m_gpu ? " and the GPU" : "") << " in " << m_path;
+        if (dropped || m_gpuFramesDropped) {
+            std::cout << ", " << dropped << " zone(s) over capacity and " << m_gpuFramesDropped
+                      << " GPU frame(s) not ready in time dropped";
+        }
+        std::cout << std::endl;
+        return bool(out);
+    }
+
+private:
+    static constexpr uint32_t GPU_THREAD_ID = 0;
+
+    struct GpuFrame {
+        const char *names[GPU_ZONES];
+        unsigned count = 0;
+        // results arrive in order, once this one's end is there all of them are
+        unsigned lastEnded = 0;
+    };
+
+    std::atomic<bool> m_active{false};
+    bool m_recording = false;
+    std::string m_path;
+    std::chrono::steady_clock::time_point m_epoch;
+
+    std::mutex m_threadMutex;
+    std::vector<std::unique_ptr<ProfileThread>> m_threads;
+    ProfileThread *m_renderThread = nullptr;
+
+    // by zone name, render thread only
+    ProfileZoneTimes m_times[ZONE_NAMES];
+    uint64_t m_cpuTimes[ZONE_NAMES] = {};
+    unsigned m_zoneNames = 0;
+
+    std::unique_ptr<ProfileThread> m_gpu;
+    std::vector<GLuint> m_queries;
+    GpuFrame m_gpuFrames[LATENCY];
+    unsigned m_gpuFrame = 0;
+    int64_t m_gpuOffset = 0;
+    unsigned long m_gpuFramesDropped = 0;
+
+    static ProfileThread*& current() {
+        static thread_local ProfileThread *thread = nullptr;
+        return thread;
+    }
+
+    ProfileThread& addThread(const char *name, size_t capacity) {
+        std::lock_guard<std::mutex> lock(m_threadMutex);
+        m_threads.emplace_back(new ProfileThread((uint32_t)m_threads.size() + 1, capacity));
+        ProfileThread &thread = *m_threads.back();
+        thread.name = *name ? name : "thread " + std::to_string(thread.id);
+        return thread;
+    }
+
+    // ZONE_NAMES once the table is full
+    unsigned zoneIndex(const char *name) {
+        for (unsigned zone = 0; zone < m_zoneNames; ++zone) {
+            if (m_times[zone].name == name || std::strcmp(m_times[zone].name, name) == 0) {
+                return zone;
+            }
+        }
+        if (m_zoneNames == ZONE_NAMES) {
+            return ZONE_NAMES;
+        }
+        m_times[m_zoneNames].name = name;
+        return m_zoneNames++;
+    }
+
+    GLuint query(unsigned frame, unsigned zone, unsigned end) const {
+        return m_queries[(frame * GPU_ZONES + zone) * 2 + end];
+    }
+
+    // moves a frame's GPU zones to the GPU thread and frees its queries
+    void collect(unsigned frameIndex, bool wait) {
+        GpuFrame &frame = m_gpuFrames[frameIndex];
+        if (frame.count == 0) {
+            return;
+        }
+        GLuint last = query(frameIndex, frame.lastEnded, 1);
+        GLuint64 available = GL_FALSE;
+        glGetQueryObjectui64v(last, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && !wait) {
+            ++m_gpuFramesDropped;
+            frame.count = 0;
+            return;
+        }
+        uint64_t times[ZONE_NAMES] = {};
+        for (unsigned zone = 0; zone < frame.count; ++zone) {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(query(frameIndex, zone, 0), GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(query(frameIndex, zone, 1), GL_QUERY_RESULT, &end);
+            unsigned name = zoneIndex(frame.names[zone]);
+            if (name < ZONE_NAMES) {
+                times[name] += end - begin;
+            }
+            if (m_recording) {
+                m_gpu->add(frame.names[zone], (uint64_t)((int64_t)begin + m_gpuOffset), (uint64_t)((int64_t)end + m_gpuOffset));
+            }
+        }
+        for (unsigned zone = 0; zone < m_zoneNames; ++zone) {
+            m_times[zone].gpu = times[zone];
+        }
+        frame.count = 0;
+    }
+
+    static void writeString(std::ostream &out, const std::string &text) {
+        out << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if ((unsigned char)c >= 0x20) {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+    static void writeThread(std::ostream &out, ProfileThread &thread, bool &first) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id
+            << ",\"args\":{\"name\":";
+        writeString(out, thread.name);
+        out << "}}";
+        first = false;
+
+        std::lock_guard<std::mutex> lock(thread.detailMutex);
+        size_t count = thread.count.load(std::memory_order_acquire);
+        char times[64];
+        for (size_t i = 0; i < count; ++i) {
+            const ProfileEvent &event = thread.events[i];
+            out << ",\n{\"name\":";
+            writeString(out, event.name);
+            // microseconds, which is what the format has
+            std::snprintf(times, sizeof(times), ",\"ts\":%.3f,\"dur\":%.3f", event.start / 1000.0,
+                          (event.end - event.start) / 1000.0);
+            out << ",\"cat\":\"" << (thread.id == GPU_THREAD_ID ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << thread.id << times;
+            if (event.detail >= 0) {
+                out << ",\"args\":{\"detail\":";
+                writeString(out, thread.details[event.detail]);
+                out << "}";
+            }
+            out << "}";
+        }
+    }
+};
+
+namespace rg {
+    // the one profiler
+    Profiler& profiler() {
+        static Profiler profiler;
+        return profiler;
+    }
+};
+
+// Times its scope on the calling thread while the profiler records.
+class ProfileZone {
+public:
+    explicit ProfileZone(const char *name, const char *detail = nullptr)
+    : m_name(name), m_detail(detail), m_active(rg::profiler().active()), m_start(m_active ? rg::profiler().now() : 0) {}
+
+    ~ProfileZone() {
+        if (m_active) {
+            Profiler &profiler = rg::profiler();
+            profiler.zoneEnded(m_name, m_detail, m_start, profiler.now());
+        }
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char *m_name;
+    const char *m_detail;
+    bool m_active;
+    uint64_t m_start;
+};
+
+// Times its scope on the GPU, and on the CPU like ProfileZone.
+class GpuProfileZone {
+public:
+    explicit GpuProfileZone(const char *name)
+    : m_cpu(name), m_name(name), m_zone(rg::profiler().active() ? rg::profiler().beginGpuZone() : -1) {}
+
+    ~GpuProfileZone() {
+        if (m_zone >= 0) {
+            rg::profiler().endGpuZone(m_zone, m_name);
+        }
+    }
+
+    GpuProfileZone(const GpuProfileZone&) = delete;
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+
+private:
+    ProfileZone m_cpu;
+    const char *m_name;
+    int m_zone;
+};
+
+// A GPU and CPU zone opened and closed by hand, for a loop that switches zones as it goes, like the
+// render queue moving from one pass's draws to the next. begin() ends the zone open before it; a null
+// name only ends it. Does nothing without RG_PROFILE.
+class GpuProfileSpan {
+public:
+    GpuProfileSpan() = default;
+    GpuProfileSpan(const GpuProfileSpan&) = delete;
+    GpuProfileSpan& operator=(const GpuProfileSpan&) = delete;
+
+    ~GpuProfileSpan() {
+        end();
+    }
+
+    void begin(const char *name) {
+#ifdef RG_PROFILE
+        end();
+        Profiler &profiler = rg::profiler();
+        if (name && profiler.active()) {
+            m_name = name;
+            m_start = profiler.now();
+            m_zone = profiler.beginGpuZone();
+        }
+#endif
+    }
+
+    void end() {
+#ifdef RG_PROFILE
+        if (!m_name) {
+            return;
+        }
+        Profiler &profiler = rg::profiler();
+        if (m_zone >= 0) {
+            profiler.endGpuZone(m_zone, m_name);
+        }
+        profiler.zoneEnded(m_name, nullptr, m_start, profiler.now());
+        m_name = nullptr;
+        m_zone = -1;
+#endif
+    }
+
+private:
+    const char *m_name = nullptr;
+    uint64_t m_start = 0;
+    int m_zone = -1;
+};
+
+#define RG_PROFILE_CONCAT_(a, b) a##b
+#define RG_PROFILE_CONCAT(a, b) RG_PROFILE_CONCAT_(a, b)
+
+#ifdef RG_PROFILE
+#define RG_PROFILE_ZONE(name) ProfileZone RG_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define RG_PROFILE_ZONE_DETAIL(name, detail) ProfileZone RG_PROFILE_CONCAT(profileZone, __LINE__)(name, detail)
+#define RG_PROFILE_GPU_ZONE(name) GpuProfileZone RG_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define RG_PROFILE_ZONE(name) do {} while (0)
+#define RG_PROFILE_ZONE_DETAIL(name, detail) do {} while (0)
+#define RG_PROFILE_GPU_ZONE(name) do {} while (0)
+#endif
+
+#endif //PROJECT_BASE_PROFILER_H
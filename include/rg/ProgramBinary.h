@@ -0,0 +1,139 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_PROGRAMBINARY_H
+#define PROJECT_BASE_PROGRAMBINARY_H
+
+#include <glad/glad.h>
+#include <string>
+#include <rg/GlExtensions.h>
+#include <rg/ProgramBinaryCache.h>
+
+// GL side of the program binary cache. glGetProgramBinary is core in 4.1 and ARB_get_program_binary
+// before that; our glad only loads 3.3, so the three entry points are fetched here.
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace rg {
+
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+    struct ProgramBinaryFunctions {
+        GetProgramBinaryProc getProgramBinary = nullptr;
+        ProgramBinaryProc programBinary = nullptr;
+        ProgramParameteriProc programParameteri = nullptr;
+    };
+
+    ProgramBinaryFunctions& programBinaryFunctions() {
+        static ProgramBinaryFunctions functions;
+        return functions;
+    }
+
+    // The cache shader constructors go through; null (the default) compiles everything from source.
+    ProgramBinaryCache*& programBinaryCache() {
+        static ProgramBinaryCache* cache = nullptr;
+        return cache;
+    }
+
+    // Call once after gladLoadGLLoader. Returns false when the context can't save program binaries.
+    bool loadProgramBinaryFunctions(GLADloadproc load) {
+        ProgramBinaryFunctions& functions = programBinaryFunctions();
+        functions = ProgramBinaryFunctions();
+
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major * 10 + minor < 41 && !hasGlExtension("GL_ARB_get_program_binary")) {
+            return false;
+        }
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats <= 0) {
+            return false;
+        }
+        functions.getProgramBinary = (GetProgramBinaryProc)load("glGetProgramBinary");
+        functions.programBinary = (ProgramBinaryProc)load("glProgramBinary");
+        functions.programParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+        if (!functions.getProgramBinary || !functions.programBinary || !functions.programParameteri) {
+            functions = ProgramBinaryFunctions();
+            return false;
+        }
+        return true;
+    }
+
+    // Everything that makes a binary from one driver useless to another.
+    std::string glDriverString() {
+        std::string driver;
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const char* value = (const char*)glGetString(name);
+            driver += value ? value : "?";
+            driver += '\n';
+        }
+        return driver;
+    }
+
+    bool programBinaryCacheActive() {
+        return programBinaryCache() != nullptr && programBinaryFunctions().programBinary != nullptr;
+    }
+
+    ProgramBinaryCache::Key programBinaryKey(const std::string& vertexSource, const std::string& fragmentSource) {
+        if (!programBinaryCacheActive()) {
+            return ProgramBinaryCache::Key();
+        }
+        const std::string sources[] = {vertexSource, fragmentSource};
+        return programBinaryCache()->makeKey(sources, 2);
+    }
+
+    // Tries to fill a fresh program from the cache. On false the caller compiles and links from source.
+    bool loadCachedProgram(GLuint program, const ProgramBinaryCache::Key& key) {
+        if (!programBinaryCacheActive()) {
+            return false;
+        }
+        ProgramBinary binary;
+        if (!programBinaryCache()->load(key, binary)) {
+            return false;
+        }
+        programBinaryFunctions().programBinary(program, binary.format, binary.data.data(), (GLsizei)binary.data.size());
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            programBinaryCache()->reject(key);
+            return false;
+        }
+        return true;
+    }
+
+    // Before glLinkProgram, so the driver keeps the binary around for storeCachedProgram.
+    void markProgramRetrievable(GLuint program) {
+        if (programBinaryCacheActive()) {
+            programBinaryFunctions().programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+    }
+
+    // After a successful link from source.
+    void storeCachedProgram(GLuint program, const ProgramBinaryCache::Key& key) {
+        if (!programBinaryCacheActive()) {
+            return;
+        }
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+        ProgramBinary binary;
+        binary.data.resize(length);
+        GLenum format = 0;
+        programBinaryFunctions().getProgramBinary(program, length, nullptr, &format, binary.data.data());
+        binary.format = format;
+        programBinaryCache()->store(key, binary);
+    }
+};
+
+#endif //PROJECT_BASE_PROGRAMBINARY_H
@@ -0,0 +1,185 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_PROGRAMBINARYCACHE_H
+#define PROJECT_BASE_PROGRAMBINARYCACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+
+namespace rg {
+
+    // FNV-1a, 64 bit. Chain calls through seed to hash several buffers as one.
+    uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t hashString(const std::string& text, uint64_t seed = 14695981039346656037ull) {
+        // the length goes in too, so {"ab", "c"} and {"a", "bc"} hash differently
+        uint64_t length = text.size();
+        return hashBytes(text.data(), text.size(), hashBytes(&length, sizeof(length), seed));
+    }
+};
+
+// A linked program as the driver hands it out with glGetProgramBinary.
+struct ProgramBinary {
+    uint32_t format = 0;
+    std::vector<char> data;
+};
+
+// On-disk store of program binaries. Knows nothing about GL: it decides where a program lives, whether a
+// stored binary may be used and when to throw one away, so it can be driven from plain CPU code.
+//
+// A program is stored under the hash of its preprocessed stage sources. The file header carries the full
+// key, which also covers the driver (vendor, renderer, version), plus a checksum of the payload. A file
+// written by another driver, an older format or cut short is stale: load() deletes it and reports a miss,
+// and the caller's store() of the freshly linked program replaces it.
+class ProgramBinaryCache {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    static constexpr uint32_t MAX_BINARY_SIZE = 64u << 20;
+
+    struct Key {
+        uint64_t sources = 0;   // names the file
+        uint64_t full = 0;      // sources + driver, must match the header
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint64_t driver;
+        uint32_t binaryFormat;
+        uint32_t size;
+        uint64_t checksum;
+    };
+
+    ProgramBinaryCache(std::string directory, const std::string& driver)
+    : m_directory(std::move(directory)), m_driver(rg::hashString(driver)) {}
+
+    Key makeKey(const std::string* sources, size_t count) const {
+        Key key;
+        uint64_t hash = rg::hashString("rg-program");
+        for (size_t i = 0; i < count; ++i) {
+            hash = rg::hashString(sources[i], hash);
+        }
+        key.sources = hash;
+        key.full = rg::hashBytes(&m_driver, sizeof(m_driver), hash);
+        return key;
+    }
+
+    std::string path(const Key& key) const {
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)key.sources);
+        return m_directory + "/" + name + ".bin";
+    }
+
+    bool load(const Key& key, ProgramBinary& binary) {
+        std::string file = path(key);
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            ++m_misses;
+            return false;
+        }
+        Header header;
+        bool valid = (bool)in.read((char*)&header, sizeof(header))
+                     && std::memcmp(header.magic, "RGPB", 4) == 0
+                     && header.version == FORMAT_VERSION
+                     && header.driver == m_driver
+                     && header.key == key.full
+                     && header.size <= MAX_BINARY_SIZE;
+        if (valid) {
+            binary.format = header.binaryFormat;
+            binary.data.resize(header.size);
+            valid = (bool)in.read(binary.data.data(), header.size)
+                    && in.peek() == std::char_traits<char>::eof()
+                    && rg::hashBytes(binary.data.data(), binary.data.size()) == header.checksum;
+        }
+        in.close();
+        if (!valid) {
+            std::remove(file.c_str());
+            binary.data.clear();
+            ++m_stale;
+            ++m_misses;
+            return false;
+        }
+        ++m_hits;
+        return true;
+    }
+
+    bool store(const Key& key, const ProgramBinary& binary) {
+        mkdir(m_directory.c_str(), 0755);
+        Header header;
+        std::memcpy(header.magic, "RGPB", 4);
+        header.version = FORMAT_VERSION;
+        header.key = key.full;
+        header.driver = m_driver;
+        header.binaryFormat = binary.format;
+        header.size = (uint32_t)binary.data.size();
+        header.checksum = rg::hashBytes(binary.data.data(), binary.data.size());
+
+        // write next to the target and rename, a crash mid-write never leaves a half file under the real name
+        std::string file = path(key);
+        std::string temporary = file + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out.write((const char*)&header, sizeof(header)) || !out.write(binary.data.data(), binary.data.size())) {
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
+        if (std::rename(temporary.c_str(), file.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+        ++m_stores;
+        return true;
+    }
+
+    // The driver would not link a binary that load() accepted, it must not be offered again.
+    void reject(const Key& key) {
+        std::remove(path(key).c_str());
+        ++m_rejected;
+        --m_hits;
+        ++m_misses;
+    }
+
+    unsigned hits() const { return m_hits; }
+    unsigned misses() const { return m_misses; }
+    unsigned stale() const { return m_stale; }
+    unsigned rejected() const { return m_rejected; }
+    unsigned stores() const { return m_stores; }
+
+    std::string summary() const {
+        std::ostringstream out;
+        out << "program binary cache: " << m_hits << " hit(s), " << m_misses << " miss(es)";
+        if (m_stale || m_rejected) {
+            out << " (" << m_stale << " stale, " << m_rejected << " rejected by the driver)";
+        }
+        out << ", " << m_stores << " stored in " << m_directory;
+        return out.str();
+    }
+
+private:
+    std::string m_directory;
+    uint64_t m_driver;
+    unsigned m_hits = 0, m_misses = 0, m_stale = 0, m_rejected = 0, m_stores = 0;
+};
+
+static_assert(sizeof(ProgramBinaryCache::Header) == 40, "program binary header is written as raw bytes");
+
+#endif //PROJECT_BASE_PROGRAMBINARYCACHE_H
@@ -0,0 +1,107 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_PROGRAMBUILDER_H
+#define PROJECT_BASE_PROGRAMBUILDER_H
+
+#include <glad/glad.h>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <rg/GlState.h>
+#include <rg/ProgramBinary.h>
+#include <rg/Profiler.h>
+#include <rg/ShaderPreprocessor.h>
+
+// Programs outside the vertex + fragment pair Shader and shader cover: compute, geometry, transform
+// feedback. Sources go through the preprocessor and the program binary cache like theirs do.
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+
+namespace rg {
+    using ShaderStages = std::vector<std::pair<GLenum, std::string>>;
+
+    const char* shaderStageName(GLenum stage) {
+        switch (stage) {
+            case GL_VERTEX_SHADER: return "VERTEX";
+            case GL_GEOMETRY_SHADER: return "GEOMETRY";
+            case GL_FRAGMENT_SHADER: return "FRAGMENT";
+            case GL_COMPUTE_SHADER: return "COMPUTE";
+            default: return "?";
+        }
+    }
+
+    // stages are (type, path) pairs. feedbackVaryings, when given, are captured interleaved. Returns 0
+    // after printing the reason when a stage doesn't compile or the program doesn't link.
+    GLuint buildProgram(const ShaderStages &stages, const std::vector<const char*> &feedbackVaryings = {},
+                        const ShaderDefines &defines = ShaderDefines()) {
+        RG_PROFILE_ZONE_DETAIL("build program", stages.front().second.c_str());
+        ShaderPreprocessor preprocessor;
+        std::vector<std::string> sources(stages.size());
+        for (size_t i = 0; i < stages.size(); ++i) {
+            if (!preprocessor.process(stages[i].second, defines, sources[i])) {
+                std::cout << "ERROR::SHADER::" << shaderStageName(stages[i].first) << "::PREPROCESSING_FAILED\n"
+                          << preprocessor.error() << std::endl;
+                return 0;
+            }
+        }
+
+        ProgramBinaryCache::Key cacheKey;
+        if (programBinaryCacheActive()) {
+            // the varyings are part of the link, so of the key
+            std::vector<std::string> keySources = sources;
+            for (size_t i = 0; i < stages.size(); ++i) {
+                keySources.push_back(std::to_string(stages[i].first));
+            }
+            for (const char* varying : feedbackVaryings) {
+                keySources.push_back(varying);
+            }
+            cacheKey = programBinaryCache()->makeKey(keySources.data(), keySources.size());
+        }
+        GLuint program = glCreateProgram();
+        if (loadCachedProgram(program, cacheKey)) {
+            return program;
+        }
+
+        int success;
+        char infoLog[512];
+        std::vector<GLuint> shaders;
+        for (size_t i = 0; i < stages.size(); ++i) {
+            GLuint shader = glCreateShader(stages[i].first);
+            const char* source = sources[i].c_str();
+            glShaderSource(shader, 1, &source, NULL);
+            glCompileShader(shader);
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success) {
+                glGetShaderInfoLog(shader, 512, NULL, infoLog);
+                std::cout << "ERROR::SHADER::" << shaderStageName(stages[i].first) << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+            }
+            glAttachShader(program, shader);
+            shaders.push_back(shader);
+        }
+        if (!feedbackVaryings.empty()) {
+            glTransformFeedbackVaryings(program, (GLsizei)feedbackVaryings.size(), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+        }
+        markProgramRetrievable(program);
+        glLinkProgram(program);
+        for (GLuint shader : shaders) {
+            glDeleteShader(shader);
+        }
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(program, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+            glDeleteProgram(program);
+            rg::glState().programDeleted(program);
+            return 0;
+        }
+        storeCachedProgram(program, cacheKey);
+        return program;
+    }
+};
+
+#endif //PROJECT_BASE_PROGRAMBUILDER_H
@@ -0,0 +1,352 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_RENDERQUEUE_H
+#define PROJECT_BASE_RENDERQUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <rg/GlState.h>
+#include <rg/Profiler.h>
+
+// One draw as the queue sees it: the state it needs and what to draw with it.
+struct RenderCommand {
+    GLuint program = 0;
+    GLuint VAO = 0;
+    // bound to units 0 and 1, 0 meaning the draw doesn't sample that unit
+    GLuint textures[2] = {0, 0};
+    bool cullFace = false;
+
+    // glDrawArrays vertices or glDrawElements indices, GL_UNSIGNED_INT from offset 0
+    GLsizei count = 0;
+    GLsizei instanceCount = 1;
+    bool indexed = false;
+
+    // A range of a stream buffer bound to a uniform block binding right before the draw, e.g. its
+    // DrawData; nothing is bound when blockSize is 0.
+    GLuint blockBinding = 0;
+    GLuint blockBuffer = 0;
+    GLintptr blockOffset = 0;
+    GLsizeiptr blockSize = 0;
+
+    // Draws that can't be described by the fields above (a Model's meshes, indirect draws) are made by
+    // custom instead, with the command's program, textures, cull state and block already set up. It may
+    // bind its own VAOs and textures.
+    void (*custom)(const RenderCommand &command) = nullptr;
+    const void* context[2] = {nullptr, nullptr};
+    // the GL draw calls custom makes, for RenderQueueStats::drawCalls
+    unsigned drawCalls = 1;
+
+    // The profiling zone execute() times the draw in, a string literal naming the render pass that
+    // submitted it ("pyramids"); null leaves it to the enclosing "render queue" zone.
+    const char* zone = nullptr;
+};
+
+// State changes execute() made, and the ones it saved against rebinding everything for every draw in the
+// order they were submitted.
+struct RenderQueueStats {
+    // commands, and the GL draw calls they made
+    unsigned draws = 0, drawCalls = 0;
+    unsigned programBinds = 0, textureBinds = 0, vaoBinds = 0, cullToggles = 0;
+    unsigned avoided = 0;
+    // what the draws of the execute() PRIMITIVE_LATENCY frames back made, with countPrimitives() on
+    uint64_t primitives = 0;
+
+    unsigned stateChanges() const {
+        return programBinds + textureBinds + vaoBinds + cullToggles;
+    }
+};
+
+// Collects a frame's draws and issues them sorted by a 64-bit key, so draws sharing state end up next to
+// each other and every piece of state is set only when it differs from the draw before. From the most
+// significant bits down the key holds
+//
+//     pass (2) | program (8) | cull face (1) | textures (12) | VAO (12) | depth (29)
+//
+// Programs, texture pairs and VAOs get small ids the first time they are seen. Depth is the distance from
+// the camera: opaque draws go front to back so early depth testing rejects what is hidden, transparent
+// ones back to front. Keys are sorted with an LSD radix sort, a byte at a time, skipping the bytes every
+// key has in common.
+//
+// Everything the queue needs is allocated up front; a frame with more draws than that grows it once.
+class RenderQueue {
+public:
+    enum Pass {
+        PASS_OPAQUE = 0,
+        PASS_TRANSPARENT = 1
+    };
+
+    // frames a primitive count is read after its frame, so the GPU is long done with it
+    static const unsigned PRIMITIVE_LATENCY = 4;
+
+    explicit RenderQueue(size_t maxCommands = 256) {
+        m_commands.reserve(maxCommands);
+        m_entries.reserve(maxCommands);
+        m_scratch.reserve(maxCommands);
+        m_programs.reserve(16);
+        m_materials.reserve(64);
+        m_VAOs.reserve(64);
+    }
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    ~RenderQueue() {
+        if (m_primitiveQueries[0]) {
+            glDeleteQueries(PRIMITIVE_LATENCY, m_primitiveQueries);
+        }
+    }
+
+    // Has execute() count the triangles its draws make with a GL_PRIMITIVES_GENERATED query.
+    void countPrimitives(bool count) {
+        if (count && !m_primitiveQueries[0]) {
+            glGenQueries(PRIMITIVE_LATENCY, m_primitiveQueries);
+        }
+        m_countPrimitives = count;
+    }
+
+    // Starts a frame seen from cameraPosition.
+    void begin(const glm::vec3 &cameraPosition) {
+        m_cameraPosition = cameraPosition;
+        m_commands.clear();
+        m_entries.clear();
+    }
+
+    // distance from the camera, what submit() sorts by
+    float depth(const glm::vec3 &position) const {
+        return glm::length(position - m_cameraPosition);
+    }
+
+    void submit(const RenderCommand &command, const glm::vec3 &position, Pass pass = PASS_OPAQUE) {
+        submit(command, depth(position), pass);
+    }
+
+    void submit(const RenderCommand &command, float depth, Pass pass = PASS_OPAQUE) {
+        m_entries.push_back({key(command, depth, pass), (uint32_t)m_commands.size()});
+        m_commands.push_back(command);
+    }
+
+    // Sorts and issues everything submitted since begin(). GL state is not assumed to be anything on entry;
+    // afterwards face culling is off. The binds themselves go through rg::glState(), which also drops
+    // what the previous frame left bound.
+    //
+    // Each run of draws with the same zone in the sorted order is timed as that zone, on the CPU and the
+    // GPU. A pass whose draws sort apart is timed in several pieces, which add up under its name.
+    void execute() {
+        RG_PROFILE_GPU_ZONE("render queue");
+        sort();
+        countUnsorted();
+
+        m_stats.programBinds = m_stats.textureBinds = m_stats.vaoBinds = m_stats.cullToggles = 0;
+        m_stats.draws = (unsigned)m_commands.size();
+        m_stats.drawCalls = 0;
+        invalidate();
+        m_cullFace = UNKNOWN;
+        beginPrimitives();
+        GpuProfileSpan zone;
+        const char* zoneName = nullptr;
+        for (const Entry &entry : m_entries) {
+            const RenderCommand &command = m_commands[entry.command];
+            if (command.zone != zoneName) {
+                zone.begin(command.zone);
+                zoneName = command.zone;
+            }
+            issue(command);
+            m_stats.drawCalls += command.drawCalls;
+        }
+        zone.end();
+        endPrimitives();
+        if (m_cullFace != 0) {
+            rg::glState().disable(GL_CULL_FACE);
+        }
+
+        unsigned made = m_stats.stateChanges();
+        m_stats.avoided = m_unsortedChanges > made ? m_unsortedChanges - made : 0;
+    }
+
+    // of the last execute()
+    const RenderQueueStats& stats() const {
+        return m_stats;
+    }
+
+private:
+    static const GLuint UNKNOWN = 0xffffffffu;
+
+    struct Entry {
+        uint64_t key;
+        uint32_t command;
+    };
+
+    std::vector<RenderCommand> m_commands;
+    std::vector<Entry> m_entries, m_scratch;
+    std::vector<GLuint> m_programs, m_VAOs;
+    std::vector<std::pair<GLuint, GLuint>> m_materials;
+    glm::vec3 m_cameraPosition = glm::vec3(0.0f);
+
+    GLuint m_program = UNKNOWN, m_VAO = UNKNOWN, m_cullFace = UNKNOWN;
+    GLuint m_textures[2] = {UNKNOWN, UNKNOWN};
+    unsigned m_unsortedChanges = 0;
+    RenderQueueStats m_stats;
+
+    bool m_countPrimitives = false;
+    GLuint m_primitiveQueries[PRIMITIVE_LATENCY] = {};
+    // which queries have a count coming
+    bool m_primitivesPending[PRIMITIVE_LATENCY] = {};
+    unsigned m_primitiveFrame = 0;
+
+    // the query this frame reuses is read first, if it is back
+    void beginPrimitives() {
+        if (!m_countPrimitives) {
+            return;
+        }
+        unsigned slot = m_primitiveFrame % PRIMITIVE_LATENCY;
+        if (m_primitivesPending[slot]) {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(m_primitiveQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint primitives = 0;
+                glGetQueryObjectuiv(m_primitiveQueries[slot], GL_QUERY_RESULT, &primitives);
+                m_stats.primitives = primitives;
+            }
+        }
+        glBeginQuery(GL_PRIMITIVES_GENERATED, m_primitiveQueries[slot]);
+    }
+
+    void endPrimitives() {
+        if (!m_countPrimitives) {
+            return;
+        }
+        glEndQuery(GL_PRIMITIVES_GENERATED);
+        m_primitivesPending[m_primitiveFrame % PRIMITIVE_LATENCY] = true;
+        ++m_primitiveFrame;
+    }
+
+    // Index of value in ids, added when new. Past what the key has room for, ids share the last value:
+    // the order gets worse, the draws stay right.
+    template <typename T>
+    static uint64_t idOf(std::vector<T> &ids, const T &value, uint64_t bits) {
+        size_t id = 0;
+        while (id < ids.size() && !(ids[id] == value)) {
+            ++id;
+        }
+        if (id == ids.size()) {
+            ids.push_back(value);
+        }
+        const uint64_t last = (1ull << bits) - 1;
+        return id < last ? (uint64_t)id : last;
+    }
+
+    uint64_t key(const RenderCommand &command, float depth, Pass pass) {
+        // a non-negative float's bits order like the float; the sign bit is always 0 and the lowest two
+        // are dropped
+        uint32_t depthBits;
+        depth = depth > 0.0f ? depth : 0.0f;
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+        uint64_t depthKey = depthBits >> 2;
+        if (pass == PASS_TRANSPARENT) {
+            depthKey = ~depthKey & ((1ull << 29) - 1);
+        }
+
+        uint64_t program = idOf(m_programs, command.program, 8);
+        uint64_t material = idOf(m_materials, std::make_pair(command.textures[0], command.textures[1]), 12);
+        uint64_t VAO = idOf(m_VAOs, command.VAO, 12);
+        return (uint64_t)pass << 62 | program << 54 | (uint64_t)command.cullFace << 53 | material << 41 |
+               VAO << 29 | depthKey;
+    }
+
+    void sort() {
+        m_scratch.resize(m_entries.size());
+        for (unsigned shift = 0; shift < 64 && !m_entries.empty(); shift += 8) {
+            size_t offsets[256] = {};
+            for (const Entry &entry : m_entries) {
+                ++offsets[(entry.key >> shift) & 0xff];
+            }
+            if (offsets[(m_entries[0].key >> shift) & 0xff] == m_entries.size()) {
+                continue;
+            }
+            size_t total = 0;
+            for (size_t &offset : offsets) {
+                size_t count = offset;
+                offset = total;
+                total += count;
+            }
+            for (const Entry &entry : m_entries) {
+                m_scratch[offsets[(entry.key >> shift) & 0xff]++] = entry;
+            }
+            m_entries.swap(m_scratch);
+        }
+    }
+
+    // What the draws would cost in submission order, each setting all of its state.
+    void countUnsorted() {
+        m_unsortedChanges = 0;
+        GLuint cullFace = 0;
+        for (const RenderCommand &command : m_commands) {
+            m_unsortedChanges += 1 + (command.VAO != 0 && !command.custom) + (command.textures[0] != 0) +
+                                 (command.textures[1] != 0) + (command.cullFace != cullFace);
+            cullFace = command.cullFace;
+        }
+    }
+
+    // forget what is bound, after something else may have changed it
+    void invalidate() {
+        m_program = m_VAO = UNKNOWN;
+        m_textures[0] = m_textures[1] = UNKNOWN;
+    }
+
+    void issue(const RenderCommand &command) {
+        if (command.cullFace != m_cullFace) {
+            if (command.cullFace) {
+                rg::glState().enable(GL_CULL_FACE);
+                glCullFace(GL_BACK);
+                glFrontFace(GL_CCW);
+            } else {
+                rg::glState().disable(GL_CULL_FACE);
+            }
+            m_cullFace = command.cullFace;
+            ++m_stats.cullToggles;
+        }
+        if (command.program != m_program) {
+            rg::glState().useProgram(command.program);
+            m_program = command.program;
+            ++m_stats.programBinds;
+        }
+        for (GLuint unit = 0; unit < 2; ++unit) {
+            if (command.textures[unit] && command.textures[unit] != m_textures[unit]) {
+                rg::glState().bindTexture(unit, GL_TEXTURE_2D, command.textures[unit]);
+                m_textures[unit] = command.textures[unit];
+                ++m_stats.textureBinds;
+            }
+        }
+        if (command.blockSize > 0) {
+            glBindBufferRange(GL_UNIFORM_BUFFER, command.blockBinding, command.blockBuffer, command.blockOffset,
+                              command.blockSize);
+        }
+
+        if (command.custom) {
+            command.custom(command);
+            invalidate();
+            m_program = command.program;
+            return;
+        }
+        if (command.VAO != m_VAO) {
+            rg::glState().bindVertexArray(command.VAO);
+            m_VAO = command.VAO;
+            ++m_stats.vaoBinds;
+        }
+        if (command.indexed) {
+            glDrawElementsInstanced(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, 0, command.instanceCount);
+        } else if (command.instanceCount != 1) {
+            glDrawArraysInstanced(GL_TRIANGLES, 0, command.count, command.instanceCount);
+        } else {
+            glDrawArrays(GL_TRIANGLES, 0, command.count);
+        }
+    }
+};
+
+#endif //PROJECT_BASE_RENDERQUEUE_H
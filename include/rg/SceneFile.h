@@ -0,0 +1,938 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_SCENEFILE_H
+#define PROJECT_BASE_SCENEFILE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <rg/MappedFile.h>
+
+// What the scene is made of, outside the code: the models and textures it uses, where every object
+// stands, the lights, and the instancing groups. Written by hand as text (resources/scenes/*.scene),
+// compiled by tools/scene_compiler.cpp to a binary .rgscene next to it:
+//
+//   Header                      counts, section offsets, the lights, and where each program's objects are
+//   Model[modelCount]
+//   Texture[textureCount]
+//   Object[objectCount]         sorted by program, in the order written within one
+//   Group[groupCount]
+//   glm::mat4[instanceCount]    the groups' instances, each group's together
+//   char[stringSize]            paths and names, not terminated
+//
+// Records refer to each other and to the strings by offset from the start of the file. A loader reads
+// the whole file in one go, checks every offset against its section and overwrites it with the pointer
+// it stands for, so there is nothing to parse and nothing to allocate per object. Little endian, 64 bit.
+//
+// The text form, one entry a line, # to the end of a line a comment:
+//
+//   texture NAME PATH [srgb] [nearest]     loaded in the order written
+//   model NAME PATH
+//   sky R G B
+//   sun DX DY DZ R G B
+//   point R G B CONSTANT LINEAR QUADRATIC ORBIT_RADIUS ORBIT_HEIGHT   the firefly, circling the origin
+//   spot R G B CONSTANT LINEAR QUADRATIC CUTOFF OUTER_CUTOFF          the camera's, angles in degrees
+//   object NAME PROGRAM [model M] [texture T]... [parent P] [double-sided] TRANSFORM...
+//   group NAME MODEL [ring COUNT RADIUS OFFSET HEIGHT]
+//   instance GROUP TRANSFORM...
+//
+// PROGRAM is pyramid or ground (one texture), box (diffuse and specular texture), beam (shown while the
+// beams are switched on) or model (a model). A TRANSFORM is translate X Y Z, rotate DEGREES X Y Z or
+// scale S | scale X Y Z, applied in the order written like a chain of glm calls; an object's is relative
+// to its parent, which has to come before it. The scene takes an object's transform apart into a
+// translation, rotation and scale again, so one that shears (a non-uniform scale before a rotate) is
+// refused. A ring group scatters COUNT instances around the origin from the run's seed when it is
+// loaded, its instance lines are added after them.
+
+// Offset in the file, or once loaded the pointer it stood for; 0 and nullptr are none.
+template<typename T>
+union SceneRef {
+    uint64_t offset;
+    T* pointer;
+};
+
+static_assert(sizeof(void*) == sizeof(uint64_t), "scene files are fixed up in place with 64 bit pointers");
+
+struct SceneFile {
+    static constexpr uint32_t VERSION = 1;
+    static constexpr const char* EXTENSION = ".rgscene";
+
+    enum Program : uint32_t {
+        PYRAMID,
+        GROUND,
+        BOX,
+        BEAM,
+        MODEL,
+        PROGRAM_COUNT
+    };
+
+    enum TextureFlags : uint32_t {
+        TEXTURE_SRGB = 1,
+        TEXTURE_NEAREST = 2
+    };
+
+    enum ObjectFlags : uint32_t {
+        OBJECT_DOUBLE_SIDED = 1
+    };
+
+    struct Range {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    struct Lights {
+        glm::vec3 sky;
+        glm::vec3 sunDirection, sunColor;
+        glm::vec3 pointColor, pointAttenuation;
+        // radius and height of the circle it flies
+        glm::vec2 pointOrbit;
+        glm::vec3 spotColor, spotAttenuation;
+        // degrees
+        glm::vec2 spotCutOff;
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        uint32_t modelCount;
+        uint32_t textureCount;
+        uint32_t objectCount;
+        uint32_t groupCount;
+        uint32_t instanceCount;
+        uint32_t stringSize;
+        Range programs[PROGRAM_COUNT];
+        uint64_t modelOffset;
+        uint64_t textureOffset;
+        uint64_t objectOffset;
+        uint64_t groupOffset;
+        uint64_t instanceOffset;
+        uint64_t stringOffset;
+        uint64_t fileSize;
+        Lights lights;
+        uint32_t padding;
+    };
+
+    struct Model {
+        SceneRef<const char> path;
+        uint32_t pathLength;
+        uint32_t padding;
+    };
+
+    struct Texture {
+        SceneRef<const char> path;
+        uint32_t pathLength;
+        uint32_t flags;
+    };
+
+    struct Object {
+        // relative to the parent, and the product of the chain up to the root
+        glm::mat4 local;
+        glm::mat4 world;
+        SceneRef<const Object> parent;
+        SceneRef<const Model> model;
+        SceneRef<const Texture> textures[2];
+        SceneRef<const char> name;
+        uint32_t nameLength;
+        uint32_t program;
+        uint32_t flags;
+        uint32_t padding;
+    };
+
+    struct Group {
+        SceneRef<const Model> model;
+        SceneRef<const glm::mat4> instances;
+        SceneRef<const char> name;
+        uint32_t nameLength;
+        uint32_t instanceCount;
+        uint32_t ringCount;
+        float ringRadius;
+        float ringOffset;
+        float ringHeight;
+    };
+
+    // Where the sections of a file with these counts start, and how long it is.
+    static void layout(Header &header) {
+        header.modelOffset = sizeof(Header);
+        header.textureOffset = header.modelOffset + (uint64_t)header.modelCount * sizeof(Model);
+        header.objectOffset = header.textureOffset + (uint64_t)header.textureCount * sizeof(Texture);
+        header.groupOffset = header.objectOffset + (uint64_t)header.objectCount * sizeof(Object);
+        header.instanceOffset = header.groupOffset + (uint64_t)header.groupCount * sizeof(Group);
+        header.stringOffset = header.instanceOffset + (uint64_t)header.instanceCount * sizeof(glm::mat4);
+        header.fileSize = header.stringOffset + header.stringSize;
+    }
+
+    static const char* programName(uint32_t program) {
+        static const char* names[PROGRAM_COUNT] = {"pyramid", "ground", "box", "beam", "model"};
+        return program < PROGRAM_COUNT ? names[program] : "";
+    }
+
+    // Whether local is a translation, rotation and scale, as TransformSystem::setLocal keeps it: axes at
+    // right angles to each other, up to float error, and nothing projective.
+    static bool splitsIntoTrs(const glm::mat4 &local) {
+        const float tolerance = 1e-4f;
+        for (int i = 0; i < 3; ++i) {
+            glm::vec3 axis(local[i]), next(local[(i + 1) % 3]);
+            if (std::fabs(glm::dot(axis, next)) > tolerance * glm::length(axis) * glm::length(next) ||
+                std::fabs(local[i][3]) > tolerance) {
+                return false;
+            }
+        }
+        return std::fabs(local[3][3] - 1.0f) <= tolerance;
+    }
+};
+
+static_assert(sizeof(SceneFile::Lights) == 4 * 25, "scene lights are written as raw bytes");
+static_assert(sizeof(SceneFile::Header) % 8 == 0 && sizeof(SceneFile::Model) == 16 && sizeof(SceneFile::Texture) == 16 &&
+              sizeof(SceneFile::Object) == 184 && sizeof(SceneFile::Group) == 48,
+              "scene file records are written as raw bytes, every section 8 byte aligned");
+
+// The text form of a scene as read, before it is compiled.
+struct SceneSource {
+    struct Named {
+        std::string name, path;
+        uint32_t flags;
+    };
+    struct Object {
+        std::string name;
+        uint32_t program = 0, flags = 0;
+        int parent = -1, model = -1;
+        std::vector<int> textures;
+        glm::mat4 local = glm::mat4(1.0f), world = glm::mat4(1.0f);
+    };
+    struct Group {
+        std::string name;
+        int model = -1;
+        uint32_t ringCount = 0;
+        float ringRadius = 0.0f, ringOffset = 0.0f, ringHeight = 0.0f;
+        std::vector<glm::mat4> instances;
+    };
+
+    std::vector<Named> models, textures;
+    std::vector<Object> objects;
+    std::vector<Group> groups;
+    SceneFile::Lights lights = {};
+
+    // On false error says which line is wrong.
+    bool parse(const std::string &text, std::string &error) {
+        std::istringstream lines(text);
+        std::string line;
+        for (unsigned number = 1; std::getline(lines, line); ++number) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream words(line);
+            std::vector<std::string> tokens;
+            for (std::string token; words >> token;) {
+                tokens.push_back(token);
+            }
+            std::string problem;
+            if (!tokens.empty() && !parseLine(tokens, problem)) {
+                error = "line " + std::to_string(number) + ": " + problem;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The binary form, stamped with source.
+    std::vector<char> compile(const FileStamp &source) const {
+        SceneFile::Header header;
+        std::memset((void*)&header, 0, sizeof(header));
+        std::memcpy(header.magic, "RGSC", 4);
+        header.version = SceneFile::VERSION;
+        header.sourceSize = source.size;
+        header.sourceModified = source.modified;
+        header.modelCount = (uint32_t)models.size();
+        header.textureCount = (uint32_t)textures.size();
+        header.objectCount = (uint32_t)objects.size();
+        header.groupCount = (uint32_t)groups.size();
+        for (const Group &group : groups) {
+            header.instanceCount += (uint32_t)group.instances.size();
+        }
+        header.lights = lights;
+
+        // objects go out a program at a time, in the order written within one
+        std::vector<uint32_t> order, position(objects.size());
+        for (uint32_t program = 0; program < SceneFile::PROGRAM_COUNT; ++program) {
+            header.programs[program].first = (uint32_t)order.size();
+            for (uint32_t i = 0; i < objects.size(); ++i) {
+                if (objects[i].program == program) {
+                    position[i] = (uint32_t)order.size();
+                    order.push_back(i);
+                }
+            }
+            header.programs[program].count = (uint32_t)order.size() - header.programs[program].first;
+        }
+        std::string strings;
+        auto text = [&strings](const std::string &value) {
+            uint64_t offset = strings.size();
+            strings += value;
+            return offset;
+        };
+        std::vector<uint64_t> modelPaths, texturePaths, objectNames, groupNames;
+        for (const Named &model : models) {
+            modelPaths.push_back(text(model.path));
+        }
+        for (const Named &texture : textures) {
+            texturePaths.push_back(text(texture.path));
+        }
+        for (uint32_t i : order) {
+            objectNames.push_back(text(objects[i].name));
+        }
+        for (const Group &group : groups) {
+            groupNames.push_back(text(group.name));
+        }
+        header.stringSize = (uint32_t)strings.size();
+        SceneFile::layout(header);
+
+        std::vector<char> compiled(header.fileSize, 0);
+        char *data = compiled.data();
+        std::memcpy(data, &header, sizeof(header));
+        SceneFile::Model *modelRecords = (SceneFile::Model*)(data + header.modelOffset);
+        for (size_t i = 0; i < models.size(); ++i) {
+            modelRecords[i].path.offset = header.stringOffset + modelPaths[i];
+            modelRecords[i].pathLength = (uint32_t)models[i].path.size();
+        }
+        SceneFile::Texture *textureRecords = (SceneFile::Texture*)(data + header.textureOffset);
+        for (size_t i = 0; i < textures.size(); ++i) {
+            textureRecords[i].path.offset = header.stringOffset + texturePaths[i];
+            textureRecords[i].pathLength = (uint32_t)textures[i].path.size();
+            textureRecords[i].flags = textures[i].flags;
+        }
+        SceneFile::Object *objectRecords = (SceneFile::Object*)(data + header.objectOffset);
+        for (size_t i = 0; i < order.size(); ++i) {
+            const Object &object = objects[order[i]];
+            SceneFile::Object &record = objectRecords[i];
+            record.local = object.local;
+            record.world = object.world;
+            record.parent.offset = object.parent < 0 ? 0 : header.objectOffset + position[object.parent] * sizeof(SceneFile::Object);
+            record.model.offset = object.model < 0 ? 0 : header.modelOffset + object.model * sizeof(SceneFile::Model);
+            for (size_t t = 0; t < object.textures.size(); ++t) {
+                record.textures[t].offset = header.textureOffset + object.textures[t] * sizeof(SceneFile::Texture);
+            }
+            record.name.offset = header.stringOffset + objectNames[i];
+            record.nameLength = (uint32_t)object.name.size();
+            record.program = object.program;
+            record.flags = object.flags;
+        }
+        SceneFile::Group *groupRecords = (SceneFile::Group*)(data + header.groupOffset);
+        uint64_t instance = header.instanceOffset;
+        for (size_t i = 0; i < groups.size(); ++i) {
+            const Group &group = groups[i];
+            SceneFile::Group &record = groupRecords[i];
+            record.model.offset = header.modelOffset + group.model * sizeof(SceneFile::Model);
+            record.instances.offset = group.instances.empty() ? 0 : instance;
+            record.name.offset = header.stringOffset + groupNames[i];
+            record.nameLength = (uint32_t)group.name.size();
+            record.instanceCount = (uint32_t)group.instances.size();
+            record.ringCount = group.ringCount;
+            record.ringRadius = group.ringRadius;
+            record.ringOffset = group.ringOffset;
+            record.ringHeight = group.ringHeight;
+            std::memcpy(data + instance, group.instances.data(), group.instances.size() * sizeof(glm::mat4));
+            instance += group.instances.size() * sizeof(glm::mat4);
+        }
+        std::memcpy(data + header.stringOffset, strings.data(), strings.size());
+        return compiled;
+    }
+
+private:
+    // index of every name in models, textures, objects and groups
+    std::unordered_map<std::string, int> m_names[4];
+
+    int find(const std::vector<Named> &list, const std::string &name) const {
+        return find(&list == &models ? 0 : 1, name);
+    }
+    int find(const std::vector<Object>&, const std::string &name) const {
+        return find(2, name);
+    }
+    int find(const std::vector<Group>&, const std::string &name) const {
+        return find(3, name);
+    }
+    int find(int kind, const std::string &name) const {
+        auto found = m_names[kind].find(name);
+        return found == m_names[kind].end() ? -1 : found->second;
+    }
+
+    static bool number(const std::vector<std::string> &tokens, size_t &i, float &value) {
+        if (i >= tokens.size()) {
+            return false;
+        }
+        char *end = nullptr;
+        value = std::strtof(tokens[i].c_str(), &end);
+        if (end == tokens[i].c_str() || *end != '\0') {
+            return false;
+        }
+        ++i;
+        return true;
+    }
+
+    static bool numbers(const std::vector<std::string> &tokens, size_t &i, float *values, int count) {
+        for (int n = 0; n < count; ++n) {
+            if (!number(tokens, i, values[n])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool vec3(const std::vector<std::string> &tokens, size_t &i, glm::vec3 &value) {
+        float values[3];
+        if (!numbers(tokens, i, values, 3)) {
+            return false;
+        }
+        value = glm::vec3(values[0], values[1], values[2]);
+        return true;
+    }
+
+    // One TRANSFORM at tokens[i], applied to matrix; false when tokens[i] isn't one.
+    static bool transform(const std::vector<std::string> &tokens, size_t &i, glm::mat4 &matrix, std::string &problem) {
+        const std::string &word = tokens[i++];
+        glm::vec3 value;
+        if (word == "translate") {
+            if (!vec3(tokens, i, value)) {
+                problem = "translate takes X Y Z";
+                return false;
+            }
+            matrix = glm::translate(matrix, value);
+        } else if (word == "rotate") {
+            float degrees;
+            if (!number(tokens, i, degrees) || !vec3(tokens, i, value) || value == glm::vec3(0.0f)) {
+                problem = "rotate takes DEGREES X Y Z";
+                return false;
+            }
+            matrix = glm::rotate(matrix, glm::radians(degrees), value);
+        } else if (word == "scale") {
+            size_t start = i;
+            if (!vec3(tokens, i, value)) {
+                i = start;
+                if (!number(tokens, i, value.x)) {
+                    problem = "scale takes S or X Y Z";
+                    return false;
+                }
+                value = glm::vec3(value.x);
+            }
+            matrix = glm::scale(matrix, value);
+        } else {
+            problem = "unknown word " + word;
+            return false;
+        }
+        return true;
+    }
+
+    bool named(std::vector<Named> &list, const std::vector<std::string> &tokens, std::string &problem) {
+        if (tokens.size() < 3) {
+            problem = tokens[0] + " takes NAME PATH";
+            return false;
+        }
+        if (find(list, tokens[1]) >= 0) {
+            problem = tokens[0] + " " + tokens[1] + " is already defined";
+            return false;
+        }
+        Named entry = {tokens[1], tokens[2], 0};
+        for (size_t i = 3; i < tokens.size(); ++i) {
+            if (&list == &textures && tokens[i] == "srgb") {
+                entry.flags |= SceneFile::TEXTURE_SRGB;
+            } else if (&list == &textures && tokens[i] == "nearest") {
+                entry.flags |= SceneFile::TEXTURE_NEAREST;
+            } else {
+                problem = "unknown word " + tokens[i];
+                return false;
+            }
+        }
+        m_names[&list == &models ? 0 : 1][entry.name] = (int)list.size();
+        list.push_back(entry);
+        return true;
+    }
+
+    bool parseObject(const std::vector<std::string> &tokens, std::string &problem) {
+        if (tokens.size() < 3) {
+            problem = "object takes NAME PROGRAM";
+            return false;
+        }
+        Object object;
+        object.name = tokens[1];
+        if (find(objects, object.name) >= 0) {
+            problem = "object " + object.name + " is already defined";
+            return false;
+        }
+        object.program = SceneFile::PROGRAM_COUNT;
+        for (uint32_t program = 0; program < SceneFile::PROGRAM_COUNT; ++program) {
+            if (tokens[2] == SceneFile::programName(program)) {
+                object.program = program;
+            }
+        }
+        if (object.program == SceneFile::PROGRAM_COUNT) {
+            problem = "unknown program " + tokens[2];
+            return false;
+        }
+        for (size_t i = 3; i < tokens.size();) {
+            const std::string &word = tokens[i];
+            if ((word == "model" || word == "texture" || word == "parent") && i + 1 == tokens.size()) {
+                problem = word + " takes a name";
+                return false;
+            }
+            if (word == "model") {
+                object.model = find(models, tokens[i + 1]);
+                if (object.model < 0) {
+                    problem = "unknown model " + tokens[i + 1];
+                    return false;
+                }
+                i += 2;
+            } else if (word == "texture") {
+                int texture = find(textures, tokens[i + 1]);
+                if (texture < 0) {
+                    problem = "unknown texture " + tokens[i + 1];
+                    return false;
+                }
+                object.textures.push_back(texture);
+                i += 2;
+            } else if (word == "parent") {
+                object.parent = find(objects, tokens[i + 1]);
+                if (object.parent < 0) {
+                    problem = "unknown parent " + tokens[i + 1] + ", parents come first";
+                    return false;
+                }
+                i += 2;
+            } else if (word == "double-sided") {
+                object.flags |= SceneFile::OBJECT_DOUBLE_SIDED;
+                ++i;
+            } else if (!transform(tokens, i, object.local, problem)) {
+                return false;
+            }
+        }
+        if (!SceneFile::splitsIntoTrs(object.local)) {
+            problem = "object " + object.name + " shears: a non-uniform scale has to come after its rotates";
+            return false;
+        }
+        size_t textureCount = object.program == SceneFile::BOX ? 2 :
+                              object.program == SceneFile::PYRAMID || object.program == SceneFile::GROUND ? 1 : 0;
+        if (object.textures.size() != textureCount) {
+            problem = std::string("a ") + SceneFile::programName(object.program) + " takes " + std::to_string(textureCount) + " texture(s)";
+            return false;
+        }
+        if ((object.program == SceneFile::MODEL) != (object.model >= 0)) {
+            problem = object.model >= 0 ? "only a model object takes a model" : "a model object takes a model";
+            return false;
+        }
+        object.world = object.parent >= 0 ? objects[object.parent].world * object.local : object.local;
+        m_names[2][object.name] = (int)objects.size();
+        objects.push_back(object);
+        return true;
+    }
+
+    bool parseGroup(const std::vector<std::string> &tokens, std::string &problem) {
+        Group group;
+        if (tokens.size() < 3) {
+            problem = "group takes NAME MODEL";
+            return false;
+        }
+        group.name = tokens[1];
+        group.model = find(models, tokens[2]);
+        if (find(groups, group.name) >= 0) {
+            problem = "group " + group.name + " is already defined";
+            return false;
+        }
+        if (group.model < 0) {
+            problem = "unknown model " + tokens[2];
+            return false;
+        }
+        if (tokens.size() > 3) {
+            size_t i = 4;
+            float ring[4];
+            // the scatter draws offsets in hundredths
+            if (tokens[3] != "ring" || !numbers(tokens, i, ring, 4) || i != tokens.size() || ring[0] < 0.0f ||
+                ring[2] < 0.01f) {
+                problem = "group takes NAME MODEL [ring COUNT RADIUS OFFSET HEIGHT], OFFSET at least 0.01";
+                return false;
+            }
+            group.ringCount = (uint32_t)ring[0];
+            group.ringRadius = ring[1];
+            group.ringOffset = ring[2];
+            group.ringHeight = ring[3];
+        }
+        m_names[3][group.name] = (int)groups.size();
+        groups.push_back(group);
+        return true;
+    }
+
+    bool parseLine(const std::vector<std::string> &tokens, std::string &problem) {
+        const std::string &word = tokens[0];
+        size_t i = 1;
+        if (word == "texture") {
+            return named(textures, tokens, problem);
+        } else if (word == "model") {
+            return named(models, tokens, problem);
+        } else if (word == "object") {
+            return parseObject(tokens, problem);
+        } else if (word == "group") {
+            return parseGroup(tokens, problem);
+        } else if (word == "instance") {
+            int group = tokens.size() > 1 ? find(groups, tokens[1]) : -1;
+            if (group < 0) {
+                problem = "instance takes the name of a group above it";
+                return false;
+            }
+            glm::mat4 matrix(1.0f);
+            for (i = 2; i < tokens.size();) {
+                if (!transform(tokens, i, matrix, problem)) {
+                    return false;
+                }
+            }
+            groups[group].instances.push_back(matrix);
+            return true;
+        } else if (word == "sky") {
+            if (vec3(tokens, i, lights.sky) && i == tokens.size()) {
+                return true;
+            }
+        } else if (word == "sun") {
+            if (vec3(tokens, i, lights.sunDirection) && vec3(tokens, i, lights.sunColor) && i == tokens.size()) {
+                return true;
+            }
+        } else if (word == "point") {
+            if (vec3(tokens, i, lights.pointColor) && vec3(tokens, i, lights.pointAttenuation) &&
+                numbers(tokens, i, &lights.pointOrbit.x, 2) && i == tokens.size()) {
+                return true;
+            }
+        } else if (word == "spot") {
+            if (vec3(tokens, i, lights.spotColor) && vec3(tokens, i, lights.spotAttenuation) &&
+                numbers(tokens, i, &lights.spotCutOff.x, 2) && i == tokens.size()) {
+                return true;
+            }
+        } else {
+            problem = "unknown entry " + word;
+            return false;
+        }
+        problem = "wrong numbers for " + word;
+        return false;
+    }
+};
+
+namespace rg {
+    // The whole file in one read; false when it can't be read.
+    bool readWholeFile(const std::string &path, std::vector<char> &bytes) {
+        std::FILE *file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        bool read = std::fseek(file, 0, SEEK_END) == 0;
+        long size = read ? std::ftell(file) : -1;
+        read = size > 0 && std::fseek(file, 0, SEEK_SET) == 0;
+        if (read) {
+            bytes.resize((size_t)size);
+            read = std::fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        }
+        std::fclose(file);
+        return read;
+    }
+
+    // Compiles the text form in memory. On false error says which line is wrong; source is the text's
+    // stamp, kept in the header so a loader can tell the result is stale.
+    bool compileScene(const std::string &text, const FileStamp &source, std::vector<char> &compiled, std::string &error) {
+        SceneSource scene;
+        if (!scene.parse(text, error)) {
+            return false;
+        }
+        compiled = scene.compile(source);
+        return true;
+    }
+
+    // Writes next to the target and renames, so a reader never reads a half written file.
+    bool writeSceneFile(const std::string &path, const std::vector<char> &compiled) {
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            out.write(compiled.data(), (std::streamsize)compiled.size());
+            if (!out) {
+                out.close();
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+// A scene, compiled: owns the bytes of an .rgscene with its offsets fixed up into pointers.
+class SceneDescription {
+public:
+    // Objects of one program, for range-for.
+    struct Objects {
+        const SceneFile::Object *first, *last;
+
+        const SceneFile::Object* begin() const {
+            return first;
+        }
+        const SceneFile::Object* end() const {
+            return last;
+        }
+        size_t size() const {
+            return last - first;
+        }
+    };
+
+    SceneDescription() = default;
+    SceneDescription(const SceneDescription&) = delete;
+    SceneDescription& operator=(const SceneDescription&) = delete;
+
+    // The compiled copy next to the text (path + ".rgscene", made by rg_scene_compile) when it is up to
+    // date, the text compiled here otherwise; a path ending in .rgscene is read as it is. Prints
+    // ERROR::SCENE_FILE:: and returns false when neither can be had.
+    bool load(const std::string &path) {
+        const std::string extension = SceneFile::EXTENSION;
+        bool compiledOnly = path.size() > extension.size() &&
+                            path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+        std::string compiledPath = compiledOnly ? path : path + extension;
+        FileStamp stamp;
+        bool hasSource = !compiledOnly && FileStamp::of(path, stamp);
+        std::vector<char> bytes;
+        if (rg::readWholeFile(compiledPath, bytes)) {
+            if (!open(std::move(bytes))) {
+                std::cout << "ERROR::SCENE_FILE:: " << compiledPath << ": " << m_error << std::endl;
+            } else if (hasSource && !(stamp == m_source)) {
+                std::cout << "Scene " << path << ": source changed since it was compiled, run the bake_scene target" << std::endl;
+            } else {
+                return true;
+            }
+            if (compiledOnly) {
+                return false;
+            }
+        } else if (compiledOnly) {
+            std::cout << "ERROR::SCENE_FILE:: cannot read " << compiledPath << std::endl;
+            return false;
+        }
+
+        std::vector<char> text;
+        if (!hasSource || !rg::readWholeFile(path, text)) {
+            std::cout << "ERROR::SCENE_FILE:: cannot read " << path << std::endl;
+            return false;
+        }
+        std::string error;
+        if (!rg::compileScene(std::string(text.begin(), text.end()), stamp, bytes, error)) {
+            std::cout << "ERROR::SCENE_FILE:: " << path << ": " << error << std::endl;
+            return false;
+        }
+        if (!open(std::move(bytes))) {
+            std::cout << "ERROR::SCENE_FILE:: " << path << ": " << m_error << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Takes a compiled scene. Checks every count and offset against the size and turns the offsets into
+    // pointers into bytes; on false error() says what is wrong and the scene stays empty.
+    bool open(std::vector<char> bytes) {
+        m_bytes.clear();
+        m_header = nullptr;
+        SceneFile::Header counts;
+        if (bytes.size() < sizeof(counts)) {
+            return fail("file too small for a header");
+        }
+        std::memcpy(&counts, bytes.data(), sizeof(counts));
+        if (std::memcmp(counts.magic, "RGSC", 4) != 0) {
+            return fail("not a compiled scene file");
+        }
+        if (counts.version != SceneFile::VERSION) {
+            return fail("compiled with format version " + std::to_string(counts.version) + ", expected " +
+                        std::to_string(SceneFile::VERSION));
+        }
+        SceneFile::Header expected = counts;
+        SceneFile::layout(expected);
+        if (std::memcmp(&expected, &counts, sizeof(counts)) != 0 || counts.fileSize != bytes.size()) {
+            return fail("size does not match the header, file is truncated or corrupt");
+        }
+        uint32_t ranged = 0;
+        for (uint32_t program = 0; program < SceneFile::PROGRAM_COUNT; ++program) {
+            if (counts.programs[program].first != ranged) {
+                return fail(std::string("the ") + SceneFile::programName(program) + " objects are out of order");
+            }
+            ranged += counts.programs[program].count;
+        }
+        if (ranged != counts.objectCount) {
+            return fail("the programs' objects do not add up");
+        }
+
+        // operator new's alignment is enough for every record
+        char *data = bytes.data();
+        const SceneFile::Header &h = counts;
+        SceneFile::Model *models = (SceneFile::Model*)(data + h.modelOffset);
+        SceneFile::Texture *textures = (SceneFile::Texture*)(data + h.textureOffset);
+        SceneFile::Object *objects = (SceneFile::Object*)(data + h.objectOffset);
+        SceneFile::Group *groups = (SceneFile::Group*)(data + h.groupOffset);
+        for (uint32_t i = 0; i < h.modelCount; ++i) {
+            if (!fixString(models[i].path, models[i].pathLength, data, h) || !models[i].pathLength) {
+                return fail("model " + std::to_string(i) + " is out of range");
+            }
+        }
+        for (uint32_t i = 0; i < h.textureCount; ++i) {
+            if (!fixString(textures[i].path, textures[i].pathLength, data, h) || !textures[i].pathLength) {
+                return fail("texture " + std::to_string(i) + " is out of range");
+            }
+        }
+        for (uint32_t i = 0; i < h.objectCount; ++i) {
+            SceneFile::Object &object = objects[i];
+            bool valid = fixString(object.name, object.nameLength, data, h) &&
+                         fix(object.parent, data, h.objectOffset, h.objectCount, 1) &&
+                         fix(object.model, data, h.modelOffset, h.modelCount, 1) &&
+                         fix(object.textures[0], data, h.textureOffset, h.textureCount, 1) &&
+                         fix(object.textures[1], data, h.textureOffset, h.textureCount, 1) &&
+                         object.program < SceneFile::PROGRAM_COUNT &&
+                         i - h.programs[object.program].first < h.programs[object.program].count;
+            if (!valid) {
+                return fail("object " + std::to_string(i) + " is out of range");
+            }
+            if (!SceneFile::splitsIntoTrs(object.local)) {
+                return fail("object " + std::to_string(i) + " has a transform that isn't a translate, rotate and scale");
+            }
+        }
+        // the compiler only lets an object name a parent before it, a chain longer than that is a loop
+        for (uint32_t i = 0; i < h.objectCount; ++i) {
+            uint32_t steps = 0;
+            for (const SceneFile::Object *parent = objects[i].parent.pointer; parent; parent = parent->parent.pointer) {
+                if (++steps > h.objectCount) {
+                    return fail("object " + std::to_string(i) + " is its own ancestor");
+                }
+            }
+        }
+        for (uint32_t i = 0; i < h.groupCount; ++i) {
+            SceneFile::Group &group = groups[i];
+            bool valid = fixString(group.name, group.nameLength, data, h) &&
+                         fix(group.model, data, h.modelOffset, h.modelCount, 1) && group.model.pointer &&
+                         fix(group.instances, data, h.instanceOffset, h.instanceCount, group.instanceCount);
+            if (!valid) {
+                return fail("group " + std::to_string(i) + " is out of range");
+            }
+        }
+
+        // a moved vector keeps its buffer, and the pointers into it
+        m_bytes = std::move(bytes);
+        m_header = (const SceneFile::Header*)m_bytes.data();
+        m_source.size = m_header->sourceSize;
+        m_source.modified = m_header->sourceModified;
+        m_error.clear();
+        return true;
+    }
+
+    const SceneFile::Lights& lights() const {
+        return m_header->lights;
+    }
+
+    uint32_t modelCount() const {
+        return m_header->modelCount;
+    }
+    const SceneFile::Model& model(uint32_t i) const {
+        return models()[i];
+    }
+    uint32_t index(const SceneFile::Model *model) const {
+        return (uint32_t)(model - models());
+    }
+
+    uint32_t textureCount() const {
+        return m_header->textureCount;
+    }
+    const SceneFile::Texture& texture(uint32_t i) const {
+        return textures()[i];
+    }
+    uint32_t index(const SceneFile::Texture *texture) const {
+        return (uint32_t)(texture - textures());
+    }
+
+    uint32_t objectCount() const {
+        return m_header->objectCount;
+    }
+    // all of them, the programs' one after the other
+    const SceneFile::Object& object(uint32_t i) const {
+        return objects()[i];
+    }
+    uint32_t index(const SceneFile::Object *object) const {
+        return (uint32_t)(object - objects());
+    }
+    Objects objects(SceneFile::Program program) const {
+        const SceneFile::Object *first = objects() + m_header->programs[program].first;
+        return {first, first + m_header->programs[program].count};
+    }
+
+    uint32_t groupCount() const {
+        return m_header->groupCount;
+    }
+    const SceneFile::Group& group(uint32_t i) const {
+        return ((const SceneFile::Group*)(m_bytes.data() + m_header->groupOffset))[i];
+    }
+
+    static std::string string(const SceneRef<const char> &text, uint32_t length) {
+        return std::string(text.pointer, length);
+    }
+    const FileStamp& source() const {
+        return m_source;
+    }
+    size_t size() const {
+        return m_bytes.size();
+    }
+    const std::string& error() const {
+        return m_error;
+    }
+
+private:
+    std::vector<char> m_bytes;
+    const SceneFile::Header *m_header = nullptr;
+    FileStamp m_source;
+    std::string m_error;
+
+    const SceneFile::Model* models() const {
+        return (const SceneFile::Model*)(m_bytes.data() + m_header->modelOffset);
+    }
+    const SceneFile::Texture* textures() const {
+        return (const SceneFile::Texture*)(m_bytes.data() + m_header->textureOffset);
+    }
+    const SceneFile::Object* objects() const {
+        return (const SceneFile::Object*)(m_bytes.data() + m_header->objectOffset);
+    }
+
+    // A reference to count consecutive records of the section of sectionCount starting at section.
+    template<typename T>
+    static bool fix(SceneRef<const T> &ref, char *data, uint64_t section, uint32_t sectionCount, uint32_t count) {
+        if (ref.offset == 0) {
+            ref.pointer = nullptr;
+            return true;
+        }
+        if (ref.offset < section || (ref.offset - section) % sizeof(T) != 0 ||
+            (ref.offset - section) / sizeof(T) + count > sectionCount) {
+            return false;
+        }
+        ref.pointer = (const T*)(data + ref.offset);
+        return true;
+    }
+
+    static bool fixString(SceneRef<const char> &ref, uint32_t length, char *data, const SceneFile::Header &header) {
+        // offset and length come from the file, so their sum could wrap
+        if (ref.offset < header.stringOffset || ref.offset > header.fileSize || length > header.fileSize - ref.offset) {
+            return false;
+        }
+        ref.pointer = data + ref.offset;
+        return true;
+    }
+
+    bool fail(const std::string &error) {
+        m_error = error;
+        return false;
+    }
+};
+
+#endif //PROJECT_BASE_SCENEFILE_H
@@ -11,131 +11,234 @@
 #include <fstream>
 #include <sstream>
 #include <rg/Error.h>
+#include <rg/GlState.h>
+#include <rg/UniformTable.h>
+#include <rg/ShaderPreprocessor.h>
+#include <rg/ProgramBinary.h>
+#include <rg/Profiler.h>
 #include <common.h>
 #include <glm/glm.hpp>
 class Shader {
     unsigned int m_Id;
+    UniformTable m_Uniforms;
 public:
-    Shader(std::string vertexShaderPath, std::string fragmentShaderPath) {
-        // build and compile our shader program
-        // ------------------------------------
-        // vertex shader
-        std::string vsString = readFileContents(vertexShaderPath);
+    // defines select the permutation, they are injected into both stages after #version
+    Shader(std::string vertexShaderPath, std::string fragmentShaderPath, const ShaderDefines &defines = ShaderDefines()) {
+        RG_PROFILE_ZONE_DETAIL("build shader", vertexShaderPath.c_str());
+        ShaderPreprocessor preprocessor;
+        std::string vsString;
+        if (!preprocessor.process(vertexShaderPath, defines, vsString)) {
+            std::cout << "ERROR::SHADER::VERTEX::PREPROCESSING_FAILED\n" << preprocessor.error() << std::endl;
+        }
         ASSERT(!vsString.empty(), "Vertex shader source is empty!");
-        const char* vertexShaderSource = vsString.c_str();
-        int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-        glCompileShader(vertexShader);
-        // check for shader compile errors
-        int success;
-        char infoLog[512];
-        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        std::string fsString;
+        if (!preprocessor.process(fragmentShaderPath, defines, fsString)) {
+            std::cout << "ERROR::SHADER::FRAGMENT::PREPROCESSING_FAILED\n" << preprocessor.error() << std::endl;
         }
-        // fragment shader
-        int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        std::string fsString = readFileContents(fragmentShaderPath);
         ASSERT(!fsString.empty(), "Fragment shader empty!");
-        const char* fragmentShaderSource = fsString.c_str();
-        glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-        glCompileShader(fragmentShader);
-        // check for shader compile errors
-        glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-        }
-        // link shaders
+
+        // a binary linked earlier from the same sources by the same driver skips compilation entirely
+        ProgramBinaryCache::Key cacheKey = rg::programBinaryKey(vsString, fsString);
         int shaderProgram = glCreateProgram();
-        glAttachShader(shaderProgram, vertexShader);
-        glAttachShader(shaderProgram, fragmentShader);
-        glLinkProgram(shaderProgram);
-        // check for linking errors
-        glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        if (!rg::loadCachedProgram(shaderProgram, cacheKey)) {
+            linkFromSource(shaderProgram, vsString, fsString);
+            rg::storeCachedProgram(shaderProgram, cacheKey);
         }
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
         m_Id = shaderProgram;
+        m_Uniforms.build(m_Id);
+    }
+
+    // the program id has a single owner, a copy would delete it twice
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    Shader(Shader&& other) noexcept : m_Id(other.m_Id), m_Uniforms(std::move(other.m_Uniforms)) {
+        other.m_Id = 0;
+    }
+
+    Shader& operator=(Shader&& other) noexcept {
+        if (this != &other) {
+            deleteProgram();
+            m_Id = other.m_Id;
+            m_Uniforms = std::move(other.m_Uniforms);
+            other.m_Id = 0;
+        }
+        return *this;
+    }
+
+    ~Shader() {
+        deleteProgram();
     }
 
     // activate the shader
     // ------------------------------------------------------------------------
-    void use()
+    void use() const
+    {
+        rg::glState().useProgram(m_Id);
+    }
+    unsigned int id() const {
+        return m_Id;
+    }
+
+    // resolve a uniform once and keep the handle, the setters below accept either
+    UniformHandle uniform(const char *name) const
     {
-        glUseProgram(m_Id);
+        return m_Uniforms.find(name);
+    }
+    // attach a std140 block to a buffer binding point, programs that do not use the block ignore it
+    void bindUniformBlock(const char *name, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(m_Id, name);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(m_Id, index, binding);
+        }
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(UniformHandle uniform, bool value) const
     {
-        glUniform1i(glGetUniformLocation(m_Id, name.c_str()), (int)value);
+        glUniform1i(uniform.location, (int)value);
+    }
+    void setBool(const char *name, bool value) const
+    {
+        setBool(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(UniformHandle uniform, int value) const
+    {
+        glUniform1i(uniform.location, value);
+    }
+    void setInt(const char *name, int value) const
     {
-        glUniform1i(glGetUniformLocation(m_Id, name.c_str()), value);
+        setInt(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(UniformHandle uniform, float value) const
     {
-        glUniform1f(glGetUniformLocation(m_Id, name.c_str()), value);
+        glUniform1f(uniform.location, value);
+    }
+    void setFloat(const char *name, float value) const
+    {
+        setFloat(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(UniformHandle uniform, const glm::vec2 &value) const
+    {
+        glUniform2fv(uniform.location, 1, &value[0]);
+    }
+    void setVec2(const char *name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(m_Id, name.c_str()), 1, &value[0]);
+        setVec2(uniform(name), value);
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(const char *name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(m_Id, name.c_str()), x, y);
+        glUniform2f(uniform(name).location, x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(UniformHandle uniform, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(m_Id, name.c_str()), 1, &value[0]);
+        glUniform3fv(uniform.location, 1, &value[0]);
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(const char *name, const glm::vec3 &value) const
     {
-        glUniform3f(glGetUniformLocation(m_Id, name.c_str()), x, y, z);
+        setVec3(uniform(name), value);
+    }
+    void setVec3(const char *name, float x, float y, float z) const
+    {
+        glUniform3f(uniform(name).location, x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(UniformHandle uniform, const glm::vec4 &value) const
+    {
+        glUniform4fv(uniform.location, 1, &value[0]);
+    }
+    void setVec4(const char *name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(m_Id, name.c_str()), 1, &value[0]);
+        setVec4(uniform(name), value);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w)
+    void setVec4(const char *name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(m_Id, name.c_str()), x, y, z, w);
+        glUniform4f(uniform(name).location, x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(UniformHandle uniform, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(m_Id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat2(const char *name, const glm::mat2 &mat) const
+    {
+        setMat2(uniform(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(UniformHandle uniform, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat3(const char *name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(m_Id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(uniform(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(UniformHandle uniform, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(m_Id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(const char *name, const glm::mat4 &mat) const
+    {
+        setMat4(uniform(name), mat);
     }
     void deleteProgram() {
-        glDeleteProgram(m_Id);
+        if (m_Id) {
+            glDeleteProgram(m_Id);
+            rg::glState().programDeleted(m_Id);
+        }
         m_Id = 0;
     }
 
-
-
+private:
+    static void linkFromSource(int shaderProgram, const std::string &vsString, const std::string &fsString) {
+        // build and compile our shader program
+        // ------------------------------------
+        // vertex shader
+        const char* vertexShaderSource = vsString.c_str();
+        int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+        glCompileShader(vertexShader);
+        // check for shader compile errors
+        int success;
+        char infoLog[512];
+        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
+        // fragment shader
+        int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        const char* fragmentShaderSource = fsString.c_str();
+        glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+        glCompileShader(fragmentShader);
+        // check for shader compile errors
+        glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
+        // link shaders
+        glAttachShader(shaderProgram, vertexShader);
+        glAttachShader(shaderProgram, fragmentShader);
+        rg::markProgramRetrievable(shaderProgram);
+        glLinkProgram(shaderProgram);
+        // check for linking errors
+        glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        }
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+    }
 };
 
 
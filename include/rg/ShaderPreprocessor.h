@@ -0,0 +1,212 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_SHADERPREPROCESSOR_H
+#define PROJECT_BASE_SHADERPREPROCESSOR_H
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <common.h>
+
+// Macros injected right after #version. One set of defines is one permutation of a shader source,
+// key() names it the same way no matter in which order the defines were set.
+class ShaderDefines {
+    std::vector<std::pair<std::string, std::string>> m_defines;
+public:
+    ShaderDefines& set(const std::string &name, const std::string &value = "1") {
+        auto it = std::lower_bound(m_defines.begin(), m_defines.end(), name,
+                                   [](const std::pair<std::string, std::string> &define, const std::string &key) {
+                                       return define.first < key;
+                                   });
+        if (it != m_defines.end() && it->first == name) {
+            it->second = value;
+        } else {
+            m_defines.insert(it, std::make_pair(name, value));
+        }
+        return *this;
+    }
+
+    ShaderDefines& set(const std::string &name, int value) {
+        return set(name, std::to_string(value));
+    }
+
+    // "NAME=VALUE;NAME=VALUE", sorted by name
+    std::string key() const {
+        std::string key;
+        for (const auto &define : m_defines) {
+            key += define.first;
+            key += '=';
+            key += define.second;
+            key += ';';
+        }
+        return key;
+    }
+
+    std::string directives() const {
+        std::string directives;
+        for (const auto &define : m_defines) {
+            directives += "#define " + define.first + " " + define.second + "\n";
+        }
+        return directives;
+    }
+
+    bool empty() const {
+        return m_defines.empty();
+    }
+};
+
+// Expands #include "file" (paths relative to the including file, each file pasted once) and injects
+// ShaderDefines after #version. Everything else, #if included, is left to the GLSL compiler. No GL
+// calls: file access goes through the reader, so the expansion can be checked without a context.
+//
+// Included text is wrapped in #line directives. The source string number is the file's index in
+// files(), so "1(12)" in a driver message is line 12 of files()[1].
+class ShaderPreprocessor {
+public:
+    using FileReader = std::function<bool(const std::string &path, std::string &contents)>;
+
+    explicit ShaderPreprocessor(FileReader reader = [](const std::string &path, std::string &contents) {
+        return readFileContents(path, contents);
+    }) : m_reader(std::move(reader)) {}
+
+    // Returns false and leaves a message in error() when a file is missing or an #include is malformed.
+    bool process(const std::string &path, const ShaderDefines &defines, std::string &output) {
+        m_files.clear();
+        m_error.clear();
+        output.clear();
+        return expand(path, defines, output);
+    }
+
+    const std::string& error() const {
+        return m_error;
+    }
+
+    const std::vector<std::string>& files() const {
+        return m_files;
+    }
+
+private:
+    FileReader m_reader;
+    std::vector<std::string> m_files;
+    std::string m_error;
+
+    static std::string directoryOf(const std::string &path) {
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+    // Name of the directive on this line ("include", "version", ...), or empty if it isn't one.
+    static std::string directiveName(const std::string &line, size_t &end) {
+        size_t i = line.find_first_not_of(" \t");
+        if (i == std::string::npos || line[i] != '#') {
+            return std::string();
+        }
+        i = line.find_first_not_of(" \t", i + 1);
+        if (i == std::string::npos) {
+            return std::string();
+        }
+        end = i;
+        while (end < line.size() && (isalnum((unsigned char)line[end]) || line[end] == '_')) {
+            ++end;
+        }
+        return line.substr(i, end - i);
+    }
+
+    static std::string lineDirective(int line, size_t file) {
+        return "#line " + std::to_string(line) + " " + std::to_string(file) + "\n";
+    }
+
+    static bool hasVersion(const std::string &source) {
+        size_t begin = 0;
+        while (begin < source.size()) {
+            size_t newline = source.find('\n', begin);
+            size_t next = newline == std::string::npos ? source.size() : newline + 1;
+            size_t nameEnd = 0;
+            if (directiveName(source.substr(begin, next - begin), nameEnd) == "version") {
+                return true;
+            }
+            begin = next;
+        }
+        return false;
+    }
+
+    bool expand(const std::string &path, const ShaderDefines &defines, std::string &output) {
+        size_t fileIndex = m_files.size();
+        m_files.push_back(path);
+
+        std::string source;
+        if (!m_reader(path, source)) {
+            m_error = "cannot read " + path;
+            return false;
+        }
+
+        bool isRoot = fileIndex == 0;
+        if (isRoot && !defines.empty() && !hasVersion(source)) {
+            output += defines.directives();
+            output += lineDirective(1, fileIndex);
+        }
+
+        int lineNumber = 0;
+        size_t begin = 0;
+        while (begin < source.size()) {
+            size_t newline = source.find('\n', begin);
+            size_t next = newline == std::string::npos ? source.size() : newline + 1;
+            std::string line = source.substr(begin, next - begin);
+            begin = next;
+            ++lineNumber;
+            if (!line.empty() && line.back() == '\n') {
+                line.pop_back();
+            }
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+
+            size_t nameEnd = 0;
+            std::string directive = directiveName(line, nameEnd);
+            if (directive == "version") {
+                if (!isRoot) {
+                    m_error = path + ":" + std::to_string(lineNumber) + ": #version in an included file";
+                    return false;
+                }
+                output += line + "\n";
+                if (!defines.empty()) {
+                    output += defines.directives();
+                    output += lineDirective(lineNumber + 1, fileIndex);
+                }
+                continue;
+            }
+            if (directive == "include") {
+                size_t open = line.find_first_of("\"<", nameEnd);
+                size_t close = open == std::string::npos
+                               ? std::string::npos
+                               : line.find(line[open] == '"' ? '"' : '>', open + 1);
+                if (close == std::string::npos || close == open + 1) {
+                    m_error = path + ":" + std::to_string(lineNumber) + ": malformed #include";
+                    return false;
+                }
+                std::string includePath = directoryOf(path) + line.substr(open + 1, close - open - 1);
+                if (std::find(m_files.begin(), m_files.end(), includePath) != m_files.end()) {
+                    // already pasted (or being pasted, for a cycle), keep the line count
+                    output += '\n';
+                    continue;
+                }
+                output += lineDirective(1, m_files.size());
+                if (!expand(includePath, defines, output)) {
+                    return false;
+                }
+                output += lineDirective(lineNumber + 1, fileIndex);
+                continue;
+            }
+            output += line;
+            output += '\n';
+        }
+        return true;
+    }
+};
+
+#endif //PROJECT_BASE_SHADERPREPROCESSOR_H
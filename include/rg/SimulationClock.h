@@ -0,0 +1,73 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_SIMULATIONCLOCK_H
+#define PROJECT_BASE_SIMULATIONCLOCK_H
+
+#include <algorithm>
+#include <cstdint>
+
+// Time for a simulation that steps at a fixed rate whatever rate frames are drawn at. Each frame moves
+// the clock's target on by the real time it took (times timeScale, so a headless run can simulate faster
+// than real time), step() is called until the simulation has caught up, and the frame draws its state
+// alpha() of the way from the state before the last step to the state after it:
+//
+//     clock.advance(elapsed);
+//     while (clock.step()) { previous = current; simulate(current, clock.time(), clock.stepSeconds()); }
+//     draw(interpolate(previous, current, clock.alpha()));
+//
+// Simulated time is a count of steps, so the same targets always make the same steps.
+class SimulationClock {
+public:
+    // real seconds a frame counts for at most, so a stall isn't followed by a burst of steps
+    static constexpr double MAX_FRAME_SECONDS = 0.25;
+
+    explicit SimulationClock(double stepSeconds, double timeScale = 1.0)
+    : m_step(stepSeconds), m_timeScale(timeScale) {}
+
+    // Real seconds since the last frame.
+    void advance(double seconds) {
+        if (seconds > MAX_FRAME_SECONDS) {
+            seconds = MAX_FRAME_SECONDS;
+        }
+        advanceTo(m_target + std::max(seconds, 0.0) * m_timeScale);
+    }
+    // Simulated seconds to catch up with; a target behind the last one is ignored.
+    void advanceTo(double target) {
+        m_target = std::max(m_target, target);
+    }
+
+    // Takes the next step if it is due.
+    bool step() {
+        // a hair of slack, so a target a whole number of steps away doesn't lose one to rounding
+        if ((double)(m_steps + 1) > m_target / m_step + 1e-6) {
+            return false;
+        }
+        ++m_steps;
+        return true;
+    }
+
+    // simulated time after the last step
+    double time() const {
+        return m_steps * m_step;
+    }
+    double stepSeconds() const {
+        return m_step;
+    }
+    uint64_t steps() const {
+        return m_steps;
+    }
+    // how far the target is past the last step, in steps
+    float alpha() const {
+        return (float)std::min(std::max((m_target - time()) / m_step, 0.0), 1.0);
+    }
+
+private:
+    double m_step;
+    double m_timeScale;
+    double m_target = 0.0;
+    uint64_t m_steps = 0;
+};
+
+#endif //PROJECT_BASE_SIMULATIONCLOCK_H
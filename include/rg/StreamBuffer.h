@@ -0,0 +1,202 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_STREAMBUFFER_H
+#define PROJECT_BASE_STREAMBUFFER_H
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <rg/GlExtensions.h>
+
+// Per-frame data the GPU reads once: uniform blocks written by the CPU while the frame is recorded and
+// bound by offset. The buffer is split into FRAMES regions used in turn, so the CPU writes one frame's
+// region while the GPU may still be reading the two before it.
+//
+// With ARB_buffer_storage the buffer is mapped once, persistently and coherently, writes are plain
+// memcpys, and a fence per region keeps the CPU from overwriting a region the GPU hasn't finished with.
+// Waiting on that fence is what the buffer counts: with three regions it should stay at zero. Without
+// buffer storage every write is a glBufferSubData, and the whole buffer is orphaned each time the
+// regions wrap around so the driver never has to wait either.
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+
+namespace rg {
+    typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+    // Null when the context has no immutable buffer storage.
+    BufferStorageProc loadBufferStorageFunction(GLADloadproc load) {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major * 10 + minor < 44 && !hasGlExtension("GL_ARB_buffer_storage")) {
+            return nullptr;
+        }
+        return (BufferStorageProc)load("glBufferStorage");
+    }
+};
+
+class StreamBuffer {
+public:
+    static const unsigned FRAMES = 3;
+
+    // frameSize bytes are available to each frame. maxRange is the largest range bound past the data
+    // written for it; the buffer goes on that far after its last region. load fetches glBufferStorage
+    // when there is one.
+    StreamBuffer(GLenum target, GLsizeiptr frameSize, GLADloadproc load, GLsizeiptr maxRange = 0) : m_target(target) {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        m_alignment = (GLintptr)alignment;
+        m_frameSize = align(frameSize);
+        m_bufferSize = m_frameSize * FRAMES + align(maxRange);
+
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(m_target, m_buffer);
+        rg::BufferStorageProc bufferStorage = rg::loadBufferStorageFunction(load);
+        if (bufferStorage) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorage(m_target, m_bufferSize, nullptr, flags);
+            m_mapped = (char*)glMapBufferRange(m_target, 0, m_bufferSize, flags);
+        }
+        if (!m_mapped) {
+            glBufferData(m_target, m_bufferSize, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(m_target, 0);
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    ~StreamBuffer() {
+        for (GLsync &fence : m_fences) {
+            if (fence) {
+                glDeleteSync(fence);
+            }
+        }
+        if (m_mapped) {
+            glBindBuffer(m_target, m_buffer);
+            glUnmapBuffer(m_target);
+            glBindBuffer(m_target, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    // Moves on to the next region, first making sure the GPU is done with what it held three frames ago.
+    void beginFrame() {
+        m_region = (m_region + 1) % FRAMES;
+        m_offset = 0;
+        m_overflowed = false;
+        GLsync &fence = m_fences[m_region];
+        if (fence) {
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                ++m_fenceWaits;
+                while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+                }
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (!m_mapped && m_region == 0) {
+            glBindBuffer(m_target, m_buffer);
+            glBufferData(m_target, m_bufferSize, nullptr, GL_STREAM_DRAW);
+            glBindBuffer(m_target, 0);
+        }
+    }
+
+    // After the frame's last draw that reads from this region.
+    void endFrame() {
+        m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // Copies size bytes into this frame's region and returns their offset in the buffer, aligned for
+    // glBindBufferRange; -1 when the region is full, which is reported once a frame. rangeSize, when
+    // larger, is the range that will be bound there: it only has to stay inside the buffer, and the region
+    // gives up just size bytes for it.
+    GLintptr write(const void* data, GLsizeiptr size, GLsizeiptr rangeSize = 0) {
+        GLintptr aligned = align(size);
+        GLintptr offset = m_region * m_frameSize + m_offset;
+        if (m_offset + aligned > m_frameSize || offset + rangeSize > m_bufferSize) {
+            if (!m_overflowed) {
+                std::cout << "ERROR::STREAM_BUFFER::FRAME_FULL " << m_frameSize << " bytes" << std::endl;
+                m_overflowed = true;
+            }
+            return -1;
+        }
+        m_offset += aligned;
+        if (m_mapped) {
+            std::memcpy(m_mapped + offset, data, size);
+        } else {
+            glBindBuffer(m_target, m_buffer);
+            glBufferSubData(m_target, offset, size, data);
+            glBindBuffer(m_target, 0);
+        }
+        return offset;
+    }
+
+    template <typename Block>
+    GLintptr write(const Block &block) {
+        return write(&block, sizeof(Block));
+    }
+
+    // Writes block and binds it to the indexed binding point (a uniform block binding for GL_UNIFORM_BUFFER).
+    template <typename Block>
+    bool bind(GLuint binding, const Block &block) {
+        return bind(binding, &block, sizeof(Block), sizeof(Block));
+    }
+
+    // The first size bytes of a rangeSize block, e.g. an array block only partly used by a draw. The
+    // whole range is bound, since GL wants the block's full size behind the binding, but only size bytes
+    // of the region are used up.
+    bool bind(GLuint binding, const void* data, GLsizeiptr size, GLsizeiptr rangeSize) {
+        GLintptr offset = write(data, size, rangeSize);
+        if (offset < 0) {
+            return false;
+        }
+        glBindBufferRange(m_target, binding, m_buffer, offset, rangeSize);
+        return true;
+    }
+
+    // for binding what write() returned later, e.g. when a queued draw is issued
+    GLuint buffer() const {
+        return m_buffer;
+    }
+    bool persistent() const {
+        return m_mapped != nullptr;
+    }
+    // Frames that found their region still in use by the GPU.
+    unsigned long fenceWaits() const {
+        return m_fenceWaits;
+    }
+    // Bytes written this frame, alignment included.
+    GLintptr frameBytes() const {
+        return m_offset;
+    }
+
+private:
+    GLenum m_target;
+    GLuint m_buffer = 0;
+    char* m_mapped = nullptr;
+    GLintptr m_alignment;
+    GLsizeiptr m_frameSize;
+    GLsizeiptr m_bufferSize;
+    unsigned m_region = FRAMES - 1;
+    GLintptr m_offset = 0;
+    bool m_overflowed = false;
+    GLsync m_fences[FRAMES] = {};
+    unsigned long m_fenceWaits = 0;
+
+    GLintptr align(GLintptr size) const {
+        return (size + m_alignment - 1) / m_alignment * m_alignment;
+    }
+};
+
+#endif //PROJECT_BASE_STREAMBUFFER_H
@@ -7,15 +7,19 @@
 #include <glad/glad.h>
 #include <stb_image.h>
 #include <rg/Error.h>
+#include <rg/GlState.h>
+#include <rg/Profiler.h>
+#include <rg/TextureLoader.h>
+#include <rg/CompressedTexture.h>
 
 class Texture2D {
 public:
     unsigned m_tex;
-    unsigned char * m_data;
+    unsigned char * m_data = nullptr;
 
     Texture2D(GLenum wrap_s, GLenum wrap_t, GLenum mag_filter, GLenum min_filter){
         glGenTextures(1,&m_tex);
-        glBindTexture(GL_TEXTURE_2D, m_tex);
+        rg::glState().bindTexture(GL_TEXTURE_2D, m_tex);
 
         //wrap
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_s);
@@ -26,11 +30,54 @@ public:
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
     }
 
+    Texture2D(const Texture2D&) = delete;
+    Texture2D& operator=(const Texture2D&) = delete;
+
+    Texture2D(Texture2D&& other) noexcept : m_tex(other.m_tex), m_data(other.m_data) {
+        other.m_tex = 0;
+        other.m_data = nullptr;
+    }
+
+    Texture2D& operator=(Texture2D&& other) noexcept {
+        if (this != &other) {
+            free_data();
+            rg::cancelTextureLoad(m_tex);
+            glDeleteTextures(1, &m_tex);
+            rg::glState().textureDeleted(m_tex);
+            m_tex = other.m_tex;
+            m_data = other.m_data;
+            other.m_tex = 0;
+            other.m_data = nullptr;
+        }
+        return *this;
+    }
+
+    ~Texture2D() {
+        free_data();
+        rg::cancelTextureLoad(m_tex);
+        glDeleteTextures(1, &m_tex);
+        rg::glState().textureDeleted(m_tex);
+    }
+
     void reflect_vertically(){
-        stbi_set_flip_vertically_on_load(true);
+        rg::flipImagesOnLoad() = true;
+        if (!rg::textureLoader()) {
+            stbi_set_flip_vertically_on_load(true);
+        }
     }
 
     void load(std::string path_to_img, bool gamma_correction){
+        RG_PROFILE_ZONE_DETAIL("load texture", path_to_img.c_str());
+        // a baked .rgtex next to the image goes up as it is, compressed and with its mip chain
+        if (rg::loadBakedTexture(m_tex, path_to_img, gamma_correction, rg::flipImagesOnLoad())) {
+            return;
+        }
+        // with a loader running the image is decoded in the background, a placeholder is shown meanwhile
+        if (rg::textureLoader()) {
+            rg::textureLoader()->request(m_tex, path_to_img, gamma_correction);
+            return;
+        }
+
         int width, height, n_channels;
 
         m_data = stbi_load(path_to_img.c_str(), &width, &height, &n_channels, 0);
@@ -51,8 +98,10 @@ public:
         }
 
         if(m_data){
-            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, m_data);
-            glGenerateMipmap(GL_TEXTURE_2D);
+            // mips are filtered on the CPU, in linear light for sRGB, rather than by the driver
+            MipChain chain;
+            rg::buildMipChain(m_data, width, height, n_channels, gamma_correction, chain, std::thread::hardware_concurrency());
+            rg::texImageMipChain(chain, internalFormat, dataFormat, chain.pixels.data());
         }
         else{
             std::cerr << "Failed to load texture\n";
@@ -61,11 +110,11 @@ public:
 
     void free_data(){
         stbi_image_free(m_data);
+        m_data = nullptr;
     }
 
-    void activate(GLenum texture_number) {
-        glActiveTexture(texture_number);
-        glBindTexture(GL_TEXTURE_2D, m_tex);
+    void activate(GLenum texture_number) const {
+        rg::glState().bindTexture(texture_number - GL_TEXTURE0, GL_TEXTURE_2D, m_tex);
     }
 };
 
@@ -0,0 +1,196 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_TEXTUREFILE_H
+#define PROJECT_BASE_TEXTUREFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <rg/BlockCompression.h>
+#include <rg/MappedFile.h>
+
+// Baked texture format (.rgtex), written by tools/texture_baker.cpp and uploaded by loadBakedTexture.
+//
+//   Header
+//   Level[levelCount]     size and position of every mip level, largest first
+//   (zero padding to 16 bytes before every level)
+//   block data            level by level, blocks left to right, top to bottom
+//
+// Rows are stored top down as in the image file unless the header says they were flipped at bake time.
+
+struct TextureFile {
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t MAX_LEVELS = 32;
+    static constexpr uint32_t FLAG_FLIPPED = 1;
+    static constexpr const char* EXTENSION = ".rgtex";
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t format;
+        uint32_t flags;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint32_t sourceChannels;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+    };
+
+    struct Level {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static uint64_t align(uint64_t offset) {
+        return (offset + 15) & ~(uint64_t)15;
+    }
+};
+
+static_assert(sizeof(TextureFile::Header) == 48 && sizeof(TextureFile::Level) == 24,
+              "texture file header and level table are written as raw bytes");
+
+// A compressed mip chain in memory, built by the baker before it is written out.
+struct BakedTexture {
+    uint32_t format = BLOCK_BC1;
+    uint32_t sourceChannels = 0;
+    bool flipped = false;
+    // levels[0] is the full size image
+    std::vector<uint32_t> widths, heights;
+    std::vector<std::vector<uint8_t>> levels;
+};
+
+// Writes next to the target and renames, so a reader never maps a half written file.
+bool writeTextureFile(const std::string &path, const BakedTexture &texture, const FileStamp &source) {
+    TextureFile::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "RGTX", 4);
+    header.version = TextureFile::VERSION;
+    header.format = texture.format;
+    header.flags = texture.flipped ? TextureFile::FLAG_FLIPPED : 0;
+    header.width = texture.widths.empty() ? 0 : texture.widths[0];
+    header.height = texture.heights.empty() ? 0 : texture.heights[0];
+    header.levelCount = (uint32_t)texture.levels.size();
+    header.sourceChannels = texture.sourceChannels;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+
+    std::vector<TextureFile::Level> levels(texture.levels.size());
+    uint64_t offset = sizeof(header) + levels.size() * sizeof(TextureFile::Level);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        offset = TextureFile::align(offset);
+        levels[i].width = texture.widths[i];
+        levels[i].height = texture.heights[i];
+        levels[i].offset = offset;
+        levels[i].size = texture.levels[i].size();
+        offset += levels[i].size;
+    }
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)levels.data(), levels.size() * sizeof(TextureFile::Level));
+        static const char padding[16] = {};
+        for (size_t i = 0; i < levels.size(); ++i) {
+            out.write(padding, levels[i].offset - (uint64_t)out.tellp());
+            out.write((const char*)texture.levels[i].data(), texture.levels[i].size());
+        }
+        if (!out || (uint64_t)out.tellp() != offset) {
+            out.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Read access to a mapped .rgtex. Holds only pointers into the mapping.
+class TextureFileView {
+public:
+    // Checks the header and that every level has the size its dimensions call for and lies inside the
+    // file. On false error() says what is wrong.
+    bool open(const char* data, size_t size) {
+        *this = TextureFileView();
+        if (size < sizeof(TextureFile::Header)) {
+            return fail("file too small for a header");
+        }
+        std::memcpy(&m_header, data, sizeof(m_header));
+        if (std::memcmp(m_header.magic, "RGTX", 4) != 0) {
+            return fail("not a baked texture file");
+        }
+        if (m_header.version != TextureFile::VERSION) {
+            return fail("baked with format version " + std::to_string(m_header.version) + ", expected " +
+                        std::to_string(TextureFile::VERSION));
+        }
+        if (!rg::isBlockFormat(m_header.format) || m_header.width == 0 || m_header.height == 0 ||
+            m_header.levelCount == 0 || m_header.levelCount > TextureFile::MAX_LEVELS) {
+            return fail("bad format, size or level count");
+        }
+        if (sizeof(TextureFile::Header) + (uint64_t)m_header.levelCount * sizeof(TextureFile::Level) > size) {
+            return fail("level table is truncated");
+        }
+        m_levels = (const TextureFile::Level*)(data + sizeof(TextureFile::Header));
+        for (uint32_t i = 0; i < m_header.levelCount; ++i) {
+            const TextureFile::Level &level = m_levels[i];
+            uint32_t width = std::max(1u, m_header.width >> i), height = std::max(1u, m_header.height >> i);
+            if (level.width != width || level.height != height ||
+                level.size != rg::compressedSize(m_header.format, width, height) ||
+                level.offset > size || level.size > size - level.offset) {
+                m_levels = nullptr;
+                return fail("level " + std::to_string(i) + " does not match the header or lies outside the file");
+            }
+        }
+        m_data = data;
+        return true;
+    }
+
+    const TextureFile::Header& header() const {
+        return m_header;
+    }
+    uint32_t levelCount() const {
+        return m_header.levelCount;
+    }
+    const TextureFile::Level& level(uint32_t i) const {
+        return m_levels[i];
+    }
+    const uint8_t* levelData(uint32_t i) const {
+        return (const uint8_t*)(m_data + m_levels[i].offset);
+    }
+    bool flipped() const {
+        return (m_header.flags & TextureFile::FLAG_FLIPPED) != 0;
+    }
+    FileStamp source() const {
+        FileStamp stamp;
+        stamp.size = m_header.sourceSize;
+        stamp.modified = m_header.sourceModified;
+        return stamp;
+    }
+    const std::string& error() const {
+        return m_error;
+    }
+
+private:
+    TextureFile::Header m_header = {};
+    const TextureFile::Level* m_levels = nullptr;
+    const char* m_data = nullptr;
+    std::string m_error;
+
+    bool fail(const std::string &error) {
+        m_error = error;
+        return false;
+    }
+};
+
+#endif //PROJECT_BASE_TEXTUREFILE_H
@@ -0,0 +1,265 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_TEXTURELOADER_H
+#define PROJECT_BASE_TEXTURELOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <rg/GlState.h>
+#include <rg/MipChain.h>
+#include <rg/Profiler.h>
+#include <rg/ThreadPool.h>
+
+// Decodes images on a thread pool while the scene is already rendering. request() gives the texture a
+// 1x1 placeholder right away and queues the file; update(), once a frame on the GL thread, uploads
+// finished images through a pixel buffer object until the frame's byte budget is spent. The mip chain
+// is built by the worker too, so the GL thread only copies.
+//
+// Workers never look at stbi's global flip flag (another thread may change it mid-decode): the loader
+// turns it off and flips rows itself when rg::flipImagesOnLoad() was set at request time.
+
+namespace rg {
+    // Whether images loaded from now on are flipped vertically. stbi has the same switch but no way to
+    // read it back, and the loader and the baked textures both need to know.
+    bool& flipImagesOnLoad() {
+        static bool flip = false;
+        return flip;
+    }
+
+    // Specifies every level of chain on the bound GL_TEXTURE_2D. pixels is chain.pixels.data(), or the
+    // offset of a copy of it in the bound GL_PIXEL_UNPACK_BUFFER.
+    void texImageMipChain(const MipChain &chain, GLenum internalFormat, GLenum dataFormat, const uint8_t* pixels) {
+        // rows of 1 and 3 channel images are not 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t i = 0; i < chain.levels.size(); ++i) {
+            const MipChain::Level &level = chain.levels[i];
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, level.width, level.height, 0, dataFormat,
+                         GL_UNSIGNED_BYTE, pixels + level.offset);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)chain.levels.size() - 1);
+    }
+};
+
+class TextureLoader {
+public:
+    static constexpr size_t DEFAULT_UPLOAD_BUDGET = 16u << 20;
+
+    explicit TextureLoader(unsigned threadCount = ThreadPool::defaultThreadCount(), size_t uploadBudget = DEFAULT_UPLOAD_BUDGET)
+    : m_uploadBudget(uploadBudget), m_start(std::chrono::steady_clock::now()), m_pool(threadCount) {
+        stbi_set_flip_vertically_on_load(false);
+        glGenBuffers(2, m_pixelBuffers);
+    }
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    ~TextureLoader() {
+        m_pool.stop();
+        glDeleteBuffers(2, m_pixelBuffers);
+    }
+
+    // GL thread. srgb picks GL_SRGB/GL_SRGB_ALPHA for 3 and 4 channel images, as Texture2D's gamma flag does.
+    void request(GLuint texture, const std::string &path, bool srgb) {
+        static const unsigned char placeholder[4] = {128, 128, 128, 255};
+        rg::glState().bindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        // complete for mipmapped filters until the real chain replaces it
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+        unsigned long ticket = ++m_tickets;
+        cancel(texture);
+        m_pending.push_back(std::make_pair(texture, ticket));
+
+        bool flip = rg::flipImagesOnLoad();
+        m_pool.submit([this, texture, ticket, path, srgb, flip] {
+            RG_PROFILE_ZONE_DETAIL("decode image", path.c_str());
+            Decoded image;
+            image.texture = texture;
+            image.ticket = ticket;
+            image.path = path;
+            image.srgb = srgb;
+            int width, height;
+            unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &image.channels, 0);
+            if (pixels) {
+                if (flip) {
+                    flipRows(pixels, width, height, image.channels);
+                }
+                // the pool already runs one image per thread, so one thread per chain
+                rg::buildMipChain(pixels, (unsigned)width, (unsigned)height, (unsigned)image.channels, srgb, image.chain);
+                stbi_image_free(pixels);
+            } else {
+                image.channels = 0;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_ready.push_back(std::move(image));
+        });
+    }
+
+    // GL thread. The texture is about to be deleted, whatever is in flight for it is dropped.
+    void cancel(GLuint texture) {
+        m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+                                       [texture](const std::pair<GLuint, unsigned long> &pending) {
+                                           return pending.first == texture;
+                                       }), m_pending.end());
+    }
+
+    // GL thread, once per frame. Always uploads at least one image so a big one can't stall the queue.
+    void update() {
+        if (m_pending.empty()) {
+            return;
+        }
+        RG_PROFILE_GPU_ZONE("texture uploads");
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_uploads.insert(m_uploads.end(), std::make_move_iterator(m_ready.begin()), std::make_move_iterator(m_ready.end()));
+            m_ready.clear();
+        }
+        size_t uploaded = 0;
+        size_t next = 0;
+        for (; next < m_uploads.size() && (next == 0 || uploaded < m_uploadBudget); ++next) {
+            Decoded &image = m_uploads[next];
+            if (isPending(image)) {
+                uploaded += upload(image);
+            }
+        }
+        m_uploads.erase(m_uploads.begin(), m_uploads.begin() + next);
+
+        if (m_pending.empty()) {
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+            std::cout << "texture loader: " << m_uploaded << " texture(s) decoded on " << m_pool.threadCount()
+                      << " thread(s), all uploaded " << milliseconds << " ms after start";
+            if (m_failed) {
+                std::cout << ", " << m_failed << " failed";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    bool idle() const {
+        return m_pending.empty();
+    }
+    unsigned uploaded() const {
+        return m_uploaded;
+    }
+    unsigned failed() const {
+        return m_failed;
+    }
+
+private:
+    struct Decoded {
+        GLuint texture = 0;
+        unsigned long ticket = 0;
+        std::string path;
+        int channels = 0;
+        MipChain chain;
+        bool srgb = false;
+    };
+
+    size_t m_uploadBudget;
+    std::chrono::steady_clock::time_point m_start;
+    unsigned long m_tickets = 0;
+    unsigned m_uploaded = 0, m_failed = 0;
+    GLuint m_pixelBuffers[2] = {0, 0};
+    unsigned m_nextPixelBuffer = 0;
+    // GL thread only: the latest request of every texture still waiting, and decoded images over budget
+    std::vector<std::pair<GLuint, unsigned long>> m_pending;
+    std::vector<Decoded> m_uploads;
+    // filled by the workers
+    std::mutex m_mutex;
+    std::vector<Decoded> m_ready;
+    // last, so the workers are gone before anything they touch
+    ThreadPool m_pool;
+
+    static void flipRows(unsigned char* pixels, int width, int height, int channels) {
+        size_t stride = (size_t)width * channels;
+        std::vector<unsigned char> row(stride);
+        for (int top = 0, bottom = height - 1; top < bottom; ++top, --bottom) {
+            unsigned char* a = pixels + top * stride;
+            unsigned char* b = pixels + bottom * stride;
+            std::memcpy(row.data(), a, stride);
+            std::memcpy(a, b, stride);
+            std::memcpy(b, row.data(), stride);
+        }
+    }
+
+    // True for the newest request of a texture that is still alive; the request is then done.
+    bool isPending(const Decoded &image) {
+        for (size_t i = 0; i < m_pending.size(); ++i) {
+            if (m_pending[i].first == image.texture && m_pending[i].second == image.ticket) {
+                m_pending.erase(m_pending.begin() + i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t upload(const Decoded &image) {
+        RG_PROFILE_ZONE_DETAIL("upload image", image.path.c_str());
+        GLenum internalFormat, dataFormat;
+        if (image.channels == 1) {
+            internalFormat = dataFormat = GL_RED;
+        } else if (image.channels == 3) {
+            internalFormat = image.srgb ? GL_SRGB : GL_RGB;
+            dataFormat = GL_RGB;
+        } else if (image.channels == 4) {
+            internalFormat = image.srgb ? GL_SRGB_ALPHA : GL_RGBA;
+            dataFormat = GL_RGBA;
+        } else {
+            // keeps the placeholder
+            std::cout << "Texture failed to load at path: " << image.path << std::endl;
+            ++m_failed;
+            return 0;
+        }
+        size_t size = image.chain.pixels.size();
+
+        // two buffers in turn, each orphaned before it is refilled, so the copy never waits on the last upload
+        GLuint pixelBuffer = m_pixelBuffers[m_nextPixelBuffer];
+        m_nextPixelBuffer ^= 1;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        const uint8_t* source = nullptr;
+        if (staging) {
+            std::memcpy(staging, image.chain.pixels.data(), size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        } else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            source = image.chain.pixels.data();
+        }
+
+        rg::glState().bindTexture(GL_TEXTURE_2D, image.texture);
+        rg::texImageMipChain(image.chain, internalFormat, dataFormat, source);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        ++m_uploaded;
+        return size;
+    }
+};
+
+namespace rg {
+    // The loader textures go through; null (the default) decodes on the calling thread.
+    TextureLoader*& textureLoader() {
+        static TextureLoader* loader = nullptr;
+        return loader;
+    }
+
+    // For texture destructors: a texture must not receive an upload after it is deleted.
+    void cancelTextureLoad(GLuint texture) {
+        if (textureLoader()) {
+            textureLoader()->cancel(texture);
+        }
+    }
+};
+
+#endif //PROJECT_BASE_TEXTURELOADER_H
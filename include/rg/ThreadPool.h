@@ -0,0 +1,91 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_THREADPOOL_H
+#define PROJECT_BASE_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads taking jobs in submission order. Jobs must not touch GL, only the
+// thread that owns the context may. Stopping (or destroying) the pool lets running jobs finish and
+// drops the ones that haven't started.
+class ThreadPool {
+public:
+    using Job = std::function<void()>;
+
+    // one thread is left for the render thread
+    static unsigned defaultThreadCount() {
+        unsigned hardware = std::thread::hardware_concurrency();
+        return hardware > 1 ? hardware - 1 : 1;
+    }
+
+    explicit ThreadPool(unsigned threadCount = defaultThreadCount()) {
+        for (unsigned i = 0; i < threadCount; ++i) {
+            m_workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        stop();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_jobs.clear();
+        }
+        m_wake.notify_all();
+        for (std::thread &worker : m_workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+
+    void submit(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(std::move(job));
+        }
+        m_wake.notify_one();
+    }
+
+    unsigned threadCount() const {
+        return (unsigned)m_workers.size();
+    }
+
+private:
+    std::vector<std::thread> m_workers;
+    std::deque<Job> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+
+    void work() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+                if (m_jobs.empty()) {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+#endif //PROJECT_BASE_THREADPOOL_H
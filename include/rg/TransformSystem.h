@@ -0,0 +1,565 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_TRANSFORMSYSTEM_H
+#define PROJECT_BASE_TRANSFORMSYSTEM_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RG_TRANSFORM_X86 1
+#endif
+
+// Entities with a local transform (translation, rotation, scale) under an optional parent, and the world
+// matrix that makes. Everything is kept as structure of arrays, one array per component, so the kernel
+// that composes world matrices loads and stores whole SIMD registers of one component for several
+// entities at a time.
+//
+// Setting a local transform only marks the entity dirty. update() collects the subtrees under the dirty
+// entities, sorts them by depth, and recomputes their world matrices one depth at a time, parents before
+// children, so an entity that doesn't move, and has no moving ancestor, is never touched again.
+//
+// Kernels: scalar, SSE2 and AVX2, picked at run time. They do the same multiplications and additions in
+// the same order, without fused multiply-adds.
+
+typedef uint32_t Entity;
+const Entity NO_ENTITY = 0xffffffffu;
+
+namespace rg {
+    enum TransformKernel {
+        TRANSFORM_KERNEL_SCALAR,
+        TRANSFORM_KERNEL_SSE2,
+        TRANSFORM_KERNEL_AVX2,
+        TRANSFORM_KERNEL_COUNT
+    };
+
+    const char* transformKernelName(TransformKernel kernel) {
+        switch (kernel) {
+            case TRANSFORM_KERNEL_SCALAR: return "scalar";
+            case TRANSFORM_KERNEL_SSE2: return "SSE2";
+            case TRANSFORM_KERNEL_AVX2: return "AVX2";
+            default: return "?";
+        }
+    }
+
+    bool transformKernelSupported(TransformKernel kernel) {
+#ifdef RG_TRANSFORM_X86
+        switch (kernel) {
+            case TRANSFORM_KERNEL_SCALAR: return true;
+            case TRANSFORM_KERNEL_SSE2: return __builtin_cpu_supports("sse2");
+            case TRANSFORM_KERNEL_AVX2: return __builtin_cpu_supports("avx2");
+            default: return false;
+        }
+#else
+        return kernel == TRANSFORM_KERNEL_SCALAR;
+#endif
+    }
+
+    TransformKernel bestTransformKernel() {
+        static const TransformKernel best = transformKernelSupported(TRANSFORM_KERNEL_AVX2) ? TRANSFORM_KERNEL_AVX2 :
+                                            transformKernelSupported(TRANSFORM_KERNEL_SSE2) ? TRANSFORM_KERNEL_SSE2 :
+                                            TRANSFORM_KERNEL_SCALAR;
+        return best;
+    }
+};
+
+class TransformSystem {
+public:
+    // Slot 0 is the implicit root every parentless entity hangs from, its world matrix the identity, so
+    // the kernels never branch on whether there is a parent.
+    TransformSystem() {
+        push(0, 0);
+        for (int k = 0; k < 12; ++k) {
+            m_world[k][0] = k % 4 == 0 ? 1.0f : 0.0f;
+        }
+    }
+
+    void reserve(size_t count) {
+        ++count;
+        for (std::vector<float> *component : components()) {
+            component->reserve(count);
+        }
+        m_parent.reserve(count);
+        m_firstChild.reserve(count);
+        m_nextSibling.reserve(count);
+        m_depth.reserve(count);
+        m_flags.reserve(count);
+    }
+
+    // An identity transform under parent, or at the top when there is none; parent has to exist already.
+    Entity create(Entity parent = NO_ENTITY) {
+        Entity slot = parent == NO_ENTITY ? 0 : slotOf(parent);
+        Entity entity = push(slot, m_depth[slot] + 1);
+        markDirty(entity);
+        return entity - 1;
+    }
+
+    Entity create(const glm::mat4 &local, Entity parent = NO_ENTITY) {
+        Entity entity = create(parent);
+        setLocal(entity, local);
+        return entity;
+    }
+
+    // Moves entity, with everything under it, under parent; false, and nothing changes, when parent is
+    // entity itself or one of its children.
+    bool setParent(Entity entity, Entity parent) {
+        Entity slot = slotOf(entity), parentSlot = parent == NO_ENTITY ? 0 : slotOf(parent);
+        for (Entity ancestor = parentSlot; ancestor != 0; ancestor = m_parent[ancestor]) {
+            if (ancestor == slot) {
+                return false;
+            }
+        }
+        unlink(slot);
+        link(slot, parentSlot);
+        m_ordered = m_ordered && parentSlot < slot;
+        // the depths of the subtree follow; it is walked again by update()
+        m_stack.clear();
+        m_stack.push_back(slot);
+        while (!m_stack.empty()) {
+            Entity e = m_stack.back();
+            m_stack.pop_back();
+            m_depth[e] = m_depth[m_parent[e]] + 1;
+            for (Entity child = m_firstChild[e]; child != 0; child = m_nextSibling[child]) {
+                m_stack.push_back(child);
+            }
+        }
+        markDirty(slot);
+        return true;
+    }
+
+    void setPosition(Entity entity, const glm::vec3 &position) {
+        Entity slot = slotOf(entity);
+        m_position[0][slot] = position.x;
+        m_position[1][slot] = position.y;
+        m_position[2][slot] = position.z;
+        markDirty(slot);
+    }
+
+    // degrees about axis, as glm::rotate(glm::radians(degrees), axis) would
+    void setRotation(Entity entity, float degrees, const glm::vec3 &axis) {
+        glm::vec3 unit = glm::normalize(axis);
+        float half = glm::radians(degrees) * 0.5f, s = std::sin(half);
+        setRotation(slotOf(entity), unit.x * s, unit.y * s, unit.z * s, std::cos(half));
+    }
+
+    void setScale(Entity entity, const glm::vec3 &scale) {
+        Entity slot = slotOf(entity);
+        m_scale[0][slot] = scale.x;
+        m_scale[1][slot] = scale.y;
+        m_scale[2][slot] = scale.z;
+        markDirty(slot);
+    }
+
+    // Takes local apart into translation, rotation and scale; a shear, which no translate, rotate and
+    // scale make, is lost. Scene files can't hold one, see SceneFile::splitsIntoTrs.
+    void setLocal(Entity entity, const glm::mat4 &local) {
+        Entity slot = slotOf(entity);
+        glm::vec3 axes[3] = {glm::vec3(local[0]), glm::vec3(local[1]), glm::vec3(local[2])};
+        float scale[3] = {glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2])};
+        // a mirror goes into the x scale
+        if (glm::dot(glm::cross(axes[0], axes[1]), axes[2]) < 0.0f) {
+            scale[0] = -scale[0];
+        }
+        for (int i = 0; i < 3; ++i) {
+            axes[i] = scale[i] != 0.0f ? axes[i] / scale[i] : glm::vec3(glm::mat4(1.0f)[i]);
+            m_position[i][slot] = local[3][i];
+            m_scale[i][slot] = scale[i];
+        }
+        // the largest of w, x, y, z is taken from the diagonal, the rest from the off-diagonal pairs
+        float xx = axes[0].x, yy = axes[1].y, zz = axes[2].z, trace = xx + yy + zz;
+        float x, y, z, w;
+        if (trace > 0.0f) {
+            float s = std::sqrt(trace + 1.0f) * 2.0f;
+            w = 0.25f * s;
+            x = (axes[1].z - axes[2].y) / s;
+            y = (axes[2].x - axes[0].z) / s;
+            z = (axes[0].y - axes[1].x) / s;
+        } else if (xx > yy && xx > zz) {
+            float s = std::sqrt(1.0f + xx - yy - zz) * 2.0f;
+            w = (axes[1].z - axes[2].y) / s;
+            x = 0.25f * s;
+            y = (axes[1].x + axes[0].y) / s;
+            z = (axes[2].x + axes[0].z) / s;
+        } else if (yy > zz) {
+            float s = std::sqrt(1.0f + yy - xx - zz) * 2.0f;
+            w = (axes[2].x - axes[0].z) / s;
+            x = (axes[1].x + axes[0].y) / s;
+            y = 0.25f * s;
+            z = (axes[2].y + axes[1].z) / s;
+        } else {
+            float s = std::sqrt(1.0f + zz - xx - yy) * 2.0f;
+            w = (axes[0].y - axes[1].x) / s;
+            x = (axes[2].x + axes[0].z) / s;
+            y = (axes[2].y + axes[1].z) / s;
+            z = 0.25f * s;
+        }
+        float length = std::sqrt(x * x + y * y + z * z + w * w);
+        setRotation(slot, x / length, y / length, z / length, w / length);
+    }
+
+    glm::vec3 position(Entity entity) const {
+        Entity slot = slotOf(entity);
+        return glm::vec3(m_position[0][slot], m_position[1][slot], m_position[2][slot]);
+    }
+    Entity parent(Entity entity) const {
+        Entity slot = m_parent[slotOf(entity)];
+        return slot == 0 ? NO_ENTITY : slot - 1;
+    }
+
+    // As of the last update().
+    glm::mat4 world(Entity entity) const {
+        Entity slot = slotOf(entity);
+        glm::mat4 matrix(1.0f);
+        for (int column = 0; column < 4; ++column) {
+            for (int row = 0; row < 3; ++row) {
+                matrix[column][row] = m_world[column * 3 + row][slot];
+            }
+        }
+        return matrix;
+    }
+
+    size_t size() const {
+        return m_parent.size() - 1;
+    }
+    // entities set since the last update(), not counting what is under them
+    size_t dirtyCount() const {
+        return m_dirty.size();
+    }
+
+    // Marks every entity dirty, for the next update() to rebuild them all.
+    void invalidateAll() {
+        for (Entity slot = 1; slot < m_parent.size(); ++slot) {
+            markDirty(slot);
+        }
+    }
+
+    // Recomputes the world matrices of the dirty entities and everything under them; returns how many.
+    size_t update(rg::TransformKernel kernel = rg::bestTransformKernel()) {
+        for (std::vector<Entity> &level : m_levels) {
+            level.clear();
+        }
+        size_t queued = 0;
+        if (m_ordered && m_dirty.size() * SCAN_RATIO >= m_parent.size()) {
+            // one pass in slot order, parents before children, instead of walking the subtrees; it leaves
+            // every depth's slots in order too
+            for (Entity e = 1; e < m_parent.size(); ++e) {
+                if ((m_flags[e] & DIRTY) || (m_flags[m_parent[e]] & QUEUED)) {
+                    m_flags[e] = QUEUED;
+                    level(m_depth[e]).push_back(e);
+                    ++queued;
+                }
+            }
+        } else {
+            // a subtree already queued from an entity further down the list is queued whole, and skipped
+            for (Entity dirty : m_dirty) {
+                m_stack.clear();
+                m_stack.push_back(dirty);
+                while (!m_stack.empty()) {
+                    Entity e = m_stack.back();
+                    m_stack.pop_back();
+                    if (m_flags[e] & QUEUED) {
+                        continue;
+                    }
+                    m_flags[e] = QUEUED;
+                    level(m_depth[e]).push_back(e);
+                    ++queued;
+                    for (Entity child = m_firstChild[e]; child != 0; child = m_nextSibling[child]) {
+                        m_stack.push_back(child);
+                    }
+                }
+            }
+        }
+        m_dirty.clear();
+
+        for (std::vector<Entity> &level : m_levels) {
+            if (level.empty()) {
+                continue;
+            }
+            compose(level.data(), level.size(), kernel);
+            for (Entity e : level) {
+                m_flags[e] = 0;
+            }
+        }
+        return queued;
+    }
+
+private:
+    enum Flags : uint8_t {
+        DIRTY = 1,
+        QUEUED = 2
+    };
+
+    // local transform; the rotation a unit quaternion x, y, z, w
+    std::vector<float> m_position[3], m_rotation[4], m_scale[3];
+    // world matrix, columns 0 to 3 of its upper 3x4, rows x, y, z: component column * 3 + row
+    std::vector<float> m_world[12];
+    // slots, 0 for none; children are a list through m_nextSibling
+    std::vector<Entity> m_parent, m_firstChild, m_nextSibling;
+    std::vector<uint32_t> m_depth;
+    std::vector<uint8_t> m_flags;
+
+    std::vector<Entity> m_dirty;
+    // every parent's slot before its children's, as create() makes them
+    bool m_ordered = true;
+    // update()'s scratch, kept so steady-state updates don't allocate
+    std::vector<Entity> m_stack;
+    std::vector<std::vector<Entity>> m_levels;
+
+    // update() scans every slot rather than walk the subtrees with 1 in SCAN_RATIO of them dirty
+    static const size_t SCAN_RATIO = 64;
+
+    // entities are numbered from 0, their slots from 1
+    static Entity slotOf(Entity entity) {
+        return entity + 1;
+    }
+
+    std::vector<std::vector<float>*> components() {
+        std::vector<std::vector<float>*> all;
+        for (int k = 0; k < 3; ++k) {
+            all.push_back(&m_position[k]);
+            all.push_back(&m_scale[k]);
+        }
+        for (int k = 0; k < 4; ++k) {
+            all.push_back(&m_rotation[k]);
+        }
+        for (int k = 0; k < 12; ++k) {
+            all.push_back(&m_world[k]);
+        }
+        return all;
+    }
+
+    Entity push(Entity parent, uint32_t depth) {
+        Entity slot = (Entity)m_parent.size();
+        for (int k = 0; k < 3; ++k) {
+            m_position[k].push_back(0.0f);
+            m_scale[k].push_back(1.0f);
+        }
+        for (int k = 0; k < 4; ++k) {
+            m_rotation[k].push_back(k == 3 ? 1.0f : 0.0f);
+        }
+        for (int k = 0; k < 12; ++k) {
+            m_world[k].push_back(0.0f);
+        }
+        m_parent.push_back(0);
+        m_firstChild.push_back(0);
+        m_nextSibling.push_back(0);
+        m_depth.push_back(depth);
+        m_flags.push_back(0);
+        if (slot != 0) {
+            link(slot, parent);
+        }
+        return slot;
+    }
+
+    std::vector<Entity>& level(uint32_t depth) {
+        if (depth >= m_levels.size()) {
+            m_levels.resize(depth + 1);
+        }
+        return m_levels[depth];
+    }
+
+    void link(Entity slot, Entity parent) {
+        m_parent[slot] = parent;
+        m_nextSibling[slot] = m_firstChild[parent];
+        m_firstChild[parent] = slot;
+    }
+
+    void unlink(Entity slot) {
+        Entity *next = &m_firstChild[m_parent[slot]];
+        while (*next != slot) {
+            next = &m_nextSibling[*next];
+        }
+        *next = m_nextSibling[slot];
+        m_nextSibling[slot] = 0;
+    }
+
+    void setRotation(Entity slot, float x, float y, float z, float w) {
+        m_rotation[0][slot] = x;
+        m_rotation[1][slot] = y;
+        m_rotation[2][slot] = z;
+        m_rotation[3][slot] = w;
+        markDirty(slot);
+    }
+
+    void markDirty(Entity slot) {
+        if (!(m_flags[slot] & DIRTY)) {
+            m_flags[slot] |= DIRTY;
+            m_dirty.push_back(slot);
+        }
+    }
+
+    // world = parent's world * translate * rotate * scale, for count entities of one depth
+    void compose(const Entity *slots, size_t count, rg::TransformKernel kernel) {
+#ifdef RG_TRANSFORM_X86
+        if (kernel == rg::TRANSFORM_KERNEL_AVX2) {
+            composeAvx2(slots, count);
+            return;
+        }
+        if (kernel == rg::TRANSFORM_KERNEL_SSE2) {
+            composeSse2(slots, count);
+            return;
+        }
+#endif
+        composeScalar(slots, 0, count);
+    }
+
+    void composeScalar(const Entity *slots, size_t first, size_t count) {
+        for (size_t i = first; i < count; ++i) {
+            Entity e = slots[i], p = m_parent[e];
+            float x = m_rotation[0][e], y = m_rotation[1][e], z = m_rotation[2][e], w = m_rotation[3][e];
+            float sx = m_scale[0][e], sy = m_scale[1][e], sz = m_scale[2][e];
+            float x2 = x + x, y2 = y + y, z2 = z + z;
+            float xx = x * x2, yy = y * y2, zz = z * z2, xy = x * y2, xz = x * z2, yz = y * z2;
+            float wx = w * x2, wy = w * y2, wz = w * z2;
+            // the local 3x4, column by column
+            float local[12] = {
+                (1.0f - (yy + zz)) * sx, (xy + wz) * sx, (xz - wy) * sx,
+                (xy - wz) * sy, (1.0f - (xx + zz)) * sy, (yz + wx) * sy,
+                (xz + wy) * sz, (yz - wx) * sz, (1.0f - (xx + yy)) * sz,
+                m_position[0][e], m_position[1][e], m_position[2][e]
+            };
+            for (int column = 0; column < 4; ++column) {
+                for (int row = 0; row < 3; ++row) {
+                    float value = m_world[row][p] * local[column * 3] + m_world[3 + row][p] * local[column * 3 + 1] +
+                                  m_world[6 + row][p] * local[column * 3 + 2];
+                    m_world[column * 3 + row][e] = column == 3 ? value + m_world[9 + row][p] : value;
+                }
+            }
+        }
+    }
+
+#ifdef RG_TRANSFORM_X86
+    // The same arithmetic four entities a register: components are gathered by slot, the parents'
+    // through the slots of the parents, and scattered back, or loaded and stored whole when the four
+    // slots are consecutive.
+    __attribute__((target("sse2")))
+    void composeSse2(const Entity *slots, size_t count) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const Entity *e = slots + i;
+            Entity p[4] = {m_parent[e[0]], m_parent[e[1]], m_parent[e[2]], m_parent[e[3]]};
+            bool run = e[1] == e[0] + 1 && e[2] == e[0] + 2 && e[3] == e[0] + 3;
+            auto gather = [](const std::vector<float> &component, const Entity *at, bool run) {
+                return run ? _mm_loadu_ps(&component[at[0]]) :
+                             _mm_set_ps(component[at[3]], component[at[2]], component[at[1]], component[at[0]]);
+            };
+            __m128 x = gather(m_rotation[0], e, run), y = gather(m_rotation[1], e, run), z = gather(m_rotation[2], e, run),
+                   w = gather(m_rotation[3], e, run);
+            __m128 sx = gather(m_scale[0], e, run), sy = gather(m_scale[1], e, run), sz = gather(m_scale[2], e, run);
+            __m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+            __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+            __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+            __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+            __m128 one = _mm_set1_ps(1.0f);
+            __m128 local[12] = {
+                _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx), _mm_mul_ps(_mm_add_ps(xy, wz), sx),
+                _mm_mul_ps(_mm_sub_ps(xz, wy), sx),
+                _mm_mul_ps(_mm_sub_ps(xy, wz), sy), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+                _mm_mul_ps(_mm_add_ps(yz, wx), sy),
+                _mm_mul_ps(_mm_add_ps(xz, wy), sz), _mm_mul_ps(_mm_sub_ps(yz, wx), sz),
+                _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz),
+                gather(m_position[0], e, run), gather(m_position[1], e, run), gather(m_position[2], e, run)
+            };
+            __m128 parent[12];
+            for (int k = 0; k < 12; ++k) {
+                parent[k] = gather(m_world[k], p, false);
+            }
+            for (int column = 0; column < 4; ++column) {
+                for (int row = 0; row < 3; ++row) {
+                    __m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(parent[row], local[column * 3]),
+                                                         _mm_mul_ps(parent[3 + row], local[column * 3 + 1])),
+                                              _mm_mul_ps(parent[6 + row], local[column * 3 + 2]));
+                    if (column == 3) {
+                        value = _mm_add_ps(value, parent[9 + row]);
+                    }
+                    std::vector<float> &component = m_world[column * 3 + row];
+                    if (run) {
+                        _mm_storeu_ps(&component[e[0]], value);
+                        continue;
+                    }
+                    float lanes[4];
+                    _mm_storeu_ps(lanes, value);
+                    component[e[0]] = lanes[0];
+                    component[e[1]] = lanes[1];
+                    component[e[2]] = lanes[2];
+                    component[e[3]] = lanes[3];
+                }
+            }
+        }
+        composeScalar(slots, i, count);
+    }
+
+    __attribute__((target("avx2")))
+    static __m256 load(const std::vector<float> &component, const Entity *e, __m256i at, bool run) {
+        return run ? _mm256_loadu_ps(&component[e[0]]) : _mm256_i32gather_ps(component.data(), at, 4);
+    }
+
+    // Eight entities a register, the scattered ones loaded with the AVX2 gathers.
+    __attribute__((target("avx2")))
+    void composeAvx2(const Entity *slots, size_t count) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const Entity *e = slots + i;
+            Entity p[8];
+            for (int lane = 0; lane < 8; ++lane) {
+                p[lane] = m_parent[e[lane]];
+            }
+            bool run = true;
+            for (int lane = 1; lane < 8; ++lane) {
+                run = run && e[lane] == e[0] + lane;
+            }
+            __m256i at = _mm256_loadu_si256((const __m256i*)e), parentAt = _mm256_loadu_si256((const __m256i*)p);
+            __m256 x = load(m_rotation[0], e, at, run), y = load(m_rotation[1], e, at, run),
+                   z = load(m_rotation[2], e, at, run), w = load(m_rotation[3], e, at, run);
+            __m256 sx = load(m_scale[0], e, at, run), sy = load(m_scale[1], e, at, run),
+                   sz = load(m_scale[2], e, at, run);
+            __m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+            __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+            __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+            __m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+            __m256 one = _mm256_set1_ps(1.0f);
+            __m256 local[12] = {
+                _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx), _mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+                _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx),
+                _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+                _mm256_mul_ps(_mm256_add_ps(yz, wx), sy),
+                _mm256_mul_ps(_mm256_add_ps(xz, wy), sz), _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+                _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz),
+                load(m_position[0], e, at, run), load(m_position[1], e, at, run),
+                load(m_position[2], e, at, run)
+            };
+            __m256 parent[12];
+            for (int k = 0; k < 12; ++k) {
+                parent[k] = _mm256_i32gather_ps(m_world[k].data(), parentAt, 4);
+            }
+            for (int column = 0; column < 4; ++column) {
+                for (int row = 0; row < 3; ++row) {
+                    __m256 value = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(parent[row], local[column * 3]),
+                                                               _mm256_mul_ps(parent[3 + row], local[column * 3 + 1])),
+                                                 _mm256_mul_ps(parent[6 + row], local[column * 3 + 2]));
+                    if (column == 3) {
+                        value = _mm256_add_ps(value, parent[9 + row]);
+                    }
+                    float *component = m_world[column * 3 + row].data();
+                    if (run) {
+                        _mm256_storeu_ps(component + e[0], value);
+                        continue;
+                    }
+                    float lanes[8];
+                    _mm256_storeu_ps(lanes, value);
+                    for (int lane = 0; lane < 8; ++lane) {
+                        component[e[lane]] = lanes[lane];
+                    }
+                }
+            }
+        }
+        composeSse2(slots + i, count - i);
+    }
+#endif
+};
+
+#endif //PROJECT_BASE_TRANSFORMSYSTEM_H
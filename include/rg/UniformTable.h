@@ -0,0 +1,134 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_UNIFORMTABLE_H
+#define PROJECT_BASE_UNIFORMTABLE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Pre-resolved uniform location. Get one from a shader once and keep it, setting a uniform
+// through a handle costs nothing but the glUniform* call.
+struct UniformHandle {
+    GLint location = -1;
+};
+
+namespace rg {
+
+    // Number of by-name uniform lookups since the last reset. Render code is expected to use
+    // handles, so in steady state this stays at zero.
+    unsigned long& uniformLookupCount() {
+        static unsigned long count = 0;
+        return count;
+    }
+
+    void resetUniformLookupCount() {
+        uniformLookupCount() = 0;
+    }
+
+    uint32_t hashUniformName(const char* name) {
+        // FNV-1a
+        uint32_t hash = 2166136261u;
+        for (; *name; ++name) {
+            hash ^= (unsigned char)*name;
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+};
+
+// Every active uniform of a program, read with glGetActiveUniform right after linking and stored in
+// an open-addressing hash table. Names live in one contiguous buffer, so lookups never allocate.
+class UniformTable {
+    struct Entry {
+        uint32_t hash = 0;
+        uint32_t nameOffset = 0;
+        GLint location = -1;
+    };
+
+    std::vector<Entry> m_entries;
+    std::string m_names;
+    unsigned m_count = 0;
+
+    void insert(const char* name, GLint location) {
+        uint32_t hash = rg::hashUniformName(name);
+        uint32_t mask = (uint32_t)m_entries.size() - 1;
+        for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+            Entry& entry = m_entries[i];
+            if (entry.location == -1) {
+                entry.hash = hash;
+                entry.nameOffset = (uint32_t)m_names.size();
+                entry.location = location;
+                m_names.append(name);
+                m_names.push_back('\0');
+                ++m_count;
+                return;
+            }
+            if (entry.hash == hash && std::strcmp(m_names.c_str() + entry.nameOffset, name) == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    void build(unsigned int program) {
+        GLint uniformCount = 0, maxNameLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+        // arrays get a second entry without the "[0]" suffix, keep the load factor under one half
+        size_t capacity = 16;
+        while (capacity < (size_t)uniformCount * 4) {
+            capacity *= 2;
+        }
+        m_entries.assign(capacity, Entry());
+        m_names.clear();
+        m_count = 0;
+
+        std::vector<char> name(maxNameLength + 1);
+        for (GLint i = 0; i < uniformCount; ++i) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+            GLint location = glGetUniformLocation(program, name.data());
+            if (location == -1) {
+                // members of uniform blocks have no location
+                continue;
+            }
+            insert(name.data(), location);
+            if (length > 3 && std::strcmp(name.data() + length - 3, "[0]") == 0) {
+                name[length - 3] = '\0';
+                insert(name.data(), location);
+            }
+        }
+    }
+
+    UniformHandle find(const char* name) const {
+        ++rg::uniformLookupCount();
+        UniformHandle handle;
+        if (m_entries.empty()) {
+            return handle;
+        }
+        uint32_t hash = rg::hashUniformName(name);
+        uint32_t mask = (uint32_t)m_entries.size() - 1;
+        for (uint32_t i = hash & mask; m_entries[i].location != -1; i = (i + 1) & mask) {
+            const Entry& entry = m_entries[i];
+            if (entry.hash == hash && std::strcmp(m_names.c_str() + entry.nameOffset, name) == 0) {
+                handle.location = entry.location;
+                break;
+            }
+        }
+        return handle;
+    }
+
+    unsigned size() const {
+        return m_count;
+    }
+};
+
+#endif //PROJECT_BASE_UNIFORMTABLE_H
@@ -0,0 +1,6 @@
+// Per-draw block, written to the stream buffer once for every draw and bound by offset.
+// DrawUniforms in rg/FrameUniforms.h mirrors the std140 layout.
+
+layout (std140) uniform DrawData {
+    mat4 model;
+};
@@ -0,0 +1,39 @@
+// Light types and the per-frame uniform block, shared by every stage that reads the camera or lights.
+// FrameUniforms in rg/FrameUniforms.h mirrors the std140 layout byte for byte.
+
+struct DirLight{
+    vec3 direction;
+    vec3 color;
+};
+
+struct PointLight{
+    float lightConst;
+    float linearConst;
+    float quadraticConst;
+
+    vec3 position;
+    vec3 color;
+};
+
+struct SpotLight{
+    float lightConst;
+    float linearConst;
+    float quadraticConst;
+
+    int spotLightFlag;
+    vec3 position;
+    vec3 direction;
+    vec3 color;
+    float cutOff;
+    float outerCutOff;
+};
+
+// camera and lights, uploaded once per frame
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    DirLight dirLight;
+    PointLight pointLight;
+    SpotLight spotLight;
+};
@@ -0,0 +1,53 @@
+// Visibility of one bounding sphere (xyz centre, w radius), shared by the compute and the transform
+// feedback culling. Frustum first; then, once a depth pyramid exists, the sphere's nearest depth
+// against the farthest depth the pyramid holds over its screen rectangle.
+
+uniform vec4 frustumPlanes[6];
+uniform sampler2D depthPyramid;
+uniform int depthPyramidLevels;     // 0: frustum only
+uniform vec2 depthPyramidSize;      // level 0, in pixels
+uniform mat4 depthViewProjection;   // camera the pyramid was built with
+
+bool insideFrustum(vec4 sphere)
+{
+    for (int i = 0; i < 6; i++) {
+        if (dot(frustumPlanes[i].xyz, sphere.xyz) + frustumPlanes[i].w < -sphere.w)
+            return false;
+    }
+    return true;
+}
+
+bool occluded(vec4 sphere)
+{
+    // screen rectangle and nearest depth of the sphere's box
+    vec3 low = vec3(1e30), high = vec3(-1e30);
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = depthViewProjection * vec4(corner, 1.0);
+        // behind that camera's near plane: no rectangle to test
+        if (clip.w <= 0.0 || clip.z < -clip.w)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        low = min(low, ndc);
+        high = max(high, ndc);
+    }
+    vec2 pixelLow = clamp(low.xy * 0.5 + 0.5, 0.0, 1.0) * depthPyramidSize;
+    vec2 pixelHigh = clamp(high.xy * 0.5 + 0.5, 0.0, 1.0) * depthPyramidSize;
+    float nearest = low.z * 0.5 + 0.5;
+
+    // the level where the rectangle spans at most 2x2 texels
+    vec2 extent = pixelHigh - pixelLow;
+    int level = int(ceil(log2(max(max(extent.x, extent.y), 1.0))));
+    level = clamp(level, 0, depthPyramidLevels - 1);
+    ivec2 levelSize = textureSize(depthPyramid, level);
+    ivec2 a = min(ivec2(pixelLow) >> level, levelSize - 1);
+    ivec2 b = min(ivec2(pixelHigh) >> level, levelSize - 1);
+    float farthest = max(max(texelFetch(depthPyramid, a, level).r, texelFetch(depthPyramid, ivec2(b.x, a.y), level).r),
+                         max(texelFetch(depthPyramid, ivec2(a.x, b.y), level).r, texelFetch(depthPyramid, b, level).r));
+    return nearest > farthest;
+}
+
+bool instanceVisible(vec4 sphere)
+{
+    return insideFrustum(sphere) && (depthPyramidLevels == 0 || !occluded(sphere));
+}
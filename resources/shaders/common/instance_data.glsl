@@ -0,0 +1,13 @@
+// Instances of a batched draw (rg/DrawBatcher.h), indexed by gl_InstanceID. InstanceUniforms in
+// rg/FrameUniforms.h mirrors the std140 layout; MAX_DRAW_INSTANCES is its MAX_INSTANCES.
+
+#define MAX_DRAW_INSTANCES 64
+
+struct DrawInstance {
+    mat4 model;
+    vec4 material;
+};
+
+layout (std140) uniform InstanceData {
+    DrawInstance instances[MAX_DRAW_INSTANCES];
+};
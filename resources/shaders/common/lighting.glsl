@@ -0,0 +1,113 @@
+// Attenuation, the spotlight cone and untextured Phong terms for the three scene lights.
+//
+// SPOT_LIGHT is a permutation key: the program built with SPOT_LIGHT 0 is the one used while the
+// spotlight is switched off, so callers wrap the spotlight term in #if SPOT_LIGHT.
+// The strength and shininess macros below may be defined before the include to tune a surface.
+
+#include "frame_data.glsl"
+
+#ifndef SPOT_LIGHT
+#define SPOT_LIGHT 1
+#endif
+
+#ifndef DIR_AMBIENT_STRENGTH
+#define DIR_AMBIENT_STRENGTH 0.1
+#endif
+#ifndef DIR_SHININESS
+#define DIR_SHININESS 16.0
+#endif
+#ifndef DIR_SPECULAR_STRENGTH
+#define DIR_SPECULAR_STRENGTH 0.2
+#endif
+#ifndef POINT_SHININESS
+#define POINT_SHININESS 32.0
+#endif
+#ifndef POINT_SPECULAR_STRENGTH
+#define POINT_SPECULAR_STRENGTH 0.2
+#endif
+#ifndef SPOT_SHININESS
+#define SPOT_SHININESS 32.0
+#endif
+#ifndef SPOT_SPECULAR_STRENGTH
+#define SPOT_SPECULAR_STRENGTH 0.2
+#endif
+
+float lightAttenuation(float lightConst, float linearConst, float quadraticConst, float distance){
+    return 1.0 / (lightConst + linearConst * distance + quadraticConst * (distance*distance));
+}
+
+float pointLightAttenuation(PointLight pointLight, vec3 fragPos){
+    float distance = length(fragPos - pointLight.position);
+    return lightAttenuation(pointLight.lightConst, pointLight.linearConst, pointLight.quadraticConst, distance);
+}
+
+float spotLightAttenuation(SpotLight spotLight, vec3 fragPos){
+    float distance = length(fragPos - spotLight.position);
+    return lightAttenuation(spotLight.lightConst, spotLight.linearConst, spotLight.quadraticConst, distance);
+}
+
+// soft edge between cutOff and outerCutOff, lightDir points from the light to the fragment
+float spotLightIntensity(SpotLight spotLight, vec3 lightDir){
+    float cosTheta = dot(lightDir, normalize(spotLight.direction));
+    if(cosTheta <= spotLight.outerCutOff){
+        return 0.0;
+    }
+    float epsilon = spotLight.cutOff - spotLight.outerCutOff;
+    return clamp((cosTheta - spotLight.outerCutOff)/epsilon, 0.0, 1.0);
+}
+
+vec3 calculateDirLight(DirLight dirLight, vec3 fragPos, vec3 viewPos, vec3 norm){
+    //light beam direction for each fragment
+    vec3 lightDir = normalize(dirLight.direction);
+
+    //ambient
+    vec3 ambient = DIR_AMBIENT_STRENGTH * dirLight.color;
+
+    //diffuse
+    float diff = max(dot(-lightDir, norm),0.0);
+    vec3 diffuse = diff * dirLight.color;
+
+    //specular
+    vec3 reflectDir = reflect(lightDir, norm);
+    vec3 viewDir = normalize(fragPos - viewPos);
+    float spec = pow(max(dot(-viewDir, reflectDir), 0.0), DIR_SHININESS);
+    vec3 specular = DIR_SPECULAR_STRENGTH * dirLight.color * spec;
+
+    return ambient + diffuse + specular;
+}
+
+vec3 calculatePointLight(PointLight pointLight, vec3 fragPos, vec3 viewPos, vec3 norm){
+    //light beam direction for each fragment
+    vec3 lightDir = normalize(fragPos - pointLight.position);
+    float attenuation = pointLightAttenuation(pointLight, fragPos);
+
+    //diffuse
+    float diff = max(dot(-lightDir, norm),0.0);
+    vec3 diffuse = diff * pointLight.color * attenuation;
+
+    //specular
+    vec3 reflectDir = reflect(-lightDir, norm);
+    vec3 viewDir = normalize(fragPos - viewPos);
+    float spec = pow(max(dot(-viewDir, reflectDir), 0.0), POINT_SHININESS);
+    vec3 specular = POINT_SPECULAR_STRENGTH * pointLight.color * spec * attenuation;
+
+    return diffuse + specular;
+}
+
+vec3 calculateSpotLight(SpotLight spotLight, vec3 fragPos, vec3 viewPos, vec3 norm){
+    //light beam direction for each fragment
+    vec3 lightDir = normalize(fragPos - spotLight.position);
+    float attenuation = spotLightAttenuation(spotLight, fragPos);
+
+    //diffuse
+    float diff = max(dot(-lightDir, norm),0.0);
+    vec3 diffuse = diff * spotLight.color * attenuation;
+
+    //specular
+    vec3 reflectDir = reflect(-lightDir, norm);
+    vec3 viewDir = normalize(fragPos - viewPos);
+    float spec = pow(max(dot(-viewDir, reflectDir), 0.0), SPOT_SHININESS);
+    vec3 specular = SPOT_SPECULAR_STRENGTH * spotLight.color * spec * attenuation;
+
+    return (diffuse + specular) * spotLightIntensity(spotLight, lightDir);
+}
@@ -2,9 +2,9 @@
 
 out vec4 FragColor;
 
-uniform vec3 lightColor;
+flat in vec4 material;
 
 void main()
 {
-    FragColor = vec4(lightColor, 1.0f);
+    FragColor = vec4(material.rgb, 1.0f);
 }
\ No newline at end of file
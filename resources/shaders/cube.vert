@@ -2,12 +2,17 @@
 
 layout (location = 0 ) in vec3 aPos;
 
-uniform mat4 view;
-uniform mat4 model;
-uniform mat4 projection;
 
+#include "common/frame_data.glsl"
+
+#include "common/instance_data.glsl"
+
+// rgb: light colour
+flat out vec4 material;
 
 void main()
 {
+    mat4 model = instances[gl_InstanceID].model;
+    material = instances[gl_InstanceID].material;
     gl_Position = projection * view * model * vec4(aPos, 1.0f);
 }
\ No newline at end of file
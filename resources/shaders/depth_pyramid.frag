@@ -0,0 +1,22 @@
+#version 330 core
+// One depth pyramid level from the one above it, which is the only level sourceLevel can read.
+uniform sampler2D sourceLevel;
+
+void main()
+{
+    ivec2 sourceSize = textureSize(sourceLevel, 0);
+    ivec2 texel = ivec2(gl_FragCoord.xy) * 2;
+    // a source side of 1 is read twice, an odd one folds its last row/column into the last texel
+    ivec2 last = min(texel + 1, sourceSize - 1);
+    ivec2 extra = ivec2(texel.x + 3 == sourceSize.x ? texel.x + 2 : last.x, texel.y + 3 == sourceSize.y ? texel.y + 2 : last.y);
+
+    float depth = 0.0;
+    for (int y = 0; y < 3; y++) {
+        int sy = y == 0 ? texel.y : (y == 1 ? last.y : extra.y);
+        for (int x = 0; x < 3; x++) {
+            int sx = x == 0 ? texel.x : (x == 1 ? last.x : extra.x);
+            depth = max(depth, texelFetch(sourceLevel, ivec2(sx, sy), 0).r);
+        }
+    }
+    gl_FragDepth = depth;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+// Transform feedback culling, one point per instance. The geometry shader passes on the survivors.
+layout (location = 0) in vec4 aSphere;
+layout (location = 1) in mat4 aInstanceMatrix;
+
+#include "common/instance_cull.glsl"
+
+out mat4 vInstanceMatrix;
+flat out int vVisible;
+
+void main()
+{
+    vInstanceMatrix = aInstanceMatrix;
+    vVisible = instanceVisible(aSphere) ? 1 : 0;
+}
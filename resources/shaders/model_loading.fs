@@ -7,54 +7,27 @@ in vec3 fragPos;
 uniform sampler2D diffuse_texture1;
 uniform sampler2D specular_texture1;
 
-uniform vec3 viewPos;
 uniform vec3 lightPosition;
 
 out vec4 fragColor;
 
-struct DirLight{
-    vec3 direction;
-    vec3 color;
-};
-
-struct PointLight{
-    float lightConst;
-    float linearConst;
-    float quadraticConst;
-
-    vec3 position;
-    vec3 color;
-};
-
-struct SpotLight{
-    float lightConst;
-    float linearConst;
-    float quadraticConst;
-
-    int spotLightFlag;
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float cutOff;
-    float outerCutOff;
-};
-
-uniform DirLight dirLight;
-uniform PointLight pointLight;
-uniform SpotLight spotLight;
-
-vec3 calculateDirLight(DirLight dirLight, vec3 fragPos, vec3 viewPos, vec3 norm);
-vec3 calculatePointLight(PointLight pointLight, vec3 fragPos, vec3 viewPos, vec3 norm);
-vec3 calculateSpotLight(SpotLight spotLight, vec3 fragPos, vec3 viewPos, vec3 norm);
+#include "common/lighting.glsl"
+
+//the backpack samples its own diffuse and specular maps, so it has textured versions of the light terms
+vec3 calculateTexturedDirLight(DirLight dirLight, vec3 fragPos, vec3 viewPos, vec3 norm);
+vec3 calculateTexturedPointLight(PointLight pointLight, vec3 fragPos, vec3 viewPos, vec3 norm);
+vec3 calculateTexturedSpotLight(SpotLight spotLight, vec3 fragPos, vec3 viewPos, vec3 norm);
 
 void main()
 {
     vec3 norm = normalize(aNormal);
 
     vec3 result = vec3(0.0);
-    result += calculateDirLight(dirLight, fragPos, viewPos, norm);
-    result += calculatePointLight(pointLight, fragPos, viewPos, norm);
-    result += calculateSpotLight(spotLight, fragPos, viewPos, norm);
+    result += calculateTexturedDirLight(dirLight, fragPos, viewPos, norm);
+    result += calculateTexturedPointLight(pointLight, fragPos, viewPos, norm);
+#if SPOT_LIGHT
+    result += calculateTexturedSpotLight(spotLight, fragPos, viewPos, norm);
+#endif
 
     //Strange behaviour of gamma correction :|
     //result = pow(result,vec3(1.0/2.2));
@@ -62,14 +35,11 @@ void main()
     fragColor = vec4(result, 1.0f);
 }
 
-vec3 calculateSpotLight(SpotLight spotLight, vec3 fragPos, vec3 viewPos, vec3 norm){
+vec3 calculateTexturedSpotLight(SpotLight spotLight, vec3 fragPos, vec3 viewPos, vec3 norm){
 
     //light beam direction for each fragment
     vec3 lightDir = normalize(fragPos - spotLight.position);
-
-    //attenuation calclutation
-    float distance = length(fragPos - spotLight.position); //not using lightDir because lightDir is normalized
-    float attenuation = 1.0 / (spotLight.lightConst + spotLight.linearConst * distance + spotLight.quadraticConst * (distance*distance));
+    float attenuation = spotLightAttenuation(spotLight, fragPos);
 
     //diffuse
     float diff = max(dot(-lightDir, norm),0.0);
@@ -87,27 +57,13 @@ vec3 calculateSpotLight(SpotLight spotLight, vec3 fragPos, vec3 viewPos, vec3 no
     vec3 specular = specularStrength * spotLight.color * spec * texture(specular_texture1, texCords).rgb;
     specular *= attenuation;
 
-    //spot
-    float cosTheta = dot(lightDir, normalize(spotLight.direction));
-    float epsilon = spotLight.cutOff - spotLight.outerCutOff;
-    float intensity = clamp((cosTheta - spotLight.outerCutOff)/epsilon, 0.0, 1.0);
-
-    vec3 spot = vec3(0.0);
-
-    if(spotLight.spotLightFlag == 1 && cosTheta > spotLight.outerCutOff){
-        spot += (diffuse + specular) * intensity;
-    }
-
-    return spot;
+    return (diffuse + specular) * spotLightIntensity(spotLight, lightDir);
 }
 
-vec3 calculatePointLight(PointLight pointLight, vec3 fragPos, vec3 viewPos, vec3 norm){
+vec3 calculateTexturedPointLight(PointLight pointLight, vec3 fragPos, vec3 viewPos, vec3 norm){
 
         vec3 lightDir = normalize(fragPos - pointLight.position);
-
-        //attenuation calclutation
-        float distance = length(fragPos - pointLight.position); //not using lightDir because lightDir is normalized
-        float attenuation = 1.0 / (pointLight.lightConst + pointLight.linearConst * distance + pointLight.quadraticConst * (distance*distance));
+        float attenuation = pointLightAttenuation(pointLight, fragPos);
 
         //ambient
         float ambientStrength = 0.2;
@@ -132,7 +88,7 @@ vec3 calculatePointLight(PointLight pointLight, vec3 fragPos, vec3 viewPos, vec3
         return point;
 }
 
-vec3 calculateDirLight(DirLight dirLight, vec3 fragPos, vec3 viewPos, vec3 norm){
+vec3 calculateTexturedDirLight(DirLight dirLight, vec3 fragPos, vec3 viewPos, vec3 norm){
     //light beam direction for each fragment
     vec3 lightDir = normalize(dirLight.direction);
 
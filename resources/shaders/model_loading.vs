@@ -7,9 +7,9 @@ layout (location = 2) in vec2 aTexCords;
 out vec3 aNormal;
 out vec2 texCords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/draw_data.glsl"
+
+#include "common/frame_data.glsl"
 
 out vec3 fragPos;
 
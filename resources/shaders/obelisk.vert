@@ -3,14 +3,18 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 normal;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/instance_data.glsl"
+
+#include "common/frame_data.glsl"
 
 out vec3 aNormal;
 out vec3 fragPos;
+// rgb: diffuse colour, a: shininess
+flat out vec4 instanceMaterial;
 void main()
 {
+    mat4 model = instances[gl_InstanceID].model;
+    instanceMaterial = instances[gl_InstanceID].material;
     gl_Position = projection * view * model *  vec4(aPos, 1.0f);
     fragPos = vec3(model * vec4(aPos, 1.0f));
     aNormal = normal;
@@ -8,9 +8,9 @@ out vec3 aNormal;
 out vec3 fragPos;
 out vec2 texCords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/draw_data.glsl"
+
+#include "common/frame_data.glsl"
 
 void main()
 {
@@ -2,12 +2,13 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in mat4 aInstanceMatrix;
+layout (location = 5) in mat4 aInstanceMatrix; // InstancedBatch::FIRST_FREE_LOCATION
 
 out vec2 TexCoords;
 out vec3 Normal;
-uniform mat4 projection;
-uniform mat4 view;
+
+#include "common/frame_data.glsl"
+
 out vec3 fragPos;
 void main()
 {
@@ -6,50 +6,22 @@ in vec3 fragPos;
 
 out vec4 fragColor;
 
-uniform vec3 viewPos;
-
 struct Material{
     sampler2D diffuse;
     sampler2D specular;
-    float shininess;
-};
-
-struct DirLight{
-    vec3 direction;
-    vec3 color;
 };
 
-struct PointLight{
-    float lightConst;
-    float linearConst;
-    float quadraticConst;
-
-    vec3 position;
-    vec3 color;
-};
+uniform Material material;
 
-struct SpotLight{
-    float lightConst;
-    float linearConst;
-    float quadraticConst;
-
-    int spotLightFlag;
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float cutOff;
-    float outerCutOff;
-};
+// x: shininess, per box
+flat in vec4 instanceMaterial;
 
-uniform Material material;
-uniform DirLight dirLight;
-uniform PointLight pointLight;
-uniform SpotLight spotLight;
+#include "common/lighting.glsl"
 
-vec3 calculateDirLight(DirLight dirLight, Material materijal, vec3 fragPos, vec3 viewPos, vec3 norm);
+vec3 calculateDirLight(DirLight dirLight, Material material, vec3 fragPos, vec3 viewPos, vec3 norm);
 vec3 calculatePointLight(PointLight pointLight, Material material, vec3 fragPos, vec3 viewPos, vec3 norm);
 vec3 calculateSpotLight(SpotLight spotLight, Material material, vec3 fragPos, vec3 viewPos, vec3 norm);
-vec3 calculateDirLightSpecular(DirLight dirLight, Material materijal, vec3 fragPos, vec3 viewPos, vec3 norm);
+vec3 calculateDirLightSpecular(DirLight dirLight, Material material, vec3 fragPos, vec3 viewPos, vec3 norm);
 vec3 calculatePointLightSpecular(PointLight pointLight, Material material, vec3 fragPos, vec3 viewPos, vec3 norm);
 vec3 calculateSpotLightSpecular(SpotLight spotLight, Material material, vec3 fragPos, vec3 viewPos, vec3 norm);
 
@@ -65,14 +37,18 @@ void main()
 
     result += calculateDirLight(dirLight, material, fragPos, viewPos, norm);
     result += calculatePointLight(pointLight, material, fragPos, viewPos, norm);
+#if SPOT_LIGHT
     result += calculateSpotLight(spotLight, material, fragPos, viewPos, norm);
+#endif
 
     //gamma correction
     result = pow(result, vec3(1.0/2.2));
 
     result += calculateDirLightSpecular(dirLight, material, fragPos, viewPos, norm);
     result += calculatePointLightSpecular(pointLight, material, fragPos, viewPos, norm);
+#if SPOT_LIGHT
     result += calculateSpotLightSpecular(spotLight, material, fragPos, viewPos, norm);
+#endif
 
     fragColor = vec4(result, 1.0);
 }
@@ -98,17 +74,11 @@ vec3 calculatePointLight(PointLight pointLight, Material material, vec3 fragPos,
     //light beam direction for each fragment
     vec3 lightDir = normalize(fragPos - pointLight.position);
 
-    //attenuation calclutation
-    float distance = length(fragPos - pointLight.position); //not using lightDir because lightDir is normalized
-    float attenuation = 1.0 / (pointLight.lightConst + pointLight.linearConst * distance + pointLight.quadraticConst * (distance*distance));
-
     //diffuse
     float diff = max(dot(-lightDir, norm),0.0);
     vec3 diffuse = diff * pointLight.color * texture(material.diffuse, texCords).rgb;
-    diffuse *= attenuation;
 
-    vec3 point = diffuse;
-    return point;
+    return diffuse * pointLightAttenuation(pointLight, fragPos);
 }
 
 vec3 calculateSpotLight(SpotLight spotLight, Material material, vec3 fragPos, vec3 viewPos, vec3 norm){
@@ -116,27 +86,12 @@ vec3 calculateSpotLight(SpotLight spotLight, Material material, vec3 fragPos, ve
     //light beam direction for each fragment
     vec3 lightDir = normalize(fragPos - spotLight.position);
 
-    //attenuation calclutation
-    float distance = length(fragPos - spotLight.position); //not using lightDir because lightDir is normalized
-    float attenuation = 1.0 / (spotLight.lightConst + spotLight.linearConst * distance + spotLight.quadraticConst * (distance*distance));
-
     //diffuse
     float diff = max(dot(-lightDir, norm),0.0);
     vec3 diffuse = diff * spotLight.color * texture(material.diffuse, texCords).rgb;
-    diffuse *= attenuation;
+    diffuse *= spotLightAttenuation(spotLight, fragPos);
 
-    //spot
-    float cosTheta = dot(lightDir, normalize(spotLight.direction));
-    float epsilon = spotLight.cutOff - spotLight.outerCutOff;
-    float intensity = clamp((cosTheta - spotLight.outerCutOff)/epsilon, 0.0, 1.0);
-
-    vec3 spot = vec3(0.0, 0.0, 0.0);
-
-    if(spotLight.spotLightFlag == 1 && cosTheta > spotLight.outerCutOff){
-        spot = diffuse * intensity;
-    }
-
-    return spot;
+    return diffuse * spotLightIntensity(spotLight, lightDir);
 }
 
 vec3 calculateDirLightSpecular(DirLight dirLight, Material material, vec3 fragPos, vec3 viewPos, vec3 norm){
@@ -146,7 +101,7 @@ vec3 calculateDirLightSpecular(DirLight dirLight, Material material, vec3 fragPo
     //specular
     vec3 viewDir = normalize(fragPos - viewPos);
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(-viewDir, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(-viewDir, reflectDir), 0.0), instanceMaterial.x);
 
     float specularStrength = 0.5;
     vec3 specular = specularStrength * dirLight.color * texture(material.specular, texCords).rgb * spec;
@@ -160,22 +115,16 @@ vec3 calculatePointLightSpecular(PointLight pointLight, Material material, vec3
     //light beam direction for each fragment
     vec3 lightDir = normalize(fragPos - pointLight.position);
 
-    //attenuation calclutation
-    float distance = length(fragPos - pointLight.position); //not using lightDir because lightDir is normalized
-    float attenuation = 1.0 / (pointLight.lightConst + pointLight.linearConst * distance + pointLight.quadraticConst * (distance*distance));
-
     //specular
     float specularStrength = 0.5;
 
     vec3 viewDir = normalize(fragPos - viewPos);
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(1.0 - max(dot(-viewDir, reflectDir), 0.0), material.shininess);
+    float spec = pow(1.0 - max(dot(-viewDir, reflectDir), 0.0), instanceMaterial.x);
 
     vec3 specular = specularStrength * pointLight.color * spec * texture(material.specular, texCords).rgb;
-    specular *= attenuation;
 
-    vec3 point = specular;
-    return point;
+    return specular * pointLightAttenuation(pointLight, fragPos);
 }
 
 vec3 calculateSpotLightSpecular(SpotLight spotLight, Material material, vec3 fragPos, vec3 viewPos, vec3 norm){
@@ -183,32 +132,15 @@ vec3 calculateSpotLightSpecular(SpotLight spotLight, Material material, vec3 fra
     //light beam direction for each fragment
     vec3 lightDir = normalize(fragPos - spotLight.position);
 
-    //attenuation calclutation
-    float distance = length(fragPos - spotLight.position); //not using lightDir because lightDir is normalized
-    float attenuation = 1.0 / (spotLight.lightConst + spotLight.linearConst * distance + spotLight.quadraticConst * (distance*distance));
-
     //specular
     float specularStrength = 0.5;
 
     vec3 viewDir = normalize(fragPos - viewPos);
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(1.0 - max(dot(-viewDir, reflectDir), 0.0), material.shininess);
+    float spec = pow(1.0 - max(dot(-viewDir, reflectDir), 0.0), instanceMaterial.x);
 
     vec3 specular = specularStrength * spotLight.color * spec * texture(material.specular, texCords).rgb;
-    specular *= attenuation;
+    specular *= spotLightAttenuation(spotLight, fragPos);
 
-    //spot
-    float cosTheta = dot(lightDir, normalize(spotLight.direction));
-    float epsilon = spotLight.cutOff - spotLight.outerCutOff;
-    float intensity = clamp((cosTheta - spotLight.outerCutOff)/epsilon, 0.0, 1.0);
-    float spotDistance = length(spotLight.position - fragPos);
-    float spotAttenuation = 1.0 / (spotLight.lightConst + spotLight.linearConst * spotDistance + spotLight.quadraticConst * (spotDistance*spotDistance));
-
-    vec3 spot = vec3(0.0, 0.0, 0.0);
-
-    if(spotLight.spotLightFlag == 1 && cosTheta > spotLight.outerCutOff){
-        spot = specular * intensity;
-    }
-
-    return spot;
-}
\ No newline at end of file
+    return specular * spotLightIntensity(spotLight, lightDir);
+}
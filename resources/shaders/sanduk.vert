@@ -7,14 +7,19 @@ layout (location = 2) in vec2 aTexCords;
 out vec3 aNormal;
 out vec2 texCords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/instance_data.glsl"
+
+// x: shininess
+flat out vec4 instanceMaterial;
+
+#include "common/frame_data.glsl"
 
 out vec3 fragPos;
 
 void main()
 {
+    mat4 model = instances[gl_InstanceID].model;
+    instanceMaterial = instances[gl_InstanceID].material;
     aNormal = transpose(inverse(mat3(model))) * normals;
     gl_Position = projection * view * model * vec4(aPos, 1.0);
     texCords = aTexCords;
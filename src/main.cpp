@@ -9,11 +9,42 @@
 #include <learnopengl/model.h>
 #include <stb_image.h>
 #include <rg/Texture2D.h>
+#include <rg/TextureLoader.h>
 #include <rg/Shader.h>
+#include <rg/FrameUniforms.h>
+#include <rg/StreamBuffer.h>
+#include <rg/DrawBatcher.h>
+#include <rg/RenderQueue.h>
+#include <rg/GlState.h>
+#include <rg/ProgramBinary.h>
+#include <rg/AllocationCounter.h>
+#include <rg/Frustum.h>
+#include <rg/DepthPyramid.h>
+#include <rg/GpuCulling.h>
+#include <rg/InstancedBatch.h>
+#include <rg/HeadlessContext.h>
+#include <rg/OffscreenTarget.h>
+#include <rg/PngWriter.h>
+#include <rg/GlMock.h>
+#include <rg/GlTrace.h>
+#include <rg/Profiler.h>
+#include <rg/PerformanceHud.h>
+#include <rg/CameraPath.h>
+#include <rg/Benchmark.h>
+#include <rg/SimulationClock.h>
+#include <rg/InputLog.h>
+#include <rg/SceneFile.h>
+#include <rg/TransformSystem.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <thread>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
-void processInput(GLFWwindow *window);
+void processInput(GLFWwindow *window, glm::vec3 &position, float seconds);
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
@@ -22,16 +53,108 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 const unsigned int SCR_WIDTH = 1980;
 const unsigned int SCR_HEIGHT = 1024;
 
-//firefly lightt
-glm::vec3 lightColor = glm::vec3(0.7f);
-glm::vec3 lightPosition = glm::vec3(1.0f ,0.5f,  -1.0f);
+// --headless: no window, the scene goes to an offscreen framebuffer of a surfaceless context for a number
+// of frames or seconds, and the run ends with frame time statistics
+struct HeadlessOptions {
+    bool enabled = false;
+    int width = 1280, height = 720;
+    // seconds wins when it is set
+    unsigned long frames = 300;
+    double seconds = 0.0;
+    // PNGs of every dumpEvery-th frame, or of the last one when it is 0; none without a directory
+    std::string dumpDirectory;
+    unsigned long dumpEvery = 0;
+};
+HeadlessOptions headless;
+
+// --trace=FILE records every GL call (include/rg/GlTrace.h), --mock-gl runs headless against GlMock with
+// no driver at all, counting the calls without a file (--stats prints the counts)
+struct TraceOptions {
+    std::string path;
+    bool mock = false;
+};
+TraceOptions traceOptions;
+
+// --profile=FILE writes the profiling zones as Chrome trace events (include/rg/Profiler.h)
+std::string profilePath;
+
+// --hud: the performance HUD and tuning panel, F1 shows it (include/rg/PerformanceHud.h)
+bool hudEnabled = false;
+PerformanceHud* performanceHud = nullptr;
+
+// --stats prints culling, batching, render queue, GL state and stream buffer counts once a second
+bool statsEnabled = false;
+// what its panel switches; without it everything stays on, at full resolution
+HudTuning tuning;
+
+// --benchmark flies benchmarkPath() on a fixed clock (include/rg/Benchmark.h)
+BenchmarkOptions benchmark;
+BenchmarkRun* benchmarkRun = nullptr;
+
+// Movement and animation step SIMULATION_STEP seconds at a time (include/rg/SimulationClock.h), frames
+// draw between the last two states. --time-scale=S simulates S seconds a real one, --max-fps=N draws at
+// most N frames a second.
+const double SIMULATION_STEP = 1.0 / 120.0;
+struct SimulationOptions {
+    double timeScale = 1.0;
+    double maxFps = 0.0;
+};
+SimulationOptions simulationOptions;
+
+// what the simulation moves
+struct SimulationState {
+    glm::vec3 cameraPos;
+    glm::vec3 lightPosition;
+};
+
+// The callbacks queue their events here, each simulation step applies them with applyInput
+// (include/rg/InputLog.h). --record-input=FILE writes them down, --replay-input=FILE plays FILE back instead.
+struct InputLogOptions {
+    std::string record;
+    std::string replay;
+};
+InputLogOptions inputOptions;
+InputLog inputLog;
+
+// --scene=FILE: what is drawn where, and the lights (include/rg/SceneFile.h); resources/scenes/desert.scene
+// without it
+std::string scenePath;
+
+// frame times of a headless run
+struct HeadlessRun {
+    double start = 0.0;
+    bool finished = false;
+    unsigned long frames = 0;
+    double total = 0.0, shortest = 0.0, longest = 0.0;
+
+    bool done(const HeadlessOptions &options, unsigned long frame, double time) const {
+        return options.seconds > 0.0 ? time - start >= options.seconds : frame >= options.frames;
+    }
 
-//sunlight
-glm::vec3 sunLightDirection = glm::vec3(glm::rotate(glm::mat4(1.0f), glm::radians(75.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(-1.0f, -2.0f, -1.0f, 1.0f));
-glm::vec3 sunLightColor = glm::vec3(0.2f);
+    void frameTime(double seconds) {
+        shortest = frames == 0 || seconds < shortest ? seconds : shortest;
+        longest = seconds > longest ? seconds : longest;
+        total += seconds;
+        ++frames;
+    }
 
-//sky color
-glm::vec3 skyColor = glm::vec3(0.2, 0.5, 0.4);
+    void report(double time, int width, int height) const {
+        double average = frames ? total / frames : 0.0;
+        std::cout << "headless: " << frames << " frames at " << width << "x" << height << " in " << time - start
+                  << " s, frame time avg " << average * 1000.0 << " ms, min " << shortest * 1000.0 << " ms, max "
+                  << longest * 1000.0 << " ms, " << (average > 0.0 ? 1.0 / average : 0.0) << " fps on "
+                  << glGetString(GL_RENDERER) << std::endl;
+    }
+};
+
+// glfwGetProcAddress, or eglGetProcAddress when headless
+GLADloadproc glLoader = nullptr;
+
+//sky, sun, firefly and spotlight, from the scene file
+SceneFile::Lights lights;
+
+//firefly lightt
+glm::vec3 lightPosition = glm::vec3(1.0f ,0.5f,  -1.0f);
 
 //cullface - press c to change
 bool cullFaceEnabled = true;
@@ -39,12 +162,10 @@ bool cullFaceEnabled = true;
 //beams - press l to cast
 bool beams = false;
 
-//rocks instancing
-unsigned int amount = 500;
-glm::mat4* modelMatrices = new glm::mat4[amount];
-float radius = 80.0;
-float offset = 35.0f;
-unsigned int buffer;
+//instancing groups - culled on the GPU against the frustum and the depth of the frame before, when
+//their culler is up; press g to compare with the CPU
+const DepthPyramid* instanceOccluders = nullptr;
+bool gpuCulling = true;
 
 //camera
 glm::vec3 cameraPos = glm::vec3(0.0, 1.0, 4.0);
@@ -52,13 +173,7 @@ glm::vec3 cameraFront = glm::vec3(0.0, 0.0, -1.0);
 glm::vec3 cameraUp = glm::vec3(0.0, 1.0, 0.0);
 float cameraSpeedParameter = 10.0;
 
-//light distance constants
-float lightConst = 1.0f;
-float linearConst = 0.08;
-float quadraticConst = 0.032f;
-
 //spotlight
-glm::vec3 spotlightColor = glm::vec3(1.0f);
 int spotLightFlag = 1;
 
 //day and night
@@ -78,32 +193,775 @@ float fov = 45.0f;
 // -------------------------------------------------------
 
 
-void renderBackpack(shader backpackShader, Model backpackModel, glm::mat4 view, glm::mat4 projection);
-void renderRocks(shader rockShader, Model rockModel, glm::mat4 view, glm::mat4 projection);
-void generateRocks(Model rockModel);
-void renderPyramid(Shader pyramidShader, Texture2D pyramidTexture, unsigned VAO, glm::mat4 model, glm::mat4 view, glm::mat4 projection);
-void renderGround(Shader groundShader, Texture2D groundTexture, std::string texUniformName, unsigned int VAO, glm::mat4 view,
-                  glm::mat4 projection);
-void renderFirefly(Shader fireflyShader, unsigned VAO, glm::mat4 view, glm::mat4 projection);
-void renderBox(Shader boxShader, unsigned VAO, Texture2D woodTexture, std::string woodTexUniformName,
-               Texture2D metalTexture, std::string metalTexUniformName, glm::mat4 model, glm::mat4 view, glm::mat4 projection);
-void renderBoxes(Shader boxShader, unsigned VAO, Texture2D woodTexture, Texture2D metalTexture, glm::mat4 view, glm::mat4 projection);
-void renderBeams(Shader obeliskShader, unsigned VAO, glm::mat4 view, glm::mat4 projection);
+// Per-object uniform handles of one program, resolved once after linking. Camera and lights come from the
+// FrameData block and the model matrix from DrawData instead. Uniforms a program doesn't have stay at -1
+// and glUniform* ignores them.
+struct ObjectUniforms {
+    UniformHandle lightColor, texture;
+    UniformHandle materialAmbient, materialDiffuse, materialSpecular, materialShininess;
+};
+
+template <typename ShaderProgram>
+ObjectUniforms resolveObjectUniforms(const ShaderProgram &program, const char *textureName = "") {
+    ObjectUniforms u;
+    u.lightColor = program.uniform("lightColor");
+    u.texture = program.uniform(textureName);
+
+    u.materialAmbient = program.uniform("material.ambient");
+    u.materialDiffuse = program.uniform("material.diffuse");
+    u.materialSpecular = program.uniform("material.specular");
+    u.materialShininess = program.uniform("material.shininess");
+    return u;
+}
 
-void renderPyramids(Shader pyramidShader, unsigned VAO, Texture2D pyramidTexture, glm::mat4 view, glm::mat4 projection);
+// One program per spotLightFlag value. [0] is built with SPOT_LIGHT 0, which compiles the spotlight term out
+// of the fragment shader, [1] with SPOT_LIGHT 1. Rendering picks the variant instead of branching per fragment.
+template <typename ShaderProgram>
+struct SpotLightVariants {
+    ShaderProgram variants[2];
+    ObjectUniforms variantUniforms[2];
+
+    SpotLightVariants(const std::string &vertexPath, const std::string &fragmentPath, const char *textureName = "")
+    : variants{ShaderProgram(vertexPath.c_str(), fragmentPath.c_str(), ShaderDefines().set("SPOT_LIGHT", 0)),
+               ShaderProgram(vertexPath.c_str(), fragmentPath.c_str(), ShaderDefines().set("SPOT_LIGHT", 1))} {
+        for (int i = 0; i < 2; i++) {
+            variantUniforms[i] = resolveObjectUniforms(variants[i], textureName);
+        }
+    }
+
+    void bindUniformBlock(const char *name, GLuint binding) const {
+        for (const ShaderProgram &variant : variants) {
+            variant.bindUniformBlock(name, binding);
+        }
+    }
+
+    const ShaderProgram &program(int spotLightFlag) const {
+        return variants[spotLightFlag != 0];
+    }
+
+    const ObjectUniforms &uniforms(int spotLightFlag) const {
+        return variantUniforms[spotLightFlag != 0];
+    }
+};
+
+// One of the scene file's instancing groups: its model drawn instanced with the rock program, every
+// instance tested against the frustum on the CPU, or on the GPU by its culler.
+struct InstanceGroup {
+    const SceneFile::Group &record;
+    const Model &model;
+    InstancedBatch batch;
+    // world space spheres of the instances, and the frame's survivors of the CPU test, packed in buffer
+    BoundingSpheres bounds;
+    std::vector<uint32_t> visible;
+    std::vector<glm::mat4> visibleMatrices;
+    GLuint buffer = 0;
+    // where an explicit group is sorted from; a ring is sorted as if it were all on the ring
+    glm::vec3 center = glm::vec3(0.0f);
+    InstanceCuller* culler = nullptr;
+
+    InstanceGroup(const SceneFile::Group &record, const Model &model)
+    : record(record), model(model), batch(model, record.ringCount + record.instanceCount) {}
+
+    ~InstanceGroup() {
+        glDeleteBuffers(1, &buffer);
+    }
+
+    InstanceGroup(const InstanceGroup&) = delete;
+    InstanceGroup& operator=(const InstanceGroup&) = delete;
+};
+
+// The scene file's objects and the firefly as entities. Their world matrices are composed once, and
+// again only for what moved since, which is the firefly.
+struct SceneEntities {
+    TransformSystem transforms;
+    // by the scene file's object index
+    std::vector<Entity> objects;
+    Entity firefly = NO_ENTITY;
+
+    glm::mat4 world(const SceneDescription &description, const SceneFile::Object &object) const {
+        return transforms.world(objects[description.index(&object)]);
+    }
+};
+
+// Every GL resource the scene uses. Created once after the context is up, destroyed before it goes away;
+// render functions only ever borrow from it.
+struct SceneResources {
+    const SceneDescription &description;
+
+    Shader obeliskShader;
+    Shader fireflyShader;
+    SpotLightVariants<Shader> boxShaders;
+    SpotLightVariants<Shader> pyramidShaders;
+    SpotLightVariants<Shader> groundShaders;
+    SpotLightVariants<shader> modelShaders;
+    SpotLightVariants<shader> rockShaders;
+
+    // the scene file's, in its order
+    std::vector<Texture2D> textures;
+    std::vector<Model> models;
+    std::vector<std::unique_ptr<InstanceGroup>> groups;
+    SceneEntities entities;
+
+    ObjectUniforms obeliskUniforms;
+
+    // FrameData and every draw's DrawData, written once and bound by offset
+    StreamBuffer stream;
+    // the cube draws (firefly, boxes, beams), merged into instanced ones
+    DrawBatcher batcher;
+    // every draw of the frame, issued in state order once the scene is submitted
+    RenderQueue queue;
+
+    unsigned cubeVAO = 0, cubeVBO = 0;
+    unsigned VAOs[2] = {0, 0}, VBOs[2] = {0, 0};
+    // object space boxes of the hard-coded meshes
+    AABB pyramidBounds, groundBounds, cubeBounds;
+
+    explicit SceneResources(const SceneDescription &description);
+    ~SceneResources();
+
+    SceneResources(const SceneResources&) = delete;
+    SceneResources& operator=(const SceneResources&) = delete;
+};
+
+// Objects outside the frustum are skipped; every render function counts what it tested and drew in stats.
+struct CullContext {
+    Frustum frustum;
+    CullStats stats;
+
+    bool visible(const AABB &bounds, const glm::mat4 &model) {
+        return stats.count(!tuning.frustumCulling || frustum.intersects(bounds.transformed(model)));
+    }
+};
+
+void renderModels(const shader &modelShader, const SceneDescription &description, const SceneEntities &entities,
+                  const std::vector<Model> &models, StreamBuffer &stream, RenderQueue &queue, CullContext &cull);
+void renderGroups(const shader &rockShader, std::vector<std::unique_ptr<InstanceGroup>> &groups, RenderQueue &queue,
+                  CullContext &cull);
+void renderGroup(const shader &rockShader, InstanceGroup &group, RenderQueue &queue, CullContext &cull);
+void generateInstances(InstanceGroup &group);
+void renderPyramid(const Shader &pyramidShader, const Texture2D &pyramidTexture, unsigned VAO, const glm::mat4 &model,
+                   bool cullFace, StreamBuffer &stream, RenderQueue &queue);
+void renderGround(const Shader &groundShader, const SceneDescription &description, const SceneEntities &entities,
+                  const std::vector<Texture2D> &textures, unsigned int VAO, const AABB &bounds, StreamBuffer &stream,
+                  RenderQueue &queue, CullContext &cull);
+void renderFirefly(const Shader &fireflyShader, unsigned VAO, const SceneEntities &entities, const AABB &bounds,
+                   DrawBatcher &batcher, CullContext &cull);
+void renderBox(const Shader &boxShader, unsigned VAO, const Texture2D &woodTexture,
+               const Texture2D &metalTexture, const glm::mat4 &model, DrawBatcher &batcher);
+void renderBoxes(const Shader &boxShader, unsigned VAO, const SceneDescription &description, const SceneEntities &entities,
+                 const std::vector<Texture2D> &textures, const AABB &bounds, DrawBatcher &batcher, CullContext &cull);
+void renderBeams(const Shader &obeliskShader, unsigned VAO, const SceneDescription &description, const SceneEntities &entities,
+                 const AABB &bounds, DrawBatcher &batcher, CullContext &cull);
+
+void renderPyramids(const Shader &pyramidShader, unsigned VAO, const SceneDescription &description,
+                    const SceneEntities &entities, const std::vector<Texture2D> &textures, const AABB &bounds,
+                    StreamBuffer &stream, RenderQueue &queue, CullContext &cull);
+
+// The entity of the scene file's object i, made after its parent's.
+Entity createEntity(const SceneDescription &description, uint32_t i, SceneEntities &entities);
+
+// The texture the scene file gave an object.
+const Texture2D& objectTexture(const SceneDescription &description, const std::vector<Texture2D> &textures,
+                               const SceneFile::Object &object, int slot);
 
 void initLoop();
 
-void renderScene(Shader pyramidShader, Texture2D pyramidTexture,
-                 Shader groundShader, Texture2D groundTexture, unsigned VAOs[],
-                 Shader fireflyShader, unsigned cubeVAO,
-                 Shader boxShader, Texture2D woodTexture, Texture2D metalTexture,
-                 Shader obeliskShader,
-                 shader backpackShader, Model backpackModel,
-                 shader rockShader, Model rockModel,
-                 glm::mat4 view, glm::mat4 projection);
+void updateFrameUniforms(FrameUniforms &frameData, const glm::mat4 &view, const glm::mat4 &projection);
+
+void renderScene(SceneResources &scene, CullContext &cull);
+
+bool writeDrawUniforms(RenderCommand &command, StreamBuffer &stream, const glm::mat4 &model);
+
+bool parseOptions(int argc, char **argv, HeadlessOptions &options, TraceOptions &trace, std::string &profile, bool &hud,
+                  bool &stats, BenchmarkOptions &bench, SimulationOptions &simulation, InputLogOptions &input,
+                  std::string &scene);
+
+void printFrameStats(unsigned long frame, const CullStats &cull, SceneResources &scene);
+
+GLFWwindow* createWindow();
+
+double now();
+
+void simulate(SimulationState &state, double time, float seconds, GLFWwindow *window);
+
+SimulationState interpolate(const SimulationState &from, const SimulationState &to, float alpha);
+
+void applyInput(const InputEvent &event);
+
+void reportInput(const char *what, uint64_t step, const SimulationState &state);
+
+CameraPath benchmarkPath();
+
+std::string buildDescription();
+
+int main(int argc, char **argv) {
+    if (!parseOptions(argc, argv, headless, traceOptions, profilePath, hudEnabled, statsEnabled, benchmark, simulationOptions,
+                      inputOptions, scenePath)) {
+        return -1;
+    }
+    if (benchmark.enabled && hudEnabled) {
+        std::cout << "ERROR::BENCHMARK::HUD the HUD's own draws would be measured with the scene's" << std::endl;
+        return -1;
+    }
+    if (!inputOptions.record.empty() && (headless.enabled || !inputOptions.replay.empty())) {
+        std::cout << "ERROR::INPUT_LOG::NO_INPUT a recording needs a window and live input" << std::endl;
+        return -1;
+    }
+    if (!inputOptions.replay.empty() && benchmark.enabled) {
+        std::cout << "ERROR::INPUT_LOG::BENCHMARK a benchmark flies its own camera" << std::endl;
+        return -1;
+    }
+    // the rock field a replay saw is the one its recording saw
+    int64_t recordedSeed = -1;
+    if (!inputOptions.replay.empty()) {
+        if (!inputLog.replay(inputOptions.replay, SIMULATION_STEP, recordedSeed)) {
+            return -1;
+        }
+        benchmark.seed = (long)recordedSeed;
+    }
+    if (benchmark.seed < 0) {
+        benchmark.seed = benchmark.enabled ? 1 : (long)(unsigned)now();
+    }
+    if (!inputOptions.record.empty() && !inputLog.record(inputOptions.record, SIMULATION_STEP, benchmark.seed)) {
+        return -1;
+    }
+    if (hudEnabled && headless.enabled) {
+        std::cout << "hud: there is no window to show it in, running without it" << std::endl;
+        hudEnabled = false;
+    }
+    if (hudEnabled && !traceOptions.path.empty()) {
+        std::cout << "ERROR::HUD::TRACING the HUD's own calls would end up in the trace" << std::endl;
+        return -1;
+    }
+
+    // read before any window opens, so a broken scene file fails right away
+    SceneDescription sceneDescription;
+    if (!sceneDescription.load(scenePath.empty() ? FileSystem::getPath("resources/scenes/desert.scene") : scenePath)) {
+        return -1;
+    }
+    lights = sceneDescription.lights();
+    std::cout << "scene: " << sceneDescription.objectCount() << " object(s), " << sceneDescription.groupCount()
+              << " instancing group(s), " << sceneDescription.size() << " bytes" << std::endl;
+
+    GLFWwindow *window = nullptr;
+    HeadlessContext headlessContext;
+    if (traceOptions.mock) {
+        glLoader = (GLADloadproc) GlMock::loadFunction;
+    } else if (headless.enabled) {
+        if (!headlessContext.create()) {
+            return -1;
+        }
+        glLoader = (GLADloadproc) HeadlessContext::loadFunction;
+    } else {
+        window = createWindow();
+        if (window == NULL) {
+            return -1;
+        }
+        glLoader = (GLADloadproc) glfwGetProcAddress;
+    }
+    // from here on every loader user gets the traced functions; the HUD only needs them counted. A benchmark
+    // keeps the driver's own, its draws and triangles are the render queue's
+    if (traceOptions.mock || !traceOptions.path.empty() || hudEnabled) {
+        if (!rg::glTrace().open(traceOptions.path, glLoader)) {
+            return -1;
+        }
+        glLoader = GlTrace::loadFunction;
+    }
+
+    // glad: load all OpenGL function pointers
+    // ---------------------------------------
+    if (!gladLoadGLLoader(glLoader)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    // the mock has no GPU clock, its zones are CPU only
+    if (!profilePath.empty() && !rg::profiler().start(profilePath, !traceOptions.mock)) {
+        return -1;
+    }
+#ifdef RG_PROFILE
+    // the HUD's per pass times, nothing recorded
+    if (hudEnabled && profilePath.empty()) {
+        rg::profiler().start("", true);
+    }
+#endif
+
+    //Enabling depth testing
+    rg::glState().enable(GL_DEPTH_TEST);
+
+    // linked programs are kept between runs, a changed shader or driver falls back to compiling from source
+    ProgramBinaryCache programCache(FileSystem::getPath("shader_cache"), rg::glDriverString());
+    if (rg::loadProgramBinaryFunctions(glLoader)) {
+        rg::programBinaryCache() = &programCache;
+    } else {
+        std::cout << "program binary cache: not supported by this context, compiling every shader" << std::endl;
+    }
+
+    // images are decoded on worker threads while the first frames already render with placeholders
+    TextureLoader textureLoader;
+    rg::textureLoader() = &textureLoader;
+
+    {
+        SceneResources scene(sceneDescription);
+        if (rg::programBinaryCache()) {
+            std::cout << programCache.summary() << std::endl;
+        }
+
+        //Rendering loop
+//    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        srand((unsigned)benchmark.seed); // initialize random seed
+        for (std::unique_ptr<InstanceGroup> &group : scene.groups)
+            generateInstances(*group);
+
+        // the groups' GPU culling reads the depth of the frame before
+        DepthPyramid depthPyramid(FileSystem::getPath("resources/shaders"));
+        std::vector<std::unique_ptr<InstanceCuller>> instanceCullers;
+        for (std::unique_ptr<InstanceGroup> &group : scene.groups) {
+            if (group->batch.size() == 0)
+                continue;
+            std::vector<unsigned> indexCounts;
+            for (const Mesh &mesh : group->model.meshes)
+                indexCounts.push_back(mesh.indexCount);
+            instanceCullers.emplace_back(new InstanceCuller(group->batch.matrices(), group->bounds, indexCounts,
+                                                            FileSystem::getPath("resources/shaders"), glLoader));
+            group->culler = instanceCullers.back().get();
+            tuning.rockCapacity = std::max(tuning.rockCapacity, (int)group->batch.size());
+        }
+        instanceOccluders = &depthPyramid;
+        if (!instanceCullers.empty()) {
+            std::cout << "instance culling: " << instanceCullers[0]->pathName() << " on the GPU, g switches to the CPU" << std::endl;
+        }
+        tuning.rockCount = tuning.rockCapacity;
+
+        PerformanceHud hud;
+        if (hudEnabled && hud.init(window)) {
+            performanceHud = &hud;
+            scene.queue.countPrimitives(true);
+            std::cout << "hud: F1 shows it" << std::endl;
+        }
+        // the scene at a fraction of the window's resolution, scaled up onto it
+        OffscreenTarget scaledTarget;
+
+        const CameraPath cameraPath = benchmarkPath();
+        BenchmarkRun bench(benchmark, (unsigned long)(cameraPath.duration() / benchmark.step) + 1, RenderQueue::PRIMITIVE_LATENCY);
+        if (benchmark.enabled) {
+            benchmarkRun = &bench;
+            scene.queue.countPrimitives(true);
+            if (window) {
+                // frames as fast as they go, not at the display's rate
+                glfwSwapInterval(0);
+            }
+        }
+
+        // headless frames go to an offscreen framebuffer, and only start once every texture is on the GPU so
+        // the timed ones draw what the window would; a benchmark waits for them too
+        OffscreenTarget target;
+        if (headless.enabled) {
+            if (!target.create(headless.width, headless.height)) {
+                return -1;
+            }
+            target.bind();
+        }
+        if (headless.enabled || benchmark.enabled) {
+            while (!textureLoader.idle()) {
+                textureLoader.update();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        const float aspect = headless.enabled ? (float)target.width() / target.height() : (float)SCR_WIDTH / SCR_HEIGHT;
+        HeadlessRun run;
+        std::vector<uint8_t> dumpPixels;
+        if (headless.enabled && !headless.dumpDirectory.empty()) {
+            dumpPixels.reserve((size_t)target.width() * target.height() * 4);
+        }
+
+        FrameUniforms frameData = {};
+        HudFrameStats hudStats;
+        CullStats frameCull;
+        unsigned long frame = 0;
+        SimulationClock simulation(SIMULATION_STEP, simulationOptions.timeScale);
+        SimulationState previousState, state;
+        state.cameraPos = cameraPos;
+        simulate(state, simulation.time(), 0.0f, nullptr);
+        previousState = state;
+        double lastFrameStart = now();
+        double lastStatsReport = now();
+        run.start = now();
+        run.finished = !benchmark.enabled && !inputLog.replaying() && run.done(headless, frame, run.start);
+        while(headless.enabled ? !run.finished : !glfwWindowShouldClose(window)){
+            RG_PROFILE_ZONE("frame");
+            double frameStart = now();
+            if (simulationOptions.maxFps > 0.0) {
+                double due = lastFrameStart + 1.0 / simulationOptions.maxFps;
+                if (frameStart < due) {
+                    std::this_thread::sleep_for(std::chrono::duration<double>(due - frameStart));
+                    frameStart = now();
+                }
+            }
+            // finished images go to the GPU, at most a budget's worth a frame
+            textureLoader.update();
+            int windowWidth = 0, windowHeight = 0;
+            bool scaled = false;
+            {
+                // our part of the frame must not touch the heap (checked with -DRG_COUNT_ALLOCATIONS=ON)
+                rg::FrameAllocationCheck allocationCheck(frame);
+                rg::resetUniformLookupCount();
+
+                int framebufferWidth = target.width(), framebufferHeight = target.height();
+                GLuint sceneFramebuffer = target.framebuffer();
+                if (window) {
+                    glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+                    framebufferWidth = windowWidth;
+                    framebufferHeight = windowHeight;
+                    scaled = tuning.resolutionScale < 1.0f;
+                    if (scaled) {
+                        framebufferWidth = std::max(1, (int)(windowWidth * tuning.resolutionScale));
+                        framebufferHeight = std::max(1, (int)(windowHeight * tuning.resolutionScale));
+                        if (framebufferWidth != scaledTarget.width() || framebufferHeight != scaledTarget.height()) {
+                            scaledTarget.resize(framebufferWidth, framebufferHeight);
+                        }
+                        scaledTarget.bind();
+                        sceneFramebuffer = scaledTarget.framebuffer();
+                    } else if (scaledTarget.width() != 0) {
+                        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                        glViewport(0, 0, windowWidth, windowHeight);
+                    }
+                }
+                scene.batcher.setInstancing(tuning.instancing);
+                for (std::unique_ptr<InstanceCuller> &culler : instanceCullers)
+                    culler->setActiveCount((GLuint)tuning.rockCount);
+
+                initLoop();
+                // the simulation catches up with the frame, which draws between its last two states
+                if (benchmarkRun) {
+                    simulation.advanceTo(benchmarkRun->time());
+                } else {
+                    simulation.advance(frameStart - lastFrameStart);
+                }
+                lastFrameStart = frameStart;
+                while (simulation.step()) {
+                    previousState = state;
+                    inputLog.step(simulation.steps(), applyInput);
+                    simulate(state, simulation.time(), (float)simulation.stepSeconds(), window);
+                }
+                if (window && inputLog.finished()) {
+                    glfwSetWindowShouldClose(window, true);
+                }
+                SimulationState drawn = interpolate(previousState, state, simulation.alpha());
+                cameraPos = drawn.cameraPos;
+                lightPosition = drawn.lightPosition;
+                {
+                    RG_PROFILE_ZONE("transforms");
+                    scene.entities.transforms.setPosition(scene.entities.firefly, lightPosition);
+                    scene.entities.transforms.update();
+                }
+                if (benchmarkRun) {
+                    CameraPose pose = cameraPath.sample(benchmarkRun->pathTime());
+                    cameraPos = pose.position;
+                    cameraFront = pose.front;
+                    fov = 45.0f;
+                }
+
+                //view and projection matrices
+                glm::mat4 view = glm::lookAt(cameraPos , cameraFront + cameraPos, cameraUp);
+                glm::mat4 projection = glm::perspective(glm::radians(fov), aspect, 0.1f, 1000.0f);
+
+                //camera and lights for every program, one write per frame
+                scene.stream.beginFrame();
+                updateFrameUniforms(frameData, view, projection);
+                scene.stream.bind(FrameUniforms::BINDING, frameData);
+
+                //render scene, skipping what the camera can't see
+                CullContext cull;
+                cull.frustum = Frustum(projection * view);
+                renderScene(scene, cull);
+                depthPyramid.build(framebufferWidth, framebufferHeight, projection * view, sceneFramebuffer);
+                if (scaled) {
+                    scaledTarget.blitTo(0, windowWidth, windowHeight);
+                }
+                scene.stream.endFrame();
+                rg::glState().endFrame();
+                frameCull = cull.stats;
+                if (performanceHud) {
+                    hudStats.cull = cull.stats;
+                    hudStats.queue = scene.queue.stats();
+                    hudStats.batchedDraws = scene.batcher.submittedDraws();
+                    hudStats.batchDrawCalls = scene.batcher.issuedDraws();
+                    hudStats.streamBytes = scene.stream.frameBytes();
+                }
+
+                // all uniforms go through handles resolved at load time
+                ASSERT(frame < rg::FrameAllocationCheck::WARMUP_FRAMES || rg::uniformLookupCount() == 0,
+                       "Frame " << frame << " did " << rg::uniformLookupCount() << " uniform lookup(s) by name");
+                ++frame;
+            }
+            if (statsEnabled && now() - lastStatsReport >= 1.0) {
+                lastStatsReport = now();
+                printFrameStats(frame - 1, frameCull, scene);
+            }
+
+            if (headless.enabled) {
+                // nothing is presented, so waiting for the GPU is what makes the time the frame's
+                glFinish();
+                run.frameTime(now() - frameStart);
+                run.finished = benchmarkRun ? bench.finished() :
+                               inputLog.replaying() ? inputLog.finished() : run.done(headless, frame, now());
+                if (!headless.dumpDirectory.empty() &&
+                    (headless.dumpEvery ? (frame - 1) % headless.dumpEvery == 0 : run.finished)) {
+                    char name[32];
+                    std::snprintf(name, sizeof(name), "/frame_%05lu.png", frame - 1);
+                    target.readPixels(dumpPixels);
+                    rg::writePng(headless.dumpDirectory + name, target.width(), target.height(), 4, dumpPixels.data());
+                }
+            } else {
+                // outside the allocation check, ImGui keeps its own buffers
+                if (performanceHud) {
+                    performanceHud->frameTime(delta_time);
+                    if (performanceHud->visible()) {
+                        performanceHud->draw(hudStats, tuning);
+                    }
+                }
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+            }
+            if (rg::glTrace().active()) {
+                rg::glTrace().endFrame();
+            }
+            rg::profiler().endFrame();
+            if (benchmarkRun) {
+                bench.endFrame(now() - frameStart, scene.queue.stats().drawCalls, scene.queue.stats().primitives);
+                if (window && bench.finished()) {
+                    glfwSetWindowShouldClose(window, true);
+                }
+            }
+        }
+        if (headless.enabled) {
+            run.report(now(), target.width(), target.height());
+        }
+        if (benchmarkRun && bench.finished()) {
+            bench.write((const char*)glGetString(GL_RENDERER), buildDescription());
+        }
+        benchmarkRun = nullptr;
+        if (inputLog.recording()) {
+            inputLog.close(simulation.steps());
+            reportInput("recorded", simulation.steps(), state);
+        } else if (inputLog.replaying()) {
+            reportInput("replayed", simulation.steps(), state);
+        }
+        instanceOccluders = nullptr;
+        performanceHud = nullptr;
+    }
+    rg::programBinaryCache() = nullptr;
+    rg::textureLoader() = nullptr;
+    rg::profiler().write();
+    if (rg::glTrace().recording()) {
+        rg::glTrace().close();
+        std::cout << "gl trace: " << rg::glTrace().frames() << " frames, " << rg::glTrace().bytes() << " bytes in "
+                  << traceOptions.path << std::endl;
+    }
+
+    if (window) {
+        glfwTerminate();
+    }
+    return 0;
+}
+
+// --headless [--size=WxH] [--frames=N | --seconds=S] [--dump=DIRECTORY [--dump-every=N]]
+// --mock-gl (implies --headless), --trace=FILE, --profile=FILE, --hud, --stats,
+// --benchmark[=PREFIX] [--warmup=N] [--seed=N], --time-scale=S, --max-fps=N, --record-input=FILE,
+// --replay-input=FILE and --scene=FILE
+bool parseOptions(int argc, char **argv, HeadlessOptions &options, TraceOptions &trace, std::string &profile, bool &hud,
+                  bool &stats, BenchmarkOptions &bench, SimulationOptions &simulation, InputLogOptions &input,
+                  std::string &scene) {
+    for (int i = 1; i < argc; ++i) {
+        const char *argument = argv[i];
+        bool valid = true;
+        if (std::strcmp(argument, "--headless") == 0) {
+            options.enabled = true;
+        } else if (std::strncmp(argument, "--size=", 7) == 0) {
+            valid = std::sscanf(argument + 7, "%dx%d", &options.width, &options.height) == 2 &&
+                    options.width > 0 && options.height > 0;
+        } else if (std::strncmp(argument, "--frames=", 9) == 0) {
+            valid = std::sscanf(argument + 9, "%lu", &options.frames) == 1;
+        } else if (std::strncmp(argument, "--seconds=", 10) == 0) {
+            valid = std::sscanf(argument + 10, "%lf", &options.seconds) == 1 && options.seconds > 0.0;
+        } else if (std::strncmp(argument, "--dump=", 7) == 0) {
+            options.dumpDirectory = argument + 7;
+            valid = !options.dumpDirectory.empty();
+        } else if (std::strncmp(argument, "--dump-every=", 13) == 0) {
+            valid = std::sscanf(argument + 13, "%lu", &options.dumpEvery) == 1;
+        } else if (std::strcmp(argument, "--mock-gl") == 0) {
+            trace.mock = true;
+            options.enabled = true;
+        } else if (std::strncmp(argument, "--trace=", 8) == 0) {
+            trace.path = argument + 8;
+            valid = !trace.path.empty();
+        } else if (std::strncmp(argument, "--profile=", 10) == 0) {
+            profile = argument + 10;
+            valid = !profile.empty();
+        } else if (std::strcmp(argument, "--hud") == 0) {
+            hud = true;
+        } else if (std::strcmp(argument, "--stats") == 0) {
+            stats = true;
+        } else if (std::strcmp(argument, "--benchmark") == 0) {
+            bench.enabled = true;
+        } else if (std::strncmp(argument, "--benchmark=", 12) == 0) {
+            bench.enabled = true;
+            bench.prefix = argument + 12;
+            valid = !bench.prefix.empty();
+        } else if (std::strncmp(argument, "--warmup=", 9) == 0) {
+            valid = std::sscanf(argument + 9, "%lu", &bench.warmupFrames) == 1;
+        } else if (std::strncmp(argument, "--seed=", 7) == 0) {
+            valid = std::sscanf(argument + 7, "%ld", &bench.seed) == 1 && bench.seed >= 0;
+        } else if (std::strncmp(argument, "--time-scale=", 13) == 0) {
+            valid = std::sscanf(argument + 13, "%lf", &simulation.timeScale) == 1 && simulation.timeScale > 0.0;
+        } else if (std::strncmp(argument, "--max-fps=", 10) == 0) {
+            valid = std::sscanf(argument + 10, "%lf", &simulation.maxFps) == 1 && simulation.maxFps > 0.0;
+        } else if (std::strncmp(argument, "--record-input=", 15) == 0) {
+            input.record = argument + 15;
+            valid = !input.record.empty();
+        } else if (std::strncmp(argument, "--replay-input=", 15) == 0) {
+            input.replay = argument + 15;
+            valid = !input.replay.empty();
+        } else if (std::strncmp(argument, "--scene=", 8) == 0) {
+            scene = argument + 8;
+            valid = !scene.empty();
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            std::cout << "ERROR::OPTIONS::INVALID " << argument << "\n"
+                      << "usage: " << argv[0] << " [--headless [--size=WxH] [--frames=N | --seconds=S] "
+                      << "[--dump=DIRECTORY [--dump-every=N]]] [--mock-gl] [--trace=FILE] [--profile=FILE] [--hud] [--stats] "
+                      << "[--benchmark[=PREFIX] [--warmup=N]] [--seed=N] [--time-scale=S] [--max-fps=N] "
+                      << "[--record-input=FILE | --replay-input=FILE] [--scene=FILE]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Once a second with --stats, outside the frame's allocation check.
+void printFrameStats(unsigned long frame, const CullStats &cull, SceneResources &scene) {
+    std::cout << "culling: frame " << frame << " drew " << cull.visible << " of " << cull.submitted << " objects" << std::endl;
+    std::cout << "batching: " << scene.batcher.submittedDraws() << " cube draws in "
+              << scene.batcher.issuedDraws() << " instanced draw call(s)" << std::endl;
+    const RenderQueueStats &queueStats = scene.queue.stats();
+    std::cout << "render queue: " << queueStats.draws << " draws in " << queueStats.drawCalls << " call(s), "
+              << queueStats.programBinds << " program, "
+              << queueStats.textureBinds << " texture, " << queueStats.vaoBinds << " VAO and "
+              << queueStats.cullToggles << " cull face change(s), " << queueStats.avoided << " avoided" << std::endl;
+    const GlState::Stats &glStats = rg::glState().lastFrame();
+    std::cout << "gl state: " << glStats.totalRedundant() << " of " << glStats.totalCalls() << " calls dropped (";
+    for (int kind = 0; kind < GlState::KINDS; ++kind) {
+        std::cout << (kind ? ", " : "") << GlState::kindName((GlState::Kind)kind) << " "
+                  << glStats.redundant[kind] << "/" << glStats.calls[kind];
+    }
+    std::cout << ")" << std::endl;
+    std::cout << "stream buffer: " << scene.stream.frameBytes() << " bytes this frame, "
+              << scene.stream.fenceWaits() << " fence wait(s) so far" << std::endl;
+    if (rg::glTrace().active()) {
+        const GlTraceStats &traceStats = rg::glTrace().lastFrame();
+        std::cout << "gl trace: " << traceStats.calls << " calls, " << traceStats.draws() << " draw(s), "
+                  << traceStats.uniforms() << " uniform upload(s), " << traceStats.uploadBytes
+                  << " upload bytes" << std::endl;
+    }
+}
+
+// seconds since the first call; glfwGetTime without needing GLFW initialised
+double now() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One step of seconds ending at simulated time: the camera moves by the keys held, the firefly circles.
+void simulate(SimulationState &state, double time, float seconds, GLFWwindow *window) {
+    processInput(window, state.cameraPos, seconds);
+    float radius = lights.pointOrbit.x;
+    state.lightPosition = glm::vec3(cos(time) * radius, lights.pointOrbit.y, sin(time) * radius);
+}
+
+SimulationState interpolate(const SimulationState &from, const SimulationState &to, float alpha) {
+    SimulationState state;
+    state.cameraPos = glm::mix(from.cameraPos, to.cameraPos, alpha);
+    state.lightPosition = glm::mix(from.lightPosition, to.lightPosition, alpha);
+    return state;
+}
+
+void keyPressed(int key);
+void cursorMoved(double xpos, double ypos);
+void scrolled(double yoffset);
+
+// An event of the step being simulated, live or replayed.
+void applyInput(const InputEvent &event) {
+    switch (event.type) {
+        case InputEvent::KEY:
+            if (event.action == GLFW_PRESS) {
+                keyPressed(event.key);
+            }
+            break;
+        case InputEvent::CURSOR:
+            cursorMoved(event.x, event.y);
+            break;
+        case InputEvent::SCROLL:
+            scrolled(event.y);
+            break;
+        case InputEvent::END:
+            break;
+    }
+}
 
-int main() {
+// What a recording ended with, for its replays to be compared against.
+void reportInput(const char *what, uint64_t step, const SimulationState &state) {
+    std::printf("input: %s %llu steps, camera at (%.9g, %.9g, %.9g) yaw %.9g pitch %.9g fov %.9g speed %.9g, "
+                "spot light %d, beams %d, cull face %d, gpu culling %d\n",
+                what, (unsigned long long)step, state.cameraPos.x, state.cameraPos.y, state.cameraPos.z, yaw, pitch, fov,
+                cameraSpeedParameter, spotLightFlag, beams, cullFaceEnabled, gpuCulling);
+}
+
+// From the camera's starting point past the pyramids and the backpack, out over the rock field and back.
+CameraPath benchmarkPath() {
+    return CameraPath({
+        {glm::vec3(0.0f, 1.0f, 4.0f), glm::vec3(2.0f, 0.5f, 0.0f)},
+        {glm::vec3(4.0f, 1.5f, 3.0f), glm::vec3(1.4f, 0.1f, -1.95f)},
+        {glm::vec3(9.0f, 3.0f, -2.0f), glm::vec3(5.0f, 1.0f, -5.0f)},
+        {glm::vec3(6.0f, 5.0f, -12.0f), glm::vec3(0.0f, 0.0f, 0.0f)},
+        {glm::vec3(-20.0f, 8.0f, -30.0f), glm::vec3(-60.0f, 0.0f, -50.0f)},
+        {glm::vec3(-70.0f, 4.0f, -10.0f), glm::vec3(-80.0f, 0.0f, 30.0f)},
+        {glm::vec3(-40.0f, 6.0f, 30.0f), glm::vec3(0.0f, 0.0f, 0.0f)},
+        {glm::vec3(-8.0f, 2.0f, 10.0f), glm::vec3(2.0f, 0.5f, 0.0f)},
+        {glm::vec3(0.0f, 1.0f, 4.0f), glm::vec3(2.0f, 0.5f, 0.0f)},
+    }, 2.0f);
+}
+
+// the configuration the results came from, for comparing builds
+std::string buildDescription() {
+    std::string description;
+#ifdef NDEBUG
+    description += "release";
+#else
+    description += "debug";
+#endif
+#ifdef RG_PROFILE
+    description += " RG_PROFILE";
+#endif
+#ifdef RG_COUNT_ALLOCATIONS
+    description += " RG_COUNT_ALLOCATIONS";
+#endif
+#ifdef RG_CHECK_GL_STATE
+    description += " RG_CHECK_GL_STATE";
+#endif
+#ifdef RG_HEADLESS
+    description += " RG_HEADLESS";
+#endif
+    if (traceOptions.mock) {
+        description += " mock-gl";
+    }
+    return description;
+}
+
+// The fullscreen window on the primary monitor, its context current and the input callbacks set.
+GLFWwindow* createWindow() {
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -122,7 +980,7 @@ int main() {
     if (window == NULL) {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
-        return -1;
+        return NULL;
     }
 
     glfwMakeContextCurrent(window);
@@ -132,12 +990,58 @@ int main() {
     glfwSetCursorPosCallback(window, mouse_callback);
 
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+    return window;
+}
+
+Texture2D loadTexture(const std::string &path, GLenum mag_filter, GLenum min_filter, bool gamma_correction) {
+    Texture2D texture = Texture2D(GL_REPEAT, GL_REPEAT, mag_filter, min_filter);
+    texture.load(path, gamma_correction);
+    texture.reflect_vertically();
+    texture.free_data();
+    return texture;
+}
+
+// The stream buffer, batcher and queue have room for a draw of every object of the scene a frame.
+SceneResources::SceneResources(const SceneDescription &description)
+: description(description),
+  obeliskShader(FileSystem::getPath("resources/shaders/obelisk.vert"), FileSystem::getPath("resources/shaders/obelisk.frag")),
+  fireflyShader(FileSystem::getPath("resources/shaders/cube.vert"), FileSystem::getPath("resources/shaders/cube.frag")),
+  boxShaders(FileSystem::getPath("resources/shaders/sanduk.vert"), FileSystem::getPath("resources/shaders/sanduk.frag")),
+  pyramidShaders(FileSystem::getPath("resources/shaders/pyramid.vert"), FileSystem::getPath("/resources/shaders/pyramid.frag"), "texture_pyramid"),
+  groundShaders(FileSystem::getPath("resources/shaders/ground_shader.vert"),FileSystem::getPath("resources/shaders/ground_shader.frag"), "sand_texture"),
+  modelShaders("resources/shaders/model_loading.vs", "resources/shaders/model_loading.fs"),
+  rockShaders("resources/shaders/rock.vs", "resources/shaders/rock.fs", "texture_diffuse1"),
+  stream(GL_UNIFORM_BUFFER, 64 * 1024 + (GLsizeiptr)description.objectCount() * 256, glLoader, sizeof(InstanceUniforms)),
+  batcher(256 + description.objectCount()),
+  queue(256 + description.objectCount() + description.groupCount()) {
+    // in the file's order: loadTexture flips stbi's vertical flag on after the first texture, before the models load
+    textures.reserve(description.textureCount());
+    for (uint32_t i = 0; i < description.textureCount(); i++) {
+        const SceneFile::Texture &texture = description.texture(i);
+        GLenum filter = texture.flags & SceneFile::TEXTURE_NEAREST ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR;
+        textures.push_back(loadTexture(FileSystem::getPath(SceneDescription::string(texture.path, texture.pathLength)), filter, filter,
+                                       (texture.flags & SceneFile::TEXTURE_SRGB) != 0));
+    }
+    // the groups keep references to the models
+    models.reserve(description.modelCount());
+    for (uint32_t i = 0; i < description.modelCount(); i++) {
+        const SceneFile::Model &model = description.model(i);
+        models.emplace_back(FileSystem::getPath(SceneDescription::string(model.path, model.pathLength)));
+        // both variants, so turning the spotlight on or a model coming into view looks nothing up by name
+        models.back().prepare(modelShaders.program(0));
+        models.back().prepare(modelShaders.program(1));
     }
+    for (uint32_t i = 0; i < description.groupCount(); i++) {
+        const SceneFile::Group &group = description.group(i);
+        groups.emplace_back(new InstanceGroup(group, models[description.index(group.model.pointer)]));
+    }
+    entities.transforms.reserve(description.objectCount() + 1);
+    entities.objects.assign(description.objectCount(), NO_ENTITY);
+    for (uint32_t i = 0; i < description.objectCount(); i++) {
+        createEntity(description, i, entities);
+    }
+    entities.firefly = entities.transforms.create();
+    entities.transforms.setScale(entities.firefly, glm::vec3(0.04f));
 
     float pyramid[] = {
         -0.5, 0.0, -0.5, 0.0, 0.0,  -1.25f, 1.25f, 0.0f,//bottom-left 0
@@ -212,12 +1116,10 @@ int main() {
         -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
     };
 
-    unsigned int cubeVBO, cubeVAO;
-
     glGenVertexArrays(1, &cubeVAO);
     glGenBuffers(1, &cubeVBO);
 
-    glBindVertexArray(cubeVAO);
+    rg::glState().bindVertexArray(cubeVAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(cube), cube, GL_STATIC_DRAW);
@@ -231,25 +1133,52 @@ int main() {
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
-    glBindVertexArray(0);
+    rg::glState().bindVertexArray(0);
+
+    obeliskUniforms = resolveObjectUniforms(obeliskShader);
 
-    Shader obeliskShader = Shader(FileSystem::getPath("resources/shaders/obelisk.vert"), FileSystem::getPath("resources/shaders/obelisk.frag"));
+    auto bindBlocks = [](const auto &program) {
+        program.bindUniformBlock(FrameUniforms::BLOCK_NAME, FrameUniforms::BINDING);
+        program.bindUniformBlock(DrawUniforms::BLOCK_NAME, DrawUniforms::BINDING);
+        program.bindUniformBlock(InstanceUniforms::BLOCK_NAME, InstanceUniforms::BINDING);
+    };
+    bindBlocks(obeliskShader);
+    bindBlocks(fireflyShader);
+    bindBlocks(boxShaders);
+    bindBlocks(pyramidShaders);
+    bindBlocks(groundShaders);
+    bindBlocks(modelShaders);
+    bindBlocks(rockShaders);
+
+    // uniforms that never change are set once here, not every frame; the diffuse colour and shininess of
+    // the beams, the boxes' shininess and the firefly's colour are per instance
+    obeliskShader.use();
+    obeliskShader.setVec3(obeliskUniforms.materialAmbient, glm::vec3(0.0215,	0.1745, 0.0215));
+    obeliskShader.setVec3(obeliskUniforms.materialSpecular, glm::vec3(0.633, 0.727811, 0.633));
 
-    Shader fireflyShader = Shader(FileSystem::getPath("resources/shaders/cube.vert"), FileSystem::getPath("resources/shaders/cube.frag"));
-    fireflyShader.use();
-    fireflyShader.setVec3("lightColor", lightColor);
+    for (int variant = 0; variant < 2; variant++) {
+        const ObjectUniforms &box = boxShaders.uniforms(variant);
+        boxShaders.program(variant).use();
+        boxShaders.program(variant).setInt(box.materialDiffuse, 0);
+        boxShaders.program(variant).setInt(box.materialSpecular, 1);
 
-    Shader boxShader = Shader(FileSystem::getPath("resources/shaders/sanduk.vert"), FileSystem::getPath("resources/shaders/sanduk.frag"));
-    boxShader.use();
+        pyramidShaders.program(variant).use();
+        pyramidShaders.program(variant).setInt(pyramidShaders.uniforms(variant).texture, 0);
 
-    //Vertex Buffer Object & Vertex Array Object
-    unsigned VBOs[2], VAOs[2];
+        groundShaders.program(variant).use();
+        groundShaders.program(variant).setInt(groundShaders.uniforms(variant).texture, 0);
+
+        rockShaders.program(variant).use();
+        rockShaders.program(variant).setVec3(rockShaders.uniforms(variant).lightColor, lights.pointColor);
+        rockShaders.program(variant).setInt(rockShaders.uniforms(variant).texture, 0);
+    }
 
+    //Vertex Buffer Object & Vertex Array Object
     glGenVertexArrays(2, VAOs);
     glGenBuffers(2, VBOs);
 
     //pyramid
-    glBindVertexArray(VAOs[0]);
+    rg::glState().bindVertexArray(VAOs[0]);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBOs[0]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(pyramid), pyramid, GL_STATIC_DRAW);
@@ -263,7 +1192,7 @@ int main() {
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void * )(5* sizeof(float)));
     glEnableVertexAttribArray(2);
     //sand
-    glBindVertexArray(VAOs[1]);
+    rg::glState().bindVertexArray(VAOs[1]);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBOs[1]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(ground), ground, GL_STATIC_DRAW);
@@ -274,196 +1203,169 @@ int main() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(3*sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    glBindVertexArray(0);
-
-    //Create shaders
-    Shader pyramidShader = Shader(FileSystem::getPath("resources/shaders/pyramid.vert"), FileSystem::getPath("/resources/shaders/pyramid.frag"));
-    Shader groundShader = Shader (FileSystem::getPath("resources/shaders/ground_shader.vert"),FileSystem::getPath("resources/shaders/ground_shader.frag"));
-
-//    Pyramid texture
-    Texture2D pyramidTexture = Texture2D(GL_REPEAT, GL_REPEAT, GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST_MIPMAP_NEAREST);
-    pyramidTexture.load(FileSystem::getPath("resources/textures/pyramid_2.jpg"), true);
-    pyramidTexture.reflect_vertically();
-    pyramidTexture.free_data();
-
-//    Sand texture
-    Texture2D groundTexture = Texture2D(GL_REPEAT, GL_REPEAT, GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST_MIPMAP_NEAREST);
-    groundTexture.load(FileSystem::getPath("/resources/textures/sand.jpg"), true);
-    groundTexture.reflect_vertically();
-    groundTexture.free_data();
+    rg::glState().bindVertexArray(0);
 
-//    wood texture
-    Texture2D woodTexture = Texture2D(GL_REPEAT, GL_REPEAT, GL_LINEAR, GL_LINEAR);
-    woodTexture.load(FileSystem::getPath("resources/textures/container2.png"), true);
-    woodTexture.reflect_vertically();
-    woodTexture.free_data();
-
-    // metal texture
-    Texture2D metalTexture = Texture2D(GL_REPEAT, GL_REPEAT, GL_LINEAR, GL_LINEAR);
-    metalTexture.load(FileSystem::getPath("resources/textures/container2_specular.png"), false);
-    metalTexture.reflect_vertically();
-    metalTexture.free_data();
-
-    //Initial color of background
-
-    //Enabling depth testing
-    stbi_set_flip_vertically_on_load(true);
-    glEnable(GL_DEPTH_TEST);
+    pyramidBounds = rg::boundsOf(pyramid, 12, 8);
+    groundBounds = rg::boundsOf(ground, 6, 5);
+    cubeBounds = rg::boundsOf(cube, 36, 8);
+}
 
-    shader backpackShader("resources/shaders/model_loading.vs",
-                       "resources/shaders/model_loading.fs");
+SceneResources::~SceneResources() {
+    glDeleteVertexArrays(1, &cubeVAO);
+    rg::glState().vertexArrayDeleted(cubeVAO);
+    glDeleteBuffers(1, &cubeVBO);
+    glDeleteVertexArrays(2, VAOs);
+    rg::glState().vertexArrayDeleted(VAOs[0]);
+    rg::glState().vertexArrayDeleted(VAOs[1]);
+    glDeleteBuffers(2, VBOs);
+}
 
-//    backpackShader.use();
+void renderScene(SceneResources &scene, CullContext &cull) {
+    scene.queue.begin(cameraPos);
 
-    Model backpackModel(FileSystem::getPath("resources/objects/backpack/backpack.obj"));
+    //render pyramids
+    renderPyramids(scene.pyramidShaders.program(spotLightFlag), scene.VAOs[0], scene.description, scene.entities,
+                   scene.textures, scene.pyramidBounds, scene.stream, scene.queue, cull);
 
-    //rock loading
+    //render ground
+    renderGround(scene.groundShaders.program(spotLightFlag), scene.description, scene.entities, scene.textures,
+                 scene.VAOs[1], scene.groundBounds, scene.stream, scene.queue, cull);
 
-    shader rockShader("resources/shaders/rock.vs",
-                      "resources/shaders/rock.fs");
+    //render firefly
+    renderFirefly(scene.fireflyShader, scene.cubeVAO, scene.entities, scene.cubeBounds, scene.batcher, cull);
 
-    Model rockModel(FileSystem::getPath("resources/objects/rock/Rock1/Rock1.obj"));
+    //render boxes
+    renderBoxes(scene.boxShaders.program(spotLightFlag), scene.cubeVAO, scene.description, scene.entities, scene.textures,
+                scene.cubeBounds, scene.batcher, cull);
 
-    //Rendering loop
-//    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    generateRocks(rockModel);
+    //render laser beams
+    renderBeams(scene.obeliskShader, scene.cubeVAO, scene.description, scene.entities, scene.cubeBounds, scene.batcher, cull);
 
-    while(!glfwWindowShouldClose(window)){
-        initLoop();
-        processInput(window);
+    //render models (the backpack)
+    renderModels(scene.modelShaders.program(spotLightFlag), scene.description, scene.entities, scene.models,
+                 scene.stream, scene.queue, cull);
 
-        //view and projection matrices
-        glm::mat4 view = glm::lookAt(cameraPos , cameraFront + cameraPos, cameraUp);
-        glm::mat4 projection = glm::perspective(glm::radians(fov), (float)SCR_WIDTH/SCR_HEIGHT, 0.1f, 1000.0f);
+    //render instancing groups (the rocks)
+    renderGroups(scene.rockShaders.program(spotLightFlag), scene.groups, scene.queue, cull);
 
-        //render scene
-        renderScene(pyramidShader, pyramidTexture,
-                    groundShader, groundTexture, VAOs,
-                    fireflyShader, cubeVAO,
-                    boxShader, woodTexture, metalTexture,
-                    obeliskShader, backpackShader, backpackModel,
-                    rockShader, rockModel,
-                    view, projection);
+    //the batched cube draws, then everything in state order
+    scene.batcher.flush(scene.stream, scene.queue);
+    scene.queue.execute();
+}
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+// The command's DrawData; false when the frame's part of the stream buffer is full and the draw has to go.
+bool writeDrawUniforms(RenderCommand &command, StreamBuffer &stream, const glm::mat4 &model) {
+    DrawUniforms drawData;
+    drawData.model = model;
+    GLintptr offset = stream.write(drawData);
+    if (offset < 0) {
+        return false;
     }
-
-    glfwTerminate();
-    return 0;
+    command.blockBinding = DrawUniforms::BINDING;
+    command.blockBuffer = stream.buffer();
+    command.blockOffset = offset;
+    command.blockSize = sizeof(DrawUniforms);
+    return true;
 }
 
-void renderScene(Shader pyramidShader, Texture2D pyramidTexture,
-                 Shader groundShader, Texture2D groundTexture, unsigned VAOs[],
-                 Shader fireflyShader, unsigned cubeVAO,
-                 Shader boxShader, Texture2D woodTexture, Texture2D metalTexture,
-                 Shader obeliskShader,
-                 shader backpackShader, Model backpackModel,
-                 shader rockShader, Model rockModel,
-                 glm::mat4 view, glm::mat4 projection) {
-    //render pyramids
-    renderPyramids(pyramidShader, VAOs[0], pyramidTexture, view, projection);
-
-    //render ground
-    renderGround(groundShader, groundTexture, "sand_texture", VAOs[1], view, projection);
-
-    //render firefly
-    renderFirefly(fireflyShader, cubeVAO, view, projection);
-
-    //render boxes
-    renderBoxes(boxShader, cubeVAO, woodTexture, metalTexture, view, projection);
+void updateFrameUniforms(FrameUniforms &frameData, const glm::mat4 &view, const glm::mat4 &projection) {
+    frameData.view = view;
+    frameData.projection = projection;
+    frameData.viewPos = cameraPos;
 
-    //render laser beams
-    renderBeams(obeliskShader, cubeVAO, view, projection);
+    //sun light (directional light)
+    frameData.dirLight.direction = lights.sunDirection;
+    frameData.dirLight.color = lights.sunColor;
 
-    //render model backpack
-    renderBackpack(backpackShader, backpackModel, view, projection);
+    //firefly (point light)
+    frameData.pointLight.lightConst = lights.pointAttenuation.x;
+    frameData.pointLight.linearConst = lights.pointAttenuation.y;
+    frameData.pointLight.quadraticConst = lights.pointAttenuation.z;
+    frameData.pointLight.position = lightPosition;
+    frameData.pointLight.color = lights.pointColor;
 
-    //render model rock
-    renderRocks(rockShader, rockModel, view, projection);
+    //spotlight
+    frameData.spotLight.lightConst = lights.spotAttenuation.x;
+    frameData.spotLight.linearConst = lights.spotAttenuation.y;
+    frameData.spotLight.quadraticConst = lights.spotAttenuation.z;
+    frameData.spotLight.spotLightFlag = spotLightFlag;
+    frameData.spotLight.position = cameraPos;
+    frameData.spotLight.direction = cameraFront;
+    frameData.spotLight.color = lights.spotColor;
+    frameData.spotLight.cutOff = glm::cos(glm::radians(lights.spotCutOff.x));
+    frameData.spotLight.outerCutOff = glm::cos(glm::radians(lights.spotCutOff.y));
 }
 
 void initLoop() {
-    glClearColor(skyColor.x, skyColor.y, skyColor.z, 1.0f);
+    glClearColor(lights.sky.x, lights.sky.y, lights.sky.z, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    float radius = 3.0f;
-    lightPosition = glm::vec3(cos(glfwGetTime())*radius  ,0.5,  sin(glfwGetTime())*radius);
-
-
     //frame-time logic
-    float current_frame = glfwGetTime();
+    float current_frame = now();
     delta_time = current_frame - last_frame;
     last_frame = current_frame;
 }
 
-void renderPyramids(Shader pyramidShader, unsigned VAO, Texture2D pyramidTexture, glm::mat4 view, glm::mat4 projection) {
-
-    // Create model matrix for super pyramid
-    glm::mat4 modelSuperPyramid = glm::mat4(1.0f);
-    modelSuperPyramid = glm::scale(modelSuperPyramid, glm::vec3(300.0f));
-
-    //CULL FACE enabled for small pyrmid
-    bool flag = false;
-    if(cullFaceEnabled){
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-        glFrontFace(GL_CCW);
-        flag = true;
+void renderPyramids(const Shader &pyramidShader, unsigned VAO, const SceneDescription &description,
+                    const SceneEntities &entities, const std::vector<Texture2D> &textures, const AABB &bounds,
+                    StreamBuffer &stream, RenderQueue &queue, CullContext &cull) {
+    RG_PROFILE_ZONE("submit pyramids");
+
+    //CULL FACE unless the scene says both faces are seen (the big pyramid), part of their sort key
+    for (const SceneFile::Object &pyramid : description.objects(SceneFile::PYRAMID)) {
+        glm::mat4 world = entities.world(description, pyramid);
+        if (cull.visible(bounds, world)) {
+            bool cullFace = cullFaceEnabled && !(pyramid.flags & SceneFile::OBJECT_DOUBLE_SIDED);
+            renderPyramid(pyramidShader, objectTexture(description, textures, pyramid, 0), VAO, world, cullFace,
+                          stream, queue);
+        }
     }
+}
 
-    //render small pyramid
-    renderPyramid(pyramidShader, pyramidTexture, VAO, modelSuperPyramid, view, projection);
-
-    // Create model matrix for small pyramid
-    glm::mat4 modelSmallPyramid = glm::mat4(1.0f);
-    modelSmallPyramid = glm::translate(modelSmallPyramid, glm::vec3(2.0f, 0.0f, 0.0f));
-    modelSmallPyramid = glm::scale(modelSmallPyramid, glm::vec3(2.0f, 2.0f, 2.0f));
-
-    renderPyramid(pyramidShader, pyramidTexture, VAO, modelSmallPyramid, view, projection);
+const Texture2D& objectTexture(const SceneDescription &description, const std::vector<Texture2D> &textures,
+                               const SceneFile::Object &object, int slot) {
+    return textures[description.index(object.textures[slot].pointer)];
+}
 
-    //DISABLING CULL FACE for small pyramid and super pyramid
-    if(flag){
-        glDisable(GL_CULL_FACE);
+Entity createEntity(const SceneDescription &description, uint32_t i, SceneEntities &entities) {
+    if (entities.objects[i] == NO_ENTITY) {
+        const SceneFile::Object &object = description.object(i);
+        Entity parent = object.parent.pointer ? createEntity(description, description.index(object.parent.pointer), entities)
+                                              : NO_ENTITY;
+        entities.objects[i] = entities.transforms.create(object.local, parent);
     }
-
-    //render big pyramid
-    glm::mat4 modelBigPyramid = glm::mat4(1.0f);
-    modelBigPyramid = glm::translate(modelBigPyramid, glm::vec3(5.0f, 0.0f, -5.0f));
-    modelBigPyramid = glm::rotate(modelBigPyramid, glm::radians(7.0f) ,glm::vec3(0.0f, 1.0f, 0.0f));
-    modelBigPyramid = glm::scale(modelBigPyramid, glm::vec3(4.0f, 4.0f, 4.0f));
-
-    renderPyramid(pyramidShader, pyramidTexture, VAO, modelBigPyramid, view, projection);
+    return entities.objects[i];
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
+// process all input: ask the input log which keys are held down this step and move position by them
+// for seconds
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow *window) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+void processInput(GLFWwindow *window, glm::vec3 &position, float seconds) {
+    if (window && inputLog.held(GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(window, true);
 
-    const float cameraSpeed = cameraSpeedParameter * delta_time;
+    const float cameraSpeed = cameraSpeedParameter * seconds;
 
     //da ne ide kamera ispod y ose
-    if (cameraPos.y  < 0.3f)
+    if (position.y  < 0.3f)
     {
-        cameraPos.y = 0.3f;
+        position.y = 0.3f;
     }
 
-    if(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS){
-        cameraPos += cameraFront * cameraSpeed;
+    if(inputLog.held(GLFW_KEY_W)){
+        position += cameraFront * cameraSpeed;
     }
 
-    if(glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS){
-        cameraPos -= cameraFront * cameraSpeed;
+    if(inputLog.held(GLFW_KEY_S)){
+        position -= cameraFront * cameraSpeed;
     }
 
-    if(glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS){
-        cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
+    if(inputLog.held(GLFW_KEY_D)){
+        position += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
     }
 
-    if(glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS){
-        cameraPos -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
+    if(inputLog.held(GLFW_KEY_A)){
+        position -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
     }
 }
 
@@ -475,18 +1377,29 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
-// glfw: whenever the mouse moves, this callback is called
+// glfw: whenever a key is pressed or released, this callback is called; the simulation takes it at its
+// next step (keyPressed), only the HUD reacts right away
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    if (action != GLFW_REPEAT) {
+        inputLog.push(InputEvent::keyEvent(key, action));
+    }
 
-    if(key == GLFW_KEY_F && action == GLFW_PRESS){
+    if(key == GLFW_KEY_F1 && action == GLFW_PRESS && performanceHud){
+        performanceHud->toggle();
+    }
+}
+
+void keyPressed(int key) {
+
+    if(key == GLFW_KEY_F){
         spotLightFlag = 1 - spotLightFlag;
     }
 
-    if(key == GLFW_KEY_L && action == GLFW_PRESS){
+    if(key == GLFW_KEY_L){
         beams = !beams;
     }
 
-    if(key == GLFW_KEY_UP && action == GLFW_PRESS){
+    if(key == GLFW_KEY_UP){
         if(cameraSpeedParameter >= 100.0){
             cameraSpeedParameter = 100.0;
         }
@@ -495,7 +1408,7 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         }
     }
 
-    if(key == GLFW_KEY_DOWN && action == GLFW_PRESS){
+    if(key == GLFW_KEY_DOWN){
         if(cameraSpeedParameter <= 5.0){
             cameraSpeedParameter = 5.0;
         }
@@ -504,12 +1417,33 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         }
     }
 
-    if(key == GLFW_KEY_C && action == GLFW_PRESS){
+    if(key == GLFW_KEY_C){
         cullFaceEnabled = !cullFaceEnabled;
     }
 
+    if(key == GLFW_KEY_G){
+        gpuCulling = !gpuCulling;
+        std::cout << "instance culling: " << (gpuCulling ? "GPU" : "CPU") << std::endl;
+    }
+
+    // the cursor comes back from the HUD somewhere else
+    if(key == GLFW_KEY_F1){
+        firstMouse = true;
+    }
+
 }
+
+// glfw: whenever the mouse moves, this callback is called
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
+{
+    // the cursor is the HUD's while it is up
+    if (performanceHud && performanceHud->visible())
+        return;
+
+    inputLog.push(InputEvent::pointerEvent(InputEvent::CURSOR, xpos, ypos));
+}
+
+void cursorMoved(double xpos, double ypos)
 {
     if (firstMouse)
     {
@@ -544,6 +1478,11 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    inputLog.push(InputEvent::pointerEvent(InputEvent::SCROLL, xoffset, yoffset));
+}
+
+void scrolled(double yoffset)
 {
     fov -= (float)yoffset;
     if (fov < 1.0f)
@@ -552,49 +1491,43 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
         fov = 45.0f;
 }
 
-void renderBackpack(shader backpackShader, Model backpackModel, glm::mat4 view, glm::mat4 projection){
-    //Model
-    glm::mat4 model_model = glm::mat4(1.0f);
-    model_model = glm::translate(model_model, glm::vec3(1.4, 0.1, -1.95));
-    model_model = glm::rotate(model_model, (float)glm::radians(-25.0f), glm::vec3(1.0, 0.0, 1.0));
-    model_model = glm::rotate(model_model, (float)glm::radians(-55.0f), glm::vec3(0.0, 1.0, 0.0));
-    model_model = glm::scale(model_model, glm::vec3(0.05));
-
-    backpackShader.use();
-    backpackShader.setMat4("model", model_model);
-    backpackShader.setMat4("view", view);
-    backpackShader.setMat4("projection", projection);
-
-    //spotLight for model
-    backpackShader.setFloat("spotLight.lightConst", lightConst);
-    backpackShader.setFloat("spotLight.linearConst", linearConst);
-    backpackShader.setFloat("spotLight.quadraticConst", quadraticConst);
-    backpackShader.setInt("spotLight.spotLightFlag", spotLightFlag);
-    backpackShader.setVec3("spotLight.position", cameraPos);
-    backpackShader.setVec3("spotLight.direction", cameraFront);
-    backpackShader.setVec3("spotLight.color", glm::vec3 (1.0f));
-    backpackShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(10.0f)));
-    backpackShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(12.5f)));
-
-    //firefly
-    backpackShader.setFloat("pointLight.lightConst", lightConst);
-    backpackShader.setFloat("pointLight.linearConst", linearConst);
-    backpackShader.setFloat("pointLight.quadraticConst", quadraticConst);
-    backpackShader.setVec3("pointLight.position", lightPosition);
-    backpackShader.setVec3("pointLight.color", lightColor);
+// context: the program and the Model
+void drawModel(const RenderCommand &command) {
+    const shader &program = *(const shader*)command.context[0];
+    ((const Model*)command.context[1])->Draw(program);
+}
 
-    backpackShader.setVec3("viewPos", cameraPos);
+void renderModels(const shader &modelShader, const SceneDescription &description, const SceneEntities &entities,
+                  const std::vector<Model> &models, StreamBuffer &stream, RenderQueue &queue, CullContext &cull) {
+    RG_PROFILE_ZONE("submit models");
+    for (const SceneFile::Object &object : description.objects(SceneFile::MODEL)) {
+        const Model &model = models[description.index(object.model.pointer)];
+        glm::mat4 world = entities.world(description, object);
+        if (!cull.visible(model.bounds, world)) {
+            continue;
+        }
 
-    //sun light
-    backpackShader.setVec3("dirLight.direction", sunLightDirection);
-    backpackShader.setVec3("dirLight.color", sunLightColor);
-    backpackModel.Draw(backpackShader);
+        RenderCommand command;
+        if (!writeDrawUniforms(command, stream, world)) {
+            return;
+        }
+        command.program = modelShader.ID;
+        command.custom = drawModel;
+        command.drawCalls = (unsigned)model.meshes.size();
+        command.context[0] = &modelShader;
+        command.context[1] = &model;
+        command.zone = "models";
+        queue.submit(command, glm::vec3(world[3]));
+    }
 }
 
-void generateRocks(Model rockModel){
-
-    srand(glfwGetTime()); // initialize random seed
+// A ring group's instances from rand(), then the ones the scene file lists.
+void generateInstances(InstanceGroup &group){
 
+    const SceneFile::Group &record = group.record;
+    unsigned int amount = record.ringCount;
+    float radius = record.ringRadius;
+    float offset = record.ringOffset;
     for (unsigned int i = 0; i < amount; i++)
     {
         glm::mat4 model = glm::mat4(1.0f);
@@ -603,7 +1536,7 @@ void generateRocks(Model rockModel){
         float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
         float x = sin(angle) * radius + displacement;
         float z = cos(angle) * radius + displacement;
-        model = glm::translate(model, glm::vec3(x, -0.01, z));
+        model = glm::translate(model, glm::vec3(x, record.ringHeight, z));
 
         // 2. scale: Scale between 0.01 and 0.10f
         float scale = (rand() % 20) / 250.0f + 0.01;
@@ -614,291 +1547,201 @@ void generateRocks(Model rockModel){
         model = glm::rotate(model, rotAngle, glm::vec3(0.0f, 1.0f, 0.0f));
 
         // 4. now add to list of matrices
-        modelMatrices[i] = model;
+        group.batch.add(model);
     }
-
-    // configure instanced array
-    // -------------------------
-    glGenBuffers(1, &buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
-
-    // set transformation matrices as an instance vertex attribute (with divisor 1)
-    // note: we're cheating a little by taking the, now publicly declared, VAO of the model's mesh(es) and adding new vertexAttribPointers
-    // normally you'd want to do this in a more organized fashion, but for learning purposes this will do.
-    // -----------------------------------------------------------------------------------------------------------------------------------
-    for (unsigned int i = 0; i < rockModel.meshes.size(); i++)
-    {
-        unsigned int VAO = rockModel.meshes[i].VAO;
-        glBindVertexArray(VAO);
-        // set attribute pointers for matrix (4 times vec4)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-
-        glBindVertexArray(0);
-    }
-}
-
-void renderRocks(shader rockShader, Model rockModel, glm::mat4 view, glm::mat4 projection) {
-
-    rockShader.use();
-
-    rockShader.setFloat("spotLight.lightConst", lightConst);
-    rockShader.setFloat("spotLight.linearConst", linearConst);
-    rockShader.setFloat("spotLight.quadraticConst", quadraticConst);
-    rockShader.setInt("spotLight.spotLightFlag", spotLightFlag);
-    rockShader.setVec3("spotLight.position", cameraPos);
-    rockShader.setVec3("spotLight.direction", cameraFront);
-    rockShader.setVec3("spotLight.color", glm::vec3 (1.0f));
-    rockShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(10.0f)));
-    rockShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(12.5f)));
-    rockShader.setVec3("lightColor", lightColor);
-    rockShader.setVec3("viewPos", cameraPos);
-
-    rockShader.setMat4("projection", projection);
-    rockShader.setMat4("view", view);
-    rockShader.setVec3("dirLight.direction", sunLightDirection);
-    rockShader.setVec3("dirLight.color", sunLightColor);
-    rockShader.setVec3("viewPos", cameraPos);
-    rockShader.setInt("texture_diffuse1", 0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, rockModel.textures_loaded[0].id); // note: we also made the textures_loaded vector public (instead of private) from the model class.
-    for (unsigned int i = 0; i < rockModel.meshes.size(); i++)
-    {
-        glBindVertexArray(rockModel.meshes[i].VAO);
-        glDrawElementsInstanced(GL_TRIANGLES, rockModel.meshes[i].indices.size(), GL_UNSIGNED_INT, 0, amount);
-        glBindVertexArray(0);
+    for (uint32_t i = 0; i < record.instanceCount; i++)
+        group.batch.add(record.instances.pointer[i]);
+
+    // the instances never move, so their spheres are computed once; the frame's buffers are sized for all of them
+    size_t count = group.batch.size();
+    group.bounds.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        group.bounds.push_back(rg::boundingSphere(group.model.bounds, group.batch.matrices()[i]));
+        group.center += glm::vec3(group.batch.matrices()[i][3]) / (float)count;
+    }
+    group.visible.resize(count);
+    group.visibleMatrices.resize(count);
+    if (count == 0) {
+        return;
     }
-}
-
-void renderPyramid(Shader pyramidShader, Texture2D pyramidTexture, unsigned VAO, glm::mat4 model, glm::mat4 view, glm::mat4 projection) {
-    //Set matrices for pyramid
-    pyramidShader.use();
-    pyramidShader.setMat4("model", model);
-    pyramidShader.setMat4("view", view);
-    pyramidShader.setMat4("projection", projection);
-
-    //viewPos
-    pyramidShader.setVec3("viewPos", cameraPos);
-
-    //spotLight specification
-    pyramidShader.setFloat("spotLight.lightConst", lightConst);
-    pyramidShader.setFloat("spotLight.linearConst", linearConst);
-    pyramidShader.setFloat("spotLight.quadraticConst", quadraticConst);
-    pyramidShader.setInt("spotLight.spotLightFlag", spotLightFlag);
-    pyramidShader.setVec3("spotLight.position", cameraPos);
-    pyramidShader.setVec3("spotLight.direction", cameraFront);
-    pyramidShader.setVec3("spotLight.color", glm::vec3 (1.0f));
-    pyramidShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(10.0f)));
-    pyramidShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(12.5f)));
-
-//        //sunLight specification
-    pyramidShader.setVec3("dirLight.direction", sunLightDirection);
-    pyramidShader.setVec3("dirLight.color", sunLightColor);
-//
-//        //bug1 specification
-    pyramidShader.setFloat("pointLight.lightConst", lightConst);
-    pyramidShader.setFloat("pointLight.linearConst", linearConst);
-    pyramidShader.setFloat("pointLight.quadraticConst", quadraticConst);
-    pyramidShader.setVec3("pointLight.position", lightPosition);
-    pyramidShader.setVec3("pointLight.color", lightColor);
-
-    //pyramid texture
-    pyramidShader.setInt("texture_pyramid", 0);
-    pyramidTexture.activate(GL_TEXTURE0);
 
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 12);
+    group.batch.upload();
 
-    glBindVertexArray(0);
+    // the frame's survivors of the CPU test are packed in here
+    glGenBuffers(1, &group.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, group.buffer);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
 }
 
-void renderGround(Shader groundShader, Texture2D groundTexture, std::string texUniformName ,unsigned int VAO, glm::mat4 view,
-                  glm::mat4 projection) {
-
-    glm::mat4 model = glm::mat4(1.0f);
-
-    groundShader.use();
-    groundShader.setMat4("model", model);
-    groundShader.setMat4("view", view);
-    groundShader.setMat4("projection", projection);
-
-    //viewPos
-    groundShader.setVec3("viewPos", cameraPos);
-
-    //sun light (directional light)
-    groundShader.setVec3("dirLight.direction", sunLightDirection);
-    groundShader.setVec3("dirLight.color", sunLightColor);
-
-    //bug light (point light)
-    groundShader.setFloat("pointLight.lightConst", lightConst);
-    groundShader.setFloat("pointLight.linearConst", linearConst);
-    groundShader.setFloat("pointLight.quadraticConst", quadraticConst);
-    groundShader.setVec3("pointLight.position", lightPosition);
-    groundShader.setVec3("pointLight.color", lightColor);
-
-    //spotlight
-    groundShader.setFloat("spotLight.lightConst", lightConst);
-    groundShader.setFloat("spotLight.linearConst", linearConst);
-    groundShader.setFloat("spotLight.quadraticConst", quadraticConst);
-    groundShader.setInt("spotLight.spotLightFlag", spotLightFlag);
-    groundShader.setVec3("spotLight.position", cameraPos);
-    groundShader.setVec3("spotLight.direction", cameraFront);
-    groundShader.setVec3("spotLight.color", glm::vec3 (1.0f));
-    groundShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(10.0f)));
-    groundShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(12.5f)));
-
-    // texture activation
-    groundShader.setInt(texUniformName, 0);
-    groundTexture.activate(GL_TEXTURE0);
-
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+// context: the InstancedBatch, and the InstanceCuller when the GPU culled them. Without one the
+// command's instanceCount is how many matrices survived on the CPU.
+void drawRocks(const RenderCommand &command) {
+    const InstancedBatch &rocks = *(const InstancedBatch*)command.context[0];
+    const InstanceCuller *culler = (const InstanceCuller*)command.context[1];
+    if (culler) {
+        for (unsigned int i = 0; i < rocks.parts().size(); i++)
+        {
+            rg::glState().bindVertexArray(rocks.parts()[i].VAO);
+            culler->draw(i);
+        }
+    } else {
+        rocks.draw(command.instanceCount);
+    }
 }
 
-void renderFirefly(Shader fireflyShader, unsigned VAO, glm::mat4 view, glm::mat4 projection) {
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, lightPosition);
-    model = glm::scale(model, glm::vec3(0.04f));
-
-    fireflyShader.use();
-
-    fireflyShader.setMat4("model", model);
-    fireflyShader.setMat4("view", view);
-    fireflyShader.setMat4("projection", projection);
-
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+void renderGroups(const shader &rockShader, std::vector<std::unique_ptr<InstanceGroup>> &groups, RenderQueue &queue,
+                  CullContext &cull) {
+    // a GPU zone still: the compute or transform feedback culling runs here, before the draws are queued
+    RG_PROFILE_GPU_ZONE("cull groups");
+    for (std::unique_ptr<InstanceGroup> &group : groups) {
+        if (group->batch.size() > 0) {
+            renderGroup(rockShader, *group, queue, cull);
+        }
+    }
 }
 
-void renderBeams(Shader obeliskShader, unsigned VAO, glm::mat4 view, glm::mat4 projection) {
-    obeliskShader.use();
-
-    //sun light (directional light)
-    obeliskShader.setVec3("dirLight.direction", sunLightDirection);
-    obeliskShader.setVec3("dirLight.color", sunLightColor);
-
-    //bug light (point light)
-    obeliskShader.setFloat("pointLight.lightConst", lightConst);
-    obeliskShader.setFloat("pointLight.linearConst", linearConst);
-    obeliskShader.setFloat("pointLight.quadraticConst", quadraticConst);
-    obeliskShader.setVec3("pointLight.position", lightPosition);
-    obeliskShader.setVec3("pointLight.color", lightColor);
+void renderGroup(const shader &rockShader, InstanceGroup &group, RenderQueue &queue, CullContext &cull) {
+    // with frustum culling off they all go the CPU way, untested
+    bool onGpu = gpuCulling && group.culler && tuning.frustumCulling;
+    size_t instanceCount = std::min<size_t>(tuning.rockCount, group.batch.size());
+    size_t visibleCount;
+    if (onGpu) {
+        // the survivors never come back to the CPU; the count in the stats is a frame old
+        group.culler->cull(cull.frustum, *instanceOccluders);
+        group.batch.setSource(group.culler->visibleMatrices());
+        visibleCount = group.culler->lastVisibleCount();
+    } else {
+        const BoundingSpheres &bounds = group.bounds;
+        if (tuning.frustumCulling) {
+            visibleCount = cull.frustum.cullSpheres(bounds.x.data(), bounds.y.data(), bounds.z.data(),
+                                                    bounds.radius.data(), instanceCount, group.visible.data());
+            for (size_t i = 0; i < visibleCount; i++) {
+                group.visibleMatrices[i] = group.batch.matrices()[group.visible[i]];
+            }
+        } else {
+            visibleCount = instanceCount;
+            std::copy(group.batch.matrices(), group.batch.matrices() + instanceCount, group.visibleMatrices.begin());
+        }
+        if (visibleCount > 0) {
+            glBindBuffer(GL_ARRAY_BUFFER, group.buffer);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, visibleCount * sizeof(glm::mat4), group.visibleMatrices.data());
+            group.batch.setSource(group.buffer);
+        }
+    }
+    cull.stats.submitted += instanceCount;
+    cull.stats.visible += visibleCount;
+    if (!onGpu && visibleCount == 0) {
+        return;
+    }
 
-    //spotlight
-    obeliskShader.setFloat("spotLight.lightConst", lightConst);
-    obeliskShader.setFloat("spotLight.linearConst", linearConst);
-    obeliskShader.setFloat("spotLight.quadraticConst", quadraticConst);
-    obeliskShader.setInt("spotLight.spotLightFlag", spotLightFlag);
-    obeliskShader.setVec3("spotLight.position", cameraPos);
-    obeliskShader.setVec3("spotLight.direction", cameraFront);
-    obeliskShader.setVec3("spotLight.color", glm::vec3 (1.0f));
-    obeliskShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(10.0f)));
-    obeliskShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(12.5f)));
+    RenderCommand command;
+    command.program = rockShader.ID;
+    command.VAO = group.batch.parts()[0].VAO;
+    // note: we also made the textures_loaded vector public (instead of private) from the model class.
+    command.textures[0] = group.model.textures_loaded.empty() ? 0 : group.model.textures_loaded[0].id;
+    command.instanceCount = (GLsizei)visibleCount;
+    command.custom = drawRocks;
+    command.drawCalls = (unsigned)group.batch.parts().size();
+    command.context[0] = &group.batch;
+    command.context[1] = onGpu ? group.culler : nullptr;
+    command.zone = "groups";
+    if (group.record.ringCount) {
+        queue.submit(command, group.record.ringRadius);
+    } else {
+        queue.submit(command, group.center);
+    }
+}
 
-    obeliskShader.setVec3("material.ambient", glm::vec3(0.0215,	0.1745, 0.0215));
-    obeliskShader.setVec3("material.diffuse", glm::vec3(0.07568, 0.61424, 0.07568));
-    obeliskShader.setVec3("material.specular", glm::vec3(0.633, 0.727811, 0.633));
-    obeliskShader.setFloat("material.shininess", 0.6);
+void renderPyramid(const Shader &pyramidShader, const Texture2D &pyramidTexture, unsigned VAO, const glm::mat4 &model,
+                   bool cullFace, StreamBuffer &stream, RenderQueue &queue) {
+    //Set matrices for pyramid
+    RenderCommand command;
+    if (!writeDrawUniforms(command, stream, model)) {
+        return;
+    }
+    command.program = pyramidShader.id();
 
-    obeliskShader.setVec3("viewPos", lightPosition);
+    //pyramid texture
+    command.textures[0] = pyramidTexture.m_tex;
 
-    glBindVertexArray(VAO);
+    command.VAO = VAO;
+    command.count = 12;
+    command.cullFace = cullFace;
+    command.zone = "pyramids";
+    queue.submit(command, glm::vec3(model[3]));
+}
 
-    for (int i = 0; i < 12 && beams; i++) {
+void renderGround(const Shader &groundShader, const SceneDescription &description, const SceneEntities &entities,
+                  const std::vector<Texture2D> &textures, unsigned int VAO, const AABB &bounds, StreamBuffer &stream,
+                  RenderQueue &queue, CullContext &cull) {
+    RG_PROFILE_ZONE("submit ground");
 
-        float radius = 7.0f;
-        glm::mat4 model_obelisk = glm::mat4(1.0f);
-        float angle = 30.0f;
+    for (const SceneFile::Object &ground : description.objects(SceneFile::GROUND)) {
+        glm::mat4 world = entities.world(description, ground);
+        if (!cull.visible(bounds, world)) {
+            continue;
+        }
 
-        model_obelisk = glm::translate(model_obelisk, glm::vec3(radius * glm::cos(glm::radians(i*angle)) + 5.0f, 0.0, radius * glm::sin(glm::radians(i*angle))-5.0f));
-        model_obelisk = glm::scale(model_obelisk, glm::vec3(0.02f, 5000.0f,  0.02f));
+        RenderCommand command;
+        if (!writeDrawUniforms(command, stream, world)) {
+            return;
+        }
+        command.program = groundShader.id();
 
-        obeliskShader.setMat4("model", model_obelisk);
-        obeliskShader.setMat4("view", view);
-        obeliskShader.setMat4("projection", projection);
+        // texture activation
+        command.textures[0] = objectTexture(description, textures, ground, 0).m_tex;
 
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        command.VAO = VAO;
+        command.count = 6;
+        command.zone = "ground";
+        // its nearest point is right under the camera
+        queue.submit(command, glm::vec3(cameraPos.x, world[3].y, cameraPos.z));
     }
-
-    glBindVertexArray(0);
 }
 
-void renderBoxes(Shader boxShader, unsigned VAO, Texture2D woodTexture, Texture2D metalTexture, glm::mat4 view, glm::mat4 projection) {
-    //model
-    glm::mat4 model_cube = glm::mat4(1.0f);
-    model_cube = glm::translate(model_cube, glm::vec3(1.3, 0.12, -2.3));
-    model_cube = glm::scale(model_cube, glm::vec3(0.2f));
-
-    renderBox(boxShader, VAO, woodTexture, "material.diffuse", metalTexture, "material.specular", model_cube, view, projection);
-
-    model_cube = glm::translate(model_cube, glm::vec3(1.1 , 0.0, 1.2));
-    model_cube = glm::rotate(model_cube, glm::radians(29.0f), glm::vec3(0.0, 1.0, 0.0));
-
-    renderBox(boxShader, VAO, woodTexture, "material.diffuse", metalTexture, "material.specular", model_cube, view, projection);
-
-    model_cube = glm::translate(model_cube, glm::vec3(0.1 , 1.0, -0.15));
-    model_cube = glm::rotate(model_cube, glm::radians(18.0f), glm::vec3(0.0, 1.0, 0.0));
-    boxShader.setMat4("model", model_cube);
-    boxShader.setMat4("view", view);
-    boxShader.setMat4("projection", projection);
+void renderFirefly(const Shader &fireflyShader, unsigned VAO, const SceneEntities &entities, const AABB &bounds,
+                   DrawBatcher &batcher, CullContext &cull) {
+    RG_PROFILE_ZONE("submit firefly");
+    glm::mat4 model = entities.transforms.world(entities.firefly);
+    if (!cull.visible(bounds, model)) {
+        return;
+    }
 
-    renderBox(boxShader, VAO, woodTexture, "material.diffuse", metalTexture, "material.specular", model_cube, view, projection);
+    batcher.submit({fireflyShader.id(), VAO, 36, {0, 0}, "firefly"}, {model, glm::vec4(lights.pointColor, 1.0f)});
 }
 
-void renderBox(Shader boxShader, unsigned VAO, Texture2D woodTexture, std::string woodTexUniformName,
-               Texture2D metalTexture, std::string metalTexUniformName, glm::mat4 model, glm::mat4 view, glm::mat4 projection) {
-    boxShader.use();
-    boxShader.setMat4("model", model);
-    boxShader.setMat4("view", view);
-    boxShader.setMat4("projection", projection);
-    //viewPos
-    boxShader.setVec3("viewPos", cameraPos);
+void renderBeams(const Shader &obeliskShader, unsigned VAO, const SceneDescription &description, const SceneEntities &entities,
+                 const AABB &bounds, DrawBatcher &batcher, CullContext &cull) {
+    RG_PROFILE_ZONE("submit beams");
+    // diffuse colour and shininess
+    const glm::vec4 material = glm::vec4(0.07568, 0.61424, 0.07568, 0.6);
 
-    //sun light (directional light)
-    boxShader.setVec3("dirLight.direction", sunLightDirection);
-    boxShader.setVec3("dirLight.color", sunLightColor);
+    if (!beams) {
+        return;
+    }
+    for (const SceneFile::Object &beam : description.objects(SceneFile::BEAM)) {
+        glm::mat4 world = entities.world(description, beam);
+        if (cull.visible(bounds, world)) {
+            batcher.submit({obeliskShader.id(), VAO, 36, {0, 0}, "beams"}, {world, material});
+        }
+    }
+}
 
-    //bug light (point light)
-    boxShader.setFloat("pointLight.lightConst", lightConst);
-    boxShader.setFloat("pointLight.linearConst", linearConst);
-    boxShader.setFloat("pointLight.quadraticConst", quadraticConst);
-    boxShader.setVec3("pointLight.position", lightPosition);
-    boxShader.setVec3("pointLight.color", lightColor);
+// the crates stacked by the small pyramid: their world matrices chain through the scene's parents
+void renderBoxes(const Shader &boxShader, unsigned VAO, const SceneDescription &description, const SceneEntities &entities,
+                 const std::vector<Texture2D> &textures, const AABB &bounds, DrawBatcher &batcher, CullContext &cull) {
+    RG_PROFILE_ZONE("submit boxes");
+    for (const SceneFile::Object &box : description.objects(SceneFile::BOX)) {
+        glm::mat4 world = entities.world(description, box);
+        if (cull.visible(bounds, world)) {
+            renderBox(boxShader, VAO, objectTexture(description, textures, box, 0), objectTexture(description, textures, box, 1),
+                      world, batcher);
+        }
+    }
+}
 
-    //spotlight
-    boxShader.setFloat("spotLight.lightConst", lightConst);
-    boxShader.setFloat("spotLight.linearConst", linearConst);
-    boxShader.setFloat("spotLight.quadraticConst", quadraticConst);
-    boxShader.setInt("spotLight.spotLightFlag", spotLightFlag);
-    boxShader.setVec3("spotLight.position", cameraPos);
-    boxShader.setVec3("spotLight.direction", cameraFront);
-    boxShader.setVec3("spotLight.color", glm::vec3 (1.0f));
-    boxShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(10.0f)));
-    boxShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(12.5f)));
-
-    boxShader.setFloat("material.shininess", 16.0f);
-
-    boxShader.setInt(woodTexUniformName, 0);
-    woodTexture.activate(GL_TEXTURE0);
-
-    boxShader.setInt(metalTexUniformName, 1);
-    metalTexture.activate(GL_TEXTURE1);
-
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+void renderBox(const Shader &boxShader, unsigned VAO, const Texture2D &woodTexture,
+               const Texture2D &metalTexture, const glm::mat4 &model, DrawBatcher &batcher) {
+    // shininess
+    batcher.submit({boxShader.id(), VAO, 36, {woodTexture.m_tex, metalTexture.m_tex}, "boxes"}, {model, glm::vec4(16.0f, 0.0f, 0.0f, 0.0f)});
 }
\ No newline at end of file
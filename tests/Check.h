@@ -0,0 +1,34 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+#ifndef PROJECT_BASE_CHECK_H
+#define PROJECT_BASE_CHECK_H
+
+#include <iostream>
+
+// The tests are plain executables run by ctest. A CHECK that fails prints where and what and the run
+// goes on; main returns checkResult(), non-zero when anything failed.
+
+int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+int checkResult() {
+    if (checkFailures() != 0) {
+        std::cout << checkFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#define CHECK(condition)                                                                                  \
+    do {                                                                                                  \
+        if (!(condition)) {                                                                               \
+            ++checkFailures();                                                                            \
+            std::cout << "ERROR::TEST::" << __FILE__ << ":" << __LINE__ << ": " << #condition << std::endl; \
+        }                                                                                                 \
+    } while (false)
+
+#endif //PROJECT_BASE_CHECK_H
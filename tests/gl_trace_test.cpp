@@ -0,0 +1,171 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// include/rg/GlTrace.h over GlMock: a few frames of draws are counted as they are made, written to a
+// trace, and played back with include/rg/GlTraceReplay.h into a second trace that has to make the same
+// calls. Both traces go to a fresh directory under /tmp that is removed at the end.
+
+#include <glad/glad.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <rg/GlMock.h>
+#include <rg/GlTrace.h>
+#include <rg/GlTraceReplay.h>
+#include "Check.h"
+
+static const unsigned FRAMES = 3;
+
+// frame n sets a matrix, makes 2 + n draws with a uniform before each and one indexed draw
+static unsigned drawsIn(unsigned frame) {
+    return 3 + frame;
+}
+static unsigned uniformsIn(unsigned frame) {
+    return 3 + frame;
+}
+
+struct Scene {
+    GLuint program = 0, VAO = 0, buffer = 0;
+    GLint index = -1, transform = -1;
+};
+
+static Scene load() {
+    Scene scene;
+    const char *source = "#version 330 core\nuniform int index;\nuniform mat4 transform;\nvoid main() {}\n";
+    GLuint shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    scene.program = glCreateProgram();
+    glAttachShader(scene.program, shader);
+    glLinkProgram(scene.program);
+    glDeleteShader(shader);
+    scene.index = glGetUniformLocation(scene.program, "index");
+    scene.transform = glGetUniformLocation(scene.program, "transform");
+
+    float vertices[9] = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+    glGenVertexArrays(1, &scene.VAO);
+    glGenBuffers(1, &scene.buffer);
+    glBindVertexArray(scene.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, scene.buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glBindVertexArray(0);
+    return scene;
+}
+
+static void draw(const Scene &scene, unsigned frame) {
+    float transform[16] = {};
+    for (int i = 0; i < 4; ++i) {
+        transform[i * 5] = 1.0f + frame;
+    }
+    glUseProgram(scene.program);
+    glBindVertexArray(scene.VAO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(transform[0]), &transform[0]);
+    glUniformMatrix4fv(scene.transform, 1, GL_FALSE, transform);
+    for (unsigned i = 0; i < 2 + frame; ++i) {
+        glUniform1i(scene.index, (GLint)i);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, (void*)0);
+    glBindVertexArray(0);
+}
+
+// the counts the trace keeps while recording, and those read back from the file
+static void countsWhileRecording(const std::string &path) {
+    CHECK(rg::glTrace().open(path, (GLADloadproc)GlMock::loadFunction));
+    CHECK(gladLoadGLLoader((GLADloadproc)GlTrace::loadFunction));
+    CHECK(rg::glTrace().recording());
+    Scene scene = load();
+    for (unsigned frame = 0; frame < FRAMES; ++frame) {
+        draw(scene, frame);
+        CHECK(rg::glTrace().frame().draws() == drawsIn(frame));
+        rg::glTrace().endFrame();
+        CHECK(rg::glTrace().lastFrame().draws() == drawsIn(frame));
+        CHECK(rg::glTrace().lastFrame().uniforms() == uniformsIn(frame));
+        CHECK(rg::glTrace().frame().calls == 0);
+    }
+    CHECK(rg::glTrace().frames() == FRAMES);
+    // the one buffer store, 9 floats
+    CHECK(rg::glTrace().memory().buffers == 9 * sizeof(float));
+    rg::glTrace().close();
+
+    GlTraceFile file;
+    CHECK(file.open(path));
+    std::vector<GlTraceStats> frames;
+    file.frameStats(frames);
+    CHECK(frames.size() == FRAMES);
+    for (unsigned frame = 0; frame < FRAMES && frame < frames.size(); ++frame) {
+        CHECK(frames[frame].draws() == drawsIn(frame));
+        CHECK(frames[frame].uniforms() == uniformsIn(frame));
+    }
+}
+
+// Replaying the trace through a second GlTrace has to record the same calls. Names GlMock hands out
+// differ between the two, so only the draws and uniform uploads are compared byte for byte.
+static void replayRoundTrip(const std::string &recorded, const std::string &replayed) {
+    GlTraceFile original;
+    CHECK(original.open(recorded));
+    CHECK(rg::glTrace().open(replayed, (GLADloadproc)GlMock::loadFunction));
+    GlTraceReplay replay(original);
+    unsigned frames = 0;
+    while (replay.replayFrame()) {
+        rg::glTrace().endFrame();
+        ++frames;
+    }
+    rg::glTrace().close();
+    CHECK(frames == FRAMES);
+
+    GlTraceFile copy;
+    CHECK(copy.open(replayed));
+    size_t a = original.begin(), b = copy.begin();
+    GlTraceFile::Record left, right;
+    unsigned records = 0, compared = 0;
+    bool same = true;
+    while (original.next(a, left)) {
+        if (!copy.next(b, right)) {
+            same = false;
+            break;
+        }
+        ++records;
+        if (left.call != right.call || left.size != right.size) {
+            std::cout << "ERROR::TEST:: record " << records << " is " << GlCall::name(left.call) << " in the trace and "
+                      << GlCall::name(right.call) << " in its replay" << std::endl;
+            same = false;
+            break;
+        }
+        GlCall::Type type = GlCall::type(left.call);
+        if (type == GlCall::DRAW || type == GlCall::UNIFORM) {
+            same = same && std::memcmp(left.data, right.data, left.size) == 0;
+            ++compared;
+        }
+    }
+    CHECK(same);
+    CHECK(!copy.next(b, right));
+    CHECK(records == replay.calls() + FRAMES);
+    unsigned expected = 0;
+    for (unsigned frame = 0; frame < FRAMES; ++frame) {
+        expected += drawsIn(frame) + uniformsIn(frame);
+    }
+    CHECK(compared == expected);
+}
+
+int main() {
+    char pattern[] = "/tmp/rg_gl_trace_XXXXXX";
+    if (!mkdtemp(pattern)) {
+        std::cout << "ERROR::TEST:: no temporary directory" << std::endl;
+        return 1;
+    }
+    std::string directory = pattern;
+    std::string recorded = directory + "/recorded.trace", replayed = directory + "/replayed.trace";
+    countsWhileRecording(recorded);
+    replayRoundTrip(recorded, replayed);
+    std::remove(recorded.c_str());
+    std::remove(replayed.c_str());
+    rmdir(directory.c_str());
+    return checkResult();
+}
@@ -0,0 +1,284 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// include/rg/ProgramBinaryCache.h on its own, and through rg::buildProgram against GlMock, without a GPU.
+// Everything is written to a fresh directory under /tmp that is removed at the end.
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <rg/GlMock.h>
+#include <rg/ProgramBuilder.h>
+#include "Check.h"
+
+static const char* DRIVER = "rg\nrg mock, no driver\n3.3 (core profile) rg mock\n";
+
+static std::vector<char> readBytes(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void writeBytes(const std::string &path, const std::vector<char> &bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+}
+
+static bool exists(const std::string &path) {
+    return std::ifstream(path).good();
+}
+
+static ProgramBinary someBinary(char fill, size_t size = 300) {
+    ProgramBinary binary;
+    binary.format = 0x1234;
+    binary.data.assign(size, fill);
+    for (size_t i = 0; i < size; i += 7) {
+        binary.data[i] = (char)i;
+    }
+    return binary;
+}
+
+static void keys() {
+    ProgramBinaryCache cache("/nowhere", DRIVER);
+    std::string a[] = {"#version 330 core\nvoid main() {}\n", "#version 330 core\nout vec4 c;\nvoid main() {}\n"};
+    std::string b[] = {a[0], a[1] + " "};
+    std::string split[] = {"ab", "c"}, joined[] = {"a", "bc"};
+
+    ProgramBinaryCache::Key key = cache.makeKey(a, 2);
+    CHECK(key.sources == cache.makeKey(a, 2).sources && key.full == cache.makeKey(a, 2).full);
+    CHECK(key.sources != cache.makeKey(b, 2).sources && key.full != cache.makeKey(b, 2).full);
+    CHECK(key.sources != cache.makeKey(a, 1).sources);
+    CHECK(cache.makeKey(split, 2).sources != cache.makeKey(joined, 2).sources);
+    // a permutation is a different preprocessed source, so a different program
+    std::string spotLight[] = {"#version 330 core\n#define SPOT_LIGHT 1\n", a[1]};
+    std::string noSpotLight[] = {"#version 330 core\n#define SPOT_LIGHT 0\n", a[1]};
+    CHECK(cache.makeKey(spotLight, 2).sources != cache.makeKey(noSpotLight, 2).sources);
+
+    // another driver, or another version of it, uses the same file but can't read what this one wrote
+    ProgramBinaryCache updated("/nowhere", "rg\nrg mock, no driver\n3.3 (core profile) rg mock 2\n");
+    CHECK(updated.makeKey(a, 2).sources == key.sources);
+    CHECK(updated.makeKey(a, 2).full != key.full);
+    CHECK(updated.path(updated.makeKey(a, 2)) == cache.path(key));
+    CHECK(cache.path(key).compare(0, 9, "/nowhere/") == 0);
+}
+
+static void storeAndLoad(const std::string &directory) {
+    ProgramBinaryCache cache(directory, DRIVER);
+    std::string sources[] = {"vertex", "fragment"};
+    ProgramBinaryCache::Key key = cache.makeKey(sources, 2);
+    ProgramBinary stored = someBinary('x'), loaded;
+
+    CHECK(!cache.load(key, loaded));
+    CHECK(cache.misses() == 1 && cache.stale() == 0);
+    CHECK(cache.store(key, stored));
+    CHECK(exists(cache.path(key)) && !exists(cache.path(key) + ".tmp"));
+    CHECK(cache.load(key, loaded));
+    CHECK(loaded.format == stored.format && loaded.data == stored.data);
+    CHECK(cache.hits() == 1 && cache.stores() == 1);
+
+    // an empty binary is still a binary
+    std::string empty[] = {"empty"};
+    CHECK(cache.store(cache.makeKey(empty, 1), ProgramBinary()));
+    CHECK(cache.load(cache.makeKey(empty, 1), loaded) && loaded.data.empty());
+
+    // the driver wouldn't take it: gone, and counted as a miss
+    cache.reject(key);
+    CHECK(!exists(cache.path(key)));
+    CHECK(cache.rejected() == 1 && cache.hits() == 1 && cache.misses() == 2);
+    CHECK(!cache.load(key, loaded));
+}
+
+// Stores a good entry, lets damage() change the file, and expects load() to miss and delete it.
+template <typename Damage>
+static void expectStale(const std::string &directory, const char *what, Damage damage) {
+    ProgramBinaryCache cache(directory, DRIVER);
+    std::string sources[] = {what};
+    ProgramBinaryCache::Key key = cache.makeKey(sources, 1);
+    CHECK(cache.store(key, someBinary('s')));
+    std::string file = cache.path(key);
+    std::vector<char> bytes = readBytes(file);
+    damage(bytes);
+    writeBytes(file, bytes);
+
+    ProgramBinary loaded = someBinary('?');
+    bool hit = cache.load(key, loaded);
+    if (hit || cache.stale() != 1 || cache.misses() != 1 || !loaded.data.empty() || exists(file)) {
+        std::cout << "    " << what << " was not thrown away" << std::endl;
+    }
+    CHECK(!hit && cache.stale() == 1 && cache.misses() == 1);
+    CHECK(loaded.data.empty());
+    CHECK(!exists(file));
+}
+
+static void staleEntries(const std::string &directory) {
+    using Header = ProgramBinaryCache::Header;
+    expectStale(directory, "empty file", [](std::vector<char> &bytes) { bytes.clear(); });
+    expectStale(directory, "truncated header", [](std::vector<char> &bytes) { bytes.resize(sizeof(Header) - 1); });
+    expectStale(directory, "truncated payload", [](std::vector<char> &bytes) { bytes.pop_back(); });
+    expectStale(directory, "trailing bytes", [](std::vector<char> &bytes) { bytes.push_back(0); });
+    expectStale(directory, "corrupt payload", [](std::vector<char> &bytes) { bytes[sizeof(Header) + 100] ^= 1; });
+    expectStale(directory, "corrupt checksum", [](std::vector<char> &bytes) { bytes[offsetof(Header, checksum)] ^= 1; });
+    expectStale(directory, "wrong magic", [](std::vector<char> &bytes) { bytes[0] = 'X'; });
+    expectStale(directory, "wrong version", [](std::vector<char> &bytes) {
+        uint32_t version = ProgramBinaryCache::FORMAT_VERSION + 1;
+        std::memcpy(&bytes[offsetof(Header, version)], &version, sizeof(version));
+    });
+    expectStale(directory, "wrong key", [](std::vector<char> &bytes) { bytes[offsetof(Header, key)] ^= 1; });
+    expectStale(directory, "oversized", [](std::vector<char> &bytes) {
+        uint32_t size = ProgramBinaryCache::MAX_BINARY_SIZE + 1;
+        std::memcpy(&bytes[offsetof(Header, size)], &size, sizeof(size));
+    });
+
+    // written by another driver
+    ProgramBinaryCache other(directory, "another vendor\n");
+    std::string sources[] = {"other driver"};
+    CHECK(other.store(other.makeKey(sources, 1), someBinary('o')));
+    ProgramBinaryCache cache(directory, DRIVER);
+    ProgramBinary loaded;
+    CHECK(!cache.load(cache.makeKey(sources, 1), loaded));
+    CHECK(cache.stale() == 1 && !exists(cache.path(cache.makeKey(sources, 1))));
+}
+
+// What GlMock leaves out for the GL side of the cache: the binary entry points, a binary length, a driver
+// that can refuse a binary, and a count of source compiles.
+struct FakeDriver {
+    static unsigned& compiles() {
+        static unsigned count = 0;
+        return count;
+    }
+    static unsigned& binariesLoaded() {
+        static unsigned count = 0;
+        return count;
+    }
+    static bool& refuseBinaries() {
+        static bool refuse = false;
+        return refuse;
+    }
+    // the program a refused binary left unlinked, until it is linked from source
+    static GLuint& refusedProgram() {
+        static GLuint program = 0;
+        return program;
+    }
+
+    static void APIENTRY compileShader(GLuint) {
+        ++compiles();
+    }
+    static void APIENTRY linkProgram(GLuint program) {
+        refusedProgram() = program == refusedProgram() ? 0 : refusedProgram();
+    }
+    static void APIENTRY getProgramiv(GLuint program, GLenum name, GLint *value) {
+        if (name == GL_PROGRAM_BINARY_LENGTH) {
+            *value = 64;
+        } else if (name == GL_LINK_STATUS) {
+            *value = program == refusedProgram() ? GL_FALSE : GL_TRUE;
+        } else {
+            *value = 0;
+        }
+    }
+    static void APIENTRY getProgramBinary(GLuint program, GLsizei size, GLsizei *length, GLenum *format, void *binary) {
+        std::memset(binary, (int)program, (size_t)size);
+        *format = 0xB1;
+    }
+    static void APIENTRY programBinary(GLuint program, GLenum format, const void *binary, GLsizei length) {
+        ++binariesLoaded();
+        if (refuseBinaries() || format != 0xB1 || length != 64) {
+            refusedProgram() = program;
+        }
+    }
+    static void APIENTRY programParameteri(GLuint, GLenum, GLint) {}
+
+    static void load() {
+        gladLoadGLLoader((GLADloadproc) GlMock::loadFunction);
+        glad_glCompileShader = compileShader;
+        glad_glLinkProgram = linkProgram;
+        glad_glGetProgramiv = getProgramiv;
+        rg::ProgramBinaryFunctions &functions = rg::programBinaryFunctions();
+        functions.getProgramBinary = getProgramBinary;
+        functions.programBinary = programBinary;
+        functions.programParameteri = programParameteri;
+    }
+};
+
+static void sourceFallback(const std::string &directory) {
+    FakeDriver::load();
+    ProgramBinaryCache cache(directory + "/programs", rg::glDriverString());
+    rg::programBinaryCache() = &cache;
+    CHECK(rg::programBinaryCacheActive());
+
+    std::ofstream(directory + "/test.vert") << "#version 330 core\nvoid main() { gl_Position = vec4(0.0); }\n";
+    std::ofstream(directory + "/test.frag") << "#version 330 core\nout vec4 color;\nvoid main() { color = vec4(1.0); }\n";
+    rg::ShaderStages stages = {{GL_VERTEX_SHADER, directory + "/test.vert"}, {GL_FRAGMENT_SHADER, directory + "/test.frag"}};
+
+    // nothing stored yet: compiled from source, then stored
+    CHECK(rg::buildProgram(stages) != 0);
+    CHECK(FakeDriver::compiles() == 2 && FakeDriver::binariesLoaded() == 0);
+    CHECK(cache.misses() == 1 && cache.stores() == 1);
+
+    // the stored binary, no compile
+    CHECK(rg::buildProgram(stages) != 0);
+    CHECK(FakeDriver::compiles() == 2 && FakeDriver::binariesLoaded() == 1);
+    CHECK(cache.hits() == 1);
+
+    // another permutation is another program
+    CHECK(rg::buildProgram(stages, {}, ShaderDefines().set("SPOT_LIGHT", 0)) != 0);
+    CHECK(FakeDriver::compiles() == 4 && cache.misses() == 2 && cache.stores() == 2);
+
+    // a damaged file: a miss, compiled from source, stored again
+    std::string sources[2];
+    ShaderPreprocessor preprocessor;
+    CHECK(preprocessor.process(stages[0].second, ShaderDefines(), sources[0]));
+    CHECK(preprocessor.process(stages[1].second, ShaderDefines(), sources[1]));
+    std::vector<std::string> keySources = {sources[0], sources[1], std::to_string(GL_VERTEX_SHADER),
+                                           std::to_string(GL_FRAGMENT_SHADER)};
+    std::string file = cache.path(cache.makeKey(keySources.data(), keySources.size()));
+    std::vector<char> bytes = readBytes(file);
+    CHECK(bytes.size() == sizeof(ProgramBinaryCache::Header) + 64);
+    bytes.resize(bytes.size() / 2);
+    writeBytes(file, bytes);
+    CHECK(rg::buildProgram(stages) != 0);
+    CHECK(FakeDriver::compiles() == 6 && cache.stale() == 1 && cache.stores() == 3);
+    CHECK(readBytes(file).size() == sizeof(ProgramBinaryCache::Header) + 64);
+
+    // the driver refuses a binary the cache accepted: rejected, compiled from source into the same program
+    FakeDriver::refuseBinaries() = true;
+    CHECK(rg::buildProgram(stages) != 0);
+    CHECK(FakeDriver::binariesLoaded() == 2 && FakeDriver::refusedProgram() == 0);
+    CHECK(FakeDriver::compiles() == 8 && cache.rejected() == 1 && cache.stores() == 4);
+    FakeDriver::refuseBinaries() = false;
+    CHECK(rg::buildProgram(stages) != 0);
+    CHECK(FakeDriver::compiles() == 8 && FakeDriver::binariesLoaded() == 3 && cache.hits() == 2);
+
+    // no cache: always from source
+    rg::programBinaryCache() = nullptr;
+    CHECK(rg::buildProgram(stages) != 0);
+    CHECK(FakeDriver::compiles() == 10 && FakeDriver::binariesLoaded() == 3 && cache.stores() == 4);
+}
+
+static void removeDirectory(const std::string &directory) {
+    std::string command = "rm -rf '" + directory + "'";
+    if (std::system(command.c_str()) != 0) {
+        std::cout << "ERROR::TEST:: couldn't remove " << directory << std::endl;
+    }
+}
+
+int main() {
+    char pattern[] = "/tmp/rg_program_cache_XXXXXX";
+    if (!mkdtemp(pattern)) {
+        std::cout << "ERROR::TEST:: no temporary directory" << std::endl;
+        return 1;
+    }
+    std::string directory = pattern;
+    keys();
+    storeAndLoad(directory);
+    staleEntries(directory);
+    sourceFallback(directory);
+    removeDirectory(directory);
+    return checkResult();
+}
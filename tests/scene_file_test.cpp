@@ -0,0 +1,168 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// The scene format (include/rg/SceneFile.h) on the CPU: a small text scene is compiled in memory and
+// opened the way main opens the .rgscene, then damaged copies of it have to be refused, saying why.
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <rg/SceneFile.h>
+#include "Check.h"
+
+static const char* SCENE =
+        "texture sand textures/sand.jpg srgb nearest\n"
+        "texture wood textures/wood.png srgb\n"
+        "model rock objects/rock.obj\n"
+        "sky 0.2 0.5 0.4\n"
+        "point 0.7 0.7 0.7   1 0.08 0.032   3 0.5\n"
+        "object ground ground texture sand\n"
+        "object crate box texture wood texture wood translate 1 0 -2 scale 0.2\n"
+        "object lid box texture wood texture wood parent crate translate 0 1 0 rotate 30 0 1 0\n"
+        "object rock model model rock scale 0.5\n"
+        "group rocks rock\n"
+        "instance rocks translate 4 0 0\n"
+        "instance rocks translate -4 0 0 scale 2\n";
+
+static std::vector<char> compile(const std::string &text, std::string &error) {
+    std::vector<char> compiled;
+    if (!rg::compileScene(text, FileStamp(), compiled, error)) {
+        compiled.clear();
+    }
+    return compiled;
+}
+
+static void opensWhatWasWritten(const std::vector<char> &good) {
+    SceneDescription scene;
+    CHECK(scene.open(good));
+    CHECK(scene.error().empty());
+    CHECK(scene.textureCount() == 2 && scene.modelCount() == 1 && scene.objectCount() == 4 && scene.groupCount() == 1);
+    CHECK(SceneDescription::string(scene.texture(1).path, scene.texture(1).pathLength) == "textures/wood.png");
+    CHECK(scene.texture(0).flags == (SceneFile::TEXTURE_SRGB | SceneFile::TEXTURE_NEAREST));
+    CHECK(scene.lights().pointOrbit.x == 3.0f && scene.lights().pointOrbit.y == 0.5f);
+
+    // sorted by program, in the order written within one
+    CHECK(scene.objects(SceneFile::GROUND).size() == 1 && scene.objects(SceneFile::BOX).size() == 2);
+    const SceneFile::Object &lid = scene.object(2);
+    CHECK(SceneDescription::string(lid.name, lid.nameLength) == "lid");
+    CHECK(lid.parent.pointer == &scene.object(1));
+    CHECK(lid.textures[0].pointer == &scene.texture(1));
+    glm::vec4 lidOrigin = lid.world * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    CHECK(glm::length(glm::vec3(lidOrigin) - glm::vec3(1.0f, 0.2f, -2.0f)) < 1e-5f);
+    CHECK(scene.object(3).model.pointer == &scene.model(0));
+
+    const SceneFile::Group &rocks = scene.group(0);
+    CHECK(rocks.model.pointer == &scene.model(0) && rocks.instanceCount == 2);
+    CHECK(glm::vec3(rocks.instances.pointer[1][3]) == glm::vec3(-4.0f, 0.0f, 0.0f));
+}
+
+static void refusedText() {
+    const char* bad[] = {
+            "object ground ground\nobject ground ground\n",
+            "object lid box parent crate\nobject crate box\n",
+            "object crate box rotate 30 0 1 0 scale 1 2 3 rotate 30 1 0 0\n",
+            "group rocks stone\n",
+            "sky 0.2 0.5\n",
+    };
+    for (const char *text : bad) {
+        std::string error;
+        CHECK(compile(text, error).empty());
+        CHECK(error.find("line ") == 0);
+    }
+}
+
+template <typename T>
+static void put(std::vector<char> &bytes, size_t offset, T value) {
+    std::memcpy(&bytes[offset], &value, sizeof(value));
+}
+
+template <typename T>
+static T get(const std::vector<char> &bytes, size_t offset) {
+    T value;
+    std::memcpy(&value, &bytes[offset], sizeof(value));
+    return value;
+}
+
+// Opens a copy of good after damage() changed it and expects it refused with error in the reason.
+template <typename Damage>
+static void expectRefused(const std::vector<char> &good, const char *what, const std::string &error, Damage damage) {
+    std::vector<char> bytes = good;
+    damage(bytes);
+    SceneDescription scene;
+    bool opened = scene.open(std::move(bytes));
+    if (opened || scene.error().find(error) == std::string::npos) {
+        std::cout << "    " << what << ": " << (opened ? "opened" : scene.error()) << std::endl;
+    }
+    CHECK(!opened);
+    CHECK(scene.error().find(error) != std::string::npos);
+}
+
+static void damagedFiles(const std::vector<char> &good) {
+    using Header = SceneFile::Header;
+    using Object = SceneFile::Object;
+    const Header header = get<Header>(good, 0);
+    size_t texture = header.textureOffset, objects = header.objectOffset;
+    size_t lid = objects + 2 * sizeof(Object);
+
+    expectRefused(good, "empty", "too small", [](std::vector<char> &bytes) { bytes.clear(); });
+    expectRefused(good, "wrong magic", "not a compiled scene", [](std::vector<char> &bytes) { bytes[0] = 'X'; });
+    expectRefused(good, "wrong version", "format version 2, expected 1", [](std::vector<char> &bytes) {
+        put<uint32_t>(bytes, offsetof(Header, version), SceneFile::VERSION + 1);
+    });
+    expectRefused(good, "cut short", "does not match the header", [](std::vector<char> &bytes) { bytes.pop_back(); });
+    expectRefused(good, "moved section", "does not match the header", [](std::vector<char> &bytes) {
+        put<uint64_t>(bytes, offsetof(Header, objectOffset), get<uint64_t>(bytes, offsetof(Header, objectOffset)) + 8);
+    });
+
+    // string offsets: before the strings, past the end, and so far out that adding the length wraps
+    expectRefused(good, "path before the strings", "texture 0", [&](std::vector<char> &bytes) {
+        put<uint64_t>(bytes, texture + offsetof(SceneFile::Texture, path), header.objectOffset);
+    });
+    expectRefused(good, "path past the end", "texture 1", [&](std::vector<char> &bytes) {
+        put<uint64_t>(bytes, texture + sizeof(SceneFile::Texture) + offsetof(SceneFile::Texture, path), header.fileSize);
+    });
+    expectRefused(good, "path length wrapping", "model 0", [&](std::vector<char> &bytes) {
+        put<uint64_t>(bytes, header.modelOffset + offsetof(SceneFile::Model, path), (uint64_t)-4);
+        put<uint32_t>(bytes, header.modelOffset + offsetof(SceneFile::Model, pathLength), 8);
+    });
+    expectRefused(good, "name length past the end", "object 2", [&](std::vector<char> &bytes) {
+        put<uint32_t>(bytes, lid + offsetof(Object, nameLength), header.stringSize + 1);
+    });
+
+    // record offsets: inside a record, in another section, and a group running past its instances
+    expectRefused(good, "parent inside a record", "object 2", [&](std::vector<char> &bytes) {
+        put<uint64_t>(bytes, lid + offsetof(Object, parent), objects + sizeof(Object) + 8);
+    });
+    expectRefused(good, "texture in the objects", "object 1", [&](std::vector<char> &bytes) {
+        put<uint64_t>(bytes, objects + sizeof(Object) + offsetof(Object, textures), objects);
+    });
+    expectRefused(good, "unknown program", "object 0", [&](std::vector<char> &bytes) {
+        put<uint32_t>(bytes, objects + offsetof(Object, program), SceneFile::PROGRAM_COUNT);
+    });
+    expectRefused(good, "too many instances", "group 0", [&](std::vector<char> &bytes) {
+        put<uint32_t>(bytes, header.groupOffset + offsetof(SceneFile::Group, instanceCount), header.instanceCount + 1);
+    });
+
+    // parents: an object its own parent, and two that are each other's
+    expectRefused(good, "own parent", "object 1 is its own ancestor", [&](std::vector<char> &bytes) {
+        put<uint64_t>(bytes, objects + sizeof(Object) + offsetof(Object, parent), objects + sizeof(Object));
+    });
+    expectRefused(good, "parent loop", "its own ancestor", [&](std::vector<char> &bytes) {
+        put<uint64_t>(bytes, objects + sizeof(Object) + offsetof(Object, parent), lid);
+    });
+}
+
+int main() {
+    std::string error;
+    std::vector<char> good = compile(SCENE, error);
+    if (good.empty()) {
+        std::cout << "ERROR::TEST:: the test scene doesn't compile: " << error << std::endl;
+        return 1;
+    }
+    opensWhatWasWritten(good);
+    refusedText();
+    damagedFiles(good);
+    return checkResult();
+}
@@ -0,0 +1,263 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// include/rg/ShaderPreprocessor.h without a GL context: files come from a map in memory, except for the
+// SPOT_LIGHT permutations, which are made from the shader in resources/shaders like main makes them.
+
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <learnopengl/filesystem.h>
+#include <rg/ShaderPreprocessor.h>
+#include "Check.h"
+
+using Files = std::map<std::string, std::string>;
+
+static ShaderPreprocessor memoryPreprocessor(const Files &files) {
+    return ShaderPreprocessor([&files](const std::string &path, std::string &contents) {
+        auto it = files.find(path);
+        if (it == files.end()) {
+            return false;
+        }
+        contents = it->second;
+        return true;
+    });
+}
+
+static std::vector<std::string> lines(const std::string &text) {
+    std::vector<std::string> result;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        result.push_back(line);
+    }
+    return result;
+}
+
+static size_t occurrences(const std::string &text, const std::string &part) {
+    size_t count = 0;
+    for (size_t at = text.find(part); at != std::string::npos; at = text.find(part, at + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+// Follows the #line directives through output the way a GLSL compiler counts, and checks that every other
+// line is the line of files() it claims to be. Defines and pasted-once blanks belong to no file line.
+static bool linesMapBack(const std::string &output, const ShaderPreprocessor &preprocessor, const Files &files) {
+    size_t file = 0;
+    int line = 1;
+    bool mapped = true;
+    for (const std::string &text : lines(output)) {
+        int nextLine = 0;
+        unsigned nextFile = 0;
+        if (sscanf(text.c_str(), "#line %d %u", &nextLine, &nextFile) == 2) {
+            line = nextLine;
+            file = nextFile;
+            continue;
+        }
+        if (text.compare(0, 8, "#define ") != 0 && !text.empty()) {
+            std::vector<std::string> source = lines(files.at(preprocessor.files().at(file)));
+            if (line < 1 || line > (int)source.size() || source[line - 1] != text) {
+                std::cout << "    " << preprocessor.files().at(file) << ":" << line << " is not \"" << text << "\"" << std::endl;
+                mapped = false;
+            }
+        }
+        ++line;
+    }
+    return mapped;
+}
+
+static void nestedIncludes() {
+    Files files = {
+            {"shaders/main.fs",          "#version 330 core\n#include \"common/lighting.glsl\"\nvoid main() {}\n"},
+            {"shaders/common/lighting.glsl", "#include \"frame_data.glsl\"\nvec3 light() { return sun; }\n"},
+            {"shaders/common/frame_data.glsl", "uniform vec3 sun;\n"},
+    };
+    ShaderPreprocessor preprocessor = memoryPreprocessor(files);
+    std::string output;
+    CHECK(preprocessor.process("shaders/main.fs", ShaderDefines(), output));
+    CHECK(preprocessor.error().empty());
+    // paths relative to the including file
+    CHECK(preprocessor.files() == std::vector<std::string>({"shaders/main.fs", "shaders/common/lighting.glsl",
+                                                            "shaders/common/frame_data.glsl"}));
+    CHECK(output == "#version 330 core\n"
+                    "#line 1 1\n"
+                    "#line 1 2\n"
+                    "uniform vec3 sun;\n"
+                    "#line 2 1\n"
+                    "vec3 light() { return sun; }\n"
+                    "#line 3 0\n"
+                    "void main() {}\n");
+    CHECK(occurrences(output, "#include") == 0);
+    CHECK(linesMapBack(output, preprocessor, files));
+}
+
+static void includeCycles() {
+    Files files = {
+            {"a.glsl", "#version 330 core\n#include \"b.glsl\"\nfloat a;\n"},
+            {"b.glsl", "#include \"c.glsl\"\nfloat b;\n"},
+            {"c.glsl", "#include \"a.glsl\"\n#include \"b.glsl\"\nfloat c;\n"},
+    };
+    ShaderPreprocessor preprocessor = memoryPreprocessor(files);
+    std::string output;
+    CHECK(preprocessor.process("a.glsl", ShaderDefines(), output));
+    CHECK(preprocessor.files().size() == 3);
+    CHECK(occurrences(output, "float a;") == 1);
+    CHECK(occurrences(output, "float b;") == 1);
+    CHECK(occurrences(output, "float c;") == 1);
+    CHECK(linesMapBack(output, preprocessor, files));
+
+    // a file that includes itself
+    Files self = {{"self.glsl", "#include \"self.glsl\"\nfloat self;\n"}};
+    ShaderPreprocessor selfPreprocessor = memoryPreprocessor(self);
+    CHECK(selfPreprocessor.process("self.glsl", ShaderDefines(), output));
+    CHECK(output == "\nfloat self;\n");
+
+    // a second #include of the same file keeps the line count
+    Files twice = {{"main.fs", "#include \"x.glsl\"\n#include \"x.glsl\"\nvoid main() {}\n"}, {"x.glsl", "float x;\n"}};
+    ShaderPreprocessor twicePreprocessor = memoryPreprocessor(twice);
+    CHECK(twicePreprocessor.process("main.fs", ShaderDefines(), output));
+    CHECK(occurrences(output, "float x;") == 1);
+    CHECK(linesMapBack(output, twicePreprocessor, twice));
+}
+
+static void missingFiles() {
+    Files files = {
+            {"main.fs", "#version 330 core\n#include \"present.glsl\"\nvoid main() {}\n"},
+            {"present.glsl", "#include \"absent.glsl\"\n"},
+            {"malformed.fs", "#version 330 core\n#include absent.glsl\n"},
+            {"empty.fs", "#include \"\"\n"},
+    };
+    ShaderPreprocessor preprocessor = memoryPreprocessor(files);
+    std::string output;
+    CHECK(!preprocessor.process("nowhere.fs", ShaderDefines(), output));
+    CHECK(preprocessor.error() == "cannot read nowhere.fs");
+
+    CHECK(!preprocessor.process("main.fs", ShaderDefines(), output));
+    CHECK(preprocessor.error() == "cannot read absent.glsl");
+
+    CHECK(!preprocessor.process("malformed.fs", ShaderDefines(), output));
+    CHECK(preprocessor.error() == "malformed.fs:2: malformed #include");
+    CHECK(!preprocessor.process("empty.fs", ShaderDefines(), output));
+    CHECK(preprocessor.error() == "empty.fs:1: malformed #include");
+
+    // the error of one run doesn't stay for the next
+    CHECK(memoryPreprocessor(files).process("present.glsl", ShaderDefines(), output) == false);
+    CHECK(preprocessor.process("main.fs", ShaderDefines(), output) == false);
+    files["absent.glsl"] = "float found;\n";
+    CHECK(preprocessor.process("main.fs", ShaderDefines(), output));
+    CHECK(preprocessor.error().empty());
+}
+
+static void definesAfterVersion() {
+    Files files = {
+            {"main.fs",      "// comment\n#version 330 core\nout vec4 color;\n"},
+            {"noversion.fs", "out vec4 color;\n"},
+            {"included.fs",  "#version 330 core\n#include \"version.glsl\"\n"},
+            {"version.glsl", "#version 330 core\n"},
+    };
+    ShaderPreprocessor preprocessor = memoryPreprocessor(files);
+    ShaderDefines defines;
+    defines.set("SPOT_LIGHT", 1).set("BLUR", "2.5");
+    std::string output;
+    CHECK(preprocessor.process("main.fs", defines, output));
+    CHECK(output == "// comment\n"
+                    "#version 330 core\n"
+                    "#define BLUR 2.5\n"
+                    "#define SPOT_LIGHT 1\n"
+                    "#line 3 0\n"
+                    "out vec4 color;\n");
+    CHECK(linesMapBack(output, preprocessor, files));
+
+    // nothing to keep first, the defines open the source
+    CHECK(preprocessor.process("noversion.fs", defines, output));
+    CHECK(output == "#define BLUR 2.5\n#define SPOT_LIGHT 1\n#line 1 0\nout vec4 color;\n");
+
+    // no defines, no #line either
+    CHECK(preprocessor.process("main.fs", ShaderDefines(), output));
+    CHECK(output == files["main.fs"]);
+
+    CHECK(!preprocessor.process("included.fs", defines, output));
+    CHECK(preprocessor.error() == "version.glsl:1: #version in an included file");
+}
+
+static void spotLightPermutations() {
+    ShaderDefines off, on;
+    off.set("SPOT_LIGHT", 0);
+    on.set("SPOT_LIGHT", 1);
+    CHECK(off.key() != on.key());
+    CHECK(on.key() == "SPOT_LIGHT=1;");
+
+    // the key doesn't depend on the order the defines were set in, a value set again replaces the old one
+    ShaderDefines ab, ba;
+    ab.set("A", 1).set("B", 2);
+    ba.set("B", 2).set("A", 0).set("A", 1);
+    CHECK(ab.key() == ba.key());
+    CHECK(ab.directives() == ba.directives());
+
+    ShaderPreprocessor preprocessor;
+    std::string sources[2];
+    for (int spotLight = 0; spotLight < 2; ++spotLight) {
+        CHECK(preprocessor.process(FileSystem::getPath("resources/shaders/rock.fs"),
+                                   ShaderDefines().set("SPOT_LIGHT", spotLight), sources[spotLight]));
+        CHECK(preprocessor.files().size() == 3);
+    }
+    CHECK(!sources[0].empty() && sources[0] != sources[1]);
+    // injected right after #version, ahead of the fallback lighting.glsl defines when nobody did
+    CHECK(sources[0].find("#version 330 core\n#define SPOT_LIGHT 0\n#line 2 0\n") == 0);
+    CHECK(sources[1].find("#version 330 core\n#define SPOT_LIGHT 1\n#line 2 0\n") == 0);
+    // the two differ in the define and nowhere else
+    std::string withoutDefine = sources[1];
+    withoutDefine.replace(withoutDefine.find("SPOT_LIGHT 1"), 12, "SPOT_LIGHT 0");
+    CHECK(withoutDefine == sources[0]);
+}
+
+static void lineMapping() {
+    Files files = {
+            {"main.fs", "#version 330 core\n"
+                        "in vec3 normal;\n"
+                        "  #  include \"lib.glsl\"\r\n"
+                        "\n"
+                        "void main() {\n"
+                        "    light();\n"
+                        "}"},
+            {"lib.glsl", "// first\n#include \"inner.glsl\"\nvoid light() {}\n"},
+            {"inner.glsl", "float inner;\nfloat inner2;\n"},
+    };
+    ShaderPreprocessor preprocessor = memoryPreprocessor(files);
+    std::string output;
+    CHECK(preprocessor.process("main.fs", ShaderDefines().set("SPOT_LIGHT", 1), output));
+    CHECK(output == "#version 330 core\n"
+                    "#define SPOT_LIGHT 1\n"
+                    "#line 2 0\n"
+                    "in vec3 normal;\n"
+                    "#line 1 1\n"
+                    "// first\n"
+                    "#line 1 2\n"
+                    "float inner;\n"
+                    "float inner2;\n"
+                    "#line 3 1\n"
+                    "void light() {}\n"
+                    "#line 4 0\n"
+                    "\n"
+                    "void main() {\n"
+                    "    light();\n"
+                    "}\n");
+    CHECK(linesMapBack(output, preprocessor, files));
+    // the source string number of a driver message is the index into files()
+    CHECK(preprocessor.files().at(2) == "inner.glsl");
+}
+
+int main() {
+    nestedIncludes();
+    includeCycles();
+    missingFiles();
+    definesAfterVersion();
+    spotLightPermutations();
+    lineMapping();
+    return checkResult();
+}
@@ -0,0 +1,257 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// The block compressor (include/rg/BlockCompression.h) and the baked texture container
+// (include/rg/TextureFile.h) on the CPU: generated images go through the baker's steps, mip chain,
+// encode, writeTextureFile, then back through MappedFile and TextureFileView and are decoded. Every level
+// of every format has to come back within its PSNR threshold. Damaged files have to be refused.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <rg/MipChain.h>
+#include <rg/TextureFile.h>
+#include "Check.h"
+
+struct FormatCase {
+    uint32_t format;
+    const char* name;
+    double minPsnr;
+};
+
+// A dB or two under the worst level the encoder makes of generateImage, and all above the 28 dB
+// rg_texture_bake accepts by default
+static const FormatCase FORMATS[] = {
+        {BLOCK_BC1, "BC1", 30.0},
+        {BLOCK_BC3, "BC3", 30.0},
+        {BLOCK_BC4, "BC4", 36.0},
+        {BLOCK_BC5, "BC5", 36.0},
+};
+
+// Like the scene's textures: brightness that varies smoothly, with waves at a few scales, in one tint,
+// and the channels moving mostly together; a soft edge in alpha. Not noise, which no texture looks like
+// and which block compression is worst at.
+static std::vector<uint8_t> generateImage(unsigned width, unsigned height, unsigned seed) {
+    std::vector<uint8_t> rgba((size_t)width * height * 4);
+    for (unsigned y = 0; y < height; ++y) {
+        for (unsigned x = 0; x < width; ++x) {
+            float u = (x + 0.5f) / width, v = (y + 0.5f) / height;
+            float brightness = 90.0f + 70.0f * u + 30.0f * std::sin((u * 3.0f + v * 2.0f + seed) * 3.14159f) +
+                               10.0f * std::sin((u * 37.0f - v * 29.0f) * 3.14159f);
+            float tint = 12.0f * std::sin((v * 5.0f + seed) * 3.14159f);
+            uint8_t* pixel = &rgba[((size_t)y * width + x) * 4];
+            pixel[0] = (uint8_t)std::lround(std::min(255.0f, brightness * 1.1f + tint));
+            pixel[1] = (uint8_t)std::lround(brightness * 0.9f);
+            pixel[2] = (uint8_t)std::lround(brightness * 0.6f - tint);
+            pixel[3] = (uint8_t)std::lround(255.0f / (1.0f + std::exp((u - 0.5f) * 12.0f)));
+        }
+    }
+    return rgba;
+}
+
+static std::vector<char> readBytes(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// encode -> writeTextureFile -> TextureFileView -> decode, for every level
+static void roundTrip(const std::string &directory, const FormatCase &format, unsigned width, unsigned height,
+                      bool flipped) {
+    std::vector<uint8_t> image = generateImage(width, height, format.format);
+    MipChain chain;
+    rg::buildMipChain(image.data(), width, height, 4, false, chain);
+
+    BakedTexture texture;
+    texture.format = format.format;
+    texture.sourceChannels = 4;
+    texture.flipped = flipped;
+    for (size_t i = 0; i < chain.levels.size(); ++i) {
+        unsigned w = chain.levels[i].width, h = chain.levels[i].height;
+        std::vector<uint8_t> blocks(rg::compressedSize(format.format, w, h));
+        rg::compressImage(format.format, chain.level(i), w, h, blocks.data());
+        texture.widths.push_back(w);
+        texture.heights.push_back(h);
+        texture.levels.push_back(std::move(blocks));
+    }
+    FileStamp stamp;
+    stamp.size = 12345;
+    stamp.modified = 67890;
+    std::string path = directory + "/" + format.name + "_" + std::to_string(width) + "x" + std::to_string(height) +
+                       TextureFile::EXTENSION;
+    CHECK(writeTextureFile(path, texture, stamp));
+
+    MappedFile file;
+    TextureFileView view;
+    CHECK(file.open(path));
+    if (!view.open(file.data(), file.size())) {
+        std::cout << "    " << path << ": " << view.error() << std::endl;
+        CHECK(false);
+        return;
+    }
+    CHECK(view.header().format == format.format);
+    CHECK(view.header().width == width && view.header().height == height);
+    CHECK(view.header().sourceChannels == 4);
+    CHECK(view.flipped() == flipped);
+    CHECK(view.source().size == 12345 && view.source().modified == 67890);
+    CHECK(view.levelCount() == chain.levels.size());
+    for (uint32_t i = 0; i < view.levelCount() && i < chain.levels.size(); ++i) {
+        unsigned w = chain.levels[i].width, h = chain.levels[i].height;
+        CHECK(view.level(i).width == w && view.level(i).height == h);
+        CHECK(view.level(i).offset % 16 == 0);
+        CHECK(std::memcmp(view.levelData(i), texture.levels[i].data(), texture.levels[i].size()) == 0);
+
+        std::vector<uint8_t> decoded(chain.levels[i].size);
+        rg::decompressImage(format.format, view.levelData(i), w, h, decoded.data());
+        double psnr = rg::psnr(chain.level(i), decoded.data(), (size_t)w * h, rg::blockChannels(format.format));
+        if (psnr < format.minPsnr) {
+            std::cout << "    " << format.name << " " << width << "x" << height << " level " << i << " (" << w << "x"
+                      << h << "): " << psnr << " dB, below " << format.minPsnr << " dB" << std::endl;
+        }
+        CHECK(psnr >= format.minPsnr);
+    }
+    file.close();
+    std::remove(path.c_str());
+}
+
+// A one-color block has to come back exactly in the channels the format keeps; the rest reads 0, or 255
+// for alpha, like the GL decoders.
+static void flatBlocks() {
+    const uint8_t colors[][4] = {{0, 0, 0, 0}, {255, 255, 255, 255}, {255, 0, 0, 255}, {0, 255, 0, 128}, {8, 4, 132, 255}};
+    for (const FormatCase &format : FORMATS) {
+        for (const uint8_t* color : colors) {
+            uint8_t rgba[64], block[16], decoded[64];
+            for (int p = 0; p < 16; ++p) {
+                std::memcpy(rgba + p * 4, color, 4);
+            }
+            rg::encodeBlock(format.format, rgba, block);
+            rg::decodeBlock(format.format, block, decoded);
+            // BC1 can only land on 5:6:5 colors, 8, 4, 132 is one
+            CHECK(rg::psnr(rgba, decoded, 16, rg::blockChannels(format.format)) == 99.0);
+        }
+    }
+}
+
+// Flipping a compressed level has to give what decoding and flipping the rows gives.
+static void flippedLevels() {
+    for (const FormatCase &format : FORMATS) {
+        for (unsigned height : {1u, 2u, 3u, 4u, 8u, 12u, 6u}) {
+            unsigned width = 12;
+            std::vector<uint8_t> image = generateImage(width, height, 7);
+            std::vector<uint8_t> blocks(rg::compressedSize(format.format, width, height)), flipped(blocks.size());
+            rg::compressImage(format.format, image.data(), width, height, blocks.data());
+            bool possible = rg::flipCompressedLevel(format.format, blocks.data(), width, height, flipped.data());
+            CHECK(possible == (height <= 4 || height % 4 == 0));
+            if (!possible) {
+                continue;
+            }
+            std::vector<uint8_t> decoded(image.size()), decodedFlipped(image.size());
+            rg::decompressImage(format.format, blocks.data(), width, height, decoded.data());
+            rg::decompressImage(format.format, flipped.data(), width, height, decodedFlipped.data());
+            size_t row = (size_t)width * 4;
+            for (unsigned y = 0; y < height; ++y) {
+                CHECK(std::memcmp(&decoded[y * row], &decodedFlipped[(height - 1 - y) * row], row) == 0);
+            }
+        }
+    }
+}
+
+// Writes bytes after damage() changed them and expects TextureFileView to refuse them, saying why.
+template <typename Damage>
+static void expectRefused(const std::vector<char> &good, const char *what, const std::string &error, Damage damage) {
+    std::vector<char> bytes = good;
+    damage(bytes);
+    TextureFileView view;
+    bool opened = view.open(bytes.data(), bytes.size());
+    if (opened || view.error().find(error) == std::string::npos) {
+        std::cout << "    " << what << ": " << (opened ? "opened" : view.error()) << std::endl;
+    }
+    CHECK(!opened);
+    CHECK(view.error().find(error) != std::string::npos);
+}
+
+static void damagedFiles(const std::string &directory) {
+    using Header = TextureFile::Header;
+    unsigned width = 32, height = 16;
+    std::vector<uint8_t> image = generateImage(width, height, 3);
+    MipChain chain;
+    rg::buildMipChain(image.data(), width, height, 4, false, chain);
+    BakedTexture texture;
+    texture.format = BLOCK_BC3;
+    for (size_t i = 0; i < chain.levels.size(); ++i) {
+        unsigned w = chain.levels[i].width, h = chain.levels[i].height;
+        texture.widths.push_back(w);
+        texture.heights.push_back(h);
+        texture.levels.push_back(std::vector<uint8_t>(rg::compressedSize(BLOCK_BC3, w, h)));
+        rg::compressImage(BLOCK_BC3, chain.level(i), w, h, texture.levels.back().data());
+    }
+    std::string path = directory + "/damaged" + TextureFile::EXTENSION;
+    CHECK(writeTextureFile(path, texture, FileStamp()));
+    const std::vector<char> good = readBytes(path);
+    std::remove(path.c_str());
+    TextureFileView view;
+    CHECK(view.open(good.data(), good.size()) && view.levelCount() == 6);
+
+    size_t table = sizeof(Header) + 6 * sizeof(TextureFile::Level);
+    expectRefused(good, "empty", "too small", [](std::vector<char> &bytes) { bytes.clear(); });
+    expectRefused(good, "cut in the header", "too small", [](std::vector<char> &bytes) { bytes.resize(sizeof(Header) - 1); });
+    expectRefused(good, "cut in the level table", "level table is truncated", [&](std::vector<char> &bytes) {
+        bytes.resize(table - 1);
+    });
+    expectRefused(good, "cut before the data", "lies outside the file", [&](std::vector<char> &bytes) {
+        bytes.resize(table);
+    });
+    expectRefused(good, "cut in the last level", "level 5", [](std::vector<char> &bytes) { bytes.pop_back(); });
+    expectRefused(good, "wrong magic", "not a baked texture", [](std::vector<char> &bytes) { bytes[3] = 'Y'; });
+    expectRefused(good, "wrong version", "format version 2, expected 1", [](std::vector<char> &bytes) {
+        uint32_t version = TextureFile::VERSION + 1;
+        std::memcpy(&bytes[offsetof(Header, version)], &version, sizeof(version));
+    });
+    expectRefused(good, "unknown format", "bad format", [](std::vector<char> &bytes) {
+        uint32_t format = 2;
+        std::memcpy(&bytes[offsetof(Header, format)], &format, sizeof(format));
+    });
+    expectRefused(good, "no levels", "level count", [](std::vector<char> &bytes) {
+        uint32_t count = 0;
+        std::memcpy(&bytes[offsetof(Header, levelCount)], &count, sizeof(count));
+    });
+    expectRefused(good, "too many levels", "level count", [](std::vector<char> &bytes) {
+        uint32_t count = TextureFile::MAX_LEVELS + 1;
+        std::memcpy(&bytes[offsetof(Header, levelCount)], &count, sizeof(count));
+    });
+    // a header that says BC1 over BC3 data: every level is twice the size it should be
+    expectRefused(good, "format and sizes disagree", "level 0", [](std::vector<char> &bytes) {
+        uint32_t format = BLOCK_BC1;
+        std::memcpy(&bytes[offsetof(Header, format)], &format, sizeof(format));
+    });
+    expectRefused(good, "level past the end", "level 2", [](std::vector<char> &bytes) {
+        uint64_t offset = (uint64_t)-8;
+        std::memcpy(&bytes[sizeof(Header) + 2 * sizeof(TextureFile::Level) + offsetof(TextureFile::Level, offset)],
+                    &offset, sizeof(offset));
+    });
+}
+
+int main() {
+    char pattern[] = "/tmp/rg_texture_file_XXXXXX";
+    if (!mkdtemp(pattern)) {
+        std::cout << "ERROR::TEST:: no temporary directory" << std::endl;
+        return 1;
+    }
+    std::string directory = pattern;
+    for (const FormatCase &format : FORMATS) {
+        roundTrip(directory, format, 256, 128, false);
+        roundTrip(directory, format, 37, 23, true);
+        roundTrip(directory, format, 3, 1, false);
+    }
+    flatBlocks();
+    flippedLevels();
+    damagedFiles(directory);
+    rmdir(directory.c_str());
+    return checkResult();
+}
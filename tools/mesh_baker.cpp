@@ -0,0 +1,53 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// Offline step for the baked mesh format: imports any file Assimp can read, with the same post-processing
+// Model uses, and writes it as <model file>.rgmesh (or the given output) for Model to map at startup.
+//
+//   rg_mesh_bake <model file> [<output>]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <rg/MeshBaker.h>
+#include <rg/MappedFile.h>
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: " << argv[0] << " <model file> [<output>]" << std::endl;
+        return 1;
+    }
+    std::string input = argv[1];
+    std::string output = argc == 3 ? argv[2] : input + MeshFile::EXTENSION;
+
+    auto start = std::chrono::steady_clock::now();
+    FileStamp stamp;
+    if (!FileStamp::of(input, stamp)) {
+        std::cerr << "ERROR::MESH_BAKER:: cannot stat " << input << std::endl;
+        return 1;
+    }
+    BakedModel model;
+    std::string error;
+    if (!rg::bakeModelFile(input, model, error)) {
+        std::cerr << "ERROR::ASSIMP:: " << error << std::endl;
+        return 1;
+    }
+    if (!writeMeshFile(output, model, stamp)) {
+        std::cerr << "ERROR::MESH_BAKER:: cannot write " << output << std::endl;
+        return 1;
+    }
+
+    // read it back the way Model will, so a bad file never reaches the renderer
+    MappedFile file;
+    MeshFileView view;
+    if (!file.open(output) || !view.open(file.data(), file.size())) {
+        std::cerr << "ERROR::MESH_BAKER:: " << output << " does not validate: " << view.error() << std::endl;
+        return 1;
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << output << ": " << model.meshes.size() << " mesh(es), " << model.materials.size() << " material(s), "
+              << model.vertices.size() << " vertices, " << model.indices.size() / 3 << " triangles, "
+              << file.size() << " bytes, " << milliseconds << " ms" << std::endl;
+    return 0;
+}
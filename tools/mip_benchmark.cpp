@@ -0,0 +1,126 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// Throughput of the mip chain kernels in include/rg/MipChain.h. Builds the full chain of an image
+// (a generated 4096x4096 one, or the given file) with every kernel the CPU supports, for 1, 3 and 4
+// channels, plain and sRGB, and reports GB/s of source levels read. Every kernel's chain is compared
+// with the scalar one; any difference fails the run.
+//
+//   rg_mip_bench [--threads N] [<image>]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stb_image.h>
+#include <rg/MipChain.h>
+
+static std::vector<uint8_t> generateImage(unsigned width, unsigned height, unsigned channels) {
+    std::vector<uint8_t> image((size_t)width * height * channels);
+    uint32_t state = 12345;
+    for (unsigned y = 0; y < height; ++y) {
+        for (unsigned x = 0; x < width; ++x) {
+            for (unsigned c = 0; c < channels; ++c) {
+                state = state * 1664525u + 1013904223u;
+                // gradient plus noise, so neither the sums nor the sRGB tables see a single value
+                image[((size_t)y * width + x) * channels + c] = (uint8_t)((x + y * (c + 1)) / 32 + (state >> 26));
+            }
+        }
+    }
+    return image;
+}
+
+// bytes the chain reads: every level but the last is a source once
+static size_t bytesRead(const MipChain &chain) {
+    return chain.pixels.size() - chain.levels.back().size;
+}
+
+static double gigabytesPerSecond(const std::vector<uint8_t> &image, unsigned width, unsigned height, unsigned channels,
+                                 bool srgb, rg::MipKernel kernel, unsigned threads, MipChain &chain) {
+    using clock = std::chrono::steady_clock;
+    rg::buildMipChain(image.data(), width, height, channels, srgb, chain, threads, kernel);
+    unsigned runs = 0;
+    auto start = clock::now();
+    double seconds = 0;
+    while (seconds < 0.5 || runs < 3) {
+        rg::buildMipChain(image.data(), width, height, channels, srgb, chain, threads, kernel);
+        ++runs;
+        seconds = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    return (double)bytesRead(chain) * runs / seconds / 1e9;
+}
+
+int main(int argc, char** argv) {
+    unsigned threads = std::thread::hardware_concurrency();
+    std::string path;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--threads" && i + 1 < argc) {
+            threads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        } else if (!argument.empty() && argument[0] != '-' && path.empty()) {
+            path = argument;
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--threads N] [<image>]" << std::endl;
+            return 1;
+        }
+    }
+
+    unsigned width = 4096, height = 4096;
+    std::vector<uint8_t> sources[5];
+    if (!path.empty()) {
+        int w, h, n;
+        for (unsigned channels : {1u, 3u, 4u}) {
+            unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &n, (int)channels);
+            if (!pixels) {
+                std::cerr << "ERROR::MIP_BENCH:: cannot decode " << path << ": " << stbi_failure_reason() << std::endl;
+                return 1;
+            }
+            sources[channels].assign(pixels, pixels + (size_t)w * h * channels);
+            stbi_image_free(pixels);
+        }
+        width = (unsigned)w;
+        height = (unsigned)h;
+    } else {
+        for (unsigned channels : {1u, 3u, 4u}) {
+            sources[channels] = generateImage(width, height, channels);
+        }
+    }
+    std::cout << width << "x" << height << ", best kernel " << rg::mipKernelName(rg::bestMipKernel())
+              << ", " << threads << " thread(s) for the threaded run" << std::endl;
+
+    bool identical = true;
+    MipChain reference, chain;
+    for (unsigned channels : {1u, 3u, 4u}) {
+        for (bool srgb : {false, true}) {
+            if (srgb && channels < 3) {
+                continue;
+            }
+            const std::vector<uint8_t> &image = sources[channels];
+            rg::buildMipChain(image.data(), width, height, channels, srgb, reference, 1, rg::MIP_KERNEL_SCALAR);
+            std::cout << channels << " channel(s)" << (srgb ? ", sRGB" : "") << ":" << std::endl;
+            for (int k = 0; k < rg::MIP_KERNEL_COUNT; ++k) {
+                rg::MipKernel kernel = (rg::MipKernel)k;
+                if (!rg::mipKernelSupported(kernel)) {
+                    continue;
+                }
+                double rate = gigabytesPerSecond(image, width, height, channels, srgb, kernel, 1, chain);
+                bool same = chain.pixels == reference.pixels;
+                identical = identical && same;
+                std::cout << "    " << rg::mipKernelName(kernel) << ": " << rate << " GB/s" << (same ? "" : "  MISMATCH") << std::endl;
+            }
+            double rate = gigabytesPerSecond(image, width, height, channels, srgb, rg::bestMipKernel(), threads, chain);
+            bool same = chain.pixels == reference.pixels;
+            identical = identical && same;
+            std::cout << "    " << rg::mipKernelName(rg::bestMipKernel()) << " x" << threads << ": " << rate << " GB/s"
+                      << (same ? "" : "  MISMATCH") << std::endl;
+        }
+    }
+    if (!identical) {
+        std::cerr << "ERROR::MIP_BENCH:: kernels disagree with the scalar one" << std::endl;
+        return 1;
+    }
+    return 0;
+}
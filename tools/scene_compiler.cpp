@@ -0,0 +1,57 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// Offline step for the scene format: compiles a text scene (resources/scenes/*.scene) and writes it as
+// <scene file>.rgscene (or the given output) for main to read in one go at startup.
+//
+//   rg_scene_compile <scene file> [<output>]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <rg/SceneFile.h>
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: " << argv[0] << " <scene file> [<output>]" << std::endl;
+        return 1;
+    }
+    std::string input = argv[1];
+    std::string output = argc == 3 ? argv[2] : input + SceneFile::EXTENSION;
+
+    auto start = std::chrono::steady_clock::now();
+    FileStamp stamp;
+    std::vector<char> text;
+    if (!FileStamp::of(input, stamp) || !rg::readWholeFile(input, text)) {
+        std::cerr << "ERROR::SCENE_COMPILER:: cannot read " << input << std::endl;
+        return 1;
+    }
+    std::vector<char> compiled;
+    std::string error;
+    if (!rg::compileScene(std::string(text.begin(), text.end()), stamp, compiled, error)) {
+        std::cerr << "ERROR::SCENE_COMPILER:: " << input << ": " << error << std::endl;
+        return 1;
+    }
+    if (!rg::writeSceneFile(output, compiled)) {
+        std::cerr << "ERROR::SCENE_COMPILER:: cannot write " << output << std::endl;
+        return 1;
+    }
+
+    // read it back the way main will, so a bad file never reaches the renderer
+    SceneDescription scene;
+    std::vector<char> bytes;
+    if (!rg::readWholeFile(output, bytes) || !scene.open(std::move(bytes))) {
+        std::cerr << "ERROR::SCENE_COMPILER:: " << output << " does not validate: " << scene.error() << std::endl;
+        return 1;
+    }
+    uint32_t instances = 0;
+    for (uint32_t i = 0; i < scene.groupCount(); ++i) {
+        instances += scene.group(i).instanceCount + scene.group(i).ringCount;
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << output << ": " << scene.objectCount() << " object(s), " << scene.groupCount() << " instancing group(s) of "
+              << instances << " instance(s), " << scene.modelCount() << " model(s), " << scene.textureCount()
+              << " texture(s), " << scene.size() << " bytes, " << milliseconds << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,137 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// Offline step for the baked texture format: decodes an image, builds its mip chain, block compresses
+// every level and writes <image>.rgtex (or the given output) for Texture2D and TextureFromFile to upload
+// with glCompressedTexImage2D. Every level is decoded again and compared with its source; below the
+// PSNR threshold nothing is written.
+//
+//   rg_texture_bake [--format bc1|bc3|bc4|bc5] [--flip] [--srgb] [--min-psnr dB] <image> [<output>]
+//
+// Without --format: 1 channel images become BC4, images with any alpha below 255 BC3, the rest BC1.
+// --flip stores rows bottom up, as the scene loads every texture after the first one. --srgb filters
+// the mips in linear light, for textures sampled through an sRGB format.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+#include <rg/MipChain.h>
+#include <rg/TextureFile.h>
+
+static bool parseFormat(const std::string &name, uint32_t &format) {
+    if (name == "bc1") format = BLOCK_BC1;
+    else if (name == "bc3") format = BLOCK_BC3;
+    else if (name == "bc4") format = BLOCK_BC4;
+    else if (name == "bc5") format = BLOCK_BC5;
+    else return false;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t format = 0;
+    bool flip = false;
+    bool srgb = false;
+    double minPsnr = 28.0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--format" && i + 1 < argc && parseFormat(argv[i + 1], format)) {
+            ++i;
+        } else if (argument == "--flip") {
+            flip = true;
+        } else if (argument == "--srgb") {
+            srgb = true;
+        } else if (argument == "--min-psnr" && i + 1 < argc) {
+            minPsnr = std::atof(argv[++i]);
+        } else if (!argument.empty() && argument[0] != '-') {
+            paths.push_back(argument);
+        } else {
+            paths.clear();
+            break;
+        }
+    }
+    if (paths.empty() || paths.size() > 2) {
+        std::cerr << "usage: " << argv[0] << " [--format bc1|bc3|bc4|bc5] [--flip] [--srgb] [--min-psnr dB] <image> [<output>]" << std::endl;
+        return 1;
+    }
+    std::string input = paths[0];
+    std::string output = paths.size() == 2 ? paths[1] : input + TextureFile::EXTENSION;
+
+    auto start = std::chrono::steady_clock::now();
+    FileStamp stamp;
+    if (!FileStamp::of(input, stamp)) {
+        std::cerr << "ERROR::TEXTURE_BAKER:: cannot stat " << input << std::endl;
+        return 1;
+    }
+    stbi_set_flip_vertically_on_load(flip);
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(input.c_str(), &width, &height, &channels, 4);
+    if (!pixels) {
+        std::cerr << "ERROR::TEXTURE_BAKER:: cannot decode " << input << ": " << stbi_failure_reason() << std::endl;
+        return 1;
+    }
+    if (!format) {
+        bool opaque = true;
+        for (size_t p = 3; p < (size_t)width * height * 4; p += 4) {
+            opaque = opaque && pixels[p] == 255;
+        }
+        format = channels == 1 ? BLOCK_BC4 : opaque ? BLOCK_BC1 : BLOCK_BC3;
+    }
+    MipChain chain;
+    rg::buildMipChain(pixels, (unsigned)width, (unsigned)height, 4, srgb, chain, std::thread::hardware_concurrency());
+    stbi_image_free(pixels);
+
+    BakedTexture texture;
+    texture.format = format;
+    texture.sourceChannels = (uint32_t)channels;
+    texture.flipped = flip;
+    double topPsnr = 0, worstPsnr = 99.0;
+    std::vector<uint8_t> decoded;
+    for (size_t i = 0; i < chain.levels.size(); ++i) {
+        unsigned w = chain.levels[i].width, h = chain.levels[i].height;
+        std::vector<uint8_t> blocks(rg::compressedSize(format, w, h));
+        rg::compressImage(format, chain.level(i), w, h, blocks.data());
+
+        decoded.resize(chain.levels[i].size);
+        rg::decompressImage(format, blocks.data(), w, h, decoded.data());
+        double psnr = rg::psnr(chain.level(i), decoded.data(), (size_t)w * h, rg::blockChannels(format));
+        topPsnr = i == 0 ? psnr : topPsnr;
+        worstPsnr = std::min(worstPsnr, psnr);
+
+        texture.widths.push_back(w);
+        texture.heights.push_back(h);
+        texture.levels.push_back(std::move(blocks));
+    }
+
+    if (topPsnr < minPsnr) {
+        std::cerr << "ERROR::TEXTURE_BAKER:: " << input << ": BC" << format << " PSNR " << topPsnr
+                  << " dB is below " << minPsnr << " dB, nothing written (try another --format)" << std::endl;
+        return 1;
+    }
+    if (!writeTextureFile(output, texture, stamp)) {
+        std::cerr << "ERROR::TEXTURE_BAKER:: cannot write " << output << std::endl;
+        return 1;
+    }
+
+    // read it back the way the renderer will and compare with what was encoded
+    MappedFile file;
+    TextureFileView view;
+    bool valid = file.open(output) && view.open(file.data(), file.size()) && view.levelCount() == texture.levels.size();
+    for (uint32_t i = 0; valid && i < view.levelCount(); ++i) {
+        valid = std::memcmp(view.levelData(i), texture.levels[i].data(), texture.levels[i].size()) == 0;
+    }
+    if (!valid) {
+        std::cerr << "ERROR::TEXTURE_BAKER:: " << output << " does not read back: " << view.error() << std::endl;
+        return 1;
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << output << ": " << width << "x" << height << " BC" << format << ", " << texture.levels.size()
+              << " level(s), " << file.size() << " bytes (" << (size_t)width * height * channels << " uncompressed), PSNR "
+              << topPsnr << " dB (worst level " << worstPsnr << " dB), " << milliseconds << " ms" << std::endl;
+    return 0;
+}
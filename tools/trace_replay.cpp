@@ -0,0 +1,147 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// Frame statistics, frame budgets and replay of a GL trace written by project_base --trace (include/rg/GlTrace.h).
+// Prints how many calls of each type the frames made. --max-draws and --max-uniforms fail the run when
+// frame N (--frame N), or any frame after the first, makes more draw calls or glUniform* calls than
+// that; with a trace recorded under --mock-gl this checks the renderer on a machine without a GPU.
+// --replay plays the trace back in a headless context (a build with -DRG_HEADLESS=ON) and reports the
+// time the driver took per frame.
+//
+//   rg_trace_replay [--frame N] [--max-draws K] [--max-uniforms M] [--replay] <trace>
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <rg/GlTraceReplay.h>
+#include <rg/HeadlessContext.h>
+
+static void printFrame(const char *label, const GlTraceStats &frame) {
+    std::cout << label << frame.calls << " calls:";
+    for (int type = 0; type < GlCall::TYPES; ++type) {
+        std::cout << " " << frame.types[type] << " " << GlCall::typeName((GlCall::Type)type);
+    }
+    std::cout << ", " << frame.uploadBytes << " upload bytes" << std::endl;
+}
+
+// a frame whose counts are the largest any frame after the first had
+static GlTraceStats steadyMaximum(const std::vector<GlTraceStats> &frames) {
+    GlTraceStats maximum;
+    for (size_t i = 1; i < frames.size(); ++i) {
+        maximum.calls = std::max(maximum.calls, frames[i].calls);
+        for (int type = 0; type < GlCall::TYPES; ++type) {
+            maximum.types[type] = std::max(maximum.types[type], frames[i].types[type]);
+        }
+        maximum.uploadBytes = std::max(maximum.uploadBytes, frames[i].uploadBytes);
+    }
+    return maximum;
+}
+
+static bool withinBudget(const std::vector<GlTraceStats> &frames, long onlyFrame, long maxDraws, long maxUniforms) {
+    bool within = true;
+    for (size_t i = onlyFrame >= 0 ? (size_t)onlyFrame : 1; i < frames.size(); ++i) {
+        if (maxDraws >= 0 && frames[i].draws() > (unsigned long)maxDraws) {
+            std::cout << "ERROR::TRACE::BUDGET frame " << i << " made " << frames[i].draws() << " draw calls, at most "
+                      << maxDraws << " allowed" << std::endl;
+            within = false;
+        }
+        if (maxUniforms >= 0 && frames[i].uniforms() > (unsigned long)maxUniforms) {
+            std::cout << "ERROR::TRACE::BUDGET frame " << i << " made " << frames[i].uniforms()
+                      << " uniform uploads, at most " << maxUniforms << " allowed" << std::endl;
+            within = false;
+        }
+        if (onlyFrame >= 0) {
+            break;
+        }
+    }
+    return within;
+}
+
+static int replay(const GlTraceFile &file) {
+    HeadlessContext context;
+    if (!context.create() || !gladLoadGLLoader((GLADloadproc) HeadlessContext::loadFunction)) {
+        return 1;
+    }
+    using clock = std::chrono::steady_clock;
+    GlTraceReplay replay(file);
+    std::vector<double> times;
+    bool more = true;
+    while (more) {
+        auto start = clock::now();
+        more = replay.replayFrame();
+        glFinish();
+        if (more) {
+            times.push_back(std::chrono::duration<double>(clock::now() - start).count());
+        }
+    }
+    std::cout << "replayed " << replay.calls() << " calls on " << glGetString(GL_RENDERER) << std::endl;
+    if (times.empty()) {
+        return 0;
+    }
+    std::cout << "frame 0 (loading included): " << times[0] * 1000.0 << " ms" << std::endl;
+    if (times.size() > 1) {
+        double total = 0.0, shortest = times[1], longest = times[1];
+        for (size_t i = 1; i < times.size(); ++i) {
+            total += times[i];
+            shortest = std::min(shortest, times[i]);
+            longest = std::max(longest, times[i]);
+        }
+        std::cout << "frames 1-" << times.size() - 1 << ": avg " << total / (times.size() - 1) * 1000.0 << " ms, min "
+                  << shortest * 1000.0 << " ms, max " << longest * 1000.0 << " ms" << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::string path;
+    long frame = -1, maxDraws = -1, maxUniforms = -1;
+    bool replayTrace = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--frame" && i + 1 < argc) {
+            frame = std::atol(argv[++i]);
+        } else if (argument == "--max-draws" && i + 1 < argc) {
+            maxDraws = std::atol(argv[++i]);
+        } else if (argument == "--max-uniforms" && i + 1 < argc) {
+            maxUniforms = std::atol(argv[++i]);
+        } else if (argument == "--replay") {
+            replayTrace = true;
+        } else if (!argument.empty() && argument[0] != '-' && path.empty()) {
+            path = argument;
+        } else {
+            path.clear();
+            break;
+        }
+    }
+    if (path.empty()) {
+        std::cerr << "usage: " << argv[0] << " [--frame N] [--max-draws K] [--max-uniforms M] [--replay] <trace>" << std::endl;
+        return 1;
+    }
+
+    GlTraceFile file;
+    if (!file.open(path)) {
+        return 1;
+    }
+    std::vector<GlTraceStats> frames;
+    file.frameStats(frames);
+    std::cout << path << ": " << frames.size() << " frames" << std::endl;
+    if (frame >= (long)frames.size()) {
+        std::cout << "ERROR::TRACE::NO_FRAME " << frame << std::endl;
+        return 1;
+    }
+    if (frame >= 0) {
+        printFrame("frame: ", frames[frame]);
+    } else if (!frames.empty()) {
+        printFrame("frame 0: ", frames[0]);
+        printFrame("most of any later frame: ", steadyMaximum(frames));
+    }
+    if (!withinBudget(frames, frame, maxDraws, maxUniforms)) {
+        return 1;
+    }
+    return replayTrace ? replay(file) : 0;
+}
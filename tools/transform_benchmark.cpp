@@ -0,0 +1,180 @@
+//
+// Created by matf-rg on 17.10.26..
+//
+
+// Cost of keeping world matrices up to date with include/rg/TransformSystem.h. Builds a forest of
+// entities (100k by default, up to 8 deep) and, for every kernel the CPU supports, runs frames where a
+// fraction of them (1% by default) gets a new rotation and position and update() recomputes what that
+// changed, against frames where every world matrix is rebuilt. The rebuild the way main did it before,
+// glm::translate, rotate and scale for every object and the parent's matrix multiplied in, is timed too.
+// Every kernel's matrices are compared with a scalar rebuild; a difference fails the run.
+//
+//   rg_transform_bench [--entities N] [--changing PERCENT] [--frames N]
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <rg/TransformSystem.h>
+
+struct Forest {
+    std::vector<Entity> parents;
+    std::vector<glm::vec3> positions, axes, scales;
+    std::vector<float> angles;
+};
+
+static uint32_t next(uint32_t &state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// a root every 64 entities or so, the others under one of the 256 before them, no deeper than 8
+static Forest generateForest(size_t count) {
+    Forest forest;
+    std::vector<unsigned> depth;
+    uint32_t state = 12345;
+    for (size_t i = 0; i < count; ++i) {
+        Entity parent = NO_ENTITY;
+        if (i > 0 && next(state) % 64 != 0) {
+            parent = (Entity)(i - 1 - next(state) % std::min<size_t>(i, 256));
+            if (depth[parent] >= 8) {
+                parent = forest.parents[parent];
+            }
+        }
+        depth.push_back(parent == NO_ENTITY ? 1 : depth[parent] + 1);
+        forest.parents.push_back(parent);
+        forest.positions.push_back(glm::vec3(next(state) % 2000 / 100.0f - 10.0f, next(state) % 200 / 100.0f,
+                                             next(state) % 2000 / 100.0f - 10.0f));
+        forest.axes.push_back(glm::vec3(next(state) % 100 / 100.0f, 1.0f, next(state) % 100 / 100.0f));
+        forest.angles.push_back((float)(next(state) % 360));
+        forest.scales.push_back(glm::vec3(0.5f + next(state) % 100 / 100.0f));
+    }
+    return forest;
+}
+
+static void build(const Forest &forest, TransformSystem &transforms) {
+    transforms.reserve(forest.parents.size());
+    for (size_t i = 0; i < forest.parents.size(); ++i) {
+        Entity entity = transforms.create(forest.parents[i]);
+        transforms.setPosition(entity, forest.positions[i]);
+        transforms.setRotation(entity, forest.angles[i], forest.axes[i]);
+        transforms.setScale(entity, forest.scales[i]);
+    }
+}
+
+// the changing entities of frame; the same ones for every kernel
+static void change(const Forest &forest, TransformSystem &transforms, size_t changing, unsigned frame) {
+    uint32_t state = 777u + frame;
+    for (size_t i = 0; i < changing; ++i) {
+        Entity entity = (Entity)(next(state) % forest.parents.size());
+        transforms.setRotation(entity, forest.angles[entity] + frame, forest.axes[entity]);
+        transforms.setPosition(entity, forest.positions[entity] + glm::vec3(0.0f, 0.01f * (frame % 100), 0.0f));
+    }
+}
+
+static double milliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static float difference(const TransformSystem &a, const TransformSystem &b) {
+    float largest = 0.0f;
+    for (Entity entity = 0; entity < a.size(); ++entity) {
+        glm::mat4 x = a.world(entity), y = b.world(entity);
+        for (int column = 0; column < 4; ++column) {
+            for (int row = 0; row < 3; ++row) {
+                largest = std::max(largest, std::fabs(x[column][row] - y[column][row]) / std::max(1.0f, std::fabs(y[column][row])));
+            }
+        }
+    }
+    return largest;
+}
+
+int main(int argc, char** argv) {
+    size_t count = 100000;
+    double percent = 1.0;
+    unsigned frames = 300;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--entities" && i + 1 < argc) {
+            count = (size_t)std::max(1, std::atoi(argv[++i]));
+        } else if (argument == "--changing" && i + 1 < argc) {
+            percent = std::min(100.0, std::max(0.0, std::atof(argv[++i])));
+        } else if (argument == "--frames" && i + 1 < argc) {
+            frames = (unsigned)std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--entities N] [--changing PERCENT] [--frames N]" << std::endl;
+            return 1;
+        }
+    }
+    using clock = std::chrono::steady_clock;
+    Forest forest = generateForest(count);
+    size_t changing = (size_t)(count * percent / 100.0);
+    std::cout << count << " entities, " << changing << " changing a frame, " << frames << " frames, best kernel "
+              << rg::transformKernelName(rg::bestTransformKernel()) << std::endl;
+
+    // main's way: every matrix from scratch every frame, parents first
+    {
+        std::vector<glm::mat4> world(count);
+        auto start = clock::now();
+        for (unsigned frame = 0; frame < frames; ++frame) {
+            for (size_t i = 0; i < count; ++i) {
+                glm::mat4 model = forest.parents[i] == NO_ENTITY ? glm::mat4(1.0f) : world[forest.parents[i]];
+                model = glm::translate(model, forest.positions[i]);
+                model = glm::rotate(model, glm::radians(forest.angles[i] + frame), forest.axes[i]);
+                world[i] = glm::scale(model, forest.scales[i]);
+            }
+        }
+        std::cout << "    glm, everything: " << milliseconds(clock::now() - start) / frames << " ms a frame" << std::endl;
+    }
+
+    TransformSystem reference;
+    build(forest, reference);
+    reference.update(rg::TRANSFORM_KERNEL_SCALAR);
+    for (unsigned frame = 0; frame < frames; ++frame) {
+        change(forest, reference, changing, frame);
+    }
+    reference.invalidateAll();
+    reference.update(rg::TRANSFORM_KERNEL_SCALAR);
+
+    bool identical = true;
+    for (int k = 0; k < rg::TRANSFORM_KERNEL_COUNT; ++k) {
+        rg::TransformKernel kernel = (rg::TransformKernel)k;
+        if (!rg::transformKernelSupported(kernel)) {
+            continue;
+        }
+        TransformSystem transforms;
+        build(forest, transforms);
+        transforms.update(kernel);
+
+        auto start = clock::now();
+        for (unsigned frame = 0; frame < frames; ++frame) {
+            transforms.invalidateAll();
+            transforms.update(kernel);
+        }
+        double everything = milliseconds(clock::now() - start) / frames;
+
+        size_t recomputed = 0;
+        start = clock::now();
+        for (unsigned frame = 0; frame < frames; ++frame) {
+            change(forest, transforms, changing, frame);
+            recomputed += transforms.update(kernel);
+        }
+        double changed = milliseconds(clock::now() - start) / frames;
+
+        float largest = difference(transforms, reference);
+        bool same = largest <= 1e-5f;
+        identical = identical && same;
+        std::cout << "    " << rg::transformKernelName(kernel) << ": everything " << everything << " ms, changed "
+                  << changed << " ms a frame, " << recomputed / frames << " of " << count << " recomputed"
+                  << (same ? "" : "  MISMATCH") << std::endl;
+    }
+    if (!identical) {
+        std::cerr << "ERROR::TRANSFORM_BENCH:: kernels disagree with the scalar rebuild" << std::endl;
+        return 1;
+    }
+    return 0;
+}